@@ -0,0 +1,61 @@
+#include "bench_data.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include "market/synthetic_data.h"
+#include "net/order_client.h"
+#include "trader/trader.h"
+
+namespace bench {
+
+std::vector<StockData> makePriceSeries(size_t count, unsigned seed) {
+  SyntheticConfig config;
+  config.seed = seed;
+  config.ticksPerDay = 1;
+  return SyntheticMarket(config).generateDaily({kSymbol}, kStartDate, count);
+}
+
+std::string makeScratchDatabase(const std::vector<StockData>& data) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "trading_engine_bench.db";
+  // A leftover write-ahead log would be replayed into the new database
+  for (const char* suffix : {"", "-wal", "-shm"}) {
+    std::filesystem::remove(path.string() + suffix);
+  }
+  SyntheticMarket::writeToDatabase(data, path.string());
+  return path.string();
+}
+
+// Buys and sells alternate, so every session holds at most one share and
+// every order fills
+bool runOrderLoad(OrderClient& client, size_t orders, size_t window, size_t batch) {
+  size_t queued = 0;
+  auto lastAnswer = std::chrono::steady_clock::now();
+  while (queued < orders || client.unacknowledged() > 0 || client.unreported() > 0) {
+    size_t inFlight = client.unacknowledged() + client.unreported();
+    if (queued < orders && inFlight < window) {
+      size_t count = std::min({batch, window - inFlight, orders - queued});
+      for (size_t i = 0; i < count; ++i, ++queued) {
+        client.sendOrder(OrderType::Market, queued % 2 == 0, 100.0);
+      }
+      if (!client.flush()) {
+        return false;
+      }
+    }
+
+    int handled = client.poll(inFlight >= window || queued == orders ? 1 : 0);
+    if (handled < 0) {
+      return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (handled > 0) {
+      lastAnswer = now;
+    } else if (now - lastAnswer > std::chrono::seconds(1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace bench
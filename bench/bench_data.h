@@ -0,0 +1,56 @@
+/**
+ * @file bench_data.h
+ * @brief Shared fixtures for the benchmark suite
+ *
+ * Provides reproducible price series from the synthetic market generator and
+ * a scratch SQLite database laid out like the one written by
+ * get_stock_data.py, so benchmarks run offline.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "market/stock_data.h"
+
+class OrderClient;
+
+namespace bench {
+
+constexpr const char* kSymbol = "BENCH";       ///< Symbol used by every fixture
+constexpr const char* kStartDate = "1700-01-04";  ///< First date; early enough that 100k weekdays stay in timestamp range
+constexpr const char* kEndDate = "2999-12-31";    ///< Date after the end of every fixture
+
+/**
+ * @brief Generates a seeded daily price series
+ *
+ * @param count Number of data points
+ * @param seed Seed for the generator
+ * @return Data points with increasing dates and strictly positive closes
+ */
+std::vector<StockData> makePriceSeries(size_t count, unsigned seed = 42);
+
+/**
+ * @brief Writes a series into a fresh stock_data table
+ *
+ * @param data Data points to store
+ * @return Path of the created database file
+ */
+std::string makeScratchDatabase(const std::vector<StockData>& data);
+
+/**
+ * @brief Sends alternating market buys and sells through a gateway client
+ *
+ * Keeps at most window orders unanswered and waits for the Ack and the
+ * execution of every one.
+ *
+ * @param client Connected client
+ * @param orders Orders to send
+ * @param window Most orders in flight at once
+ * @param batch Orders written per flush
+ * @return False if the connection failed or no answer came for a second
+ */
+bool runOrderLoad(OrderClient& client, size_t orders, size_t window, size_t batch);
+
+}  // namespace bench
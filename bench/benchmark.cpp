@@ -0,0 +1,284 @@
+#include "benchmark.h"
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+namespace bench {
+
+namespace {
+
+// A benchmark function plus the argument sets it should be run with
+struct Entry {
+    std::string name;
+    Function function;
+    std::vector<std::vector<int64_t>> argSets;
+};
+
+// Result of running one benchmark instance
+struct Result {
+    std::string name;
+    int64_t iterations;
+    double realNsPerIter;
+    double cpuNsPerIter;
+    double itemsPerSecond;
+    std::map<std::string, double> counters;
+};
+
+std::vector<Entry>& registry() {
+  static std::vector<Entry> entries;
+  return entries;
+}
+
+double processCpuSeconds() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+std::string instanceName(const Entry& entry, const std::vector<int64_t>& args) {
+  std::string name = entry.name;
+  for (int64_t value : args) {
+    name += "/" + std::to_string(value);
+  }
+  return name;
+}
+
+std::string jsonEscape(const std::string& text) {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out;
+}
+
+// Runs one instance, growing the iteration count until min_time is reached
+Result runInstance(const Entry& entry, const std::vector<int64_t>& args, double minTime) {
+  int64_t iterations = 1;
+
+  while (true) {
+    State state(iterations, args);
+    entry.function(state);
+
+    double elapsed = state.elapsedSeconds();
+    if (elapsed >= minTime || iterations >= 1000000000) {
+      Result result;
+      result.name = instanceName(entry, args);
+      result.iterations = state.iterations();
+      result.realNsPerIter = elapsed * 1e9 / state.iterations();
+      result.cpuNsPerIter = state.cpuSeconds() * 1e9 / state.iterations();
+      result.itemsPerSecond = elapsed > 0 ? state.itemsProcessed() / elapsed : 0;
+      result.counters = state.counters;
+      return result;
+    }
+
+    // Predict the iterations needed, overshooting slightly like Google Benchmark
+    double multiplier = elapsed > 0 ? minTime * 1.4 / elapsed : 10.0;
+    if (multiplier > 10.0) {
+      multiplier = 10.0;
+    }
+    int64_t next = static_cast<int64_t>(iterations * multiplier);
+    iterations = next > iterations ? next : iterations + 1;
+  }
+}
+
+void printResult(const Result& result) {
+  std::cout << std::left << std::setw(44) << result.name << std::right
+            << std::setw(14) << std::fixed << std::setprecision(1) << result.realNsPerIter << " ns"
+            << std::setw(14) << result.cpuNsPerIter << " ns"
+            << std::setw(12) << result.iterations;
+  if (result.itemsPerSecond > 0) {
+    std::cout << "  items/s=" << std::setprecision(0) << result.itemsPerSecond;
+  }
+  for (const auto& counter : result.counters) {
+    std::cout << "  " << counter.first << "=" << std::setprecision(2) << counter.second;
+  }
+  std::cout << "\n";
+}
+
+void writeJson(const std::string& path, const std::vector<Result>& results) {
+  std::ofstream out(path);
+  if (!out) {
+    std::cerr << "Cannot write benchmark output: " << path << "\n";
+    return;
+  }
+
+  std::time_t now = std::time(nullptr);
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+  out << std::setprecision(10);
+  out << "{\n";
+  out << "  \"context\": {\n";
+  out << "    \"date\": \"" << date << "\",\n";
+  out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+  out << "    \"library_build_type\": \"release\"\n";
+#else
+  out << "    \"library_build_type\": \"debug\"\n";
+#endif
+  out << "  },\n";
+  out << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out << "    {\n";
+    out << "      \"name\": \"" << jsonEscape(r.name) << "\",\n";
+    out << "      \"run_name\": \"" << jsonEscape(r.name) << "\",\n";
+    out << "      \"run_type\": \"iteration\",\n";
+    out << "      \"iterations\": " << r.iterations << ",\n";
+    out << "      \"real_time\": " << r.realNsPerIter << ",\n";
+    out << "      \"cpu_time\": " << r.cpuNsPerIter << ",\n";
+    out << "      \"time_unit\": \"ns\"";
+    if (r.itemsPerSecond > 0) {
+      out << ",\n      \"items_per_second\": " << r.itemsPerSecond;
+    }
+    for (const auto& counter : r.counters) {
+      out << ",\n      \"" << jsonEscape(counter.first) << "\": " << counter.second;
+    }
+    out << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+}  // namespace
+
+State::State(int64_t iterations, std::vector<int64_t> args)
+: maxIterations(iterations), completed(0), items(0), arguments(std::move(args)),
+  running(false), cpuStart(0), wallTotal(0), cpuTotal(0) {}
+
+bool State::keepRunning() {
+  if (completed == 0 && !running) {
+    resumeTiming();
+  }
+  if (completed < maxIterations) {
+    ++completed;
+    return true;
+  }
+  pauseTiming();
+  return false;
+}
+
+void State::pauseTiming() {
+  if (!running) {
+    return;
+  }
+  wallTotal += std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  cpuTotal += processCpuSeconds() - cpuStart;
+  running = false;
+}
+
+void State::resumeTiming() {
+  if (running) {
+    return;
+  }
+  running = true;
+  cpuStart = processCpuSeconds();
+  wallStart = std::chrono::steady_clock::now();
+}
+
+int64_t State::range(size_t index) const {
+  return index < arguments.size() ? arguments[index] : 0;
+}
+
+void State::setItemsProcessed(int64_t n) {
+  items = n;
+}
+
+int64_t State::iterations() const {
+  return completed;
+}
+
+int64_t State::itemsProcessed() const {
+  return items;
+}
+
+double State::elapsedSeconds() const {
+  return wallTotal;
+}
+
+double State::cpuSeconds() const {
+  return cpuTotal;
+}
+
+Registration::Registration(size_t i) : index(i) {}
+
+Registration* Registration::arg(int64_t value) {
+  return args({value});
+}
+
+Registration* Registration::args(std::vector<int64_t> values) {
+  registry()[index].argSets.push_back(std::move(values));
+  return this;
+}
+
+Registration* registerBenchmark(const std::string& name, Function function) {
+  registry().push_back({name, std::move(function), {}});
+  return new Registration(registry().size() - 1);
+}
+
+int runBenchmarks(int argc, char** argv) {
+  std::string filter = ".*";
+  std::string outPath;
+  double minTime = 0.5;
+  bool listOnly = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string flag = argv[i];
+    if (flag.rfind("--benchmark_filter=", 0) == 0) {
+      filter = flag.substr(19);
+    } else if (flag.rfind("--benchmark_out=", 0) == 0) {
+      outPath = flag.substr(16);
+    } else if (flag.rfind("--benchmark_min_time=", 0) == 0) {
+      minTime = std::atof(flag.substr(21).c_str());
+    } else if (flag == "--benchmark_list_tests") {
+      listOnly = true;
+    } else {
+      std::cerr << "Unknown flag: " << flag << "\n";
+      return 1;
+    }
+  }
+
+  std::regex pattern(filter);
+  std::vector<Result> results;
+
+  if (!listOnly) {
+    std::cout << std::left << std::setw(44) << "Benchmark" << std::right
+              << std::setw(17) << "Time" << std::setw(17) << "CPU"
+              << std::setw(12) << "Iterations" << "\n";
+    std::cout << std::string(90, '-') << "\n";
+  }
+
+  for (const Entry& entry : registry()) {
+    std::vector<std::vector<int64_t>> argSets = entry.argSets;
+    if (argSets.empty()) {
+      argSets.push_back({});
+    }
+
+    for (const auto& args : argSets) {
+      std::string name = instanceName(entry, args);
+      if (!std::regex_search(name, pattern)) {
+        continue;
+      }
+      if (listOnly) {
+        std::cout << name << "\n";
+        continue;
+      }
+      results.push_back(runInstance(entry, args, minTime));
+      printResult(results.back());
+    }
+  }
+
+  if (!outPath.empty()) {
+    writeJson(outPath, results);
+  }
+
+  return 0;
+}
+
+}  // namespace bench
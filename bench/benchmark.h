@@ -0,0 +1,171 @@
+/**
+ * @file benchmark.h
+ * @brief Minimal self-contained microbenchmark harness
+ *
+ * This file defines a small benchmark runner modelled on Google Benchmark.
+ * Benchmarks are registered with the BENCHMARK macro, run until a minimum
+ * wall time has elapsed, and reported both to the console and, optionally,
+ * as JSON compatible with Google Benchmark's output so the same regression
+ * tooling can consume it.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @class State
+ * @brief Per-run state handed to every benchmark function
+ *
+ * A benchmark loops on keepRunning() and may pause the timer around setup
+ * work, report the number of items it processed, and attach custom counters.
+ */
+class State {
+  public:
+    /**
+     * @brief Constructs a new State instance
+     *
+     * @param iterations Number of iterations the benchmark should run
+     * @param args Arguments registered for this benchmark instance
+     */
+    State(int64_t iterations, std::vector<int64_t> args);
+
+    /**
+     * @brief Advances the benchmark loop
+     *
+     * Starts the timer on the first call and stops it once the requested
+     * number of iterations has been run.
+     *
+     * @return True while more iterations remain
+     */
+    bool keepRunning();
+
+    /**
+     * @brief Stops the timer, e.g. around per-iteration setup
+     */
+    void pauseTiming();
+
+    /**
+     * @brief Restarts the timer after pauseTiming()
+     */
+    void resumeTiming();
+
+    /**
+     * @brief Gets a registered argument
+     *
+     * @param index Position of the argument
+     * @return The argument value
+     */
+    int64_t range(size_t index) const;
+
+    /**
+     * @brief Records how many items were processed across all iterations
+     *
+     * @param items Total number of items
+     */
+    void setItemsProcessed(int64_t items);
+
+    int64_t iterations() const;
+    int64_t itemsProcessed() const;
+    double elapsedSeconds() const;
+    double cpuSeconds() const;
+
+    std::map<std::string, double> counters;  ///< Custom counters reported with the results
+
+  private:
+    int64_t maxIterations;   ///< Iterations requested by the runner
+    int64_t completed;       ///< Iterations handed out so far
+    int64_t items;           ///< Items processed, for throughput reporting
+    std::vector<int64_t> arguments;  ///< Registered arguments
+    bool running;            ///< True while the timer is running
+    std::chrono::steady_clock::time_point wallStart;  ///< Wall time at last resume
+    double cpuStart;         ///< Process CPU time at last resume
+    double wallTotal;        ///< Accumulated wall time in seconds
+    double cpuTotal;         ///< Accumulated CPU time in seconds
+};
+
+using Function = std::function<void(State&)>;
+
+/**
+ * @class Registration
+ * @brief Handle returned by BENCHMARK used to attach arguments
+ */
+class Registration {
+  public:
+    /**
+     * @brief Constructs a registration for a benchmark
+     *
+     * @param index Position of the benchmark in the registry
+     */
+    explicit Registration(size_t index);
+
+    /**
+     * @brief Adds one instance of the benchmark run with a single argument
+     *
+     * @param value The argument value
+     * @return This registration for chaining
+     */
+    Registration* arg(int64_t value);
+
+    /**
+     * @brief Adds one instance of the benchmark run with several arguments
+     *
+     * @param values The argument values
+     * @return This registration for chaining
+     */
+    Registration* args(std::vector<int64_t> values);
+
+  private:
+    size_t index;  ///< Position of the benchmark in the registry
+};
+
+/**
+ * @brief Registers a benchmark function
+ *
+ * @param name Name reported in the results
+ * @param function Function that runs the benchmark loop
+ * @return Registration used to attach arguments
+ */
+Registration* registerBenchmark(const std::string& name, Function function);
+
+/**
+ * @brief Runs every registered benchmark matching the command line filter
+ *
+ * Recognised flags: --benchmark_filter=<regex>, --benchmark_min_time=<seconds>,
+ * --benchmark_out=<file> (JSON) and --benchmark_list_tests.
+ *
+ * @return Process exit code
+ */
+int runBenchmarks(int argc, char** argv);
+
+/**
+ * @brief Prevents the compiler from optimising away a computed value
+ */
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+  static volatile const void* sink;
+  sink = &value;
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+}  // namespace bench
+
+#define BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_INNER(a, b)
+
+/**
+ * @brief Registers a function as a benchmark under its own name
+ */
+#define BENCHMARK(fn) \
+  static ::bench::Registration* BENCHMARK_CONCAT(bench_registration_, __LINE__) = \
+      ::bench::registerBenchmark(#fn, fn)
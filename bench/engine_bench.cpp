@@ -0,0 +1,370 @@
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/engine.h"
+#include "core/journal.h"
+#include "core/thread_pool.h"
+#include "net/event_publisher.h"
+#include "net/event_receiver.h"
+#include "net/order_client.h"
+#include "net/order_gateway.h"
+#include "trader/trader.h"
+
+namespace {
+
+// Trader that never reacts to prices; it only exists to own orders
+class PassiveTrader : public Trader {
+  public:
+    void notify(double) override {}
+};
+
+constexpr int kOrdersPerProducer = 10000;
+
+// Measures end-to-end throughput of orders submitted by N producer threads
+// until the engine thread has executed every one of them
+void BM_EngineThroughput(bench::State& state) {
+  const int producers = static_cast<int>(state.range(0));
+  Engine engine;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    std::vector<std::unique_ptr<PassiveTrader>> traders;
+    for (int p = 0; p < producers; ++p) {
+      traders.push_back(std::make_unique<PassiveTrader>());
+      traders.back()->setEngine(&engine);
+    }
+    state.resumeTiming();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      PassiveTrader* trader = traders[p].get();
+      threads.emplace_back([trader] {
+        for (int i = 0; i < kOrdersPerProducer; ++i) {
+          if (i % 2 == 0) {
+            trader->queueUpBuy(1.0);
+          } else {
+            trader->queueUpSell(1.0);
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    engine.waitUntilIdle();
+  }
+
+  state.setItemsProcessed(state.iterations() * producers * kOrdersPerProducer);
+}
+BENCHMARK(BM_EngineThroughput)->arg(1)->arg(2)->arg(4)->arg(8);
+
+// Engines created, fed and drained per iteration, threaded (0) or pooled
+// (1): a threaded engine starts and joins a thread of its own, a pooled one
+// queues drain tasks on the shared pool
+void BM_EngineModes(bench::State& state) {
+  const EngineMode mode = state.range(0) != 0 ? EngineMode::Pooled : EngineMode::Threaded;
+  const int engineCount = 16;
+  const int ordersPerEngine = 1000;
+
+  while (state.keepRunning()) {
+    std::vector<std::unique_ptr<Engine>> engines;
+    std::vector<std::unique_ptr<PassiveTrader>> traders;
+    for (int e = 0; e < engineCount; ++e) {
+      engines.push_back(std::make_unique<Engine>(mode));
+      traders.push_back(std::make_unique<PassiveTrader>());
+      traders.back()->setEngine(engines.back().get());
+    }
+    for (int i = 0; i < ordersPerEngine; ++i) {
+      for (auto& trader : traders) {
+        trader->queueUpBuy(1.0);
+      }
+    }
+    for (auto& engine : engines) {
+      engine->waitUntilIdle();
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * engineCount * ordersPerEngine);
+}
+BENCHMARK(BM_EngineModes)->arg(0)->arg(1);
+
+// Tasks through the shared pool, submitted from this thread (0) or spawned
+// by a task running on a worker (1), which pushes to its own deque without
+// a lock and leaves the other workers to steal
+void BM_ThreadPoolTasks(bench::State& state) {
+  const bool spawned = state.range(0) != 0;
+  const int tasks = 10000;
+  ThreadPool& pool = ThreadPool::shared();
+  ThreadPoolStats before = pool.stats();
+  std::atomic<int> done(0);
+
+  while (state.keepRunning()) {
+    TaskGroup group(pool);
+    auto submitAll = [&] {
+      TaskGroup inner(pool);
+      for (int i = 0; i < tasks; ++i) {
+        inner.run([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+      }
+    };
+    if (spawned) {
+      group.run(submitAll);
+    } else {
+      submitAll();
+    }
+  }
+
+  ThreadPoolStats after = pool.stats();
+  state.setItemsProcessed(state.iterations() * tasks);
+  state.counters["workers"] = static_cast<double>(pool.workerCount());
+  state.counters["stolen"] = static_cast<double>(after.stolen - before.stolen);
+  state.counters["sleeps"] = static_cast<double>(after.sleeps - before.sleeps);
+}
+BENCHMARK(BM_ThreadPoolTasks)->arg(0)->arg(1);
+
+// Single-producer throughput with journaling off (0) or on with each fsync
+// policy: 1 never, 2 interval, 3 every commit. The logger thread writes in
+// the background while orders are processed, as it would in a real run.
+void BM_EngineJournal(bench::State& state) {
+  const int mode = static_cast<int>(state.range(0));
+  std::unique_ptr<Journal> journal;
+  if (mode > 0) {
+    JournalOptions options;
+    options.directory = (std::filesystem::temp_directory_path() / "trading_engine_bench_journal").string();
+    std::filesystem::remove_all(options.directory);
+    options.fsync = mode == 1 ? FsyncPolicy::Never : mode == 2 ? FsyncPolicy::Interval : FsyncPolicy::EveryCommit;
+    journal = std::make_unique<Journal>(options);
+  }
+
+  Engine engine;
+  engine.setJournal(journal.get());
+  PassiveTrader trader;
+  trader.setEngine(&engine);
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < kOrdersPerProducer; ++i) {
+      if (i % 2 == 0) {
+        trader.queueUpBuy(1.0);
+      } else {
+        trader.queueUpSell(1.0);
+      }
+    }
+    engine.waitUntilIdle();
+  }
+
+  if (journal) {
+    journal->flush();
+  }
+
+  state.setItemsProcessed(state.iterations() * kOrdersPerProducer);
+  if (journal) {
+    state.counters["records"] = static_cast<double>(journal->recordsWritten());
+    state.counters["ring_growths"] = static_cast<double>(journal->ringGrowths());
+  }
+}
+BENCHMARK(BM_EngineJournal)->arg(0)->arg(1)->arg(2)->arg(3);
+
+// Single-producer throughput with the event feed off (0) or on (1): every
+// order is acked and executed on the feed, which a receiver thread drains
+// over loopback UDP. Counters are events the engine's ring had no room
+// for, events the receiver never got, and the event-to-receipt latency.
+void BM_EngineEvents(bench::State& state) {
+  bool publish = state.range(0) != 0;
+  std::unique_ptr<EventPublisher> publisher;
+  EventReceiver receiver;
+  std::atomic<bool> listening(publish);
+  std::thread listener;
+  if (publish && receiver.listen("127.0.0.1", 0)) {
+    EventPublisherConfig config;
+    config.port = receiver.port();
+    publisher = std::make_unique<EventPublisher>(config);
+    listener = std::thread([&] {
+      while (listening.load(std::memory_order_acquire)) {
+        receiver.poll(10);
+      }
+      receiver.poll(0);
+    });
+  }
+
+  Engine engine;
+  engine.setEventStream(publisher ? publisher->openStream() : nullptr);
+  PassiveTrader trader;
+  trader.setEngine(&engine);
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < kOrdersPerProducer; ++i) {
+      if (i % 2 == 0) {
+        trader.queueUpBuy(1.0);
+      } else {
+        trader.queueUpSell(1.0);
+      }
+    }
+    engine.waitUntilIdle();
+  }
+
+  state.setItemsProcessed(state.iterations() * kOrdersPerProducer);
+  if (publisher) {
+    publisher->flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    listening.store(false, std::memory_order_release);
+    listener.join();
+    const EventReceiverStats& received = receiver.stats();
+    state.counters["dropped"] = static_cast<double>(publisher->stats().dropped);
+    state.counters["missed"] = static_cast<double>(received.missed);
+    state.counters["event_p50_us"] = received.eventLatency.percentile(50) / 1000.0;
+    state.counters["event_p99_us"] = received.eventLatency.percentile(99) / 1000.0;
+  }
+}
+BENCHMARK(BM_EngineEvents)->arg(0)->arg(1);
+
+// Measures the cost of enqueueing alone, without waiting for execution
+void BM_EngineEnqueue(bench::State& state) {
+  Engine engine;
+  PassiveTrader trader;
+  trader.setEngine(&engine);
+
+  while (state.keepRunning()) {
+    trader.queueUpBuy(1.0);
+    trader.queueUpSell(1.0);
+  }
+  engine.waitUntilIdle();
+
+  state.setItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_EngineEnqueue);
+
+// Four producers bursting orders into a threaded engine with no limit (0)
+// or a 256-order queue that blocks (1), rejects (2), drops the oldest (3)
+// or coalesces (4). Items are orders sent, refused or not.
+void BM_EngineBoundedQueue(bench::State& state) {
+  const int policy = static_cast<int>(state.range(0));
+  const int producers = 4;
+  Engine engine;
+  if (policy > 0) {
+    engine.setQueueLimit(256, static_cast<QueuePolicy>(policy - 1));
+  }
+  std::vector<std::unique_ptr<PassiveTrader>> traders;
+  for (int p = 0; p < producers; ++p) {
+    traders.push_back(std::make_unique<PassiveTrader>());
+    traders.back()->setEngine(&engine);
+  }
+
+  while (state.keepRunning()) {
+    std::vector<std::thread> threads;
+    for (auto& trader : traders) {
+      PassiveTrader* sender = trader.get();
+      threads.emplace_back([sender] {
+        for (int i = 0; i < kOrdersPerProducer; ++i) {
+          sender->queueUpBuy(1.0);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    engine.waitUntilIdle();
+  }
+
+  EngineQueueStats stats = engine.getQueueStats();
+  state.setItemsProcessed(state.iterations() * producers * kOrdersPerProducer);
+  state.counters["high_watermark"] = static_cast<double>(stats.highWatermark);
+  state.counters["blocked"] = static_cast<double>(stats.blocked);
+  state.counters["refused"] = static_cast<double>(stats.rejected + stats.dropped + stats.coalesced);
+}
+BENCHMARK(BM_EngineBoundedQueue)->arg(0)->arg(1)->arg(2)->arg(3)->arg(4);
+
+// Orders per batch in the cancel benchmark, and how many of each ten are cancelled
+constexpr int kCancelBatch = 10000;
+
+// Submits a batch of orders, cancels or replaces most of them by id while
+// they are still queued, then executes the rest on the calling thread
+void BM_EngineCancelReplace(bench::State& state) {
+  const int cancelled = static_cast<int>(state.range(0));
+  Engine engine(EngineMode::Deterministic);
+  PassiveTrader trader;
+  trader.setEngine(&engine);
+  std::vector<uint64_t> ids(kCancelBatch);
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < kCancelBatch; ++i) {
+      ids[i] = trader.queueUpBuy(1.0);
+    }
+    for (int i = 0; i < kCancelBatch; ++i) {
+      if (i % 10 < cancelled) {
+        trader.cancelOrder(ids[i]);
+      } else {
+        trader.replaceOrder(ids[i], 0.5);
+      }
+    }
+    engine.drain();
+  }
+
+  state.setItemsProcessed(state.iterations() * kCancelBatch);
+}
+BENCHMARK(BM_EngineCancelReplace)->arg(0)->arg(9);
+
+// Bars checked against a book of N resting sell stops spread below the
+// market; each bar reaches exactly one of them, and a new stop replaces it
+void BM_EngineTriggers(bench::State& state) {
+  const int resting = static_cast<int>(state.range(0));
+  Engine engine(EngineMode::Deterministic);
+  PassiveTrader trader;
+  trader.setEngine(&engine);
+  engine.observe(StockData(1, 0, 100.0));
+  for (int i = 0; i < resting; ++i) {
+    trader.queueUpOrder(OrderType::Stop, false, 0, 10.0 + 80.0 * i / resting);
+  }
+  engine.advance();
+
+  int64_t time = 0;
+  while (state.keepRunning()) {
+    time += 1;
+    // Dips to the highest stop, which sells and is placed again for the next
+    // bar; bars carry single-precision prices, so the level is one as well
+    double level = static_cast<float>(10.0 + 80.0 * (resting - 1) / resting);
+    engine.observe(StockData(1, time, 100.0, 100.0, level, 100.0, 0));
+    trader.queueUpOrder(OrderType::Stop, false, 0, level);
+    engine.advance();
+    trader.pollExecutions();
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EngineTriggers)->arg(1000)->arg(100000);
+
+// Orders per second from a loopback client through the gateway over TCP (0)
+// or UDP (1), each acknowledged and executed, with 256 in flight; the
+// counters are the gateway's wire-to-engine latency percentiles in us
+void BM_GatewayOrders(bench::State& state) {
+  const size_t orders = 20000;
+  bool udp = state.range(0) != 0;
+  Engine engine;
+  OrderGateway gateway(engine);
+  gateway.start();
+  uint16_t port = udp ? gateway.udpPort() : gateway.tcpPort();
+  bool completed = true;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    OrderClient client;
+    client.connect("127.0.0.1", port, udp ? OrderClient::Transport::Udp : OrderClient::Transport::Tcp);
+    state.resumeTiming();
+
+    completed = bench::runOrderLoad(client, orders, 256, 32) && completed;
+  }
+
+  GatewayStats stats = gateway.stats();
+  state.setItemsProcessed(state.iterations() * orders);
+  state.counters["wire_p50_us"] = stats.wireToEngine.percentile(50) / 1000.0;
+  state.counters["wire_p99_us"] = stats.wireToEngine.percentile(99) / 1000.0;
+  state.counters["failed"] = completed ? 0 : 1;
+}
+BENCHMARK(BM_GatewayOrders)->arg(0)->arg(1);
+
+}  // namespace
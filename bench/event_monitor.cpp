@@ -0,0 +1,166 @@
+// Receiver for the engine event feed. Listens to the datagrams a backtest
+// run with --events sends, and reports once a second how many events
+// arrived, how many were missed according to the sequence numbers, and
+// how late they were.
+//
+//   TradingEngineMonitor [--listen HOST:PORT] [--interface ADDRESS]
+//                        [--seconds N] [--print N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "core/latency_histogram.h"
+#include "net/event_receiver.h"
+
+namespace {
+
+struct MonitorOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 47000;
+    std::string interface = "127.0.0.1";
+    int seconds = 10;
+    size_t print = 0;
+};
+
+void printUsage(std::ostream& out) {
+  out << "Usage: TradingEngineMonitor [options]\n"
+      << "  --listen HOST:PORT    Address the feed is sent to (default 127.0.0.1:47000);\n"
+      << "                        a 224.0.0.0/4 host joins that multicast group\n"
+      << "  --interface ADDRESS   Interface to join a multicast group on (default 127.0.0.1)\n"
+      << "  --seconds N           How long to listen (default 10)\n"
+      << "  --print N             Print the first N events received\n";
+}
+
+bool parseOptions(int argc, char** argv, MonitorOptions& options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string flag = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << flag << "\n";
+      return false;
+    }
+    std::string value = argv[++i];
+    if (flag == "--listen" && value.find(':') != std::string::npos) {
+      options.host = value.substr(0, value.rfind(':'));
+      options.port = static_cast<uint16_t>(std::atoi(value.c_str() + value.rfind(':') + 1));
+    } else if (flag == "--interface") {
+      options.interface = value;
+    } else if (flag == "--seconds") {
+      options.seconds = std::max(1, std::atoi(value.c_str()));
+    } else if (flag == "--print") {
+      options.print = std::strtoull(value.c_str(), nullptr, 10);
+    } else {
+      std::cerr << "Invalid option " << flag << " " << value << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+const char* typeName(wire::EventType type) {
+  switch (type) {
+    case wire::EventType::Ack:
+      return "ack";
+    case wire::EventType::Execution:
+      return "execution";
+    case wire::EventType::Price:
+      return "price";
+  }
+  return "unknown";
+}
+
+void printEvent(uint16_t stream, const wire::EventRecord& record) {
+  std::cout << "stream " << stream << " #" << record.sequence << " " << typeName(record.type);
+  if (record.type == wire::EventType::Price) {
+    std::cout << " " << std::string(record.symbol, ::strnlen(record.symbol, sizeof(record.symbol)))
+              << " close " << record.price << " volume " << record.quantity << "\n";
+  } else {
+    std::cout << " order " << record.id << " trader " << record.trader << (record.buy != 0 ? " buy" : " sell")
+              << " at " << record.price << " detail " << static_cast<int>(record.detail) << "\n";
+  }
+}
+
+void printLatency(const char* label, const LatencyHistogram& latency) {
+  std::cout << label << " (us): p50 " << latency.percentile(50) / 1000.0 << ", p99 " << latency.percentile(99) / 1000.0
+            << ", max " << latency.max() / 1000.0;
+}
+
+void addStats(EventReceiverStats& totals, const EventReceiverStats& part) {
+  totals.datagrams += part.datagrams;
+  totals.events += part.events;
+  totals.acks += part.acks;
+  totals.executions += part.executions;
+  totals.prices += part.prices;
+  totals.missed += part.missed;
+  totals.late += part.late;
+  totals.malformed += part.malformed;
+  totals.restarts += part.restarts;
+  totals.eventLatency.merge(part.eventLatency);
+  totals.wireLatency.merge(part.wireLatency);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  MonitorOptions options;
+  if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+    printUsage(std::cout);
+    return 0;
+  }
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(std::cerr);
+    return 1;
+  }
+
+  EventReceiver receiver;
+  if (!receiver.listen(options.host, options.port, options.interface)) {
+    return 1;
+  }
+  size_t printed = 0;
+  if (options.print > 0) {
+    receiver.setHandler([&](uint16_t stream, const wire::EventRecord& record) {
+      if (printed < options.print) {
+        printEvent(stream, record);
+        printed += 1;
+      }
+    });
+  }
+  std::cout << "Listening on " << options.host << ":" << receiver.port() << " for " << options.seconds << " s"
+            << std::endl;
+
+  // Each line covers one second; the totals cover the whole run
+  EventReceiverStats totals;
+  auto end = std::chrono::steady_clock::now() + std::chrono::seconds(options.seconds);
+  auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (std::chrono::steady_clock::now() < end) {
+    if (receiver.poll(100) < 0) {
+      std::cerr << "Event feed socket failed\n";
+      return 1;
+    }
+    if (std::chrono::steady_clock::now() < nextReport) {
+      continue;
+    }
+    nextReport += std::chrono::seconds(1);
+    const EventReceiverStats& second = receiver.stats();
+    std::cout << second.events << " events/s in " << second.datagrams << " datagrams, " << second.missed
+              << " missed, " << second.late << " late; ";
+    printLatency("event to receipt", second.eventLatency);
+    std::cout << std::endl;
+    addStats(totals, second);
+    receiver.resetStats();
+  }
+  addStats(totals, receiver.stats());
+
+  std::cout << "Total: " << totals.events << " events (" << totals.acks << " acks, " << totals.executions
+            << " executions, " << totals.prices << " prices) from " << receiver.stats().streams << " stream(s), "
+            << totals.missed << " missed, " << totals.late << " late, " << totals.malformed << " malformed, " << totals.restarts
+            << " restarted\n";
+  printLatency("Event to receipt", totals.eventLatency);
+  std::cout << "\n";
+  printLatency("Send to receipt", totals.wireLatency);
+  std::cout << "\n";
+  return 0;
+}
@@ -0,0 +1,174 @@
+// Loopback load generator for the order gateway. Starts an engine and a
+// gateway in this process, or connects to one that is already running,
+// then drives it from one or more client threads and reports the order
+// rate and latency percentiles.
+//
+//   TradingEngineLoadGen [--transport tcp|udp] [--clients N] [--orders N]
+//                        [--window N] [--batch N] [--connect HOST:PORT]
+//   TradingEngineLoadGen --serve SECONDS [--port N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_data.h"
+#include "core/engine.h"
+#include "core/latency_histogram.h"
+#include "net/order_client.h"
+#include "net/order_gateway.h"
+
+namespace {
+
+struct LoadOptions {
+    OrderClient::Transport transport = OrderClient::Transport::Tcp;
+    size_t clients = 1;
+    size_t orders = 100000;
+    size_t window = 256;
+    size_t batch = 32;
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+    bool connect = false;
+    int serveSeconds = 0;
+};
+
+void printUsage(std::ostream& out) {
+  out << "Usage: TradingEngineLoadGen [options]\n"
+      << "  --transport tcp|udp   Protocol the clients use (default tcp)\n"
+      << "  --clients N           Client threads, one connection each (default 1)\n"
+      << "  --orders N            Orders per client (default 100000)\n"
+      << "  --window N            Most orders in flight per client (default 256)\n"
+      << "  --batch N             Orders per write (default 32)\n"
+      << "  --connect HOST:PORT   Use a running gateway instead of starting one\n"
+      << "  --serve SECONDS       Only run a gateway, for clients in other processes\n"
+      << "  --port N              TCP and UDP port of the served gateway (default any)\n";
+}
+
+bool parseOptions(int argc, char** argv, LoadOptions& options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string flag = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << flag << "\n";
+      return false;
+    }
+    std::string value = argv[++i];
+    if (flag == "--transport" && (value == "tcp" || value == "udp")) {
+      options.transport = value == "tcp" ? OrderClient::Transport::Tcp : OrderClient::Transport::Udp;
+    } else if (flag == "--clients") {
+      options.clients = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (flag == "--orders") {
+      options.orders = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (flag == "--window") {
+      options.window = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (flag == "--batch") {
+      options.batch = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (flag == "--connect" && value.find(':') != std::string::npos) {
+      options.host = value.substr(0, value.find(':'));
+      options.port = static_cast<uint16_t>(std::atoi(value.c_str() + value.find(':') + 1));
+      options.connect = true;
+    } else if (flag == "--serve") {
+      options.serveSeconds = std::max(1, std::atoi(value.c_str()));
+    } else if (flag == "--port") {
+      options.port = static_cast<uint16_t>(std::atoi(value.c_str()));
+    } else {
+      std::cerr << "Invalid option " << flag << " " << value << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+void printLatency(const char* label, const LatencyHistogram& latency) {
+  std::cout << label << " (us): p50 " << latency.percentile(50) / 1000.0 << ", p99 " << latency.percentile(99) / 1000.0
+            << ", p99.9 " << latency.percentile(99.9) / 1000.0 << ", max " << latency.max() / 1000.0 << "\n";
+}
+
+void printGatewayStats(const GatewayStats& stats) {
+  std::cout << "Gateway: " << stats.orders << " orders in " << stats.reads << " reads ("
+            << (stats.reads > 0 ? static_cast<double>(stats.orders) / stats.reads : 0.0) << " per read), "
+            << stats.refused << " refused, " << stats.malformed << " malformed, " << stats.dropped << " dropped, "
+            << stats.peersRefused << " peers refused\n";
+  printLatency("Wire to engine", stats.wireToEngine);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  LoadOptions options;
+  if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+    printUsage(std::cout);
+    return 0;
+  }
+  if (!parseOptions(argc, argv, options) || (options.connect && options.serveSeconds > 0)) {
+    printUsage(std::cerr);
+    return 1;
+  }
+
+  std::unique_ptr<Engine> engine;
+  std::unique_ptr<OrderGateway> gateway;
+  if (!options.connect) {
+    GatewayConfig config;
+    config.tcpPort = options.port;
+    config.udpPort = options.port;
+    engine = std::make_unique<Engine>();
+    gateway = std::make_unique<OrderGateway>(*engine, config);
+    if (!gateway->start()) {
+      return 1;
+    }
+    options.port = options.transport == OrderClient::Transport::Tcp ? gateway->tcpPort() : gateway->udpPort();
+  }
+
+  if (options.serveSeconds > 0) {
+    std::cout << "Serving on TCP port " << gateway->tcpPort() << " and UDP port " << gateway->udpPort() << " for "
+              << options.serveSeconds << " s" << std::endl;
+    std::this_thread::sleep_for(std::chrono::seconds(options.serveSeconds));
+    gateway->stop();
+    printGatewayStats(gateway->stats());
+    return 0;
+  }
+
+  std::vector<std::unique_ptr<OrderClient>> clients;
+  for (size_t i = 0; i < options.clients; ++i) {
+    clients.push_back(std::make_unique<OrderClient>());
+    if (!clients.back()->connect(options.host, options.port, options.transport)) {
+      return 1;
+    }
+  }
+
+  std::vector<char> completed(options.clients, 0);
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < options.clients; ++i) {
+    threads.emplace_back([&, i] {
+      completed[i] = bench::runOrderLoad(*clients[i], options.orders, options.window, options.batch) ? 1 : 0;
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  LatencyHistogram roundTrip;
+  size_t failures = 0;
+  for (size_t i = 0; i < options.clients; ++i) {
+    roundTrip.merge(clients[i]->roundTrip());
+    failures += completed[i] == 0 ? 1 : 0;
+  }
+  size_t total = options.clients * options.orders;
+  std::cout << total << " orders from " << options.clients << " client(s) in " << seconds << " s: "
+            << static_cast<double>(total) / seconds << " orders/s\n";
+  printLatency("Round trip to ack", roundTrip);
+  if (gateway) {
+    gateway->stop();
+    printGatewayStats(gateway->stats());
+  }
+  if (failures > 0) {
+    std::cerr << failures << " client(s) lost their connection or answers\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,297 @@
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include <cmath>
+#include <filesystem>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "market/bar_aggregator.h"
+#include "market/bulk_loader.h"
+#include "market/connection_pool.h"
+#include "market/date.h"
+#include "market/market_data_cache.h"
+#include "market/series_codec.h"
+#include "market/shared_feed.h"
+#include "market/stock_market.h"
+#include "market/synthetic_data.h"
+#include "trader/trader.h"
+
+namespace {
+
+// Trader that only counts the updates it receives
+class CountingTrader : public Trader {
+  public:
+    void notify(double newPrice) override {
+      currentPrice = newPrice;
+      count += 1;
+    }
+};
+
+// Trader that spends a fixed amount of compute on every update, standing in
+// for a strategy whose evaluation cost is comparable to row decoding
+class BusyTrader : public Trader {
+  public:
+    void notify(double newPrice) override {
+      double x = newPrice;
+      for (int i = 0; i < 200; ++i) {
+        x = x * 1.0000001 + 1e-9;
+      }
+      bench::doNotOptimize(x);
+      count += 1;
+    }
+};
+
+// Rows per second replayed out of SQLite, including the open and the query;
+// the second argument toggles the prefetching reader thread
+template <typename TraderType>
+void runSqliteReplay(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  std::string path = bench::makeScratchDatabase(bench::makePriceSeries(rows));
+
+  while (state.keepRunning()) {
+    TraderType trader;
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, path);
+    market.setCached(false);
+    market.setPrefetch(state.range(1) != 0);
+    market.addTrader(&trader);
+    market.runSimulation();
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+}
+
+void BM_MarketReplaySqlite(bench::State& state) {
+  runSqliteReplay<CountingTrader>(state);
+}
+BENCHMARK(BM_MarketReplaySqlite)->args({100000, 0})->args({100000, 1});
+
+void BM_MarketReplaySqliteBusyTrader(bench::State& state) {
+  runSqliteReplay<BusyTrader>(state);
+}
+BENCHMARK(BM_MarketReplaySqliteBusyTrader)->args({100000, 0})->args({100000, 1});
+
+// Short range queries per second, as a sweep of uncached backtests issues
+// them; the second argument toggles pooling of connections and statements
+void BM_MarketQueryPooled(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  std::string path = bench::makeScratchDatabase(bench::makePriceSeries(rows));
+  ConnectionPool::instance().clear();
+  ConnectionPool::instance().setMaxIdle(state.range(1) != 0 ? 16 : 0);
+
+  while (state.keepRunning()) {
+    CountingTrader trader;
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, path);
+    market.setCached(false);
+    market.setPrefetch(false);
+    market.addTrader(&trader);
+    market.runSimulation();
+  }
+
+  ConnectionPool::instance().setMaxIdle(16);
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MarketQueryPooled)->args({250, 0})->args({250, 1});
+
+// Rows per second replayed out of an in-memory vector
+void BM_MarketReplayMemory(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  std::vector<StockData> data = bench::makePriceSeries(rows);
+
+  while (state.keepRunning()) {
+    CountingTrader trader;
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, ":memory:");
+    market.addTrader(&trader);
+    market.replay(data);
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_MarketReplayMemory)->arg(100000);
+
+// Rows per second for a parameter sweep replaying one symbol through the
+// shared cache; only the first iteration touches the database
+void BM_MarketReplayCached(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  std::string path = bench::makeScratchDatabase(bench::makePriceSeries(rows));
+  MarketDataCache::instance().clear();
+
+  while (state.keepRunning()) {
+    CountingTrader trader;
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, path);
+    market.addTrader(&trader);
+    market.runSimulation();
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+  state.counters["db_loads"] = static_cast<double>(MarketDataCache::instance().stats().misses);
+}
+BENCHMARK(BM_MarketReplayCached)->arg(100000);
+
+// One-minute bars of a year of sessions, priced in cents as exchanges quote them
+std::vector<StockData> makeMinuteBars() {
+  std::vector<StockData> bars =
+      SyntheticMarket(SyntheticConfig()).generateIntraday({bench::kSymbol}, "2020-01-02", 250, 60 * kNanosPerSecond);
+  for (StockData& bar : bars) {
+    for (float* price : {&bar.open, &bar.high, &bar.low, &bar.close}) {
+      *price = static_cast<float>(std::round(*price * 100.0) / 100.0);
+    }
+  }
+  return bars;
+}
+
+// Bars per second through the series encoder, and the compression it reaches
+void BM_SeriesEncode(bench::State& state) {
+  std::vector<StockData> bars = makeMinuteBars();
+  CompressedSeries series;
+
+  while (state.keepRunning()) {
+    series = compressSeries(bars.data(), bars.size());
+    bench::doNotOptimize(series.data.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * bars.size());
+  state.counters["ratio"] = series.ratio();
+}
+BENCHMARK(BM_SeriesEncode);
+
+// Bars per second decoded from a compressed series into a reused block
+void BM_SeriesDecode(bench::State& state) {
+  std::vector<StockData> bars = makeMinuteBars();
+  CompressedSeries series = compressSeries(bars.data(), bars.size());
+  StockData block[SeriesDecoder::kBlockBars];
+
+  while (state.keepRunning()) {
+    SeriesDecoder decoder(series);
+    while (decoder.next(block) > 0) {
+      bench::doNotOptimize(block);
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * bars.size());
+}
+BENCHMARK(BM_SeriesDecode);
+
+// Rows per second replayed out of a compressed series, decoding as it goes
+void BM_MarketReplayCompressed(bench::State& state) {
+  std::vector<StockData> bars = makeMinuteBars();
+  CompressedSeries series = compressSeries(bars.data(), bars.size());
+
+  while (state.keepRunning()) {
+    CountingTrader trader;
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, ":memory:");
+    market.addTrader(&trader);
+    market.replay(series);
+  }
+
+  state.setItemsProcessed(state.iterations() * bars.size());
+}
+BENCHMARK(BM_MarketReplayCompressed);
+
+// Bars per second delivered through a shared-memory feed to the given number
+// of subscriber processes, counting every copy each subscriber reads; the ring
+// holds the whole series, so nothing is lost however the processes are scheduled
+void BM_SharedFeed(bench::State& state) {
+  std::vector<StockData> bars = makeMinuteBars();
+  const int subscribers = static_cast<int>(state.range(0));
+  const std::string name = "/trading_engine_bench_feed";
+  int64_t failed = 0;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    SharedFeedPublisher publisher(name, bars.size());
+    std::vector<pid_t> children;
+    for (int i = 0; i < subscribers; ++i) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        SharedFeedSubscriber subscriber(name);
+        CountingTrader trader;
+        StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, ":memory:");
+        market.addTrader(&trader);
+        market.replay(subscriber);
+        _exit(subscriber.isOpen() && subscriber.missed() == 0 ? 0 : 1);
+      }
+      children.push_back(pid);
+    }
+    state.resumeTiming();
+
+    for (const StockData& bar : bars) {
+      publisher.publish(bar);
+    }
+    publisher.close();
+    for (pid_t child : children) {
+      int status = 0;
+      waitpid(child, &status, 0);
+      failed += WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * bars.size() * subscribers);
+  state.counters["failed"] = static_cast<double>(failed);
+}
+BENCHMARK(BM_SharedFeed)->arg(1)->arg(4);
+
+// One-second ticks replayed to a trader subscribed to bars of the given
+// length in seconds; throughput is in ticks
+void BM_MarketReplayAggregated(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  std::vector<StockData> data = bench::makePriceSeries(rows);
+  for (size_t i = 0; i < rows; ++i) {
+    data[i].timestamp = static_cast<int64_t>(i) * kNanosPerSecond;
+  }
+
+  while (state.keepRunning()) {
+    CountingTrader trader;
+    trader.setBarSize(state.range(1) * kNanosPerSecond);
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, ":memory:");
+    market.addTrader(&trader);
+    market.replay(data);
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_MarketReplayAggregated)->args({1000000, 60})->args({1000000, 300});
+
+// Rows per second bulk loaded into a fresh database, for a universe of 100
+// symbols stored day by day, as a full-universe download arrives; the second
+// argument is the rows per INSERT statement
+void BM_BulkLoad(bench::State& state) {
+  const size_t days = static_cast<size_t>(state.range(0)) / 100;
+  std::vector<std::string> symbols;
+  for (int i = 0; i < 100; ++i) {
+    symbols.push_back("LOAD" + std::to_string(i));
+  }
+  SyntheticConfig config;
+  config.ticksPerDay = 1;
+  std::vector<StockData> bySymbol = SyntheticMarket(config).generateDaily(symbols, bench::kStartDate, days);
+  std::vector<StockData> byDay;
+  byDay.reserve(bySymbol.size());
+  for (size_t day = 0; day < days; ++day) {
+    for (size_t symbol = 0; symbol < symbols.size(); ++symbol) {
+      byDay.push_back(bySymbol[symbol * days + day]);
+    }
+  }
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "trading_engine_load.db";
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+      std::filesystem::remove(path.string() + suffix);
+    }
+    state.resumeTiming();
+
+    BulkLoader loader(path.string(), static_cast<size_t>(state.range(1)));
+    if (!loader.begin() || !loader.add(byDay) || !loader.finish()) {
+      break;
+    }
+  }
+
+  for (const char* suffix : {"", "-wal", "-shm"}) {
+    std::filesystem::remove(path.string() + suffix);
+  }
+  state.setItemsProcessed(state.iterations() * byDay.size());
+}
+BENCHMARK(BM_BulkLoad)->args({100000, 1})->args({100000, 128});
+
+}  // namespace
@@ -0,0 +1,57 @@
+#include "benchmark.h"
+
+#include "trader/portfolio.h"
+
+namespace {
+
+// Cost of recording a single-share buy
+void BM_PortfolioAddStock(bench::State& state) {
+  Portfolio portfolio;
+  double price = 100.0;
+
+  while (state.keepRunning()) {
+    portfolio.addStock(price, 1);
+    price += 0.01;
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PortfolioAddStock);
+
+// Cost of a buy followed by a FIFO sell of the same share
+void BM_PortfolioAddRemoveStock(bench::State& state) {
+  Portfolio portfolio;
+  double price = 100.0;
+
+  while (state.keepRunning()) {
+    portfolio.addStock(price, 1);
+    portfolio.removeStock(price + 0.5, 1);
+    price += 0.01;
+  }
+
+  state.setItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_PortfolioAddRemoveStock);
+
+// Cost of selling out of a deep position, one lot at a time
+void BM_PortfolioRemoveFromDepth(bench::State& state) {
+  const int depth = static_cast<int>(state.range(0));
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    Portfolio portfolio;
+    for (int i = 0; i < depth; ++i) {
+      portfolio.addStock(100.0 + i * 0.01, 1);
+    }
+    state.resumeTiming();
+
+    for (int i = 0; i < depth; ++i) {
+      portfolio.removeStock(110.0, 1);
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK(BM_PortfolioRemoveFromDepth)->arg(1000);
+
+}  // namespace
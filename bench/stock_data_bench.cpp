@@ -0,0 +1,75 @@
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include <algorithm>
+#include <random>
+#include <regex>
+
+#include "market/date.h"
+
+namespace {
+
+// Fast fixed-layout date parsing used by the market layer
+void BM_ParseDate(bench::State& state) {
+  const char* dates[] = {"2019-01-02", "2020-02-29", "2023-12-22", "1999-07-15"};
+  size_t i = 0;
+  int32_t days = 0;
+
+  while (state.keepRunning()) {
+    parseDate(dates[i++ & 3], days);
+    bench::doNotOptimize(days);
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseDate);
+
+// The std::regex check parseDate replaced, kept for comparison
+void BM_ValidateDateRegex(bench::State& state) {
+  const std::string dates[] = {"2019-01-02", "2020-02-29", "2023-12-22", "1999-07-15"};
+  size_t i = 0;
+
+  while (state.keepRunning()) {
+    bool valid = std::regex_match(dates[i++ & 3], std::regex("^\\d{4}-\\d{2}-\\d{2}$"));
+    bench::doNotOptimize(valid);
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ValidateDateRegex);
+
+void BM_FormatDate(bench::State& state) {
+  char buffer[11];
+  int32_t days = 17000;
+
+  while (state.keepRunning()) {
+    formatDate(days++, buffer);
+    bench::doNotOptimize(buffer[9]);
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatDate);
+
+// Sorting shuffled bars by (timestamp, symbol) with integer comparisons
+void BM_SortBars(bench::State& state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  std::vector<StockData> bars = bench::makePriceSeries(count);
+  std::mt19937 rng(7);
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    std::shuffle(bars.begin(), bars.end(), rng);
+    state.resumeTiming();
+
+    std::sort(bars.begin(), bars.end(), [](const StockData& a, const StockData& b) {
+      return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.symbol < b.symbol;
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * count);
+  state.counters["bytes_per_bar"] = sizeof(StockData);
+}
+BENCHMARK(BM_SortBars)->arg(1000000);
+
+}  // namespace
@@ -0,0 +1,148 @@
+#include "benchmark.h"
+#include "bench_data.h"
+
+#include "core/engine.h"
+#include "core/simulation_kernel.h"
+#include "core/thread_pool.h"
+#include "market/date.h"
+#include "market/stock_market.h"
+#include "trader/strategies/mean_reversion.h"
+#include "trader/strategies/moving_avg.h"
+#include "trader/strategies/take_profit.h"
+
+#include <memory>
+
+namespace {
+
+constexpr size_t kSeriesLength = 4096;
+
+// Per-tick notify cost of a strategy, including any orders it queues
+template <typename Strategy>
+void runNotify(bench::State& state) {
+  std::vector<StockData> data = bench::makePriceSeries(kSeriesLength);
+  Engine engine;
+  Strategy strategy;
+  strategy.setEngine(&engine);
+
+  size_t i = 0;
+  while (state.keepRunning()) {
+    strategy.notify(data[i].close);
+    i = (i + 1) % kSeriesLength;
+  }
+  engine.waitUntilIdle();
+
+  state.setItemsProcessed(state.iterations());
+}
+
+void BM_MovingAverageNotify(bench::State& state) {
+  runNotify<MovingAverage>(state);
+}
+BENCHMARK(BM_MovingAverageNotify);
+
+void BM_MeanReversionNotify(bench::State& state) {
+  runNotify<MeanReversion>(state);
+}
+BENCHMARK(BM_MeanReversionNotify);
+
+// Full backtest of both strategies over an in-memory series with the engine
+// threaded (0) or sequenced deterministically on the market thread (1)
+void BM_Backtest(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  const EngineMode mode = state.range(1) != 0 ? EngineMode::Deterministic : EngineMode::Threaded;
+  std::vector<StockData> data = bench::makePriceSeries(rows);
+
+  while (state.keepRunning()) {
+    Engine engine(mode);
+    MovingAverage movingAverage;
+    MeanReversion meanReversion;
+    movingAverage.setEngine(&engine);
+    meanReversion.setEngine(&engine);
+
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, ":memory:");
+    market.addTrader(&movingAverage);
+    market.addTrader(&meanReversion);
+    if (mode == EngineMode::Deterministic) {
+      market.setEngine(&engine);
+    }
+    market.replay(data);
+    engine.waitUntilIdle();
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_Backtest)->args({100000, 0})->args({100000, 1});
+
+// Ticks per second through 500 moving-average strategies on one market,
+// notified one by one or in the given number of parallel lanes on the
+// shared pool; the inverse is the time from a tick to the last decision
+void BM_BacktestFanOut(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  const size_t lanes = static_cast<size_t>(state.range(1));
+  const size_t strategies = 500;
+  std::vector<StockData> data = bench::makePriceSeries(rows);
+
+  while (state.keepRunning()) {
+    Engine engine;
+    std::vector<std::unique_ptr<MovingAverage>> traders;
+    StockMarket market(bench::kSymbol, bench::kStartDate, bench::kEndDate, ":memory:");
+    for (size_t i = 0; i < strategies; ++i) {
+      traders.push_back(std::make_unique<MovingAverage>());
+      traders.back()->setEngine(&engine);
+      market.addTrader(traders.back().get());
+    }
+    market.setFanOut(lanes);
+    market.replay(data);
+    engine.waitUntilIdle();
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+  state.counters["workers"] = static_cast<double>(ThreadPool::shared().workerCount());
+}
+BENCHMARK(BM_BacktestFanOut)->args({10000, 1})->args({10000, 2})->args({10000, 4});
+
+// The same backtest run entirely on one thread by the discrete-event kernel
+void BM_BacktestKernel(bench::State& state) {
+  const size_t rows = static_cast<size_t>(state.range(0));
+  std::vector<StockData> data = bench::makePriceSeries(rows);
+
+  while (state.keepRunning()) {
+    SimulationKernel kernel;
+    MovingAverage movingAverage;
+    MeanReversion meanReversion;
+    movingAverage.setEngine(&kernel);
+    meanReversion.setEngine(&kernel);
+
+    kernel.addTrader(&movingAverage);
+    kernel.addTrader(&meanReversion);
+    kernel.run(data.data(), data.size());
+    kernel.waitUntilIdle();
+  }
+
+  state.setItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_BacktestKernel)->arg(100000);
+
+// Many coroutine strategies sharing one kernel: every bar resumes each of
+// them, and every order suspends its strategy until the fill is reported
+void BM_CoroutineStrategies(bench::State& state) {
+  const size_t strategies = static_cast<size_t>(state.range(0));
+  const size_t rows = static_cast<size_t>(state.range(1));
+  std::vector<StockData> data = bench::makePriceSeries(rows);
+
+  while (state.keepRunning()) {
+    SimulationKernel kernel;
+    std::vector<std::unique_ptr<TakeProfit>> traders;
+    for (size_t i = 0; i < strategies; ++i) {
+      traders.push_back(std::make_unique<TakeProfit>(10 + static_cast<int>(i % 20), 0.02, 10 * kNanosPerDay));
+      traders.back()->setEngine(&kernel);
+      kernel.addTrader(traders.back().get());
+    }
+    kernel.run(data.data(), data.size());
+    kernel.waitUntilIdle();
+  }
+
+  state.setItemsProcessed(state.iterations() * rows * strategies);
+}
+BENCHMARK(BM_CoroutineStrategies)->args({1000, 10000});
+
+}  // namespace
@@ -0,0 +1,47 @@
+#include "benchmark.h"
+
+#include <vector>
+
+#include "market/synthetic_data.h"
+
+namespace {
+
+constexpr size_t kTicks = 1 << 20;
+
+// Ticks per second written into an in-memory buffer for each price model
+void BM_SyntheticTicks(bench::State& state) {
+  SyntheticConfig config;
+  config.model = static_cast<PriceModel>(state.range(0));
+  SyntheticMarket market(config);
+  std::vector<double> prices(kTicks);
+
+  size_t stream = 0;
+  while (state.keepRunning()) {
+    market.generateTicks(stream++, prices.data(), prices.size());
+    bench::doNotOptimize(prices.back());
+  }
+
+  state.setItemsProcessed(state.iterations() * kTicks);
+}
+BENCHMARK(BM_SyntheticTicks)
+    ->arg(static_cast<int64_t>(PriceModel::GeometricBrownianMotion))
+    ->arg(static_cast<int64_t>(PriceModel::JumpDiffusion))
+    ->arg(static_cast<int64_t>(PriceModel::OrnsteinUhlenbeck))
+    ->arg(static_cast<int64_t>(PriceModel::RegimeSwitching));
+
+// Daily OHLCV bars per second, each built from 390 intraday steps
+void BM_SyntheticDailyBars(bench::State& state) {
+  SyntheticConfig config;
+  SyntheticMarket market(config);
+  const size_t days = 2520;
+
+  while (state.keepRunning()) {
+    std::vector<StockData> bars = market.generateDaily({"AAA", "BBB"}, "2000-01-03", days);
+    bench::doNotOptimize(bars.back().close);
+  }
+
+  state.setItemsProcessed(state.iterations() * days * 2);
+}
+BENCHMARK(BM_SyntheticDailyBars);
+
+}  // namespace
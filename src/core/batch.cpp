@@ -0,0 +1,703 @@
+#include "batch.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+#include "engine.h"
+#include "thread_pool.h"
+#include "../market/bar_aggregator.h"
+#include "../market/date.h"
+#include "../market/market_data_cache.h"
+#include "../market/market_recording.h"
+#include "../market/stock_market.h"
+#include "../net/event_publisher.h"
+#include "../trader/strategies/mean_reversion.h"
+#include "../trader/strategies/moving_avg.h"
+#include "../trader/strategies/take_profit.h"
+
+namespace {
+
+// Parameters each strategy accepts, with their defaults
+const std::map<std::string, std::map<std::string, double>>& knownStrategies() {
+  static const std::map<std::string, std::map<std::string, double>> strategies = {
+    {"moving_average", {{"short", 20}, {"long", 50}}},
+    {"mean_reversion", {{"window", 50}}},
+    {"take_profit", {{"window", 20}, {"target", 0.02}, {"hold_days", 10}}},
+  };
+  return strategies;
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, separator)) {
+    if (!part.empty()) {
+      parts.push_back(part);
+    }
+  }
+  return parts;
+}
+
+std::string trim(const std::string& text) {
+  size_t first = text.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    return "";
+  }
+  size_t last = text.find_last_not_of(" \t\r\n");
+  return text.substr(first, last - first + 1);
+}
+
+// Parses name:key=value,key=value, filling in defaults for missing keys
+bool parseStrategy(const std::string& text, StrategySpec& spec) {
+  size_t colon = text.find(':');
+  spec.name = text.substr(0, colon);
+
+  auto known = knownStrategies().find(spec.name);
+  if (known == knownStrategies().end()) {
+    std::cerr << "Error: Unknown strategy '" << spec.name << "'.\n";
+    return false;
+  }
+  spec.params = known->second;
+
+  if (colon == std::string::npos) {
+    return true;
+  }
+
+  for (const std::string& pair : split(text.substr(colon + 1), ',')) {
+    size_t equals = pair.find('=');
+    std::string key = pair.substr(0, equals);
+    if (equals == std::string::npos || spec.params.count(key) == 0) {
+      std::cerr << "Error: Invalid parameter '" << pair << "' for strategy " << spec.name << ".\n";
+      return false;
+    }
+    spec.params[key] = std::atof(pair.substr(equals + 1).c_str());
+  }
+  return true;
+}
+
+std::unique_ptr<Trader> makeStrategy(const StrategySpec& spec) {
+  if (spec.name == "moving_average") {
+    return std::make_unique<MovingAverage>(static_cast<int>(spec.params.at("short")),
+                                           static_cast<int>(spec.params.at("long")));
+  }
+  if (spec.name == "mean_reversion") {
+    return std::make_unique<MeanReversion>(static_cast<int>(spec.params.at("window")));
+  }
+  if (spec.name == "take_profit") {
+    return std::make_unique<TakeProfit>(static_cast<int>(spec.params.at("window")), spec.params.at("target"),
+                                        static_cast<int64_t>(spec.params.at("hold_days") * kNanosPerDay));
+  }
+  return nullptr;
+}
+
+// Applies one flag; shared by the command line and config file parsers
+bool applyOption(const std::string& key, const std::string& value, BatchConfig& config) {
+  if (key == "config") {
+    return loadConfigFile(value, config);
+  } else if (key == "symbols" || key == "symbol") {
+    for (const std::string& symbol : split(value, ',')) {
+      config.symbols.push_back(symbol);
+    }
+  } else if (key == "start") {
+    if (config.ranges.empty()) {
+      config.ranges.push_back({"", ""});
+    }
+    config.ranges.back().start = value;
+  } else if (key == "end") {
+    if (config.ranges.empty()) {
+      config.ranges.push_back({"", ""});
+    }
+    config.ranges.back().end = value;
+  } else if (key == "range") {
+    size_t colon = value.find(':');
+    if (colon == std::string::npos) {
+      std::cerr << "Error: Range must be written as START:END.\n";
+      return false;
+    }
+    config.ranges.push_back({value.substr(0, colon), value.substr(colon + 1)});
+  } else if (key == "strategy") {
+    StrategySpec spec;
+    if (!parseStrategy(value, spec)) {
+      return false;
+    }
+    config.strategies.push_back(spec);
+  } else if (key == "source") {
+    if (value == "yahoo") {
+      config.source = DataSource::Yahoo;
+    } else if (value == "database") {
+      config.source = DataSource::Database;
+    } else if (value == "synthetic") {
+      config.source = DataSource::Synthetic;
+    } else {
+      std::cerr << "Error: Unknown source '" << value << "'.\n";
+      return false;
+    }
+  } else if (key == "model") {
+    if (value == "gbm") {
+      config.model = PriceModel::GeometricBrownianMotion;
+    } else if (value == "jump") {
+      config.model = PriceModel::JumpDiffusion;
+    } else if (value == "ou") {
+      config.model = PriceModel::OrnsteinUhlenbeck;
+    } else if (value == "regime") {
+      config.model = PriceModel::RegimeSwitching;
+    } else {
+      std::cerr << "Error: Unknown model '" << value << "'.\n";
+      return false;
+    }
+  } else if (key == "interval" || key == "bar") {
+    int64_t period = 0;
+    if (!parseBarSize(value, period)) {
+      std::cerr << "Error: Invalid bar size '" << value << "'.\n";
+      return false;
+    }
+    (key == "bar" ? config.barSize : config.interval) = period;
+  } else if (key == "seed") {
+    config.seed = std::strtoull(value.c_str(), nullptr, 10);
+  } else if (key == "database") {
+    config.database = value;
+  } else if (key == "output") {
+    config.output = value;
+  } else if (key == "threads") {
+    config.threads = std::max(1, std::atoi(value.c_str()));
+  } else if (key == "fanout") {
+    config.fanOut = std::max(1, std::atoi(value.c_str()));
+  } else if (key == "mode") {
+    config.eventDriven = false;
+    if (value == "threaded") {
+      config.mode = EngineMode::Threaded;
+    } else if (value == "deterministic") {
+      config.mode = EngineMode::Deterministic;
+    } else if (value == "pooled") {
+      config.mode = EngineMode::Pooled;
+    } else if (value == "event") {
+      config.mode = EngineMode::Deterministic;
+      config.eventDriven = true;
+    } else {
+      std::cerr << "Error: Unknown engine mode '" << value << "'.\n";
+      return false;
+    }
+  } else if (key == "queue-limit") {
+    config.queueLimit = std::strtoull(value.c_str(), nullptr, 10);
+  } else if (key == "queue-policy") {
+    if (value == "block") {
+      config.queuePolicy = QueuePolicy::Block;
+    } else if (value == "reject") {
+      config.queuePolicy = QueuePolicy::Reject;
+    } else if (value == "drop-oldest") {
+      config.queuePolicy = QueuePolicy::DropOldest;
+    } else if (value == "coalesce") {
+      config.queuePolicy = QueuePolicy::Coalesce;
+    } else {
+      std::cerr << "Error: Unknown queue policy '" << value << "'.\n";
+      return false;
+    }
+  } else if (key == "latency-us") {
+    config.kernel.orderLatency.baseNs = std::strtoll(value.c_str(), nullptr, 10) * 1000;
+  } else if (key == "jitter-us") {
+    config.kernel.orderLatency.jitterNs = std::strtoll(value.c_str(), nullptr, 10) * 1000;
+  } else if (key == "latency-dist") {
+    if (value == "fixed") {
+      config.kernel.orderLatency.distribution = LatencyDistribution::Fixed;
+    } else if (value == "uniform") {
+      config.kernel.orderLatency.distribution = LatencyDistribution::Uniform;
+    } else if (value == "exponential") {
+      config.kernel.orderLatency.distribution = LatencyDistribution::Exponential;
+    } else if (value == "lognormal") {
+      config.kernel.orderLatency.distribution = LatencyDistribution::LogNormal;
+    } else {
+      std::cerr << "Error: Unknown latency distribution '" << value << "'.\n";
+      return false;
+    }
+  } else if (key == "spread-bps") {
+    config.slippage.spreadBps = std::strtod(value.c_str(), nullptr);
+  } else if (key == "impact") {
+    config.slippage.impact = std::strtod(value.c_str(), nullptr);
+  } else if (key == "record") {
+    config.record = value;
+  } else if (key == "replay") {
+    config.replay = value;
+    config.source = DataSource::Recording;
+  } else if (key == "events") {
+    if (value.find(':') == std::string::npos) {
+      std::cerr << "Error: --events expects HOST:PORT.\n";
+      return false;
+    }
+    config.events = value;
+  } else if (key == "journal") {
+    config.journal = value;
+  } else if (key == "fsync") {
+    if (value == "never") {
+      config.fsync = FsyncPolicy::Never;
+    } else if (value == "interval") {
+      config.fsync = FsyncPolicy::Interval;
+    } else if (value == "always") {
+      config.fsync = FsyncPolicy::EveryCommit;
+    } else {
+      std::cerr << "Error: Unknown fsync policy '" << value << "'.\n";
+      return false;
+    }
+  } else if (key == "cache-mb") {
+    config.cacheMb = std::strtoull(value.c_str(), nullptr, 10);
+  } else {
+    std::cerr << "Error: Unknown option '" << key << "'.\n";
+    return false;
+  }
+  return true;
+}
+
+// Names yfinance gives the bar sizes it can download
+bool yahooInterval(int64_t interval, std::string& name) {
+  static const std::map<int64_t, std::string> names = {
+      {0, "1d"}, {60, "1m"}, {120, "2m"}, {300, "5m"}, {900, "15m"}, {1800, "30m"},
+      {3600, "1h"}, {5400, "90m"}, {86400, "1d"}};
+  if (interval % 1000000000 != 0) {
+    return false;
+  }
+  auto it = names.find(interval / 1000000000);
+  if (it == names.end()) {
+    return false;
+  }
+  name = it->second;
+  return true;
+}
+
+// Symbols and ranges get distinct synthetic series even though they share a seed
+uint64_t jobSeed(uint64_t seed, const std::string& symbol, const DateRange& range) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : symbol + ":" + range.start) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+  }
+  return seed ^ hash;
+}
+
+// Journal subdirectories and recordings are named after the job
+std::string jobName(const std::string& symbol, const DateRange& range) {
+  return symbol + "_" + range.start + "_" + range.end;
+}
+
+std::string jsonString(const std::string& text) {
+  std::string out = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out + "\"";
+}
+
+}  // namespace
+
+bool parseCommandLine(int argc, char** argv, BatchConfig& config) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--", 0) != 0) {
+      std::cerr << "Error: Unexpected argument '" << arg << "'.\n";
+      return false;
+    }
+
+    std::string key = arg.substr(2);
+    std::string value;
+    size_t equals = key.find('=');
+    if (equals != std::string::npos) {
+      value = key.substr(equals + 1);
+      key = key.substr(0, equals);
+    } else if (i + 1 < argc) {
+      value = argv[++i];
+    } else {
+      std::cerr << "Error: Missing value for --" << key << ".\n";
+      return false;
+    }
+
+    if (!applyOption(key, value, config)) {
+      return false;
+    }
+  }
+
+  // Validate the assembled configuration
+  if (config.symbols.empty()) {
+    std::cerr << "Error: No symbols given.\n";
+    return false;
+  }
+  if (config.ranges.empty()) {
+    std::cerr << "Error: No date range given.\n";
+    return false;
+  }
+  if (!config.eventDriven && (config.kernel.orderLatency.baseNs != 0 || config.kernel.orderLatency.jitterNs != 0)) {
+    std::cerr << "Error: Order latency is simulated only with --mode event.\n";
+    return false;
+  }
+  if (config.queueLimit > 0 && config.eventDriven) {
+    std::cerr << "Error: --queue-limit applies to engine queues; the event kernel has none.\n";
+    return false;
+  }
+  std::string yahoo;
+  if (config.source == DataSource::Yahoo && !yahooInterval(config.interval, yahoo)) {
+    std::cerr << "Error: Yahoo does not serve that --interval; use 1m, 2m, 5m, 15m, 30m, 1h, 90m or 1d.\n";
+    return false;
+  }
+  if (config.fanOut > 1 && (config.eventDriven || config.mode == EngineMode::Deterministic)) {
+    std::cerr << "Error: --fanout needs --mode threaded or pooled; parallel notifies would reorder a tick's orders.\n";
+    return false;
+  }
+  for (const DateRange& range : config.ranges) {
+    int32_t start = 0;
+    int32_t end = 0;
+    if (!parseDate(range.start, start) || !parseDate(range.end, end) || end < start) {
+      std::cerr << "Error: Invalid date range '" << range.start << ":" << range.end
+                << "'. Dates must be YYYY-MM-DD and the end must not be before the start.\n";
+      return false;
+    }
+  }
+  if (config.strategies.empty()) {
+    for (const auto& strategy : knownStrategies()) {
+      config.strategies.push_back({strategy.first, strategy.second});
+    }
+  }
+  return true;
+}
+
+bool loadConfigFile(const std::string& path, BatchConfig& config) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Error: Cannot open config file " << path << ".\n";
+    return false;
+  }
+
+  std::string line;
+  int number = 0;
+  while (std::getline(file, line)) {
+    number += 1;
+    line = trim(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    size_t equals = line.find('=');
+    if (equals == std::string::npos) {
+      std::cerr << "Error: " << path << ":" << number << ": expected 'key = value'.\n";
+      return false;
+    }
+    if (!applyOption(trim(line.substr(0, equals)), trim(line.substr(equals + 1)), config)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void printUsage(std::ostream& out) {
+  out << "Usage: TradingEngine [options]\n"
+      << "Without options the engine runs interactively.\n\n"
+      << "  --config FILE        Read options from FILE ('option = value' per line)\n"
+      << "  --symbols A,B,...    Symbols to backtest\n"
+      << "  --start YYYY-MM-DD   Start of the date range\n"
+      << "  --end YYYY-MM-DD     End of the date range\n"
+      << "  --range START:END    Additional date range (repeatable)\n"
+      << "  --strategy SPEC      name[:key=value,...] (repeatable; default: all)\n"
+      << "                       moving_average:short=20,long=50\n"
+      << "                       mean_reversion:window=50\n"
+      << "                       take_profit:window=20,target=0.02,hold_days=10\n"
+      << "  --source SOURCE      yahoo (default), database or synthetic\n"
+      << "  --model MODEL        Synthetic model: gbm, jump, ou or regime\n"
+      << "  --seed N             Synthetic data seed (default 42)\n"
+      << "  --interval SIZE      Bar size fetched from Yahoo (1m, 2m, 5m, 15m, 30m, 1h,\n"
+      << "                       90m) or generated: 1s, 1m, 5m, 1h, ... (default 1d)\n"
+      << "  --bar SIZE           Aggregate prices to SIZE bars for the strategies\n"
+      << "                       (default: as stored or generated)\n"
+      << "  --database PATH      SQLite database (default " << MarketDataCache::kDefaultDatabase << ")\n"
+      << "  --output PATH        JSON results file, '-' for stdout (default results.json)\n"
+      << "  --threads N          Backtests run concurrently (default 1)\n"
+      << "  --fanout N           Notify each backtest's traders in N parallel lanes\n"
+      << "                       per tick (default 1; threaded or pooled mode)\n"
+      << "  --cache-mb N         Memory for cached price series in MiB (default 256)\n"
+      << "  --journal DIR        Journal orders and fills, one subdirectory per backtest\n"
+      << "  --fsync POLICY       Journal sync: never, interval (default) or always\n"
+      << "  --mode MODE          threaded (default) or deterministic: orders execute\n"
+      << "                       after each tick, before the next, on one thread;\n"
+      << "                       pooled: orders execute as tasks on the thread pool;\n"
+      << "                       event: discrete-event kernel, one thread per backtest\n"
+      << "  --queue-limit N      Most orders queued in each engine (default: no limit)\n"
+      << "  --queue-policy P     block (default), reject, drop-oldest or coalesce:\n"
+      << "                       what an order finding the queue full gets\n"
+      << "  --latency-us N       Minimum order latency in the event kernel (default 0)\n"
+      << "  --jitter-us N        Scale of the random part of the order latency\n"
+      << "  --latency-dist DIST  fixed (default), uniform, exponential or lognormal\n"
+      << "  --spread-bps X       Bid-ask spread paid on every execution, in basis points\n"
+      << "  --impact X           Square-root market impact coefficient (uses bar volume)\n"
+      << "  --record DIR         Record each backtest's input events into DIR\n"
+      << "  --replay DIR         Replay input events recorded with --record\n"
+      << "  --events HOST:PORT   Send acks, executions and prices as UDP datagrams;\n"
+      << "                       a 224.0.0.0/4 host sends multicast\n";
+}
+
+std::vector<BacktestResult> runBatch(const BatchConfig& config, const DataFetcher& fetch) {
+  MarketDataCache::instance().setCapacity(config.cacheMb << 20);
+
+  // One job per symbol and range; every strategy shares the job's market
+  struct Job {
+      std::string symbol;
+      DateRange range;
+      bool ready;
+  };
+
+  std::vector<Job> jobs;
+  for (const std::string& symbol : config.symbols) {
+    for (const DateRange& range : config.ranges) {
+      jobs.push_back({symbol, range, true});
+    }
+  }
+
+  if (config.source == DataSource::Yahoo) {
+    std::string interval = "1d";
+    yahooInterval(config.interval, interval);
+    std::filesystem::path parent = std::filesystem::path(config.database).parent_path();
+    if (!parent.empty()) {
+      std::filesystem::create_directories(parent);
+    }
+    for (Job& job : jobs) {
+      job.ready = fetch && fetch(job.symbol, job.range.start, job.range.end, config.database, interval);
+      if (!job.ready) {
+        std::cerr << "Skipping " << job.symbol << ": data could not be fetched.\n";
+      }
+    }
+  }
+
+  if (!config.record.empty()) {
+    std::filesystem::create_directories(config.record);
+  }
+
+  std::unique_ptr<EventPublisher> publisher;
+  if (!config.events.empty()) {
+    EventPublisherConfig feed;
+    feed.host = config.events.substr(0, config.events.rfind(':'));
+    feed.port = static_cast<uint16_t>(std::atoi(config.events.c_str() + config.events.rfind(':') + 1));
+    publisher = std::make_unique<EventPublisher>(feed);
+  }
+
+  const size_t perJob = config.strategies.size();
+  std::vector<BacktestResult> results(jobs.size() * perJob);
+  std::vector<bool> filled(results.size(), false);
+  std::atomic<size_t> nextJob(0);
+
+  auto worker = [&]() {
+    // Each worker's engines and markets keep one stream each across jobs;
+    // an engine's processing thread or drain task has finished before the
+    // next job starts
+    EventStream* engineEvents = publisher ? publisher->openStream() : nullptr;
+    EventStream* marketEvents = publisher ? publisher->openStream() : nullptr;
+    for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+      const Job& job = jobs[j];
+      if (!job.ready) {
+        continue;
+      }
+
+      auto begin = std::chrono::steady_clock::now();
+
+      // Declared before the engine so it outlives the processing thread
+      std::unique_ptr<Journal> journal;
+      if (!config.journal.empty()) {
+        JournalOptions options;
+        options.directory = (std::filesystem::path(config.journal) / jobName(job.symbol, job.range)).string();
+        options.fsync = config.fsync;
+        journal = std::make_unique<Journal>(options);
+      }
+
+      // Synthetic and recorded prices are replayed from memory, and so is
+      // the cached series when the event kernel drives the backtest
+      std::vector<StockData> data;
+      SeriesView series;
+      bool inMemory = config.source == DataSource::Synthetic || config.source == DataSource::Recording;
+      if (config.source == DataSource::Synthetic) {
+        SyntheticConfig synthetic;
+        synthetic.model = config.model;
+        synthetic.seed = jobSeed(config.seed, job.symbol, job.range);
+        data = SyntheticMarket(synthetic).generateIntraday(
+            {job.symbol}, job.range.start,
+            SyntheticMarket::tradingDaysBetween(job.range.start, job.range.end), config.interval);
+      } else if (config.source == DataSource::Recording) {
+        std::string path = (std::filesystem::path(config.replay) / (jobName(job.symbol, job.range) + ".events")).string();
+        if (!loadRecording(path, data)) {
+          std::cerr << "Skipping " << job.symbol << ": no recording.\n";
+          continue;
+        }
+      }
+      if (inMemory) {
+        series.data = data.data();
+        series.size = data.size();
+      } else if (config.eventDriven) {
+        series = MarketDataCache::instance().range(config.database, job.symbol, job.range.start, job.range.end);
+      }
+
+      std::unique_ptr<MarketRecorder> recorder;
+      if (!config.record.empty()) {
+        recorder = std::make_unique<MarketRecorder>(
+            (std::filesystem::path(config.record) / (jobName(job.symbol, job.range) + ".events")).string());
+      }
+
+      std::unique_ptr<Engine> engine;
+      SimulationKernel* kernel = nullptr;
+      if (config.eventDriven) {
+        KernelConfig kernelConfig = config.kernel;
+        kernelConfig.seed = jobSeed(config.seed, job.symbol, job.range);
+        auto owned = std::make_unique<SimulationKernel>(kernelConfig);
+        kernel = owned.get();
+        engine = std::move(owned);
+      } else {
+        engine = std::make_unique<Engine>(config.mode);
+        engine->setQueueLimit(config.queueLimit, config.queuePolicy);
+      }
+      engine->setJournal(journal.get());
+      engine->setEventStream(engineEvents);
+      engine->setSlippage(config.slippage);
+      std::vector<std::unique_ptr<Trader>> traders;
+      for (const StrategySpec& spec : config.strategies) {
+        traders.push_back(makeStrategy(spec));
+        traders.back()->setEngine(engine.get());
+        traders.back()->setBarSize(config.barSize);
+      }
+
+      if (kernel != nullptr) {
+        for (auto& trader : traders) {
+          kernel->addTrader(trader.get());
+        }
+        if (recorder) {
+          for (const StockData& bar : series) {
+            recorder->record(bar);
+          }
+        }
+        kernel->run(series.data, series.size);
+      } else {
+        StockMarket market(job.symbol, job.range.start, job.range.end, inMemory ? ":memory:" : config.database);
+        for (auto& trader : traders) {
+          market.addTrader(trader.get());
+        }
+        market.setEngine(engine.get());
+        market.setRecorder(recorder.get());
+        market.setEventStream(marketEvents);
+        market.setFanOut(config.fanOut);
+        if (inMemory) {
+          market.replay(series.data, series.size);
+        } else {
+          market.runSimulation();
+        }
+      }
+
+      // Let queued orders execute, then flatten every position
+      engine->waitUntilIdle();
+      for (auto& trader : traders) {
+        trader->closePositions();
+      }
+      engine->waitUntilIdle();
+
+      double elapsed = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - begin).count();
+
+      for (size_t s = 0; s < perJob; ++s) {
+        Trader& trader = *traders[s];
+        results[j * perJob + s] = {job.symbol, job.range, config.strategies[s],
+                                   trader.getUpdateCount(), trader.getBalance(),
+                                   trader.getSummary(), elapsed, engine->getDigest(), engine->getQueueStats()};
+        filled[j * perJob + s] = true;
+      }
+    }
+  };
+
+  // Backtests run as tasks on the shared pool. Every backtest also gets a
+  // worker for each extra notify lane, and pooled engines one for their
+  // drain tasks, which would otherwise wait behind the backtests
+  size_t threadCount = std::min<size_t>(config.threads, std::max<size_t>(jobs.size(), 1));
+  bool pooled = config.mode == EngineMode::Pooled && !config.eventDriven;
+  ThreadPoolOptions poolOptions;
+  poolOptions.workers = threadCount * (config.fanOut + (pooled ? 1 : 0));
+  ThreadPool::configureShared(poolOptions);
+  {
+    TaskGroup backtests;
+    for (size_t t = 0; t < threadCount; ++t) {
+      backtests.run(worker);
+    }
+  }
+
+  if (publisher) {
+    publisher->flush();
+    EventPublisherStats sent = publisher->stats();
+    if (sent.dropped > 0 || sent.sendErrors > 0) {
+      std::cerr << "Warning: event feed dropped " << sent.dropped << " events and failed " << sent.sendErrors
+                << " sends.\n";
+    }
+  }
+
+  // Drop the slots of jobs that were skipped
+  std::vector<BacktestResult> completed;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (filled[i]) {
+      completed.push_back(results[i]);
+    }
+  }
+  return completed;
+}
+
+bool writeResults(const BatchConfig& config, const std::vector<BacktestResult>& results, double wallMs) {
+  std::ofstream file;
+  if (config.output != "-") {
+    file.open(config.output);
+    if (!file) {
+      std::cerr << "Error: Cannot write results to " << config.output << ".\n";
+      return false;
+    }
+  }
+  std::ostream& out = config.output == "-" ? std::cout : file;
+
+  out << std::defaultfloat << std::setprecision(10);
+  out << "{\n";
+  out << "  \"threads\": " << config.threads << ",\n";
+  out << "  \"fanout\": " << config.fanOut << ",\n";
+  out << "  \"mode\": \"" << (config.eventDriven ? "event"
+                            : config.mode == EngineMode::Deterministic ? "deterministic"
+                            : config.mode == EngineMode::Pooled ? "pooled" : "threaded") << "\",\n";
+  out << "  \"wall_ms\": " << wallMs << ",\n";
+  out << "  \"backtests_per_second\": " << (wallMs > 0 ? results.size() * 1000.0 / wallMs : 0) << ",\n";
+  MarketDataCache::Stats cache = MarketDataCache::instance().stats();
+  out << "  \"cache\": {\"hits\": " << cache.hits << ", \"misses\": " << cache.misses
+      << ", \"evictions\": " << cache.evictions << ", \"bytes\": " << cache.bytes << "},\n";
+  out << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BacktestResult& r = results[i];
+    out << "    {\"symbol\": " << jsonString(r.symbol)
+        << ", \"start\": " << jsonString(r.range.start)
+        << ", \"end\": " << jsonString(r.range.end)
+        << ", \"strategy\": " << jsonString(r.strategy.name)
+        << ", \"params\": {";
+    bool first = true;
+    for (const auto& param : r.strategy.params) {
+      out << (first ? "" : ", ") << jsonString(param.first) << ": " << param.second;
+      first = false;
+    }
+    out << "}, \"bars\": " << r.bars
+        << ", \"buys\": " << r.summary.buys
+        << ", \"sells\": " << r.summary.sells
+        << ", \"bought\": " << r.summary.bought
+        << ", \"sold\": " << r.summary.sold
+        << ", \"yearly_return\": " << r.summary.yearlyReturn
+        << ", \"final_balance\": " << r.finalBalance
+        << ", \"elapsed_ms\": " << r.elapsedMs
+        << ", \"digest\": \"" << std::hex << std::setw(16) << std::setfill('0') << r.digest
+        << std::dec << std::setfill(' ') << "\""
+        << ", \"queue\": {\"high_watermark\": " << r.queue.highWatermark
+        << ", \"blocked\": " << r.queue.blocked
+        << ", \"rejected\": " << r.queue.rejected
+        << ", \"dropped\": " << r.queue.dropped
+        << ", \"coalesced\": " << r.queue.coalesced << "}"
+        << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}\n";
+  return true;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file batch.h
+ * @brief Non-interactive batch backtesting driven by command line or config file
+ *
+ * This file defines the configuration, runner and result output for headless
+ * runs. A batch is the cross product of symbols, date ranges and strategies;
+ * each symbol and range is replayed once with every strategy attached, and
+ * independent backtests run in parallel on a configurable number of threads.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+#include "journal.h"
+#include "simulation_kernel.h"
+#include "../market/market_data_cache.h"
+#include "../market/synthetic_data.h"
+#include "../trader/portfolio.h"
+
+/**
+ * @struct StrategySpec
+ * @brief A strategy name plus its numeric parameters
+ *
+ * Written on the command line as name:key=value,key=value, e.g.
+ * moving_average:short=20,long=50 or mean_reversion:window=30.
+ */
+struct StrategySpec {
+    std::string name;                      ///< Strategy name
+    std::map<std::string, double> params;  ///< Parameters by name
+};
+
+/**
+ * @struct DateRange
+ * @brief Inclusive date range (YYYY-MM-DD)
+ */
+struct DateRange {
+    std::string start;  ///< First date
+    std::string end;    ///< Last date
+};
+
+/**
+ * @enum DataSource
+ * @brief Where a batch gets its prices from
+ */
+enum class DataSource {
+  Yahoo,      ///< Fetch into the database with get_stock_data.py, then replay
+  Database,   ///< Replay whatever the database already holds
+  Synthetic,  ///< Replay seeded synthetic data generated in memory
+  Recording   ///< Replay event streams captured earlier with --record
+};
+
+/**
+ * @struct BatchConfig
+ * @brief Everything needed to run a batch of backtests
+ */
+struct BatchConfig {
+    std::vector<std::string> symbols;       ///< Symbols to backtest
+    std::vector<DateRange> ranges;          ///< Date ranges to backtest
+    std::vector<StrategySpec> strategies;   ///< Strategies attached to every market
+    DataSource source = DataSource::Yahoo;  ///< Price source
+    PriceModel model = PriceModel::GeometricBrownianMotion;  ///< Synthetic price model
+    uint64_t seed = 42;                     ///< Synthetic data seed
+    int64_t interval = 0;                   ///< Bar length fetched or generated in ns; 0 for daily bars
+    int64_t barSize = 0;                    ///< Bar length strategies subscribe to in ns; 0 for the raw stream
+    std::string database = MarketDataCache::kDefaultDatabase;  ///< SQLite database path
+    std::string output = "results.json";    ///< Result file, or "-" for stdout
+    int threads = 1;                        ///< Backtests run concurrently
+    int fanOut = 1;                         ///< Traders of a backtest notified at once on each tick
+    size_t cacheMb = 256;                   ///< MarketDataCache budget in MiB
+    std::string journal;                    ///< Journal directory; empty disables journaling
+    FsyncPolicy fsync = FsyncPolicy::Interval;  ///< Journal durability policy
+    EngineMode mode = EngineMode::Threaded; ///< Engine scheduling; deterministic for reproducible runs
+    size_t queueLimit = 0;                  ///< Most requests queued in each engine; 0 for no limit
+    QueuePolicy queuePolicy = QueuePolicy::Block;  ///< What an order finding the engine's queue full gets
+    bool eventDriven = false;               ///< Run each backtest on one thread in a SimulationKernel
+    KernelConfig kernel;                    ///< Simulated latencies of the SimulationKernel
+    SlippageModel slippage;                 ///< Spread and market impact paid by every execution
+    std::string record;                     ///< Directory to record event streams into; empty disables
+    std::string replay;                     ///< Directory of recorded event streams for DataSource::Recording
+    std::string events;                     ///< HOST:PORT to send acks, executions and prices to; empty disables
+};
+
+/**
+ * @struct BacktestResult
+ * @brief Outcome of one strategy over one symbol and date range
+ */
+struct BacktestResult {
+    std::string symbol;     ///< Symbol replayed
+    DateRange range;        ///< Date range replayed
+    StrategySpec strategy;  ///< Strategy and parameters
+    int bars;               ///< Price updates the strategy received
+    double finalBalance;    ///< Balance after closing all positions
+    TradeSummary summary;   ///< Trade totals and yearly return
+    double elapsedMs;       ///< Wall time of the backtest the result came from
+    uint64_t digest;        ///< Engine execution digest of the backtest the result came from
+    EngineQueueStats queue; ///< Request queue of the backtest's engine
+};
+
+/**
+ * @brief Callback that makes prices for a symbol and range available in a database
+ *
+ * The interval is a yfinance interval name such as "1d" or "5m".
+ */
+using DataFetcher = std::function<bool(const std::string& symbol, const std::string& start,
+                                       const std::string& end, const std::string& database,
+                                       const std::string& interval)>;
+
+/**
+ * @brief Parses command line flags into a batch configuration
+ *
+ * Flags may be written as --flag value or --flag=value. --config loads a
+ * file of "flag = value" lines in place, so later flags override it.
+ *
+ * @param argc Argument count
+ * @param argv Argument values
+ * @param config Configuration to fill
+ * @return True if the configuration is complete and valid
+ */
+bool parseCommandLine(int argc, char** argv, BatchConfig& config);
+
+/**
+ * @brief Loads a config file of "flag = value" lines
+ *
+ * Blank lines and lines starting with '#' are ignored. Keys are the long
+ * flag names without the leading dashes.
+ *
+ * @param path Path of the config file
+ * @param config Configuration to fill
+ * @return True if every line was understood
+ */
+bool loadConfigFile(const std::string& path, BatchConfig& config);
+
+/**
+ * @brief Prints the batch mode flags
+ *
+ * @param out Stream to print to
+ */
+void printUsage(std::ostream& out);
+
+/**
+ * @brief Runs every backtest in the batch
+ *
+ * With the Yahoo source, data is fetched sequentially before any backtest
+ * starts, since the embedded interpreter is not thread-safe.
+ *
+ * @param config Batch configuration
+ * @param fetch Callback used to fetch data for the Yahoo source
+ * @return One result per symbol, range and strategy, in configuration order
+ */
+std::vector<BacktestResult> runBatch(const BatchConfig& config, const DataFetcher& fetch);
+
+/**
+ * @brief Writes results as JSON
+ *
+ * @param config Batch configuration the results came from
+ * @param results Results to write
+ * @param wallMs Wall time of the whole batch
+ * @return True if the output was written
+ */
+bool writeResults(const BatchConfig& config, const std::vector<BacktestResult>& results, double wallMs);
@@ -1,15 +1,49 @@
 #include "engine.h"
-#include "../Trader/trader.h"
+#include "journal.h"
+#include "thread_pool.h"
+#include "../net/event_publisher.h"
+#include "../trader/trader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// FNV-1a over the bytes of a value
+template <typename T>
+uint64_t mixDigest(uint64_t hash, const T& value) {
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  for (unsigned char byte : bytes) {
+    hash = (hash ^ byte) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+}  // namespace
 
 /**
  * @brief Constructs a new Engine instance and starts the processing thread
  * 
- * Initializes the stopProcessing flag to false and creates a new thread
- * that will handle the processing of trading requests.
+ * Initializes the stopProcessing flag to false and, in threaded mode,
+ * creates a new thread that will handle the processing of trading requests.
+ * 
+ * @param engineMode Scheduling mode
  */
-Engine::Engine() : stopProcessing(false) {
+Engine::Engine(EngineMode engineMode)
+: stopProcessing(false), processing(false), drainScheduled(false), mode(engineMode), digest(0xcbf29ce484222325ULL),
+  queueCapacity(0), queuePolicy(QueuePolicy::Block), waitingForRoom(0), buyLimits(false), sellLimits(true),
+  buyStops(true), sellStops(false), restingOrders(0),
+  lastClose(std::numeric_limits<double>::quiet_NaN()), nextOrderId(1), journal(nullptr), eventStream(nullptr),
+  clock(0) {
   // Create thread to process data
-  processingThread = std::thread(&Engine::processRequests, this);
+  if (mode == EngineMode::Threaded) {
+    processingThread = std::thread(&Engine::processRequests, this);
+  } else if (mode == EngineMode::Pooled) {
+    drainSlot = std::make_shared<DrainSlot>();
+    drainSlot->engine = this;
+  }
 }
 
 /**
@@ -19,9 +53,21 @@ Engine::Engine() : stopProcessing(false) {
  * for it to complete before destruction.
  */
 Engine::~Engine() {
-  stopProcessing = true;
+  {
+    std::lock_guard<std::mutex> lock(requestMutex);
+    stopProcessing = true;
+  }
   condition.notify_one();
-  processingThread.join();
+  idleCondition.notify_all();
+  roomCondition.notify_all();
+  if (processingThread.joinable()) {
+    processingThread.join();
+  }
+  // Waits out a running drain task; tasks still queued find no engine
+  if (drainSlot) {
+    std::lock_guard<std::mutex> lock(drainSlot->mutex);
+    drainSlot->engine = nullptr;
+  }
 }
 
 /**
@@ -32,12 +78,13 @@ Engine::~Engine() {
  * 
  * @param trader Reference to the trader making the request
  * @param price The price at which to execute the buy
+ * @return Id of the order
  */
-void Engine::processBuy(Trader& trader, double price) {
-  std::string action = "buy";
+uint64_t Engine::processBuy(Trader& trader, double price) {
   std::unique_lock<std::mutex> lock(requestMutex);
-  requestQueue.push(std::make_pair(std::ref(trader), std::make_pair(action, price)));
-  condition.notify_one();
+  uint64_t orderId = submit(lock, trader, OrderType::Market, true, price, 0);
+  schedule();
+  return orderId;
 }
 
 /**
@@ -48,13 +95,672 @@ void Engine::processBuy(Trader& trader, double price) {
  * 
  * @param trader Reference to the trader making the request
  * @param price The price at which to execute the sell
+ * @return Id of the order
  */
-void Engine::processSell(Trader& trader, double price) {
-  std::string action = "sell";
+uint64_t Engine::processSell(Trader& trader, double price) {
   std::unique_lock<std::mutex> lock(requestMutex);
-  //std::cout << action << " " << price << "\n";
-  requestQueue.push(std::make_pair(std::ref(trader), std::make_pair(action, price)));
-  condition.notify_one();
+  uint64_t orderId = submit(lock, trader, OrderType::Market, false, price, 0);
+  schedule();
+  return orderId;
+}
+
+/**
+ * @brief Queues an order of any type for processing
+ * 
+ * Conditional orders are queued like any other and only checked against
+ * the market once the engine reaches them, so they keep their place
+ * among the trader's orders.
+ * 
+ * @param trader Reference to the trader making the request
+ * @param type Order type
+ * @param isBuy True for a buy, false for a sell
+ * @param price Order price or limit
+ * @param stopPrice Trigger of a stop or stop-limit order
+ * @return Id of the order
+ */
+uint64_t Engine::processOrder(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice) {
+  std::unique_lock<std::mutex> lock(requestMutex);
+  uint64_t orderId = submit(lock, trader, type, isBuy, price, stopPrice);
+  schedule();
+  return orderId;
+}
+
+/**
+ * @brief Cancels a queued order
+ * 
+ * Only marks the order's slot, so cancelling costs one index lookup no
+ * matter how long the queue is; the slot is freed when the order reaches
+ * the front.
+ * 
+ * @param orderId Id of the order
+ * @return True if the order will not execute
+ */
+bool Engine::cancel(uint64_t orderId) {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  uint32_t slot;
+  if (!orderIndex.find(orderId, slot)) {
+    return false;
+  }
+  orders[slot].cancelled = true;
+  orderIndex.erase(orderId);
+  // A resting order is in no queue; it goes through one to be reported in turn
+  if (withdraw(slot)) {
+    resubmit(slot);
+  }
+  return true;
+}
+
+/**
+ * @brief Changes the price of a queued order in place
+ * 
+ * A triggered order already has its execution price and is left alone.
+ * 
+ * @param orderId Id of the order
+ * @param price New order price
+ * @return True if the order will execute at the new price
+ */
+bool Engine::replace(uint64_t orderId, double price) {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  uint32_t slot;
+  if (!orderIndex.find(orderId, slot) || orders[slot].triggered) {
+    return false;
+  }
+  Order& order = orders[slot];
+  bool rested = withdraw(slot);
+  if (order.type == OrderType::Stop) {
+    order.stopPrice = price;
+  } else {
+    order.price = price;
+  }
+  if (rested) {
+    order.acked = false;
+    resubmit(slot);
+  }
+  return true;
+}
+
+/**
+ * @brief Blocks until every queued request has been executed
+ * 
+ * Waits on the idle condition until the queue is empty and the processing
+ * thread is no longer executing a request. A pooled engine with nothing
+ * running drains on the calling thread instead of waiting for its task to
+ * reach the front of a busy pool.
+ */
+void Engine::waitUntilIdle() {
+  if (mode == EngineMode::Deterministic) {
+    drain();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(requestMutex);
+  if (mode == EngineMode::Pooled) {
+    while ((!requestQueue.empty() || !refused.empty() || processing) && !stopProcessing) {
+      if (processing) {
+        idleCondition.wait(lock);
+        continue;
+      }
+      processing = true;
+      executeQueued(lock);
+      processing = false;
+      idleCondition.notify_all();
+    }
+    return;
+  }
+  idleCondition.wait(lock, [this] {
+    return (requestQueue.empty() && refused.empty() && !processing) || stopProcessing;
+  });
+}
+
+/**
+ * @brief Records every processed order and its outcome in a journal
+ * 
+ * @param log Journal to append to, or nullptr to stop journaling
+ */
+void Engine::setJournal(Journal* log) {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  journal = log;
+}
+
+/**
+ * @brief Publishes every order taken and every outcome to an event feed
+ * 
+ * @param stream Stream to publish to, or nullptr to stop publishing
+ */
+void Engine::setEventStream(EventStream* stream) {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  eventStream = stream;
+}
+
+/**
+ * @brief Makes every execution pay a spread and market impact
+ * 
+ * @param model Slippage model
+ */
+void Engine::setSlippage(const SlippageModel& model) {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  slippage = model;
+}
+
+/**
+ * @brief Tells the engine which bar orders are executing against
+ * 
+ * Takes the lock only if a slippage model is set or orders are resting,
+ * so engines trading market orders alone pay one atomic store per bar.
+ * 
+ * @param current Latest bar
+ */
+void Engine::observe(const StockData& current) {
+  lastClose.store(current.close, std::memory_order_relaxed);
+  if (!slippage.enabled() && restingOrders.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(requestMutex);
+  bar = current;
+  trigger(current, fired);
+  if (fired.empty()) {
+    return;
+  }
+  for (uint32_t slot : fired) {
+    push(slot);
+  }
+  fired.clear();
+  schedule();
+}
+
+/**
+ * @brief Executes the orders of the current tick, then moves the logical clock on
+ */
+void Engine::advance() {
+  drain();
+  clock += 1;
+}
+
+/**
+ * @brief Executes every queued request on the calling thread
+ * 
+ * Requests queued while draining, e.g. by a trader reacting to its own
+ * fill, are executed in the same call.
+ * 
+ * @return Number of requests executed
+ */
+size_t Engine::drain() {
+  std::unique_lock<std::mutex> lock(requestMutex);
+  return executeQueued(lock);
+}
+
+size_t Engine::executeQueued(std::unique_lock<std::mutex>& lock) {
+  size_t executed = 0;
+  std::thread::id previous = executor;
+  executor = std::this_thread::get_id();
+  while (!requestQueue.empty() || !refused.empty()) {
+    // Reports of refused orders go out from the only thread that sends
+    // reports, so every trader's mailbox keeps a single producer
+    if (!refused.empty()) {
+      std::vector<ExecutionReport> reports;
+      reports.swap(refused);
+      EventStream* stream = eventStream;
+      lock.unlock();
+      sendReports(reports, stream);
+      lock.lock();
+      continue;
+    }
+
+    HeldReports waiting;
+    if (!held.empty()) {
+      auto it = held.find(requestQueue.front());
+      if (it != held.end()) {
+        waiting = std::move(it->second);
+        held.erase(it);
+      }
+    }
+    Order order;
+    bool ready = dequeue(order);
+    // Blocked senders wake together once a quarter of the queue is free,
+    // rather than one context switch per executed order
+    if (waitingForRoom > 0 && requestQueue.size() <= queueCapacity - queueCapacity / 4) {
+      roomCondition.notify_all();
+    }
+    if (!ready) {
+      // A resting order is reported when it leaves the book, after orders
+      // sent later, so the reports it held need not wait for it
+      if (!waiting.before.empty() || !waiting.after.empty()) {
+        EventStream* stream = eventStream;
+        lock.unlock();
+        sendReports(waiting.before, stream);
+        sendReports(waiting.after, stream);
+        lock.lock();
+      }
+      continue;
+    }
+    Journal* log = journal;
+    EventStream* stream = eventStream;
+    StockData current = bar;
+    lock.unlock();
+
+    sendReports(waiting.before, stream);
+    complete(order, current, log, stream);
+    sendReports(waiting.after, stream);
+    executed += 1;
+
+    lock.lock();
+  }
+  executor = previous;
+  return executed;
+}
+
+void Engine::schedule() {
+  if (mode == EngineMode::Threaded) {
+    condition.notify_one();
+    return;
+  }
+  if (mode != EngineMode::Pooled || processing || drainScheduled) {
+    return;
+  }
+  drainScheduled = true;
+  ThreadPool::shared().submit([slot = drainSlot] {
+    std::lock_guard<std::mutex> guard(slot->mutex);
+    if (slot->engine != nullptr) {
+      slot->engine->runScheduled();
+    }
+  });
+}
+
+// A request queued while the task runs is picked up by the same task, so an
+// engine has at most one task queued and one running
+void Engine::runScheduled() {
+  std::unique_lock<std::mutex> lock(requestMutex);
+  drainScheduled = false;
+  if (processing || stopProcessing) {
+    return;
+  }
+  processing = true;
+  executeQueued(lock);
+  processing = false;
+  idleCondition.notify_all();
+}
+
+/**
+ * @brief Bounds the number of queued requests
+ * 
+ * @param capacity Most requests queued; 0 for no limit
+ * @param policy What to do with an order that finds the queue full
+ */
+void Engine::setQueueLimit(size_t capacity, QueuePolicy policy) {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  queueCapacity = capacity;
+  queuePolicy = policy;
+  newestQueued.clear();
+  roomCondition.notify_all();
+}
+
+/**
+ * @brief Gets the queue depth, its high watermark and what the limit did
+ * 
+ * @return Snapshot of the counters
+ */
+EngineQueueStats Engine::getQueueStats() {
+  std::lock_guard<std::mutex> lock(requestMutex);
+  EngineQueueStats stats = queueStats;
+  stats.depth = requestQueue.size();
+  return stats;
+}
+
+// Only new orders are held to the limit; an order the engine triggered or
+// re-queued was accepted already and goes back in even past it
+uint64_t Engine::submit(std::unique_lock<std::mutex>& lock, Trader& trader, OrderType type, bool isBuy,
+                        double price, double stopPrice) {
+  if (queueCapacity != 0 && requestQueue.size() >= queueCapacity) {
+    if (queuePolicy == QueuePolicy::Block) {
+      waitForRoom(lock);
+    } else if (queuePolicy == QueuePolicy::DropOldest) {
+      dropOldest();
+    } else {
+      uint64_t orderId = queuePolicy == QueuePolicy::Coalesce ? coalesce(trader, type, isBuy, price, stopPrice) : 0;
+      if (orderId != 0) {
+        return orderId;
+      }
+      orderId = nextOrderId++;
+      refuse(ExecutionReport::single(orderId, 0, &trader, price, isBuy, RejectReason::QueueFull));
+      queueStats.rejected += 1;
+      return orderId;
+    }
+  }
+
+  uint32_t slot;
+  uint64_t orderId = storeOrder(trader, type, isBuy, price, stopPrice, slot);
+  push(slot);
+  if (queueCapacity != 0) {
+    newestQueued[trader.getId()] = slot;
+  }
+  return orderId;
+}
+
+// Every earlier order of the oldest one's trader has left the queue, so its
+// report, and those it held, only wait for the order executing now
+void Engine::dropOldest() {
+  uint32_t slot = requestQueue.front();
+  requestQueue.pop();
+  forget(slot);
+  HeldReports waiting;
+  auto it = held.find(slot);
+  if (it != held.end()) {
+    waiting = std::move(it->second);
+    held.erase(it);
+  }
+  Order oldest = releaseOrder(slot);
+  refused.insert(refused.end(), waiting.before.begin(), waiting.before.end());
+  refused.push_back(oldest.cancelled
+                        ? ExecutionReport::cancelled(oldest.id, 0, oldest.trader, oldest.price, oldest.buy)
+                        : ExecutionReport::single(oldest.id, 0, oldest.trader, oldest.price, oldest.buy,
+                                                  RejectReason::QueueFull));
+  refused.insert(refused.end(), waiting.after.begin(), waiting.after.end());
+  queueStats.dropped += 1;
+}
+
+// A trader's reports follow the order it sent: a refused order is reported
+// right after the trader's newest queued order, or at once if it has none
+void Engine::refuse(const ExecutionReport& report) {
+  auto it = newestQueued.find(report.trader->getId());
+  if (it == newestQueued.end()) {
+    refused.push_back(report);
+  } else {
+    held[it->second].after.push_back(report);
+  }
+}
+
+void Engine::forget(uint32_t slot) {
+  if (newestQueued.empty()) {
+    return;
+  }
+  auto it = newestQueued.find(orders[slot].trader->getId());
+  if (it != newestQueued.end() && it->second == slot) {
+    newestQueued.erase(it);
+  }
+}
+
+void Engine::sendReports(const std::vector<ExecutionReport>& reports, EventStream* stream) {
+  for (const ExecutionReport& report : reports) {
+    if (stream != nullptr) {
+      stream->execution(report);
+    }
+    report.trader->deliverExecution(report);
+  }
+}
+
+// The sender is never the thread that would make room: the executing
+// thread queues past the limit, and an engine with no thread of its own
+// executes on the sender's
+void Engine::waitForRoom(std::unique_lock<std::mutex>& lock) {
+  if (executor == std::this_thread::get_id()) {
+    return;
+  }
+  queueStats.blocked += 1;
+  while (queueCapacity != 0 && requestQueue.size() >= queueCapacity && !stopProcessing) {
+    if (mode != EngineMode::Threaded && !processing) {
+      processing = true;
+      executeQueued(lock);
+      processing = false;
+      idleCondition.notify_all();
+      continue;
+    }
+    waitingForRoom += 1;
+    roomCondition.wait(lock);
+    waitingForRoom -= 1;
+  }
+}
+
+// The displaced order is reported cancelled and the new one executes in its
+// place, so the trader's latest price wins without the queue growing. Only
+// the trader's newest order, with no refusal waiting behind it, can be
+// displaced; anything else would report the new order ahead of older ones.
+uint64_t Engine::coalesce(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice) {
+  auto it = newestQueued.find(trader.getId());
+  if (it == newestQueued.end()) {
+    return 0;
+  }
+  Order& order = orders[it->second];
+  if (order.cancelled || order.type != type || order.buy != isBuy) {
+    return 0;
+  }
+  HeldReports& waiting = held[it->second];
+  if (!waiting.after.empty()) {
+    return 0;
+  }
+  waiting.before.push_back(ExecutionReport::cancelled(order.id, 0, &trader, order.price, isBuy));
+  orderIndex.erase(order.id);
+  order.id = nextOrderId++;
+  order.price = price;
+  order.stopPrice = stopPrice;
+  orderIndex.insert(order.id, it->second);
+  queueStats.coalesced += 1;
+  return order.id;
+}
+
+void Engine::push(uint32_t slot) {
+  requestQueue.push(slot);
+  queueStats.highWatermark = std::max(queueStats.highWatermark, requestQueue.size());
+}
+
+// Orders reach the market here, in queue order, so a conditional order is
+// checked against the close of the bar its trader last saw
+bool Engine::dequeue(Order& order) {
+  uint32_t slot = requestQueue.front();
+  requestQueue.pop();
+  forget(slot);
+  if (!orders[slot].cancelled) {
+    acknowledge(slot);
+    if (!arrive(slot, lastClose.load(std::memory_order_relaxed))) {
+      return false;
+    }
+  }
+  order = releaseOrder(slot);
+  return true;
+}
+
+uint64_t Engine::storeOrder(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice,
+                            uint32_t& slot) {
+  uint64_t orderId = nextOrderId++;
+  Order order{orderId, &trader, price, stopPrice, type, isBuy, false, false, false, false};
+  if (!freeOrders.empty()) {
+    slot = freeOrders.back();
+    freeOrders.pop_back();
+    orders[slot] = order;
+  } else {
+    slot = static_cast<uint32_t>(orders.size());
+    orders.push_back(order);
+  }
+  orderIndex.insert(orderId, slot);
+  return orderId;
+}
+
+Engine::Order Engine::releaseOrder(uint32_t slot) {
+  Order order = orders[slot];
+  freeOrders.push_back(slot);
+  if (!order.cancelled) {
+    orderIndex.erase(order.id);
+  }
+  return order;
+}
+
+void Engine::complete(const Order& order, const StockData& current, Journal* log, EventStream* stream) {
+  Trader& trader = *order.trader;
+  ExecutionReport report = order.cancelled
+                               ? ExecutionReport::cancelled(order.id, 0, &trader, order.price, order.buy)
+                               : execute(order.id, trader, order.buy, fillPrice(order, current), log);
+  if (stream != nullptr) {
+    stream->execution(report);
+  }
+  trader.deliverExecution(report);
+}
+
+// NaN compares false, so before the first bar every conditional order rests
+bool Engine::arrive(uint32_t slot, double reference) {
+  Order& order = orders[slot];
+  if (order.triggered || order.type == OrderType::Market) {
+    return true;
+  }
+
+  if (order.type == OrderType::Stop || order.type == OrderType::StopLimit) {
+    if (!(order.buy ? reference >= order.stopPrice : reference <= order.stopPrice)) {
+      ladderOf(order).insert(order.stopPrice, order.id, slot);
+      order.resting = true;
+      countResting();
+      return false;
+    }
+    if (order.type == OrderType::Stop) {
+      order.type = OrderType::Market;
+      order.price = reference;
+      order.triggered = true;
+      return true;
+    }
+    order.type = OrderType::Limit;
+  }
+
+  if (!(order.buy ? reference <= order.price : reference >= order.price)) {
+    ladderOf(order).insert(order.price, order.id, slot);
+    order.resting = true;
+    countResting();
+    return false;
+  }
+  order.price = reference;
+  order.triggered = true;
+  return true;
+}
+
+// Limits are collected before stops, so a stop-limit converted on this bar
+// is not filled from the part of the range that came before its stop
+void Engine::trigger(const StockData& current, std::vector<uint32_t>& slots) {
+  if (restingOrders.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  size_t first = slots.size();
+  double open = current.open;
+
+  buyLimits.collect(current.low, current.high, slots);
+  sellLimits.collect(current.low, current.high, slots);
+  for (size_t i = first; i < slots.size(); ++i) {
+    Order& order = orders[slots[i]];
+    order.price = order.buy ? std::min(order.price, open) : std::max(order.price, open);
+    order.resting = false;
+    order.triggered = true;
+  }
+
+  buyStops.collect(current.low, current.high, stopped);
+  sellStops.collect(current.low, current.high, stopped);
+  for (uint32_t slot : stopped) {
+    Order& order = orders[slot];
+    order.resting = false;
+    if (order.type == OrderType::Stop) {
+      order.type = OrderType::Market;
+      order.price = order.buy ? std::max(order.stopPrice, open) : std::min(order.stopPrice, open);
+      order.triggered = true;
+      slots.push_back(slot);
+    } else {
+      order.type = OrderType::Limit;
+      if (arrive(slot, current.close)) {
+        slots.push_back(slot);
+      }
+    }
+  }
+  stopped.clear();
+
+  std::sort(slots.begin() + static_cast<std::ptrdiff_t>(first), slots.end(),
+            [this](uint32_t a, uint32_t b) { return orders[a].id < orders[b].id; });
+  countResting();
+}
+
+bool Engine::withdraw(uint32_t slot) {
+  Order& order = orders[slot];
+  if (!order.resting) {
+    return false;
+  }
+  bool limit = order.type == OrderType::Limit;
+  ladderOf(order).erase(limit ? order.price : order.stopPrice, order.id);
+  order.resting = false;
+  countResting();
+  return true;
+}
+
+// Never called from trigger(), which runs on the thread observing bars
+void Engine::acknowledge(uint32_t slot) {
+  Order& order = orders[slot];
+  if (order.acked || order.triggered) {
+    return;
+  }
+  order.acked = true;
+  if (eventStream != nullptr) {
+    eventStream->ack(order.id, order.trader->getId(), order.type, order.buy,
+                     order.type == OrderType::Stop ? order.stopPrice : order.price);
+  }
+}
+
+void Engine::resubmit(uint32_t slot) {
+  push(slot);
+  schedule();
+}
+
+double Engine::fillPrice(const Order& order, const StockData& current) const {
+  return order.type == OrderType::Limit ? order.price : executionPrice(order.buy, order.price, current);
+}
+
+TriggerLadder& Engine::ladderOf(const Order& order) {
+  if (order.type == OrderType::Limit) {
+    return order.buy ? buyLimits : sellLimits;
+  }
+  return order.buy ? buyStops : sellStops;
+}
+
+void Engine::countResting() {
+  size_t resting = buyLimits.size() + sellLimits.size() + buyStops.size() + sellStops.size();
+  restingOrders.store(resting, std::memory_order_relaxed);
+}
+
+EngineMode Engine::getMode() const {
+  return mode;
+}
+
+uint64_t Engine::getClock() const {
+  return clock;
+}
+
+uint64_t Engine::getDigest() const {
+  return digest;
+}
+
+/**
+ * @brief Executes one request and records it in the journal and digest
+ * 
+ * @param orderId Id of the order
+ * @param trader Trader that sent the request
+ * @param isBuy True for a buy, false for a sell
+ * @param price Execution price
+ * @param log Journal to append to, or nullptr
+ * @return Report of the execution, for the trader
+ */
+ExecutionReport Engine::execute(uint64_t orderId, Trader& trader, bool isBuy, double price, Journal* log) {
+  bool filled = isBuy ? trader.buy(price) : trader.sell(price);
+  double balance = filled ? trader.getBalance() : 0;
+
+  digest = mixDigest(digest, clock);
+  uint32_t slot = digestSlots.emplace(trader.getId(), static_cast<uint32_t>(digestSlots.size())).first->second;
+  digest = mixDigest(digest, slot);
+  digest = mixDigest(digest, isBuy);
+  digest = mixDigest(digest, price);
+  digest = mixDigest(digest, filled);
+  digest = mixDigest(digest, balance);
+
+  if (log != nullptr) {
+    log->append({orderId, price, balance, slot,
+                 filled ? JournalRecordType::Fill : JournalRecordType::Reject,
+                 isBuy ? OrderSide::Buy : OrderSide::Sell, 1});
+  }
+  RejectReason reason = filled ? RejectReason::None
+                               : isBuy ? RejectReason::InsufficientFunds : RejectReason::NoPosition;
+  return ExecutionReport::single(orderId, 0, &trader, price, isBuy, reason);
+}
+
+double Engine::executionPrice(bool isBuy, double price, const StockData& current) const {
+  return slippage.enabled() ? slippage.apply(isBuy, price, 1, current) : price;
 }
 
 /**
@@ -66,38 +772,27 @@ void Engine::processSell(Trader& trader, double price) {
  * The processing loop:
  * 1. Waits for new requests or stop signal
  * 2. Processes all queued requests
- * 3. Executes the appropriate trader action (buy/sell)
- * 4. Maintains thread safety using mutex locks
+ * 3. Executes the appropriate trader action (buy/sell), or skips a cancelled
+ *    order, and reports the outcome to the trader
+ * 4. Journals the order and its fill or rejection, if a journal is set
+ * 5. Maintains thread safety using mutex locks
+ * 
+ * Only runs in threaded mode.
  */
 void Engine::processRequests() {
   while (true) {
     // Wait for new requests or stop signal
     std::unique_lock<std::mutex> lock(requestMutex);
-    condition.wait(lock, [this] { return !requestQueue.empty() || stopProcessing; });
+    condition.wait(lock, [this] { return !requestQueue.empty() || !refused.empty() || stopProcessing; });
 
     if (stopProcessing) {
       break;
     }
 
     // Process all queued requests
-    while (!requestQueue.empty()) {
-      auto request = requestQueue.front();
-      requestQueue.pop();
-      lock.unlock();
-
-      // Extract request details
-      Trader& trader = request.first;
-      std::string& action = request.second.first;
-      double price = request.second.second;
-
-      // Execute the appropriate trading action
-      if (action == "buy") {
-        trader.buy(price);
-      } else if (action == "sell") {
-        trader.sell(price);
-      }
-
-      lock.lock();
-    }
+    processing = true;
+    executeQueued(lock);
+    processing = false;
+    idleCondition.notify_all();
   }
 }
\ No newline at end of file
@@ -10,15 +10,61 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
 #include <queue>
+#include <unordered_map>
 #include <mutex>
 #include <utility>
 #include <condition_variable>
 
+#include "execution_model.h"
+#include "order_index.h"
+#include "trigger_ladder.h"
+
 class Trader;
+class Journal;
+class EventStream;
+struct ExecutionReport;
+enum class OrderType : uint8_t;
+
+/**
+ * @enum EngineMode
+ * @brief How an Engine schedules the execution of queued requests
+ */
+enum class EngineMode {
+  Threaded,       ///< A processing thread executes requests as soon as it gets to them
+  Deterministic,  ///< Requests execute only when the owner calls advance() or drain()
+  Pooled,         ///< Requests execute as tasks on ThreadPool::shared(); the engine has no thread of its own
+};
+
+/**
+ * @enum QueuePolicy
+ * @brief What an Engine with a bounded queue does with an order that finds it full
+ */
+enum class QueuePolicy {
+  Block,       ///< The sender waits until the engine has executed enough to make room
+  Reject,      ///< The new order is rejected with RejectReason::QueueFull
+  DropOldest,  ///< The oldest queued order is rejected with RejectReason::QueueFull to make room
+  Coalesce,    ///< The new order takes the queue place of its trader's newest order, if of the same side and type; else Reject
+};
+
+/**
+ * @struct EngineQueueStats
+ * @brief Depth of an Engine's request queue and what its limit did
+ */
+struct EngineQueueStats {
+    size_t depth = 0;          ///< Requests queued now
+    size_t highWatermark = 0;  ///< Most requests queued at once
+    uint64_t blocked = 0;      ///< Orders whose sender had to wait for room
+    uint64_t rejected = 0;     ///< New orders rejected because the queue was full
+    uint64_t dropped = 0;      ///< Queued orders rejected to make room for newer ones
+    uint64_t coalesced = 0;    ///< Queued orders cancelled because a newer order took their place
+};
 
 /**
  * @class Engine
@@ -33,9 +79,15 @@ class Engine {
     /**
      * @brief Constructs a new Engine instance
      * 
-     * Initializes the engine and starts the processing thread.
+     * Initializes the engine and, in threaded mode, starts the processing
+     * thread. In deterministic mode no thread is started; requests wait in
+     * the queue until the owner sequences them with advance(). In pooled
+     * mode a request arriving at an idle engine queues a drain task on the
+     * shared thread pool, so many engines share the pool's workers.
+     * 
+     * @param engineMode Scheduling mode (default threaded)
      */
-    Engine();
+    explicit Engine(EngineMode engineMode = EngineMode::Threaded);
 
     /**
      * @brief Destructor for the Engine
@@ -43,23 +95,191 @@ class Engine {
      * Ensures proper cleanup by stopping the processing thread and waiting
      * for it to finish.
      */
-    ~Engine();
+    virtual ~Engine();
 
     /**
      * @brief Processes a buy request from a trader
      * 
      * @param trader Reference to the trader making the request
      * @param price The price at which to execute the buy
+     * @return Id of the order, unique within this engine; see setQueueLimit() for a full queue
      */
-    void processBuy(Trader& trader, double price);
+    virtual uint64_t processBuy(Trader& trader, double price);
 
     /**
      * @brief Processes a sell request from a trader
      * 
      * @param trader Reference to the trader making the request
      * @param price The price at which to execute the sell
+     * @return Id of the order, unique within this engine; see setQueueLimit() for a full queue
+     */
+    virtual uint64_t processSell(Trader& trader, double price);
+
+    /**
+     * @brief Processes an order of any type from a trader
+     * 
+     * Limit, stop and stop-limit orders are checked against the last bar
+     * passed to observe() when the engine reaches them. Those the market
+     * has not reached yet rest in the engine until a later bar triggers
+     * them; see observe().
+     * 
+     * @param trader Reference to the trader making the request
+     * @param type Order type
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price of a market order, limit of a limit or stop-limit order
+     * @param stopPrice Trigger of a stop or stop-limit order
+     * @return Id of the order, unique within this engine; see setQueueLimit() for a full queue
+     */
+    virtual uint64_t processOrder(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice);
+
+    /**
+     * @brief Cancels a queued or resting order
+     * 
+     * The order keeps its place in the queue and, when reached, is reported
+     * to its trader as cancelled instead of executing, so reports still
+     * arrive in the order the orders were sent. A resting order leaves the
+     * book and joins the back of the queue to be reported. Cancelled orders
+     * are not journaled and do not change the digest.
+     * 
+     * @param orderId Id returned by processBuy() or processSell()
+     * @return True if the order will not execute; false if it already has or is executing
+     */
+    virtual bool cancel(uint64_t orderId);
+
+    /**
+     * @brief Changes the price of a queued or resting order
+     * 
+     * A resting order leaves the book and joins the back of the queue, to
+     * be checked against the market again at its new price.
+     * 
+     * @param orderId Id returned by processBuy() or processSell()
+     * @param price New order price: the limit, or the stop of a stop order
+     * @return True if the order will execute at the new price; false if it already has or is executing
+     */
+    virtual bool replace(uint64_t orderId, double price);
+
+    /**
+     * @brief Blocks until every queued request has been executed
+     * 
+     * Used by callers that need a consistent view of trader state, such as
+     * benchmarks measuring end-to-end throughput.
+     */
+    virtual void waitUntilIdle();
+
+    /**
+     * @brief Bounds the number of queued requests
+     * 
+     * A new order that finds capacity requests queued is handled by the
+     * policy. Every order still gets an id and exactly one report: rejected
+     * orders, and orders a newer one displaced, are reported by the thread
+     * executing requests with RejectReason::QueueFull or as cancelled. Each
+     * trader still gets its reports in the order it sent the orders: a
+     * refused order is reported after the trader's orders queued before it.
+     * Orders triggered or re-queued by the engine itself are never refused,
+     * so the queue may briefly run past the limit.
+     * 
+     * Block waits on the processing thread in threaded mode. A pooled or
+     * deterministic engine that is not executing drains the queue on the
+     * sending thread instead. Orders sent from the executing thread itself,
+     * by a trader reacting to a report, are never blocked.
+     * 
+     * Set the limit before orders are sent: orders queued before it are not
+     * tracked, so a refusal could be reported ahead of them.
+     * 
+     * @param capacity Most requests queued; 0 (default) for no limit
+     * @param policy What to do with an order that finds the queue full
+     */
+    void setQueueLimit(size_t capacity, QueuePolicy policy = QueuePolicy::Block);
+
+    /**
+     * @brief Gets the queue depth, its high watermark and what the limit did
+     */
+    EngineQueueStats getQueueStats();
+
+    /**
+     * @brief Records every processed order and its outcome in a journal
+     * 
+     * Set before submitting requests. The processing thread becomes the
+     * journal's only producer; pass nullptr to stop journaling.
+     * 
+     * @param log Journal to append to, owned by the caller
      */
-    void processSell(Trader& trader, double price);
+    void setJournal(Journal* log);
+
+    /**
+     * @brief Publishes every order taken and every outcome to an event feed
+     * 
+     * Set before submitting requests. The processing thread becomes the
+     * stream's only producer and never waits on it; pass nullptr to stop.
+     * 
+     * @param stream Stream of an EventPublisher, owned by the publisher
+     */
+    void setEventStream(EventStream* stream);
+
+    /**
+     * @brief Makes every execution pay a spread and market impact
+     * 
+     * Set before submitting requests. Impact is computed against the bar
+     * last passed to observe().
+     * 
+     * @param model Slippage model; the default model executes at the order price
+     */
+    void setSlippage(const SlippageModel& model);
+
+    /**
+     * @brief Tells the engine which bar orders are executing against
+     * 
+     * Called by the market for every bar before traders see it. Resting
+     * orders whose level lies within the bar's range are queued to execute,
+     * oldest first: limits at their limit, or at the open if the bar opened
+     * through it, and stops at their stop or a worse open. A stop-limit
+     * whose stop the bar reaches becomes a limit order checked against the
+     * close. Only the orders triggered are touched, however many rest.
+     * 
+     * @param current Latest bar
+     */
+    void observe(const StockData& current);
+
+    /**
+     * @brief Executes every queued request, then moves the logical clock on
+     * 
+     * Called by the market after each tick has been delivered to every
+     * trader, so the orders a tick produced always execute before the next
+     * tick, in the order they were submitted. Only valid in deterministic
+     * mode, from the thread that drives the market.
+     */
+    void advance();
+
+    /**
+     * @brief Executes every queued request on the calling thread
+     * 
+     * @return Number of requests executed
+     */
+    size_t drain();
+
+    /**
+     * @brief Gets the scheduling mode
+     */
+    EngineMode getMode() const;
+
+    /**
+     * @brief Gets the logical clock: the number of completed advance() calls
+     */
+    uint64_t getClock() const;
+
+    /**
+     * @brief Gets a digest of every execution so far
+     * 
+     * Folds the logical time, trader, side, price, outcome and resulting
+     * balance of each processed order into a 64-bit hash. Traders are
+     * identified by the order in which they first traded on this engine, so
+     * the digest does not depend on process-wide trader ids. Two runs that
+     * produced the same digest executed identical orders at identical
+     * prices in the same order.
+     * 
+     * @return The digest
+     */
+    uint64_t getDigest() const;
 
   private:
     /**
@@ -70,11 +290,289 @@ class Engine {
      */
     void processRequests();
 
+    /**
+     * @brief Executes queued requests until the queue is empty
+     * 
+     * Unlocks around every execution and returns with the lock held.
+     * 
+     * @param lock Lock on requestMutex
+     * @return Number of requests executed
+     */
+    size_t executeQueued(std::unique_lock<std::mutex>& lock);
+
+    /**
+     * @brief Applies the queue limit to a new order, then queues it
+     * 
+     * @param lock Lock on requestMutex; released while blocked
+     * @return Id of the order
+     */
+    uint64_t submit(std::unique_lock<std::mutex>& lock, Trader& trader, OrderType type, bool isBuy, double price,
+                    double stopPrice);
+
+    /**
+     * @brief Waits until the queue is below its limit, draining it if nothing else will
+     */
+    void waitForRoom(std::unique_lock<std::mutex>& lock);
+
+    /**
+     * @brief Moves a new order into the queue place of the trader's newest order, if alike
+     * 
+     * @return Id of the new order, or 0 if the trader's newest queued order cannot be displaced
+     */
+    uint64_t coalesce(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice);
+
+    /**
+     * @brief Rejects the oldest queued order to make room; requestMutex must be held
+     */
+    void dropOldest();
+
+    /**
+     * @brief Holds a refused order's report until its trader's earlier orders are reported
+     * 
+     * requestMutex must be held.
+     */
+    void refuse(const ExecutionReport& report);
+
+    /**
+     * @brief Stops tracking an order leaving the queue as its trader's newest; requestMutex must be held
+     */
+    void forget(uint32_t slot);
+
+    /**
+     * @brief Publishes reports and delivers them to their traders; requestMutex must not be held
+     */
+    static void sendReports(const std::vector<ExecutionReport>& reports, EventStream* stream);
+
+    /**
+     * @brief Queues a request and updates the high watermark; requestMutex must be held
+     */
+    void push(uint32_t slot);
+
+    /**
+     * @brief Gets queued requests executed; requestMutex must be held
+     * 
+     * Wakes the processing thread in threaded mode and queues a drain task
+     * in pooled mode, unless one is queued or running already.
+     */
+    void schedule();
+
+    /**
+     * @brief Body of a pooled drain task
+     */
+    void runScheduled();
+
+    /**
+     * @struct DrainSlot
+     * @brief What a pooled drain task reaches its engine through
+     * 
+     * Shared between the engine and its queued tasks, so a task that runs
+     * after the engine is gone finds engine unset and does nothing.
+     */
+    struct DrainSlot {
+        std::mutex mutex;  ///< Held while a task runs; the destructor waits for it
+        Engine* engine;    ///< Engine to drain, or nullptr once destroyed
+    };
+
+    /**
+     * @struct HeldReports
+     * @brief Reports held back by a queued order, so its trader gets them in send order
+     */
+    struct HeldReports {
+        std::vector<ExecutionReport> before;  ///< Cancellations of the orders it displaced, oldest first
+        std::vector<ExecutionReport> after;   ///< Refusals of orders its trader sent after it
+    };
+
     std::thread processingThread;  ///< Thread that processes trading requests
-    std::queue<std::pair<Trader&, std::pair<std::string, double>>> requestQueue;  ///< Queue of pending trading requests
+    std::queue<uint32_t> requestQueue;  ///< Slots of pending trading requests, oldest first
     std::mutex requestMutex;  ///< Mutex for thread-safe queue access
     std::condition_variable condition;  ///< Condition variable for thread synchronization
+    std::condition_variable idleCondition;  ///< Signalled when the queue has been fully drained
     bool stopProcessing;  ///< Flag to control the processing thread's lifecycle
+    bool processing;      ///< True while the processing thread or a drain task is executing requests
+    std::thread::id executor;  ///< Thread executing requests, if any
+    bool drainScheduled;  ///< True while a pooled drain task is queued and has not started
+    std::shared_ptr<DrainSlot> drainSlot;  ///< Engine handle of pooled drain tasks
+    EngineMode mode;      ///< Scheduling mode
+    uint64_t digest;      ///< Running hash of every execution
+    std::unordered_map<uint32_t, uint32_t> digestSlots;  ///< Trader id to order of first appearance, for the digest
+    size_t queueCapacity;   ///< Most requests queued; 0 for no limit
+    QueuePolicy queuePolicy;  ///< What a new order finding the queue full gets
+    EngineQueueStats queueStats;  ///< Queue counters; depth is filled in when read
+    std::condition_variable roomCondition;  ///< Signalled when a request leaves a full queue
+    size_t waitingForRoom;  ///< Senders blocked on roomCondition
+    std::vector<ExecutionReport> refused;  ///< Refusal reports due now, sent by the executing thread
+    std::unordered_map<uint32_t, uint32_t> newestQueued;  ///< Trader id to the slot of its newest queued order, with a limit
+    std::unordered_map<uint32_t, HeldReports> held;       ///< Slot to the reports waiting on the order in it
+
+  protected:
+    /**
+     * @struct Order
+     * @brief A pending order, held in a reusable slot
+     */
+    struct Order {
+        uint64_t id;      ///< Order id
+        Trader* trader;   ///< Trader that sent the order
+        double price;     ///< Order price, limit, or once triggered the price to execute at
+        double stopPrice; ///< Trigger of a stop or stop-limit order
+        OrderType type;   ///< Order type; a triggered stop becomes a market order, a stop-limit a limit order
+        bool buy;         ///< True for a buy, false for a sell
+        bool cancelled;   ///< Whether the order was cancelled while pending
+        bool triggered;   ///< Whether the market reached the order; it executes at price
+        bool resting;     ///< Whether the order is in one of the trigger ladders
+        bool acked;       ///< Whether the order's ack, at its current price, is on the event stream
+    };
+
+    /**
+     * @brief Gives a new order an id and a slot, and indexes it for cancel() and replace()
+     * 
+     * requestMutex must be held in threaded mode.
+     * 
+     * @param trader Trader sending the order
+     * @param type Order type
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price or limit
+     * @param stopPrice Trigger of a stop or stop-limit order
+     * @param slot Receives the order's slot
+     * @return Id of the order
+     */
+    uint64_t storeOrder(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice, uint32_t& slot);
+
+    /**
+     * @brief Frees an order's slot; from then on it can no longer be cancelled or replaced
+     * 
+     * requestMutex must be held in threaded mode.
+     * 
+     * @param slot Slot from storeOrder()
+     * @return The order as it was when released
+     */
+    Order releaseOrder(uint32_t slot);
+
+    /**
+     * @brief Decides what happens to an order reaching the engine
+     * 
+     * Market and triggered orders execute. A limit, stop or stop-limit
+     * order the reference price has reached is triggered at that price;
+     * any other rests in its trigger ladder. requestMutex must be held in
+     * threaded mode.
+     * 
+     * @param slot Slot of the order
+     * @param reference Latest traded price; NaN if nothing has traded yet
+     * @return True if the order executes now, false if it rests
+     */
+    bool arrive(uint32_t slot, double reference);
+
+    /**
+     * @brief Publishes an order's ack on the event stream, unless it has one already
+     * 
+     * Called by the thread executing requests when the order reaches the
+     * engine, so that thread is the stream's only publisher. A resting order
+     * replaced at a new price is acked again when it comes back.
+     * requestMutex must be held in threaded mode.
+     * 
+     * @param slot Slot of the order
+     */
+    void acknowledge(uint32_t slot);
+
+    /**
+     * @brief Takes the resting orders a bar reaches out of the trigger ladders
+     * 
+     * requestMutex must be held in threaded mode.
+     * 
+     * @param current Bar traded
+     * @param slots Receives the slots of the triggered orders, oldest order first
+     */
+    void trigger(const StockData& current, std::vector<uint32_t>& slots);
+
+    /**
+     * @brief Takes a resting order out of its trigger ladder; requestMutex must be held
+     * 
+     * @param slot Slot of the order
+     * @return False if the order was not resting
+     */
+    bool withdraw(uint32_t slot);
+
+    /**
+     * @brief Sends an order taken out of a ladder back through the queue; requestMutex must be held
+     * 
+     * @param slot Slot of the order
+     */
+    virtual void resubmit(uint32_t slot);
+
+    /**
+     * @brief Gets the price a market or triggered order executes at
+     * 
+     * Limit orders execute at exactly their price; other orders pay the
+     * slippage model.
+     * 
+     * @param order Order to execute
+     * @param current Bar the order executes against
+     * @return Execution price
+     */
+    double fillPrice(const Order& order, const StockData& current) const;
+
+    /**
+     * @brief Executes one request and records it in the journal and digest
+     * 
+     * @param orderId Id of the order
+     * @param trader Trader that sent the request
+     * @param isBuy True for a buy, false for a sell
+     * @param price Execution price
+     * @param log Journal to append to, or nullptr
+     * @return Report of the execution, for the trader
+     */
+    ExecutionReport execute(uint64_t orderId, Trader& trader, bool isBuy, double price, Journal* log);
+
+    /**
+     * @brief Applies the slippage model to an order price
+     * 
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price
+     * @param current Bar the order executes against
+     * @return Execution price
+     */
+    double executionPrice(bool isBuy, double price, const StockData& current) const;
+
+    std::vector<Order> orders;          ///< Order slots, reused once their order is released
+    std::vector<uint32_t> freeOrders;   ///< Slots not holding an order
+    OrderIndex orderIndex;              ///< Id of every pending, uncancelled order to its slot
+    TriggerLadder buyLimits;            ///< Resting buy limits, triggered as the price falls
+    TriggerLadder sellLimits;           ///< Resting sell limits, triggered as the price rises
+    TriggerLadder buyStops;             ///< Resting buy stops and stop-limits, triggered as the price rises
+    TriggerLadder sellStops;            ///< Resting sell stops and stop-limits, triggered as the price falls
+    std::atomic<size_t> restingOrders;  ///< Orders in the ladders, read without the lock to skip empty books
+    std::atomic<double> lastClose;      ///< Close of the latest observed bar; NaN before the first
+    std::vector<uint32_t> fired;        ///< Slots of triggered orders, reused between bars
+    std::vector<uint32_t> stopped;      ///< Slots of triggered stops, reused between bars
+    uint64_t nextOrderId; ///< Id given to the next order queued
+    Journal* journal;     ///< Optional journal of orders and fills
+    EventStream* eventStream;  ///< Optional feed of acks and executions
+    uint64_t clock;       ///< Logical time, advanced once per market tick
+    SlippageModel slippage;  ///< Execution cost model
+    StockData bar;        ///< Latest observed bar; guarded by requestMutex in threaded mode
+
+  private:
+    /**
+     * @brief Takes the oldest queued order out of its slot; requestMutex must be held
+     * 
+     * @param order Receives the order, unless it went to rest instead
+     * @return False if the order is resting and there is nothing to execute
+     */
+    bool dequeue(Order& order);
+
+    /**
+     * @brief Gets the ladder an order rests in: by stop until triggered, then by limit
+     */
+    TriggerLadder& ladderOf(const Order& order);
+
+    /**
+     * @brief Republishes the number of resting orders after a ladder changed
+     */
+    void countResting();
+
+    /**
+     * @brief Executes a dequeued order, or reports its cancellation, and tells its trader
+     */
+    void complete(const Order& order, const StockData& current, Journal* log, EventStream* stream);
 };
 
 #endif // ENGINE_H
@@ -0,0 +1,53 @@
+#include "execution_model.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 1 / (2 sqrt(ln 2)), scales ln(high / low) to a standard deviation
+constexpr double kParkinsonScale = 0.6005612043932249;
+
+}  // namespace
+
+LatencySampler::LatencySampler(LatencyModel _model, uint64_t seed) : model(_model), state(seed) {}
+
+int64_t LatencySampler::next() {
+  double jitter = static_cast<double>(model.jitterNs);
+  double extra = 0;
+  switch (model.distribution) {
+    case LatencyDistribution::Fixed:
+      break;
+    case LatencyDistribution::Uniform:
+      extra = jitter * uniform();
+      break;
+    case LatencyDistribution::Exponential:
+      extra = -jitter * std::log(uniform());
+      break;
+    case LatencyDistribution::LogNormal: {
+      // Box-Muller; the second normal is discarded to keep the stream simple
+      double normal = std::sqrt(-2.0 * std::log(uniform())) * std::cos(6.283185307179586 * uniform());
+      extra = jitter * std::exp(normal);
+      break;
+    }
+  }
+  return std::max<int64_t>(0, model.baseNs + static_cast<int64_t>(extra));
+}
+
+// splitmix64, so streams are identical across standard libraries
+double LatencySampler::uniform() {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return ((z >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+double SlippageModel::apply(bool isBuy, double price, uint32_t quantity, const StockData& bar) const {
+  double cost = spreadBps * 0.5e-4;
+  if (impact != 0 && bar.volume > 0 && bar.low > 0 && bar.high > bar.low) {
+    double sigma = kParkinsonScale * std::log(static_cast<double>(bar.high) / bar.low);
+    cost += impact * sigma * std::sqrt(static_cast<double>(quantity) / bar.volume);
+  }
+  return isBuy ? price * (1 + cost) : price * (1 - cost);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file execution_model.h
+ * @brief Simulated order latency and execution slippage
+ *
+ * This file defines the latency distributions a SimulationKernel draws
+ * order delays from and the slippage model the Engine applies to every
+ * execution. Both are deterministic: the same seed and the same input
+ * produce the same delays and the same prices on every run.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "../market/stock_data.h"
+
+/**
+ * @enum LatencyDistribution
+ * @brief Shape of the random part of an order's latency
+ */
+enum class LatencyDistribution {
+  Fixed,        ///< Always the base latency
+  Uniform,      ///< Base plus a uniform draw from [0, jitter]
+  Exponential,  ///< Base plus an exponential draw with mean jitter
+  LogNormal,    ///< Base plus a lognormal draw with median jitter; heavy-tailed
+};
+
+/**
+ * @struct LatencyModel
+ * @brief Distribution of the delay between placing and executing an order
+ */
+struct LatencyModel {
+    LatencyDistribution distribution = LatencyDistribution::Fixed;  ///< Shape of the random part
+    int64_t baseNs = 0;    ///< Minimum latency in ns
+    int64_t jitterNs = 0;  ///< Scale of the random part in ns
+};
+
+/**
+ * @class LatencySampler
+ * @brief Deterministic stream of latencies drawn from a LatencyModel
+ */
+class LatencySampler {
+  public:
+    /**
+     * @brief Constructs a sampler
+     *
+     * @param model Distribution to draw from
+     * @param seed Seed of the random stream
+     */
+    explicit LatencySampler(LatencyModel model = LatencyModel(), uint64_t seed = 1);
+
+    /**
+     * @brief Draws the next latency
+     *
+     * @return Latency in ns, never negative
+     */
+    int64_t next();
+
+  private:
+    /**
+     * @brief Draws a uniform double in (0, 1)
+     */
+    double uniform();
+
+    LatencyModel model;  ///< Distribution
+    uint64_t state;      ///< splitmix64 state
+};
+
+/**
+ * @struct SlippageModel
+ * @brief Cost of crossing the spread and of moving the market
+ *
+ * A buy pays half the spread above the order price and a sell receives
+ * half the spread below it. Market impact follows the square-root law:
+ * the price moves by impact * sigma * sqrt(quantity / volume), with sigma
+ * estimated from the bar's high-low range (Parkinson) and volume taken
+ * from the bar. Bars without a volume or range add no impact.
+ */
+struct SlippageModel {
+    double spreadBps = 0;  ///< Full bid-ask spread in basis points of the price
+    double impact = 0;     ///< Square-root impact coefficient, typically near 1
+
+    /**
+     * @brief Checks whether the model changes any price
+     */
+    bool enabled() const { return spreadBps != 0 || impact != 0; }
+
+    /**
+     * @brief Gets the price an order executes at
+     *
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price
+     * @param quantity Shares in the order
+     * @param bar Bar the order executes against
+     * @return Execution price, worse than the order price for both sides
+     */
+    double apply(bool isBuy, double price, uint32_t quantity, const StockData& bar) const;
+};
@@ -0,0 +1,402 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'T', 'E', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr const char* kSegmentPrefix = "segment-";
+constexpr const char* kSegmentSuffix = ".jnl";
+
+// Records at most this many are copied per group commit, so a busy Engine
+// cannot postpone a due sync indefinitely
+constexpr size_t kMaxCommitRecords = 4096;
+
+/**
+ * @struct SegmentHeader
+ * @brief First 32 bytes of every segment file
+ */
+struct SegmentHeader {
+    char magic[8];        ///< kSegmentMagic
+    uint32_t recordSize;  ///< sizeof(JournalRecord) of the writer
+    uint32_t index;       ///< Position of the segment in the journal
+    uint32_t run;         ///< Journal that wrote the segment; 0 in segments from before runs were numbered
+    char reserved[12];    ///< Zero
+};
+
+static_assert(sizeof(SegmentHeader) == sizeof(JournalRecord), "Segment header must keep records aligned");
+
+std::string segmentPath(const std::string& directory, uint32_t index) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%s%06u%s", kSegmentPrefix, index, kSegmentSuffix);
+  return (std::filesystem::path(directory) / name).string();
+}
+
+bool isSegment(const std::filesystem::path& path) {
+  std::string name = path.filename().string();
+  return name.rfind(kSegmentPrefix, 0) == 0 && path.extension() == kSegmentSuffix;
+}
+
+// Reads and checks a segment's header
+bool readHeader(std::ifstream& file, SegmentHeader& header) {
+  return file.read(reinterpret_cast<char*>(&header), sizeof(header))
+         && std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) == 0
+         && header.recordSize == sizeof(JournalRecord);
+}
+
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+}  // namespace
+
+Journal::Journal(JournalOptions _options)
+: options(std::move(_options)), writeBlock(new RingBlock(options.ringCapacity)), readBlock(writeBlock),
+  growths(0), stopLogging(false), syncRequested(false), appended(0), written(0), durable(0), open(false),
+  currentRun(0), fd(-1), segment(nullptr), used(0), synced(0), segmentIndex(0),
+  lastSync(std::chrono::steady_clock::now()) {
+  options.segmentBytes = std::max(options.segmentBytes, pageSize());
+
+  // Earlier runs, finished or cut short, stay readable ahead of this one
+  // and are told apart from it by their run number
+  std::error_code error;
+  std::filesystem::create_directories(options.directory, error);
+  for (const auto& entry : std::filesystem::directory_iterator(options.directory, error)) {
+    if (isSegment(entry.path())) {
+      std::string name = entry.path().stem().string();
+      uint32_t index = static_cast<uint32_t>(std::strtoul(name.c_str() + std::strlen(kSegmentPrefix), nullptr, 10));
+      segmentIndex = std::max(segmentIndex, index + 1);
+      std::ifstream file(entry.path(), std::ios::binary);
+      SegmentHeader header;
+      if (readHeader(file, header)) {
+        currentRun = std::max(currentRun, header.run + 1);
+      }
+    }
+  }
+
+  open = openSegment();
+  if (open) {
+    logger = std::thread(&Journal::run, this);
+  }
+}
+
+Journal::~Journal() {
+  if (open) {
+    stopLogging.store(true, std::memory_order_release);
+    logger.join();
+    closeSegment();
+  }
+  while (readBlock != nullptr) {
+    RingBlock* next = readBlock->next.load(std::memory_order_acquire);
+    delete readBlock;
+    readBlock = next;
+  }
+}
+
+bool Journal::isOpen() const {
+  return open;
+}
+
+void Journal::append(const JournalRecord& record) {
+  if (!open) {
+    return;
+  }
+  JournalRecord* slot = writeBlock->ring.beginWrite();
+  if (slot == nullptr) {
+    // The logger is behind: rather than stall execution until it catches
+    // up, move on to a ring big enough for the backlog it let build up
+    RingBlock* larger = new RingBlock(writeBlock->ring.capacity() * 2);
+    writeBlock->next.store(larger, std::memory_order_release);
+    writeBlock = larger;
+    growths.store(growths.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slot = writeBlock->ring.beginWrite();
+  }
+  *slot = record;
+  writeBlock->ring.commitWrite();
+  appended.store(appended.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Journal::flush() {
+  if (!open) {
+    return;
+  }
+  uint64_t target = appended.load(std::memory_order_acquire);
+  syncRequested.store(true, std::memory_order_release);
+  for (unsigned attempt = 0; durable.load(std::memory_order_acquire) < target; ++attempt) {
+    backoff(attempt);
+  }
+}
+
+uint64_t Journal::recordsWritten() const {
+  return written.load(std::memory_order_acquire);
+}
+
+uint64_t Journal::ringGrowths() const {
+  return growths.load(std::memory_order_relaxed);
+}
+
+uint32_t Journal::runNumber() const {
+  return currentRun;
+}
+
+// append() publishes the next ring only after its last write to this one,
+// so a ring that is still empty once next is set is done with
+JournalRecord* Journal::beginRead() {
+  while (true) {
+    JournalRecord* record = readBlock->ring.beginRead();
+    if (record != nullptr) {
+      return record;
+    }
+    RingBlock* next = readBlock->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return nullptr;
+    }
+    record = readBlock->ring.beginRead();
+    if (record != nullptr) {
+      return record;
+    }
+    delete readBlock;
+    readBlock = next;
+  }
+}
+
+// Drain the ring in batches, copy each batch into the mapped segment, then
+// decide whether this commit also has to reach the disk.
+void Journal::run() {
+  uint64_t total = 0;
+
+  while (true) {
+    size_t batch = 0;
+    JournalRecord* record = nullptr;
+    while (batch < kMaxCommitRecords && (record = beginRead()) != nullptr) {
+      if (segment != nullptr && used + sizeof(JournalRecord) > options.segmentBytes) {
+        closeSegment();
+        ++segmentIndex;
+        openSegment();
+      }
+      if (segment == nullptr) {
+        // Nothing can be written any more; keep draining so the rings stay small
+        readBlock->ring.commitRead();
+        ++batch;
+        continue;
+      }
+
+      // Publish the type byte last so a record cut short by a crash reads as unwritten
+      JournalRecord copy = *record;
+      JournalRecordType type = copy.type;
+      copy.type = static_cast<JournalRecordType>(0);
+      std::memcpy(segment + used, &copy, sizeof(copy));
+      std::atomic_signal_fence(std::memory_order_release);
+      std::memcpy(segment + used + offsetof(JournalRecord, type), &type, sizeof(type));
+      used += sizeof(JournalRecord);
+
+      readBlock->ring.commitRead();
+      ++batch;
+    }
+    total += batch;
+    written.store(total, std::memory_order_release);
+
+    bool requested = syncRequested.exchange(false, std::memory_order_acq_rel);
+    bool due = false;
+    if (batch > 0 || used > synced) {
+      switch (options.fsync) {
+        case FsyncPolicy::EveryCommit:
+          due = batch > 0;
+          break;
+        case FsyncPolicy::Interval:
+          due = std::chrono::steady_clock::now() - lastSync >= options.syncInterval;
+          break;
+        case FsyncPolicy::Never:
+          break;
+      }
+    }
+    if (requested || due) {
+      sync();
+    }
+    if (requested || due || options.fsync == FsyncPolicy::Never) {
+      durable.store(total, std::memory_order_release);
+    }
+
+    if (batch == kMaxCommitRecords) {
+      continue;
+    }
+    if (stopLogging.load(std::memory_order_acquire) && total == appended.load(std::memory_order_acquire)) {
+      break;
+    }
+    // Sleep even after a partial batch: polling a trickle of records would
+    // take CPU from the Engine, while waiting lets the next commit grow
+    std::this_thread::sleep_for(options.commitInterval);
+  }
+}
+
+bool Journal::openSegment() {
+  std::string path = segmentPath(options.directory, segmentIndex);
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "Cannot open journal segment " << path << ": " << std::strerror(errno) << "\n";
+    return false;
+  }
+  // Allocate the blocks and fault the pages in now, so the copy loop never
+  // stalls on a page fault or block allocation
+  int error = posix_fallocate(fd, 0, static_cast<off_t>(options.segmentBytes));
+  if (error != 0) {
+    std::cerr << "Cannot size journal segment " << path << ": " << std::strerror(error) << "\n";
+    ::close(fd);
+    fd = -1;
+    return false;
+  }
+
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;
+#endif
+  void* mapping = mmap(nullptr, options.segmentBytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map journal segment " << path << ": " << std::strerror(errno) << "\n";
+    ::close(fd);
+    fd = -1;
+    return false;
+  }
+  segment = static_cast<char*>(mapping);
+
+  SegmentHeader header = {};
+  std::memcpy(header.magic, kSegmentMagic, sizeof(header.magic));
+  header.recordSize = sizeof(JournalRecord);
+  header.index = segmentIndex;
+  header.run = currentRun;
+  std::memcpy(segment, &header, sizeof(header));
+  used = sizeof(header);
+  synced = 0;
+  return true;
+}
+
+void Journal::closeSegment() {
+  if (segment == nullptr) {
+    return;
+  }
+  if (options.fsync != FsyncPolicy::Never) {
+    sync();
+  }
+  munmap(segment, options.segmentBytes);
+  segment = nullptr;
+
+  // Drop the preallocated tail so readers see only what was written
+  if (ftruncate(fd, static_cast<off_t>(used)) == 0 && options.fsync != FsyncPolicy::Never) {
+    fsync(fd);
+  }
+  ::close(fd);
+  fd = -1;
+}
+
+void Journal::sync() {
+  lastSync = std::chrono::steady_clock::now();
+  if (segment == nullptr || used <= synced) {
+    return;
+  }
+  size_t start = synced & ~(pageSize() - 1);
+  msync(segment + start, used - start, MS_SYNC);
+  synced = used;
+}
+
+JournalReader::JournalReader(const std::string& directory) {
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+    if (isSegment(entry.path())) {
+      paths.push_back(entry.path().string());
+    }
+  }
+  // Zero-padded indices sort in write order
+  std::sort(paths.begin(), paths.end());
+
+  for (const std::string& path : paths) {
+    std::ifstream file(path, std::ios::binary);
+    SegmentHeader header;
+    if (!readHeader(file, header)) {
+      std::cerr << "Skipping invalid journal segment " << path << "\n";
+      continue;
+    }
+    segments.push_back({path, header.run});
+  }
+}
+
+std::vector<uint32_t> JournalReader::runs() const {
+  std::vector<uint32_t> found;
+  for (const Segment& segment : segments) {
+    found.push_back(segment.run);
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  return found;
+}
+
+std::vector<JournalRecord> JournalReader::readAll() const {
+  std::vector<uint32_t> found = runs();
+  return found.empty() ? std::vector<JournalRecord>() : readRun(found.back());
+}
+
+std::vector<JournalRecord> JournalReader::readRun(uint32_t run) const {
+  std::vector<JournalRecord> records;
+  for (const Segment& segment : segments) {
+    if (segment.run != run) {
+      continue;
+    }
+    std::ifstream file(segment.path, std::ios::binary);
+    file.seekg(sizeof(SegmentHeader));
+
+    JournalRecord record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+      uint8_t type = static_cast<uint8_t>(record.type);
+      if (type < static_cast<uint8_t>(JournalRecordType::Fill) ||
+          type > static_cast<uint8_t>(JournalRecordType::Reject)) {
+        // Unwritten space: the run stopped here, mid-segment if it crashed
+        break;
+      }
+      records.push_back(record);
+    }
+  }
+  return records;
+}
+
+std::map<uint32_t, RecoveredTrader> JournalReader::rebuild(double initialBalance) const {
+  std::vector<uint32_t> found = runs();
+  return found.empty() ? std::map<uint32_t, RecoveredTrader>() : rebuildRun(found.back(), initialBalance);
+}
+
+std::map<uint32_t, RecoveredTrader> JournalReader::rebuildRun(uint32_t run, double initialBalance) const {
+  std::map<uint32_t, RecoveredTrader> traders;
+  for (const JournalRecord& record : readRun(run)) {
+    auto inserted = traders.emplace(record.trader, RecoveredTrader());
+    RecoveredTrader& trader = inserted.first->second;
+    if (inserted.second) {
+      trader.balance = initialBalance;
+    }
+
+    trader.orders += 1;
+    if (record.type == JournalRecordType::Fill) {
+      trader.fills += 1;
+      trader.balance = record.balance;
+      if (record.side == OrderSide::Buy) {
+        trader.position += record.quantity;
+        trader.portfolio.addStock(record.price, record.quantity);
+      } else {
+        trader.position -= record.quantity;
+        trader.portfolio.removeStock(record.price, record.quantity);
+      }
+    }
+  }
+  return traders;
+}
@@ -0,0 +1,302 @@
+/**
+ * @file journal.h
+ * @brief Append-only binary journal of the orders and fills an Engine processes
+ *
+ * This file defines the Journal, which records every order the Engine takes
+ * and its outcome in memory-mapped segment files, and the JournalReader,
+ * which reads them back and rebuilds trader balances and positions after a
+ * run has stopped, cleanly or not.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "../trader/portfolio.h"
+
+/**
+ * @enum JournalRecordType
+ * @brief Outcome of the order a journal record describes
+ *
+ * Zero is reserved: it marks unwritten space at the end of a segment.
+ */
+enum class JournalRecordType : uint8_t {
+  Fill = 1,    ///< The order executed
+  Reject = 2,  ///< The order could not execute (no cash or no stock)
+};
+
+/**
+ * @enum OrderSide
+ * @brief Direction of an order
+ */
+enum class OrderSide : uint8_t {
+  Buy = 0,   ///< Buy shares
+  Sell = 1,  ///< Sell shares
+};
+
+/**
+ * @struct JournalRecord
+ * @brief Fixed-size 32-byte journal entry for one processed order
+ *
+ * Each order the Engine processes produces exactly one record holding the
+ * order and its outcome, written in processing order. A fill carries the
+ * trader's balance after execution so recovery does not depend on knowing
+ * the starting balance.
+ */
+struct JournalRecord {
+    uint64_t orderId;        ///< Engine-assigned order id, starting at 1
+    double price;            ///< Order price
+    double balance;          ///< Trader balance after a fill; 0 otherwise
+    uint32_t trader;         ///< Trader's number in the engine, as in the digest: 0 for the first to execute an order
+    JournalRecordType type;  ///< Kind of event
+    OrderSide side;          ///< Order direction
+    uint16_t quantity;       ///< Shares in the order
+};
+
+static_assert(sizeof(JournalRecord) == 32, "JournalRecord must stay a 32-byte record");
+
+/**
+ * @enum FsyncPolicy
+ * @brief When the logger thread forces written records to disk
+ */
+enum class FsyncPolicy {
+  Never,        ///< Leave write-back to the operating system
+  Interval,     ///< Sync at most once per JournalOptions::syncInterval
+  EveryCommit,  ///< Sync after every group commit
+};
+
+/**
+ * @struct JournalOptions
+ * @brief Configuration of a Journal
+ */
+struct JournalOptions {
+    std::string directory = "./data/journal";  ///< Directory holding the segment files
+    size_t segmentBytes = size_t(16) << 20;    ///< Size of each segment file
+    size_t ringCapacity = 8192;                ///< Records buffered between Engine and logger; small enough to stay in cache
+    FsyncPolicy fsync = FsyncPolicy::Interval; ///< Durability policy
+    std::chrono::milliseconds syncInterval{100};  ///< Period for FsyncPolicy::Interval
+    std::chrono::microseconds commitInterval{200};  ///< Logger sleep between group commits
+};
+
+/**
+ * @class Journal
+ * @brief Write-ahead journal fed through a lock-free ring
+ *
+ * The Engine's processing thread is the only producer: append() copies a
+ * record into an SpscRing and returns. A dedicated logger thread wakes every
+ * commit interval, drains whatever has accumulated, copies it into the
+ * current memory-mapped segment in one pass (group commit) and then applies
+ * the fsync policy. If the logger falls behind and the ring fills, append()
+ * moves on to a ring twice the size rather than wait, and the logger follows
+ * once it has drained the full one.
+ * Segments are preallocated, rolled over when full and truncated to their
+ * used length when closed. Every segment is stamped with the run that
+ * wrote it, so the runs sharing a directory are recovered separately.
+ */
+class Journal {
+  public:
+    /**
+     * @brief Opens a journal and starts the logger thread
+     *
+     * Existing segment files in the directory are kept, and new segments
+     * are numbered after the last one under a new run number. A journal
+     * reopened after a crash keeps the crashed run readable beside the new
+     * one; remove the directory to start over.
+     *
+     * @param options Directory, segment size and durability policy
+     */
+    explicit Journal(JournalOptions options = JournalOptions());
+
+    /**
+     * @brief Writes out every appended record, syncs and stops the logger thread
+     */
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /**
+     * @brief Checks whether the journal's first segment could be created
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Queues a record for the logger thread
+     *
+     * Must only be called from one thread at a time. Never waits for the
+     * logger and never drops a record.
+     *
+     * @param record Record to append; its type must not be zero
+     */
+    void append(const JournalRecord& record);
+
+    /**
+     * @brief Blocks until every appended record is in a segment and synced
+     */
+    void flush();
+
+    /**
+     * @brief Gets the number of records written to segments so far
+     */
+    uint64_t recordsWritten() const;
+
+    /**
+     * @brief Gets how many times append() found the ring full and moved to a larger one
+     */
+    uint64_t ringGrowths() const;
+
+    /**
+     * @brief Gets the run number stamped on this journal's segments
+     */
+    uint32_t runNumber() const;
+
+  private:
+    /**
+     * @brief Logger thread loop
+     */
+    void run();
+
+    /**
+     * @struct RingBlock
+     * @brief One ring of the chain between the Engine and the logger
+     */
+    struct RingBlock {
+        explicit RingBlock(size_t capacity) : ring(capacity), next(nullptr) {}
+
+        SpscRing<JournalRecord> ring;   ///< Records in flight
+        std::atomic<RingBlock*> next;   ///< Larger ring append() moved on to, or nullptr
+    };
+
+    /**
+     * @brief Gets the oldest record not yet taken by the logger
+     *
+     * Moves on to the next ring, freeing the drained one, once append() has.
+     *
+     * @return The record, or nullptr if there is none
+     */
+    JournalRecord* beginRead();
+
+    /**
+     * @brief Maps a fresh segment file
+     */
+    bool openSegment();
+
+    /**
+     * @brief Syncs, unmaps and truncates the current segment
+     */
+    void closeSegment();
+
+    /**
+     * @brief Forces the records written since the last sync to disk
+     */
+    void sync();
+
+    JournalOptions options;           ///< Configuration
+    RingBlock* writeBlock;            ///< Ring append() writes to; used by the producer only
+    RingBlock* readBlock;             ///< Ring the logger reads from; owns it and every later one
+    std::atomic<uint64_t> growths;    ///< Times append() moved on to a larger ring
+    std::thread logger;               ///< Thread writing segments
+    std::atomic<bool> stopLogging;    ///< Asks the logger to drain and exit
+    std::atomic<bool> syncRequested;  ///< Asks the logger to sync regardless of policy
+    std::atomic<uint64_t> appended;   ///< Records handed to the ring
+    std::atomic<uint64_t> written;    ///< Records copied into segments
+    std::atomic<uint64_t> durable;    ///< Records known to be on disk
+    bool open;                        ///< Whether segments can be written
+    uint32_t currentRun;              ///< One more than the highest run found in the directory
+
+    // Owned by the logger thread
+    int fd;                 ///< Current segment file descriptor
+    char* segment;          ///< Mapping of the current segment
+    size_t used;            ///< Bytes written into the current segment
+    size_t synced;          ///< Bytes of the current segment known to be on disk
+    uint32_t segmentIndex;  ///< Index of the current segment
+    std::chrono::steady_clock::time_point lastSync;  ///< Time of the last sync
+};
+
+/**
+ * @struct RecoveredTrader
+ * @brief Trader state rebuilt from a journal
+ */
+struct RecoveredTrader {
+    double balance = 0;     ///< Balance after the last fill
+    int position = 0;       ///< Shares held
+    uint64_t orders = 0;    ///< Orders processed
+    uint64_t fills = 0;     ///< Orders that executed
+    Portfolio portfolio;    ///< Positions and history replayed from fills
+};
+
+/**
+ * @class JournalReader
+ * @brief Reads the segments of a journal in order, one run at a time
+ *
+ * Each run numbers its traders from 0, so records of different runs are
+ * never merged. Reading a segment stops at its first unwritten or partially
+ * written record, which is where a run that died mid-write left off.
+ */
+class JournalReader {
+  public:
+    /**
+     * @brief Opens every segment in a journal directory
+     *
+     * @param directory Directory passed to Journal
+     */
+    explicit JournalReader(const std::string& directory);
+
+    /**
+     * @brief Gets the runs that wrote segments to the directory
+     *
+     * @return Run numbers, oldest first
+     */
+    std::vector<uint32_t> runs() const;
+
+    /**
+     * @brief Reads every complete record of the latest run
+     *
+     * @return Records in the order they were written
+     */
+    std::vector<JournalRecord> readAll() const;
+
+    /**
+     * @brief Reads every complete record of one run
+     *
+     * @param run Run number, as returned by runs()
+     * @return Records in the order they were written
+     */
+    std::vector<JournalRecord> readRun(uint32_t run) const;
+
+    /**
+     * @brief Rebuilds the state of every trader of the latest run
+     *
+     * @param initialBalance Balance of traders that never filled
+     * @return State by the trader's number in the engine
+     */
+    std::map<uint32_t, RecoveredTrader> rebuild(double initialBalance = 1000000) const;
+
+    /**
+     * @brief Rebuilds the state of every trader of one run
+     *
+     * @param run Run number, as returned by runs()
+     * @param initialBalance Balance of traders that never filled
+     * @return State by the trader's number in the engine
+     */
+    std::map<uint32_t, RecoveredTrader> rebuildRun(uint32_t run, double initialBalance = 1000000) const;
+
+  private:
+    /**
+     * @struct Segment
+     * @brief A valid segment file and the run that wrote it
+     */
+    struct Segment {
+        std::string path;  ///< Segment file
+        uint32_t run;      ///< Run number from its header
+    };
+
+    std::vector<Segment> segments;  ///< Valid segments in write order
+};
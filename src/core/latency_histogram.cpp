@@ -0,0 +1,78 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() : counts{}, total(0), sum(0), longest(0) {}
+
+void LatencyHistogram::record(int64_t nanos) {
+  uint64_t value = nanos > 0 ? static_cast<uint64_t>(nanos) : 0;
+  counts[bucketOf(value)] += 1;
+  total += 1;
+  sum += static_cast<double>(value);
+  longest = std::max<int64_t>(longest, static_cast<int64_t>(value));
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kBuckets; ++i) {
+    counts[i] += other.counts[i];
+  }
+  total += other.total;
+  sum += other.sum;
+  longest = std::max(longest, other.longest);
+}
+
+void LatencyHistogram::reset() {
+  *this = LatencyHistogram();
+}
+
+uint64_t LatencyHistogram::count() const {
+  return total;
+}
+
+double LatencyHistogram::mean() const {
+  return total > 0 ? sum / static_cast<double>(total) : 0.0;
+}
+
+int64_t LatencyHistogram::max() const {
+  return longest;
+}
+
+int64_t LatencyHistogram::percentile(double percent) const {
+  if (total == 0) {
+    return 0;
+  }
+  // Rank of the duration wanted, counting from 1
+  double clamped = std::clamp(percent, 0.0, 100.0);
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(total))));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return std::min<int64_t>(static_cast<int64_t>(std::min<uint64_t>(upperBound(i), INT64_MAX)), longest);
+    }
+  }
+  return longest;
+}
+
+// Values below 2^kSubBits have a bucket each; above, every power of two is
+// split into 2^kSubBits equal buckets by the bits after the leading one
+size_t LatencyHistogram::bucketOf(uint64_t nanos) {
+  if (nanos < (uint64_t(1) << kSubBits)) {
+    return static_cast<size_t>(nanos);
+  }
+  int exponent = std::bit_width(nanos) - 1;
+  uint64_t sub = (nanos >> (exponent - kSubBits)) & ((uint64_t(1) << kSubBits) - 1);
+  return (static_cast<size_t>(exponent - kSubBits + 1) << kSubBits) + static_cast<size_t>(sub);
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) {
+  if (bucket < (size_t(1) << kSubBits)) {
+    return bucket;
+  }
+  int shift = static_cast<int>(bucket >> kSubBits) - 1;
+  uint64_t sub = bucket & ((size_t(1) << kSubBits) - 1);
+  uint64_t lower = ((uint64_t(1) << kSubBits) + sub) << shift;
+  return lower + ((uint64_t(1) << shift) - 1);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file latency_histogram.h
+ * @brief Fixed-size histogram of latencies with bounded relative error
+ *
+ * This file defines LatencyHistogram, which counts nanosecond durations in
+ * buckets that grow with the value: eight linear buckets per power of two,
+ * so any percentile it reports is within 12.5% of the true value. Recording
+ * is a few instructions and never allocates, so it can sit on a hot path.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * @brief Counts of durations by logarithmic bucket
+ *
+ * Not thread-safe; each writer keeps its own histogram and merges it into
+ * a total when a report is wanted.
+ */
+class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    /**
+     * @brief Counts one duration
+     *
+     * @param nanos Duration in ns; negative values count as 0
+     */
+    void record(int64_t nanos);
+
+    /**
+     * @brief Adds the counts of another histogram
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief Forgets every duration recorded
+     */
+    void reset();
+
+    /**
+     * @brief Gets the number of durations recorded
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Gets the mean duration in ns; 0 if empty
+     */
+    double mean() const;
+
+    /**
+     * @brief Gets the longest duration recorded in ns
+     */
+    int64_t max() const;
+
+    /**
+     * @brief Gets a percentile
+     *
+     * @param percent Percentile in [0, 100]
+     * @return Upper bound of the bucket holding it, capped at max(); 0 if empty
+     */
+    int64_t percentile(double percent) const;
+
+  private:
+    static constexpr int kSubBits = 3;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+    /**
+     * @brief Gets the bucket a duration falls in
+     */
+    static size_t bucketOf(uint64_t nanos);
+
+    /**
+     * @brief Gets the largest duration a bucket holds
+     */
+    static uint64_t upperBound(size_t bucket);
+
+    std::array<uint64_t, kBuckets> counts;  ///< Durations per bucket
+    uint64_t total;                         ///< Durations recorded
+    double sum;                             ///< Sum of durations, for the mean
+    int64_t longest;                        ///< Longest duration recorded
+};
@@ -0,0 +1,105 @@
+#include "order_index.h"
+
+#include <limits>
+
+namespace {
+
+constexpr uint64_t kEmpty = 0;
+constexpr uint64_t kTombstone = std::numeric_limits<uint64_t>::max();
+
+// Consecutive ids placed side by side: four cache lines of entries
+constexpr uint64_t kRun = 16;
+
+}  // namespace
+
+OrderIndex::OrderIndex(size_t minCapacity) : mask(0), shift(64), live(0), tombstones(0) {
+  size_t capacity = 2 * kRun;
+  while (capacity < minCapacity * 2) {
+    capacity <<= 1;
+  }
+  rebuild(capacity);
+}
+
+// Ids arrive in sequence, so each run of kRun consecutive ids shares a few
+// cache lines, and Fibonacci hashing scatters the runs. Unscattered ids
+// would pile up once resting orders pin old ids and new ones wrap onto them
+size_t OrderIndex::home(uint64_t id) const {
+  uint64_t run = ((id / kRun) * 0x9E3779B97F4A7C15ULL) >> shift;
+  return static_cast<size_t>(run * kRun + id % kRun) & mask;
+}
+
+// Kept at most three quarters full counting tombstones, so probes stay short
+// even when most orders are cancelled rather than filled
+void OrderIndex::insert(uint64_t id, uint32_t slot) {
+  if ((live + tombstones + 1) * 4 > entries.size() * 3) {
+    size_t capacity = entries.size();
+    while ((live + 1) * 2 > capacity) {
+      capacity <<= 1;
+    }
+    rebuild(capacity);
+  }
+
+  size_t i = home(id);
+  while (entries[i].id != kEmpty && entries[i].id != kTombstone) {
+    i = (i + 1) & mask;
+  }
+  if (entries[i].id == kTombstone) {
+    tombstones -= 1;
+  }
+  entries[i] = {id, slot};
+  live += 1;
+}
+
+bool OrderIndex::find(uint64_t id, uint32_t& slot) const {
+  for (size_t i = home(id); entries[i].id != kEmpty; i = (i + 1) & mask) {
+    if (entries[i].id == id) {
+      slot = entries[i].slot;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OrderIndex::erase(uint64_t id) {
+  for (size_t i = home(id); entries[i].id != kEmpty; i = (i + 1) & mask) {
+    if (entries[i].id == id) {
+      // The cell after an empty one needs no tombstone: no probe runs through it
+      if (entries[(i + 1) & mask].id == kEmpty) {
+        entries[i].id = kEmpty;
+      } else {
+        entries[i].id = kTombstone;
+        tombstones += 1;
+      }
+      live -= 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t OrderIndex::size() const {
+  return live;
+}
+
+void OrderIndex::rebuild(size_t capacity) {
+  std::vector<Entry> old(capacity, Entry{kEmpty, 0});
+  old.swap(entries);
+  mask = capacity - 1;
+  shift = 64;
+  for (size_t runs = capacity / kRun; runs > 1; runs >>= 1) {
+    shift -= 1;
+  }
+  live = 0;
+  tombstones = 0;
+
+  for (const Entry& entry : old) {
+    if (entry.id != kEmpty && entry.id != kTombstone) {
+      size_t i = home(entry.id);
+      while (entries[i].id != kEmpty) {
+        i = (i + 1) & mask;
+      }
+      entries[i] = entry;
+      live += 1;
+    }
+  }
+}
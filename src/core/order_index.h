@@ -0,0 +1,91 @@
+/**
+ * @file order_index.h
+ * @brief Open-addressing hash index from order id to order slot
+ *
+ * This file defines OrderIndex, which maps the id of every live order to
+ * the slot holding it, so cancel and replace requests find their order in
+ * O(1) however many orders are queued or resting. The table is one flat
+ * array probed linearly, so a lookup touches one or two cache lines and
+ * nothing is allocated per order.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class OrderIndex
+ * @brief Map from nonzero order ids to 32-bit slots
+ *
+ * Erased entries become tombstones, so erasing never moves other entries;
+ * tombstones are reused by later inserts and cleared whenever the table is
+ * rebuilt. Not thread-safe: callers guard it with the lock that guards the
+ * orders themselves.
+ */
+class OrderIndex {
+  public:
+    /**
+     * @brief Constructs an empty index
+     *
+     * @param minCapacity Entries to make room for before the first rebuild
+     */
+    explicit OrderIndex(size_t minCapacity = 64);
+
+    /**
+     * @brief Adds an order
+     *
+     * @param id Order id; nonzero and not already present
+     * @param slot Slot holding the order
+     */
+    void insert(uint64_t id, uint32_t slot);
+
+    /**
+     * @brief Looks up an order
+     *
+     * @param id Order id
+     * @param slot Receives the order's slot if found
+     * @return True if the order is present
+     */
+    bool find(uint64_t id, uint32_t& slot) const;
+
+    /**
+     * @brief Removes an order
+     *
+     * @param id Order id
+     * @return True if the order was present
+     */
+    bool erase(uint64_t id);
+
+    /**
+     * @brief Gets the number of orders present
+     */
+    size_t size() const;
+
+  private:
+    /**
+     * @struct Entry
+     * @brief One table cell; id 0 is empty and the maximum id a tombstone
+     */
+    struct Entry {
+        uint64_t id;    ///< Order id, or an empty or tombstone marker
+        uint32_t slot;  ///< Slot holding the order
+    };
+
+    /**
+     * @brief Gets the cell a probe for an id starts at
+     */
+    size_t home(uint64_t id) const;
+
+    /**
+     * @brief Rebuilds the table with a capacity, dropping tombstones
+     */
+    void rebuild(size_t capacity);
+
+    std::vector<Entry> entries;  ///< Cells; the size is a power of two
+    size_t mask;                 ///< Capacity minus one
+    unsigned shift;              ///< 64 minus log2 of the number of runs of cells
+    size_t live;                 ///< Orders present
+    size_t tombstones;           ///< Cells holding a tombstone
+};
@@ -0,0 +1,191 @@
+#include "simulation_kernel.h"
+#include "../net/event_publisher.h"
+#include "../trader/trader.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+SimulationKernel::SimulationKernel(KernelConfig _config)
+: Engine(EngineMode::Deterministic), config(_config), latency(config.orderLatency, config.seed), time(0), lastArrival(0), sequence(0), ticks(0), dispatched(0),
+  lastPrice(0), hasPrice(false) {}
+
+void SimulationKernel::addTrader(Trader* trader) {
+  bars.addTrader(trader);
+}
+
+void SimulationKernel::setReportHandler(ReportHandler handler) {
+  reportHandler = std::move(handler);
+}
+
+// Callbacks live in reusable slots so the heap only moves plain events
+void SimulationKernel::scheduleTimer(int64_t delayNs, TimerCallback callback) {
+  uint32_t slot;
+  if (!freeTimers.empty()) {
+    slot = freeTimers.back();
+    freeTimers.pop_back();
+    timers[slot] = std::move(callback);
+  } else {
+    slot = static_cast<uint32_t>(timers.size());
+    timers.push_back(std::move(callback));
+  }
+  schedule({time + delayNs, 0, 0, nullptr, 0, slot, EventType::Timer, false, ExecutionStatus::Filled, RejectReason::None});
+}
+
+// Merge the tick array with the event heap; ties go to the heap so orders
+// placed on one tick execute before the next tick at the same timestamp
+void SimulationKernel::run(const StockData* data, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    runUntil(data[i].timestamp);
+    dispatchTick(data[i]);
+  }
+  if (count > 0) {
+    runUntil(data[count - 1].timestamp);
+    // Partial bars count as one more tick, as they do for a StockMarket
+    if (bars.finish()) {
+      clock = ticks++;
+      runUntil(data[count - 1].timestamp);
+    }
+  }
+  clock = ticks;
+}
+
+uint64_t SimulationKernel::processBuy(Trader& trader, double price) {
+  return processOrder(trader, OrderType::Market, true, price, 0);
+}
+
+uint64_t SimulationKernel::processSell(Trader& trader, double price) {
+  return processOrder(trader, OrderType::Market, false, price, 0);
+}
+
+uint64_t SimulationKernel::processOrder(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice) {
+  uint32_t slot;
+  uint64_t orderId = storeOrder(trader, type, isBuy, price, stopPrice, slot);
+  send(slot);
+  return orderId;
+}
+
+void SimulationKernel::waitUntilIdle() {
+  runUntil(std::numeric_limits<int64_t>::max());
+}
+
+int64_t SimulationKernel::now() const {
+  return time;
+}
+
+uint64_t SimulationKernel::eventsProcessed() const {
+  return dispatched;
+}
+
+void SimulationKernel::schedule(Event event) {
+  event.sequence = sequence++;
+  events.push(event);
+}
+
+void SimulationKernel::runUntil(int64_t limit) {
+  while (!events.empty() && events.top().time <= limit) {
+    Event event = events.top();
+    events.pop();
+    dispatch(event);
+  }
+}
+
+// The Engine clock counts ticks, as a StockMarket advancing a deterministic
+// Engine would, so both produce the same digest for the same executions
+void SimulationKernel::dispatchTick(const StockData& tick) {
+  time = tick.timestamp;
+  clock = ticks++;
+  bar = tick;
+  lastPrice = tick.close;
+  hasPrice = true;
+  dispatched += 1;
+  // Resting orders the tick reaches execute before any trader sees it
+  if (eventStream != nullptr) {
+    eventStream->price(tick);
+  }
+  trigger(tick, fired);
+  for (uint32_t slot : fired) {
+    fill(slot);
+  }
+  fired.clear();
+  bars.publish(tick);
+}
+
+void SimulationKernel::dispatch(const Event& event) {
+  time = event.time;
+  dispatched += 1;
+  switch (event.type) {
+    case EventType::Order:
+      if (!orders[event.slot].cancelled) {
+        acknowledge(event.slot);
+        if (!arrive(event.slot, hasPrice ? lastPrice : std::numeric_limits<double>::quiet_NaN())) {
+          break;
+        }
+      }
+      fill(event.slot);
+      break;
+    case EventType::Report:
+      if (event.status == ExecutionStatus::Cancelled) {
+        deliver(ExecutionReport::cancelled(event.orderId, time, event.trader, event.price, event.buy));
+      } else {
+        deliver(ExecutionReport::single(event.orderId, time, event.trader, event.price, event.buy, event.reason));
+      }
+      break;
+    case EventType::Timer: {
+      TimerCallback callback = std::move(timers[event.slot]);
+      freeTimers.push_back(event.slot);
+      callback();
+      break;
+    }
+  }
+}
+
+void SimulationKernel::fill(uint32_t slot) {
+  Order order = releaseOrder(slot);
+  if (order.cancelled) {
+    ExecutionReport cancelled = ExecutionReport::cancelled(order.id, time, order.trader, order.price, order.buy);
+    if (eventStream != nullptr) {
+      eventStream->execution(cancelled);
+    }
+    report(cancelled);
+    return;
+  }
+  // An order that spent time in flight trades at the price it finds; a
+  // triggered one at the price that triggered it
+  double price = order.triggered ? fillPrice(order, bar)
+                                 : executionPrice(order.buy, hasPrice ? lastPrice : order.price, bar);
+  ExecutionReport executed = execute(order.id, *order.trader, order.buy, price, journal);
+  executed.time = time;
+  if (eventStream != nullptr) {
+    eventStream->execution(executed);
+  }
+  report(executed);
+}
+
+// Withdrawn by a cancel or replace, which take effect at once, as they do
+// for orders still in flight
+void SimulationKernel::resubmit(uint32_t slot) {
+  schedule({time, 0, 0, nullptr, 0, slot, EventType::Order, false, ExecutionStatus::Filled, RejectReason::None});
+}
+
+void SimulationKernel::report(const ExecutionReport& executed) {
+  if (config.reportLatencyNs == 0) {
+    deliver(executed);
+    return;
+  }
+  schedule({time + config.reportLatencyNs, 0, executed.orderId, executed.trader, executed.price, 0, EventType::Report,
+            executed.buy, executed.status, executed.reason});
+}
+
+void SimulationKernel::deliver(const ExecutionReport& executed) {
+  executed.trader->deliverExecution(executed);
+  if (reportHandler) {
+    reportHandler(executed);
+  }
+}
+
+// An order never overtakes one sent before it, whatever latency it drew
+void SimulationKernel::send(uint32_t slot) {
+  lastArrival = std::max(time + latency.next(), lastArrival);
+  schedule({lastArrival, 0, 0, nullptr, 0, slot, EventType::Order, false, ExecutionStatus::Filled, RejectReason::None});
+}
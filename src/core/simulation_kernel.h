@@ -0,0 +1,242 @@
+/**
+ * @file simulation_kernel.h
+ * @brief Single-threaded discrete-event backtesting kernel
+ *
+ * This file defines the SimulationKernel, an Engine that runs a whole
+ * backtest on the calling thread: market ticks, order arrivals, execution
+ * reports and strategy timers are events ordered by simulated time, so no
+ * lock, condition variable or second thread is involved. Independent
+ * backtests scale by running one kernel per core.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "engine.h"
+#include "execution_model.h"
+#include "../market/bar_aggregator.h"
+#include "../market/stock_data.h"
+#include "../trader/trader.h"
+
+/**
+ * @struct KernelConfig
+ * @brief Simulated latencies of a SimulationKernel
+ */
+struct KernelConfig {
+    LatencyModel orderLatency;   ///< Delay between placing an order and its execution
+    int64_t reportLatencyNs = 0; ///< Delay between an execution and its report
+    uint64_t seed = 1;           ///< Seed of the order latency stream
+};
+
+/**
+ * @class SimulationKernel
+ * @brief Engine driven by a discrete-event queue on one thread
+ *
+ * Ticks are read in order from a contiguous array and merged with a binary
+ * heap of pending events; at equal times pending events run before the
+ * tick. An order placed while a tick is being delivered arrives after a
+ * latency drawn from the configured model and executes, after slippage, at
+ * the last traded price at that moment. Orders travel one ordered channel,
+ * like a session to an exchange, so jitter delays but never reorders them.
+ * The trader that placed an order receives its ExecutionReport after the
+ * report latency. With zero latency and traders
+ * taking the stream as delivered, the kernel executes exactly what a
+ * deterministic Engine driven by a StockMarket would, with the same digest.
+ */
+class SimulationKernel : public Engine {
+  public:
+    /// Callback run when a timer fires
+    using TimerCallback = std::function<void()>;
+
+    /// Callback receiving execution reports
+    using ReportHandler = std::function<void(const ExecutionReport&)>;
+
+    /**
+     * @brief Constructs an idle kernel
+     *
+     * @param config Simulated latencies
+     */
+    explicit SimulationKernel(KernelConfig config = KernelConfig());
+
+    /**
+     * @brief Adds a trader to receive ticks aggregated to its bar size
+     *
+     * The trader's engine must be set to this kernel.
+     *
+     * @param trader Trader to notify; must outlive the kernel's runs
+     */
+    void addTrader(Trader* trader);
+
+    /**
+     * @brief Sets the receiver of execution reports
+     *
+     * The handler sees every report, when its trader does.
+     *
+     * @param handler Callback, or an empty function to stop reporting
+     */
+    void setReportHandler(ReportHandler handler);
+
+    /**
+     * @brief Schedules a callback after a simulated delay
+     *
+     * @param delayNs Delay from now in ns
+     * @param callback Function to run; may schedule further timers
+     */
+    void scheduleTimer(int64_t delayNs, TimerCallback callback);
+
+    /**
+     * @brief Replays ticks and every event due up to the last of them
+     *
+     * Bars still being aggregated are delivered at the time of the last
+     * tick. Events scheduled for later, such as orders still in flight after
+     * the last tick, remain pending for waitUntilIdle().
+     *
+     * @param data Ticks ordered by timestamp
+     * @param count Number of ticks
+     */
+    void run(const StockData* data, size_t count);
+
+    /**
+     * @brief Queues a buy order to arrive after the order latency
+     *
+     * @param trader Trader placing the order
+     * @param price Price the trader saw
+     * @return Id of the order; it can be cancelled or replaced until it arrives
+     */
+    uint64_t processBuy(Trader& trader, double price) override;
+
+    /**
+     * @brief Queues a sell order to arrive after the order latency
+     *
+     * @param trader Trader placing the order
+     * @param price Price the trader saw
+     * @return Id of the order; it can be cancelled or replaced until it arrives
+     */
+    uint64_t processSell(Trader& trader, double price) override;
+
+    /**
+     * @brief Queues an order of any type to arrive after the order latency
+     * 
+     * A conditional order the market has not reached when it arrives rests
+     * until a tick reaches it, and then executes at that tick's time.
+     * 
+     * @param trader Trader placing the order
+     * @param type Order type
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price of a market order, limit of a limit or stop-limit order
+     * @param stopPrice Trigger of a stop or stop-limit order
+     * @return Id of the order
+     */
+    uint64_t processOrder(Trader& trader, OrderType type, bool isBuy, double price, double stopPrice) override;
+
+    /**
+     * @brief Runs every pending event, however far in the future
+     */
+    void waitUntilIdle() override;
+
+    /**
+     * @brief Gets the current simulated time in ns
+     */
+    int64_t now() const;
+
+    /**
+     * @brief Gets the number of ticks and events dispatched so far
+     */
+    uint64_t eventsProcessed() const;
+
+  private:
+    /**
+     * @enum EventType
+     * @brief Kind of a pending event
+     */
+    enum class EventType : uint8_t {
+      Order,   ///< An order reaches the engine
+      Report,  ///< An execution report reaches its trader
+      Timer,   ///< A timer fires
+    };
+
+    /**
+     * @struct Event
+     * @brief Pending event, ordered by time and then by scheduling order
+     */
+    struct Event {
+        int64_t time;       ///< Simulated time of the event, in ns
+        uint64_t sequence;  ///< Scheduling order, breaks ties between equal times
+        uint64_t orderId;   ///< Id of a reported order
+        Trader* trader;     ///< Trader of a report
+        double price;       ///< Execution price of a report
+        uint32_t slot;      ///< Slot of an order or of a timer callback
+        EventType type;     ///< Kind of event
+        bool buy;           ///< Side of a report
+        ExecutionStatus status;  ///< Report outcome
+        RejectReason reason;     ///< Why a reported order was rejected
+
+        bool operator>(const Event& other) const {
+          return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    /**
+     * @brief Adds an event to the heap
+     */
+    void schedule(Event event);
+
+    /**
+     * @brief Runs pending events due at or before a time
+     */
+    void runUntil(int64_t time);
+
+    /**
+     * @brief Delivers one tick to every trader at its resolution
+     */
+    void dispatchTick(const StockData& tick);
+
+    /**
+     * @brief Runs one pending event
+     */
+    void dispatch(const Event& event);
+
+    /**
+     * @brief Executes an order that reached the market, or reports its cancellation
+     */
+    void fill(uint32_t slot);
+
+    /**
+     * @brief Sends a withdrawn resting order back to the market at once
+     */
+    void resubmit(uint32_t slot) override;
+
+    /**
+     * @brief Delivers an execution report after the report latency
+     */
+    void report(const ExecutionReport& executed);
+
+    /**
+     * @brief Delivers an execution report to its trader and the handler now
+     */
+    void deliver(const ExecutionReport& executed);
+
+    /**
+     * @brief Schedules the arrival of a stored order, behind every order sent before it
+     */
+    void send(uint32_t slot);
+
+    KernelConfig config;            ///< Simulated latencies
+    LatencySampler latency;         ///< Order latency stream
+    BarRouter bars;                 ///< Traders by subscribed bar size
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;  ///< Pending events, earliest first
+    std::vector<TimerCallback> timers;  ///< Timer callbacks by slot
+    std::vector<uint32_t> freeTimers;   ///< Slots of timers that already fired
+    ReportHandler reportHandler;    ///< Receiver of execution reports
+    int64_t time;                   ///< Current simulated time in ns
+    int64_t lastArrival;            ///< Arrival time of the latest order, keeps orders in sequence
+    uint64_t sequence;              ///< Events scheduled so far
+    uint64_t ticks;                 ///< Ticks delivered so far, plus final partial bar deliveries
+    uint64_t dispatched;            ///< Ticks and events dispatched so far
+    double lastPrice;               ///< Close of the latest tick
+    bool hasPrice;                  ///< Whether any tick has been delivered
+};
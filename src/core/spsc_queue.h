@@ -0,0 +1,127 @@
+/**
+ * @file spsc_queue.h
+ * @brief Unbounded lock-free single-producer single-consumer queue
+ *
+ * This file defines SpscQueue, a queue of fixed-size chunks linked in
+ * order. Unlike SpscRing it never refuses a value, so a producer that must
+ * not block, such as an engine thread reporting executions, can always
+ * hand off its output however far behind the consumer is. Chunks the
+ * consumer has finished are recycled for the producer, so a queue in
+ * steady state allocates nothing.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "spsc_ring.h"
+
+/**
+ * @class SpscQueue
+ * @brief Unbounded queue of T shared by one producer and one consumer
+ *
+ * @tparam T Value type; copied in and out
+ * @tparam ChunkSize Values per chunk
+ */
+template <typename T, size_t ChunkSize = 64>
+class SpscQueue {
+  public:
+    SpscQueue() : head(new Chunk), readIndex(0), tail(head), writeIndex(0), lastChunk(head), spare(nullptr) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    ~SpscQueue() {
+      while (head != nullptr) {
+        Chunk* next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+      }
+      delete spare.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Appends a value; called by the producer only
+     *
+     * @param value Value to append
+     */
+    void push(const T& value) {
+      if (writeIndex == ChunkSize) {
+        Chunk* chunk = spare.exchange(nullptr, std::memory_order_acquire);
+        if (chunk == nullptr) {
+          chunk = new Chunk;
+        }
+        chunk->written.store(0, std::memory_order_relaxed);
+        chunk->next.store(nullptr, std::memory_order_relaxed);
+        tail->next.store(chunk, std::memory_order_release);
+        tail = chunk;
+        writeIndex = 0;
+        lastChunk.store(chunk, std::memory_order_relaxed);
+      }
+      tail->items[writeIndex] = value;
+      writeIndex += 1;
+      tail->written.store(writeIndex, std::memory_order_release);
+    }
+
+    /**
+     * @brief Removes the oldest value; called by the consumer only
+     *
+     * @param value Destination of the value
+     * @return False if the queue is empty
+     */
+    bool tryPop(T& value) {
+      if (readIndex == ChunkSize) {
+        Chunk* next = head->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+          return false;
+        }
+        recycle(head);
+        head = next;
+        readIndex = 0;
+      }
+      if (readIndex == head->written.load(std::memory_order_acquire)) {
+        return false;
+      }
+      value = head->items[readIndex];
+      readIndex += 1;
+      return true;
+    }
+
+    /**
+     * @brief Checks whether more than a chunk is waiting; called by the consumer only
+     *
+     * Reads a field the producer writes once per chunk, so it is cheap to
+     * call often.
+     */
+    bool backlogged() const {
+      return head != lastChunk.load(std::memory_order_relaxed);
+    }
+
+  private:
+    /**
+     * @struct Chunk
+     * @brief A block of values plus the link to the next block
+     */
+    struct Chunk {
+        T items[ChunkSize];                 ///< Values, written in order
+        std::atomic<size_t> written{0};     ///< Values the producer has published
+        std::atomic<Chunk*> next{nullptr};  ///< Next chunk, once the producer has filled this one
+    };
+
+    /**
+     * @brief Keeps one finished chunk for the producer to reuse
+     */
+    void recycle(Chunk* chunk) {
+      delete spare.exchange(chunk, std::memory_order_release);
+    }
+
+    Chunk* head;         ///< Chunk the consumer reads from
+    size_t readIndex;    ///< Next value to read in head
+
+    alignas(kCacheLineSize) Chunk* tail;  ///< Chunk the producer writes to
+    size_t writeIndex;   ///< Next value to write in tail
+
+    alignas(kCacheLineSize) std::atomic<Chunk*> lastChunk;  ///< Copy of tail for the consumer
+    alignas(kCacheLineSize) std::atomic<Chunk*> spare;      ///< Finished chunk awaiting reuse
+};
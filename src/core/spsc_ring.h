@@ -0,0 +1,181 @@
+/**
+ * @file spsc_ring.h
+ * @brief Bounded lock-free single-producer single-consumer ring
+ *
+ * This file defines SpscRing, a fixed-capacity ring buffer that hands slots
+ * from exactly one producer thread to exactly one consumer thread without
+ * locks. Slots are written and read in place, so large records such as
+ * batches of rows are never copied through the ring.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/// Size used to keep independently written fields on separate cache lines
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief Briefly spins, then yields, while waiting on another thread
+ *
+ * @param attempt Number of times the caller has already waited
+ */
+inline void backoff(unsigned attempt) {
+  if (attempt < 64) {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    _mm_pause();
+#endif
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * @class SpscRing
+ * @brief Fixed-capacity ring of T shared by one producer and one consumer
+ *
+ * The producer calls beginWrite() to get a free slot, fills it and calls
+ * commitWrite(). The consumer calls beginRead() to get the oldest filled
+ * slot, uses it and calls commitRead(). Head and tail live on separate
+ * cache lines and each side caches the other's index to avoid touching the
+ * shared line on every operation.
+ *
+ * @tparam T Slot type; slots are default constructed once and reused
+ */
+template <typename T>
+class SpscRing {
+  public:
+    /**
+     * @brief Constructs a ring with room for at least the given number of slots
+     *
+     * @param minCapacity Minimum capacity; rounded up to a power of two
+     */
+    explicit SpscRing(size_t minCapacity) {
+      size_t capacity = 1;
+      while (capacity < minCapacity) {
+        capacity <<= 1;
+      }
+      slots = std::vector<T>(capacity);
+      mask = capacity - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Gets the next free slot for the producer
+     *
+     * @return Pointer to the slot, or nullptr if the ring is full
+     */
+    T* beginWrite() {
+      size_t head = producer.index.load(std::memory_order_relaxed);
+      if (head - producer.cachedOther > mask) {
+        producer.cachedOther = consumer.index.load(std::memory_order_acquire);
+        if (head - producer.cachedOther > mask) {
+          return nullptr;
+        }
+      }
+      return &slots[head & mask];
+    }
+
+    /**
+     * @brief Publishes the slot returned by beginWrite() to the consumer
+     */
+    void commitWrite() {
+      producer.index.store(producer.index.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies a value into the ring
+     *
+     * @param value Value to push
+     * @return False if the ring is full
+     */
+    bool tryPush(const T& value) {
+      T* slot = beginWrite();
+      if (slot == nullptr) {
+        return false;
+      }
+      *slot = value;
+      commitWrite();
+      return true;
+    }
+
+    /**
+     * @brief Gets the oldest filled slot for the consumer
+     *
+     * @return Pointer to the slot, or nullptr if the ring is empty
+     */
+    T* beginRead() {
+      size_t tail = consumer.index.load(std::memory_order_relaxed);
+      if (tail == consumer.cachedOther) {
+        consumer.cachedOther = producer.index.load(std::memory_order_acquire);
+        if (tail == consumer.cachedOther) {
+          return nullptr;
+        }
+      }
+      return &slots[tail & mask];
+    }
+
+    /**
+     * @brief Returns the slot from beginRead() to the producer
+     */
+    void commitRead() {
+      consumer.index.store(consumer.index.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_release);
+    }
+
+    /**
+     * @brief Moves the oldest value out of the ring
+     *
+     * @param value Destination of the value
+     * @return False if the ring is empty
+     */
+    bool tryPop(T& value) {
+      T* slot = beginRead();
+      if (slot == nullptr) {
+        return false;
+      }
+      value = std::move(*slot);
+      commitRead();
+      return true;
+    }
+
+    /**
+     * @brief Gets the number of filled slots; exact only when both sides are idle
+     */
+    size_t size() const {
+      return producer.index.load(std::memory_order_acquire) -
+             consumer.index.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Gets the number of slots in the ring
+     */
+    size_t capacity() const {
+      return mask + 1;
+    }
+
+  private:
+    /**
+     * @struct Cursor
+     * @brief One side's index plus its cached copy of the other side's index
+     */
+    struct alignas(kCacheLineSize) Cursor {
+        std::atomic<size_t> index{0};  ///< Next slot this side will use
+        size_t cachedOther = 0;        ///< Last observed index of the other side
+    };
+
+    Cursor producer;        ///< Written by the producer thread
+    Cursor consumer;        ///< Written by the consumer thread
+    std::vector<T> slots;   ///< Slot storage
+    size_t mask;            ///< Capacity minus one
+};
@@ -0,0 +1,326 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Pool and worker index of the calling thread; null and -1 off the pool
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local int currentIndex = -1;
+
+// Victim search starts at a random worker so thieves spread out
+uint32_t nextVictim() {
+  thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+std::mutex& sharedConfigMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+ThreadPoolOptions sharedOptions;
+bool sharedStarted = false;
+
+ThreadPoolOptions startShared() {
+  std::lock_guard<std::mutex> lock(sharedConfigMutex());
+  sharedStarted = true;
+  return sharedOptions;
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& _options)
+: options(_options), queued(0), sleeping(0), epoch(0), helped(0), stopping(false) {
+  size_t count = options.workers > 0 ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < count; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  // Every deque exists before any worker can try to steal from it
+  for (size_t i = 0; i < count; ++i) {
+    workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  stopping.store(true, std::memory_order_seq_cst);
+  wake(true);
+  for (auto& worker : workers) {
+    worker->thread.join();
+  }
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool(startShared());
+  return pool;
+}
+
+bool ThreadPool::configureShared(const ThreadPoolOptions& options) {
+  std::lock_guard<std::mutex> lock(sharedConfigMutex());
+  if (sharedStarted) {
+    return false;
+  }
+  sharedOptions = options;
+  return true;
+}
+
+void ThreadPool::submit(std::function<void()> task, int affinity) {
+  enqueue(new Task{std::move(task), nullptr}, affinity);
+}
+
+size_t ThreadPool::workerCount() const {
+  return workers.size();
+}
+
+int ThreadPool::currentWorker() const {
+  return currentPool == this ? currentIndex : -1;
+}
+
+ThreadPoolStats ThreadPool::stats() const {
+  ThreadPoolStats stats;
+  stats.executed = helped.load(std::memory_order_relaxed);
+  for (const auto& worker : workers) {
+    stats.executed += worker->executed.load(std::memory_order_relaxed);
+    stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+    stats.sleeps += worker->sleeps.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+// A worker's own tasks skip every lock; an affinity to another worker wakes
+// all sleepers, since notify_one() cannot pick which one
+void ThreadPool::enqueue(Task* task, int affinity) {
+  int self = currentWorker();
+  int target = affinity >= 0 ? affinity % static_cast<int>(workers.size()) : self;
+  if (target >= 0 && target == self) {
+    workers[self]->deque.push(task);
+  } else if (target >= 0) {
+    Worker& worker = *workers[target];
+    std::lock_guard<std::mutex> lock(worker.inboxMutex);
+    worker.inbox.push_back(task);
+    worker.inboxSize.fetch_add(1, std::memory_order_release);
+  } else {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    sharedQueue.push_back(task);
+  }
+  queued.fetch_add(1, std::memory_order_seq_cst);
+  wake(target >= 0 && target != self);
+}
+
+void ThreadPool::wake(bool all) {
+  epoch.fetch_add(1, std::memory_order_seq_cst);
+  if (sleeping.load(std::memory_order_seq_cst) == 0) {
+    return;
+  }
+  if (all) {
+    epoch.notify_all();
+  } else {
+    epoch.notify_one();
+  }
+}
+
+// Sleeping re-checks the queue count after announcing itself, and submit()
+// bumps the epoch after counting the task, so a wake-up is never lost
+void ThreadPool::run(size_t index) {
+  currentPool = this;
+  currentIndex = static_cast<int>(index);
+#ifdef __linux__
+  if (options.pinWorkers) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+#endif
+
+  Worker& self = *workers[index];
+  unsigned idle = 0;
+  while (true) {
+    Task* task = find(static_cast<int>(index));
+    if (task != nullptr) {
+      execute(task, static_cast<int>(index));
+      idle = 0;
+      continue;
+    }
+    if (stopping.load(std::memory_order_seq_cst) && queued.load(std::memory_order_seq_cst) == 0) {
+      return;
+    }
+    if (idle < options.spinRounds) {
+      backoff(idle++);
+      continue;
+    }
+    uint32_t seen = epoch.load(std::memory_order_seq_cst);
+    sleeping.fetch_add(1, std::memory_order_seq_cst);
+    if (queued.load(std::memory_order_seq_cst) == 0 && !stopping.load(std::memory_order_seq_cst)) {
+      self.sleeps.fetch_add(1, std::memory_order_relaxed);
+      epoch.wait(seen, std::memory_order_seq_cst);
+    }
+    sleeping.fetch_sub(1, std::memory_order_seq_cst);
+    idle = 0;
+  }
+}
+
+ThreadPool::Task* ThreadPool::find(int index) {
+  Task* task = nullptr;
+  if (index >= 0) {
+    Worker& self = *workers[index];
+    if (self.deque.pop(task) || (task = takeInbox(self)) != nullptr) {
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      return task;
+    }
+  }
+  if (queued.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (!sharedQueue.empty()) {
+      task = sharedQueue.front();
+      sharedQueue.pop_front();
+    }
+  }
+  if (task != nullptr) {
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+  }
+
+  size_t count = workers.size();
+  size_t start = nextVictim() % count;
+  for (size_t i = 0; i < count; ++i) {
+    size_t victim = (start + i) % count;
+    if (static_cast<int>(victim) == index) {
+      continue;
+    }
+    if (workers[victim]->deque.steal(task) || (task = takeInbox(*workers[victim])) != nullptr) {
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      if (index >= 0) {
+        workers[index]->stolen.fetch_add(1, std::memory_order_relaxed);
+      }
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+ThreadPool::Task* ThreadPool::takeInbox(Worker& worker) {
+  if (worker.inboxSize.load(std::memory_order_acquire) == 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(worker.inboxMutex);
+  if (worker.inbox.empty()) {
+    return nullptr;
+  }
+  Task* task = worker.inbox.front();
+  worker.inbox.pop_front();
+  worker.inboxSize.fetch_sub(1, std::memory_order_relaxed);
+  return task;
+}
+
+void ThreadPool::execute(Task* task, int index) {
+  perform(task, index);
+  release(task);
+}
+
+// A group task sits both in a queue and in its group's list; whichever of a
+// worker and the group's wait() gets to it first runs it
+bool ThreadPool::perform(Task* task, int index) {
+  if (task->claimed.exchange(true, std::memory_order_acq_rel)) {
+    return false;
+  }
+  task->run();
+  task->run = nullptr;
+  if (index >= 0) {
+    workers[index]->executed.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    helped.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (task->group != nullptr) {
+    task->group->finish();
+  }
+  return true;
+}
+
+void ThreadPool::release(Task* task) {
+  if (task->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete task;
+  }
+}
+
+TaskGroup::TaskGroup(ThreadPool& _pool)
+: pool(_pool), outstanding(0), tasks(nullptr) {}
+
+TaskGroup::~TaskGroup() {
+  wait();
+}
+
+void TaskGroup::run(std::function<void()> task, int affinity) {
+  auto* queued = new ThreadPool::Task{std::move(task), this};
+  queued->refs.store(2, std::memory_order_relaxed);
+  queued->nextInGroup = tasks.load(std::memory_order_relaxed);
+  while (!tasks.compare_exchange_weak(queued->nextInGroup, queued, std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+  }
+  outstanding.fetch_add(1, std::memory_order_relaxed);
+  pool.enqueue(queued, affinity);
+}
+
+// A worker runs this group's tasks that no one has started, and only those,
+// then spins until the ones other workers took are done; any other thread
+// spins as long as an idle worker would, for groups as short as one tick's
+// deliveries, then sleeps until the last task is done
+void TaskGroup::wait() {
+  int index = pool.currentWorker();
+  if (index >= 0) {
+    unsigned idle = 0;
+    while (outstanding.load(std::memory_order_acquire) != 0) {
+      if (takeTasks(index)) {
+        idle = 0;
+      } else {
+        backoff(idle++);
+      }
+    }
+  } else {
+    unsigned spin = 0;
+    while (spin < pool.options.spinRounds && outstanding.load(std::memory_order_acquire) != 0) {
+      backoff(spin++);
+    }
+  }
+  {
+    // The last finish() may still hold the lock
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [this] { return outstanding.load(std::memory_order_acquire) == 0; });
+  }
+  takeTasks(-1);
+}
+
+// The whole list is taken at once, so a task is never unlinked while
+// another thread pushes, and the list has no ABA problem
+bool TaskGroup::takeTasks(int index) {
+  ThreadPool::Task* task = tasks.exchange(nullptr, std::memory_order_acquire);
+  bool ran = false;
+  while (task != nullptr) {
+    ThreadPool::Task* next = task->nextInGroup;
+    if (index >= 0) {
+      ran = pool.perform(task, index) || ran;
+    }
+    ThreadPool::release(task);
+    task = next;
+  }
+  return ran;
+}
+
+void TaskGroup::finish() {
+  std::lock_guard<std::mutex> lock(doneMutex);
+  if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    done.notify_all();
+  }
+}
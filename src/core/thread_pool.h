@@ -0,0 +1,269 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing thread pool shared by the whole process
+ *
+ * This file defines ThreadPool and TaskGroup. Each worker owns a
+ * WorkStealingDeque: tasks a worker spawns go to its own deque, tasks from
+ * other threads go to a shared queue, and an idle worker steals from the
+ * others before it sleeps. Backtests, pooled engines and anything else
+ * that wants parallelism submit to ThreadPool::shared(), so running many
+ * of them at once never starts more threads than there are workers.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "work_stealing_deque.h"
+
+class TaskGroup;
+
+/**
+ * @struct ThreadPoolOptions
+ * @brief Size and placement of a ThreadPool's workers
+ */
+struct ThreadPoolOptions {
+    size_t workers = 0;         ///< Worker threads; 0 uses one per hardware thread
+    bool pinWorkers = false;    ///< Pin worker i to CPU i, modulo the CPU count
+    unsigned spinRounds = 256;  ///< Failed searches for work before an idle worker sleeps
+};
+
+/**
+ * @struct ThreadPoolStats
+ * @brief Counters of a ThreadPool
+ */
+struct ThreadPoolStats {
+    uint64_t executed = 0;  ///< Tasks run, by workers and by helping threads
+    uint64_t stolen = 0;    ///< Tasks taken from another worker's deque
+    uint64_t sleeps = 0;    ///< Times a worker found nothing to do and slept
+};
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of workers running submitted tasks
+ *
+ * A worker looks for work in its own deque (newest first), then its inbox
+ * of tasks submitted with an affinity to it, then the shared queue, then
+ * the deques and inboxes of the other workers (oldest first). After
+ * spinRounds fruitless searches it sleeps until a task is submitted.
+ * Tasks must not block waiting on tasks queued behind them, except through
+ * TaskGroup::wait(), which runs the group's own tasks while it waits.
+ */
+class ThreadPool {
+  public:
+    /**
+     * @brief Starts the workers
+     *
+     * @param options Worker count, pinning and idle behaviour
+     */
+    explicit ThreadPool(const ThreadPoolOptions& options = ThreadPoolOptions());
+
+    /**
+     * @brief Runs every task already submitted, then stops the workers
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Gets the process-wide pool, starting it on first use
+     */
+    static ThreadPool& shared();
+
+    /**
+     * @brief Sets the options the process-wide pool starts with
+     *
+     * @param options Options for shared()
+     * @return False if the pool has already started; its options stay as they were
+     */
+    static bool configureShared(const ThreadPoolOptions& options);
+
+    /**
+     * @brief Queues a task
+     *
+     * Called on one of this pool's workers, the task goes to that worker's
+     * deque without taking a lock.
+     *
+     * @param task Task to run
+     * @param affinity Worker that should preferably run the task; -1 for any
+     */
+    void submit(std::function<void()> task, int affinity = -1);
+
+    /**
+     * @brief Gets the number of workers
+     */
+    size_t workerCount() const;
+
+    /**
+     * @brief Gets the index of the calling thread among this pool's workers
+     *
+     * @return Worker index, or -1 if the caller is not one of them
+     */
+    int currentWorker() const;
+
+    /**
+     * @brief Gets a snapshot of the counters
+     */
+    ThreadPoolStats stats() const;
+
+  private:
+    friend class TaskGroup;
+
+    /**
+     * @struct Task
+     * @brief A queued task and the group waiting for it
+     */
+    struct Task {
+        std::function<void()> run;  ///< Work to do
+        TaskGroup* group;           ///< Group to tell when done, or nullptr
+        std::atomic<bool> claimed{false};  ///< Set by the one thread that runs the task
+        std::atomic<int> refs{1};          ///< Queue entry, plus the group's list for group tasks
+        Task* nextInGroup = nullptr;       ///< Task submitted before this one to the same group
+    };
+
+    /**
+     * @struct Worker
+     * @brief One worker thread and its queues
+     */
+    struct Worker {
+        WorkStealingDeque<Task*> deque;  ///< Tasks spawned by this worker
+        std::mutex inboxMutex;           ///< Guards inbox
+        std::deque<Task*> inbox;         ///< Tasks submitted elsewhere with an affinity to this worker
+        std::atomic<size_t> inboxSize{0};  ///< Size of inbox, read without the lock
+        alignas(kCacheLineSize) std::atomic<uint64_t> executed{0};  ///< Tasks this worker ran
+        std::atomic<uint64_t> stolen{0};   ///< Tasks this worker stole
+        std::atomic<uint64_t> sleeps{0};   ///< Times this worker slept
+        std::thread thread;              ///< The worker thread
+    };
+
+    /**
+     * @brief Queues a task object
+     */
+    void enqueue(Task* task, int affinity);
+
+    /**
+     * @brief Worker loop
+     */
+    void run(size_t index);
+
+    /**
+     * @brief Finds a task for a worker, or for another thread if index is -1
+     *
+     * @return The task, or nullptr if none was found
+     */
+    Task* find(int index);
+
+    /**
+     * @brief Takes the oldest task from a worker's inbox
+     */
+    static Task* takeInbox(Worker& worker);
+
+    /**
+     * @brief Runs a task taken from a queue, unless its group's wait() already has
+     */
+    void execute(Task* task, int index);
+
+    /**
+     * @brief Runs a task on the calling thread and tells its group, if no other thread has claimed it
+     *
+     * @return True if the task ran here
+     */
+    bool perform(Task* task, int index);
+
+    /**
+     * @brief Drops one reference to a task, deleting it with the last
+     */
+    static void release(Task* task);
+
+    /**
+     * @brief Wakes a sleeping worker after a task was queued
+     *
+     * @param all Wake every worker, so the one a task has an affinity to is among them
+     */
+    void wake(bool all);
+
+    ThreadPoolOptions options;                     ///< Options the pool started with
+    std::vector<std::unique_ptr<Worker>> workers;  ///< Workers
+    std::mutex sharedMutex;                        ///< Guards sharedQueue
+    std::deque<Task*> sharedQueue;                 ///< Tasks submitted from outside the pool
+    std::atomic<size_t> queued;                    ///< Tasks queued and not yet taken
+    std::atomic<size_t> sleeping;                  ///< Workers asleep or about to sleep
+    std::atomic<uint32_t> epoch;                   ///< Bumped on every submit; sleepers wait on it
+    std::atomic<uint64_t> helped;                  ///< Tasks run by threads that are not workers
+    std::atomic<bool> stopping;                    ///< Asks the workers to exit once the queues are empty
+};
+
+/**
+ * @class TaskGroup
+ * @brief Tasks submitted together and waited for together
+ *
+ * wait() on a worker of the pool runs the group's tasks no worker has
+ * started, so a task may wait for the tasks it spawned without tying up a
+ * worker. It never runs another group's task, so a short wait is not held
+ * up behind unrelated work such as a whole backtest. Other threads spin as
+ * long as an idle worker would and then sleep, so a short group returns
+ * quickly and a long one leaves the CPUs to the workers.
+ */
+class TaskGroup {
+  public:
+    /**
+     * @brief Creates an empty group
+     *
+     * @param pool Pool to run the tasks on
+     */
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::shared());
+
+    /**
+     * @brief Waits for every task of the group
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Submits a task as part of the group
+     *
+     * @param task Task to run
+     * @param affinity Worker that should preferably run the task; -1 for any
+     */
+    void run(std::function<void()> task, int affinity = -1);
+
+    /**
+     * @brief Blocks until every task submitted so far has finished
+     */
+    void wait();
+
+  private:
+    friend class ThreadPool;
+
+    /**
+     * @brief Counts a finished task
+     */
+    void finish();
+
+    /**
+     * @brief Takes the tasks submitted since the last call and drops the group's hold on them
+     *
+     * @param index Worker to run the tasks no thread has claimed yet on; -1 to leave them to the pool
+     * @return True if a task ran
+     */
+    bool takeTasks(int index);
+
+    ThreadPool& pool;                  ///< Pool running the tasks
+    std::atomic<size_t> outstanding;   ///< Tasks submitted and not yet finished
+    std::mutex doneMutex;              ///< Taken by every finish, so a finished group is safe to destroy
+    std::condition_variable done;      ///< Signalled when outstanding reaches zero
+    std::atomic<ThreadPool::Task*> tasks;  ///< Newest task submitted and not yet taken, linked by nextInGroup
+};
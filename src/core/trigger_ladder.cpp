@@ -0,0 +1,46 @@
+#include "trigger_ladder.h"
+
+#include <algorithm>
+
+TriggerLadder::TriggerLadder(bool _rising) : rising(_rising) {}
+
+// Rising ladders trigger from their lowest level and falling ones from
+// their highest, so the order due next is always at the back
+bool TriggerLadder::before(const Entry& a, const Entry& b) const {
+  if (a.level != b.level) {
+    return rising ? a.level > b.level : a.level < b.level;
+  }
+  return a.id > b.id;
+}
+
+void TriggerLadder::insert(double level, uint64_t id, uint32_t slot) {
+  Entry entry{level, id, slot};
+  auto position = std::upper_bound(entries.begin(), entries.end(), entry,
+                                   [this](const Entry& a, const Entry& b) { return before(a, b); });
+  entries.insert(position, entry);
+}
+
+bool TriggerLadder::erase(double level, uint64_t id) {
+  Entry entry{level, id, 0};
+  auto position = std::lower_bound(entries.begin(), entries.end(), entry,
+                                   [this](const Entry& a, const Entry& b) { return before(a, b); });
+  if (position == entries.end() || position->id != id) {
+    return false;
+  }
+  entries.erase(position);
+  return true;
+}
+
+size_t TriggerLadder::collect(double low, double high, std::vector<uint32_t>& slots) {
+  size_t triggered = 0;
+  while (!entries.empty() && (rising ? entries.back().level <= high : entries.back().level >= low)) {
+    slots.push_back(entries.back().slot);
+    entries.pop_back();
+    triggered += 1;
+  }
+  return triggered;
+}
+
+size_t TriggerLadder::size() const {
+  return entries.size();
+}
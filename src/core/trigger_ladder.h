@@ -0,0 +1,88 @@
+/**
+ * @file trigger_ladder.h
+ * @brief Sorted array of resting orders waiting for a price level
+ *
+ * This file defines TriggerLadder, which holds the limit or stop orders of
+ * one side of the book sorted by trigger level, with the next order to
+ * trigger last. Checking a bar then touches only the orders it triggers,
+ * plus one comparison, however many orders rest further away; inserting or
+ * removing an order is a binary search and a move of the orders behind it.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class TriggerLadder
+ * @brief Resting orders of one kind and side, ordered by level and then by id
+ *
+ * A rising ladder holds orders that trigger when the price reaches their
+ * level from below, such as buy stops and sell limits; a falling ladder
+ * those that trigger when it reaches their level from above. Of two
+ * orders at the same level, the older one triggers first. Not
+ * thread-safe: callers guard it with the lock that guards the orders.
+ */
+class TriggerLadder {
+  public:
+    /**
+     * @brief Constructs an empty ladder
+     *
+     * @param _rising True if orders trigger at or above their level, false at or below
+     */
+    explicit TriggerLadder(bool _rising);
+
+    /**
+     * @brief Adds an order
+     *
+     * @param level Trigger price
+     * @param id Order id
+     * @param slot Slot holding the order
+     */
+    void insert(double level, uint64_t id, uint32_t slot);
+
+    /**
+     * @brief Removes an order
+     *
+     * @param level Trigger price the order was inserted with
+     * @param id Order id
+     * @return True if the order was present
+     */
+    bool erase(double level, uint64_t id);
+
+    /**
+     * @brief Removes every order a price range triggers
+     *
+     * @param low Lowest price traded
+     * @param high Highest price traded
+     * @param slots Receives the slots of the triggered orders, next to trigger first
+     * @return Number of orders triggered
+     */
+    size_t collect(double low, double high, std::vector<uint32_t>& slots);
+
+    /**
+     * @brief Gets the number of resting orders
+     */
+    size_t size() const;
+
+  private:
+    /**
+     * @struct Entry
+     * @brief One resting order
+     */
+    struct Entry {
+        double level;   ///< Trigger price
+        uint64_t id;    ///< Order id, breaks ties in favour of older orders
+        uint32_t slot;  ///< Slot holding the order
+    };
+
+    /**
+     * @brief Checks whether an entry triggers after another; later triggers sort first
+     */
+    bool before(const Entry& a, const Entry& b) const;
+
+    std::vector<Entry> entries;  ///< Resting orders, next to trigger last
+    bool rising;                 ///< Whether orders trigger at or above their level
+};
@@ -0,0 +1,156 @@
+/**
+ * @file work_stealing_deque.h
+ * @brief Lock-free Chase-Lev work-stealing deque
+ *
+ * This file defines WorkStealingDeque, the per-worker queue of ThreadPool.
+ * Its owner pushes and pops at the bottom like a stack, which keeps the
+ * most recently spawned, cache-warm task local; other threads steal from
+ * the top, taking the oldest and usually largest piece of work. Only a
+ * pop racing a steal for the last item needs a compare-and-swap.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "spsc_ring.h"
+
+/**
+ * @class WorkStealingDeque
+ * @brief Growable deque with one owner and any number of thieves
+ *
+ * Follows Chase and Lev, with the memory orders of Lê et al. (PPoPP 2013).
+ * The array doubles when full; replaced arrays are kept until the deque is
+ * destroyed, since a thief may still be reading one.
+ *
+ * @tparam T Item type; must be trivially copyable and lock-free as an atomic, e.g. a pointer
+ */
+template <typename T>
+class WorkStealingDeque {
+  public:
+    /**
+     * @brief Constructs an empty deque
+     *
+     * @param minCapacity Initial capacity; rounded up to a power of two
+     */
+    explicit WorkStealingDeque(size_t minCapacity = 256) : top(0), bottom(0) {
+      size_t capacity = 1;
+      while (capacity < minCapacity) {
+        capacity <<= 1;
+      }
+      arrays.push_back(std::make_unique<Array>(capacity));
+      array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Adds an item at the bottom; owner only
+     */
+    void push(T item) {
+      int64_t b = bottom.load(std::memory_order_relaxed);
+      int64_t t = top.load(std::memory_order_acquire);
+      Array* a = array.load(std::memory_order_relaxed);
+      if (b - t > static_cast<int64_t>(a->mask)) {
+        a = grow(a, t, b);
+      }
+      a->put(b, item);
+      bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Takes the newest item; owner only
+     *
+     * @param item Receives the item
+     * @return False if the deque is empty or a thief took the last item
+     */
+    bool pop(T& item) {
+      int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+      Array* a = array.load(std::memory_order_relaxed);
+      bottom.store(b, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t t = top.load(std::memory_order_relaxed);
+      if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+      }
+      item = a->get(b);
+      if (t == b) {
+        // Last item: whoever moves top first gets it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+      }
+      return true;
+    }
+
+    /**
+     * @brief Takes the oldest item; any thread
+     *
+     * @param item Receives the item
+     * @return False if the deque is empty or another thread won the item
+     */
+    bool steal(T& item) {
+      int64_t t = top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t b = bottom.load(std::memory_order_acquire);
+      if (t >= b) {
+        return false;
+      }
+      Array* a = array.load(std::memory_order_acquire);
+      item = a->get(t);
+      return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the number of items; exact only when no thread is using the deque
+     */
+    size_t size() const {
+      int64_t b = bottom.load(std::memory_order_acquire);
+      int64_t t = top.load(std::memory_order_acquire);
+      return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+  private:
+    /**
+     * @struct Array
+     * @brief Circular storage indexed by the unbounded top and bottom
+     */
+    struct Array {
+        explicit Array(size_t capacity) : mask(capacity - 1), items(capacity) {}
+
+        T get(int64_t index) const {
+          return items[static_cast<size_t>(index) & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T item) {
+          items[static_cast<size_t>(index) & mask].store(item, std::memory_order_relaxed);
+        }
+
+        size_t mask;                        ///< Capacity minus one
+        std::vector<std::atomic<T>> items;  ///< Slots
+    };
+
+    /**
+     * @brief Replaces a full array with one twice its size; owner only
+     */
+    Array* grow(Array* old, int64_t t, int64_t b) {
+      arrays.push_back(std::make_unique<Array>((old->mask + 1) * 2));
+      Array* bigger = arrays.back().get();
+      for (int64_t i = t; i < b; ++i) {
+        bigger->put(i, old->get(i));
+      }
+      array.store(bigger, std::memory_order_release);
+      return bigger;
+    }
+
+    alignas(kCacheLineSize) std::atomic<int64_t> top;     ///< Next item to steal; advanced by thieves
+    alignas(kCacheLineSize) std::atomic<int64_t> bottom;  ///< Next free slot; moved by the owner
+    std::atomic<Array*> array;                            ///< Current storage
+    std::vector<std::unique_ptr<Array>> arrays;           ///< Every array allocated; owner only
+};
@@ -1,27 +1,39 @@
 #include <iostream>
 #include <chrono>
 #include <ctime>
-#include <thread>
-#include <regex>
 
 #include <Python.h>
 
+#include "market/date.h"
+#include "market/market_data_cache.h"
 #include "market/stock_market.h"
 #include "trader/strategies/moving_avg.h"
 #include "trader/strategies/mean_reversion.h"
 #include "core/engine.h"
+#include "core/batch.h"
+
+// Calls python function to get stock data into sqlite database; interval is
+// a yfinance bar size such as "1d" or "5m"
+bool getStockData(std::string symbol, std::string start_date, std::string end_date,
+                  std::string database = MarketDataCache::kDefaultDatabase, std::string interval = "1d") {
+    // Rows already stored need neither the interpreter nor a download
+    if (MarketDataCache::instance().hasData(database, symbol, start_date, end_date)) {
+        std::clog << "Found existing data for " << symbol << " from " << start_date << " to " << end_date << "\n";
+        return true;
+    }
 
-// Calls python function to get stock data into sqlite database
-bool getStockData(std::string symbol, std::string start_date, std::string end_date) {
     const char* symbol_cstr = symbol.c_str();
     const char* start_cstr = start_date.c_str();
     const char* end_cstr = end_date.c_str();
 
-    // Initialize the Python interpreter
-    Py_Initialize();
+    // Initialize the Python interpreter once; it is finalized when main exits
+    // because extension modules such as numpy cannot be re-initialized
+    if (!Py_IsInitialized()) {
+        Py_Initialize();
+        PyRun_SimpleString("import sys\nsys.path.append('./src/python')");
+    }
 
     // Import the Python module
-    PyRun_SimpleString("import sys\nsys.path.append('./src/python')");
     PyObject* pName = PyUnicode_DecodeFSDefault("get_stock_data");
     PyObject* pModule = PyImport_Import(pName);
     Py_XDECREF(pName);
@@ -32,11 +44,12 @@ bool getStockData(std::string symbol, std::string start_date, std::string end_da
 
         if (pFunc && PyCallable_Check(pFunc)) {
             // Prepare arguments and call the python function
-            PyObject* pArgs = PyTuple_Pack(4,
+            PyObject* pArgs = PyTuple_Pack(5,
                 PyUnicode_DecodeFSDefault(symbol_cstr),
                 PyUnicode_DecodeFSDefault(start_cstr),
                 PyUnicode_DecodeFSDefault(end_cstr),
-                PyUnicode_DecodeFSDefault("data/stock_data.db")
+                PyUnicode_DecodeFSDefault(database.c_str()),
+                PyUnicode_DecodeFSDefault(interval.c_str())
             );
 
             PyObject* pValue = PyObject_CallObject(pFunc, pArgs);
@@ -44,30 +57,25 @@ bool getStockData(std::string symbol, std::string start_date, std::string end_da
 
             if (pValue != NULL) {
                 Py_XDECREF(pValue);
+                MarketDataCache::instance().invalidate(database, symbol);
             } else {
                 PyErr_Print();  // Print error message if the function call failed
                 Py_XDECREF(pFunc);
                 Py_XDECREF(pModule);
-                Py_Finalize();
                 return false;
             }
             Py_XDECREF(pFunc);
         } else {
             PyErr_Print();  // Print error message if the function is not callable
             Py_XDECREF(pModule);
-            Py_Finalize();
             return false;
         }
         Py_XDECREF(pModule);
     } else {
         PyErr_Print();  // Print error message if the module import failed
-        Py_Finalize();
         return false;
     }
 
-    // Finalize the Python interpreter
-    Py_Finalize();
-
     return true;
 }
 
@@ -105,19 +113,16 @@ std::string getDateFiveYearsAgo() {
   return std::string(buffer);
 }
 
-bool isValidDate(const std::string& date) {
-  // Date should be in the format YYYY-MM-DD
-  return std::regex_match(date, std::regex("^\\d{4}-\\d{2}-\\d{2}$"));
-}
-
 bool isValidStartDate(const std::string& startDate) {
-  // Start date should not be in the future
+  // Start date should be a real YYYY-MM-DD date
   return isValidDate(startDate);
 }
 
 bool isValidEndDate(const std::string& endDate, const std::string& startDate) {
-  // End date should not be in the future or before the start date
-  return isValidDate(endDate) && endDate >= startDate;
+  // End date should be a real YYYY-MM-DD date not before the start date
+  int32_t end = 0;
+  int32_t start = 0;
+  return parseDate(endDate, end) && parseDate(startDate, start) && end >= start;
 }
 
 bool getInput(std::string &sym, std::string &s, std::string &e) {
@@ -183,12 +188,48 @@ bool getInput(std::string &sym, std::string &s, std::string &e) {
   return true;
 }
 
-int main() {
+// Runs the backtests described by the command line without any prompts
+int runBatchMode(int argc, char** argv) {
+  std::string first = argv[1];
+  if (first == "--help" || first == "-h") {
+    printUsage(std::cout);
+    return 0;
+  }
+
+  BatchConfig config;
+  if (!parseCommandLine(argc, argv, config)) {
+    printUsage(std::cerr);
+    return 1;
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<BacktestResult> results = runBatch(config, [](const std::string& symbol,
+      const std::string& start, const std::string& end, const std::string& database, const std::string& interval) {
+    return getStockData(symbol, start, end, database, interval);
+  });
+  double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+  bool written = writeResults(config, results, wallMs);
+  if (Py_IsInitialized()) {
+    Py_Finalize();
+  }
+  return written && !results.empty() ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    return runBatchMode(argc, argv);
+  }
+
   std::string symbol = "AAPL";
   std::string start_date = "2018-12-29";
   std::string end_date = "2023-12-23";
 
-  if (!getInput(symbol, start_date, end_date)) {
+  bool haveData = getInput(symbol, start_date, end_date);
+  if (Py_IsInitialized()) {
+    Py_Finalize();
+  }
+  if (!haveData) {
     return 0;
   }
 
@@ -206,9 +247,8 @@ int main() {
   stock_market.addTrader(&moving_avg_trader);
   stock_market.addTrader(&mean_reversion_trader);
 
-  // Thread for the stock market
-  std::thread stock_market_thread(&StockMarket::runSimulation, &stock_market);
-  stock_market_thread.join();
+  // Run the stock market on this thread
+  stock_market.runSimulation();
 
   // Print trader portfolios
   moving_avg_trader.print("Moving Average", true);
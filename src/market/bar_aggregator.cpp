@@ -0,0 +1,207 @@
+#include "bar_aggregator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "date.h"
+#include "../core/thread_pool.h"
+#include "../trader/trader.h"
+
+namespace {
+
+// Start of the period containing a timestamp, also for timestamps before 1970
+inline int64_t periodStart(int64_t timestamp, int64_t period) {
+  int64_t offset = timestamp % period;
+  return timestamp - (offset < 0 ? offset + period : offset);
+}
+
+}  // namespace
+
+bool parseBarSize(std::string_view text, int64_t& periodNs) {
+  if (text == "tick" || text == "0") {
+    periodNs = 0;
+    return true;
+  }
+  if (text.size() < 2) {
+    return false;
+  }
+
+  int64_t unit = 0;
+  switch (text.back()) {
+    case 's': unit = kNanosPerSecond; break;
+    case 'm': unit = 60 * kNanosPerSecond; break;
+    case 'h': unit = 3600 * kNanosPerSecond; break;
+    case 'd': unit = kNanosPerDay; break;
+    default: return false;
+  }
+
+  int64_t count = 0;
+  for (char c : text.substr(0, text.size() - 1)) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    count = count * 10 + (c - '0');
+    if (count > std::numeric_limits<int64_t>::max() / unit) {
+      return false;
+    }
+  }
+  if (count == 0) {
+    return false;
+  }
+  periodNs = count * unit;
+  return true;
+}
+
+BarAggregator::BarAggregator(int64_t periodNs) : period(periodNs), bucket(0), volume(0), open(false) {}
+
+int64_t BarAggregator::getPeriod() const {
+  return period;
+}
+
+bool BarAggregator::add(const StockData& tick, StockData& completed) {
+  if (period <= 0) {
+    completed = tick;
+    return true;
+  }
+
+  int64_t start = periodStart(tick.timestamp, period);
+  bool done = open && start != bucket;
+  if (done) {
+    flush(completed);
+  }
+
+  if (!open) {
+    bar = tick;
+    bar.timestamp = start;
+    bucket = start;
+    volume = tick.volume;
+    open = true;
+  } else {
+    bar.high = std::max(bar.high, tick.high);
+    bar.low = std::min(bar.low, tick.low);
+    bar.close = tick.close;
+    volume += tick.volume;
+  }
+  return done;
+}
+
+bool BarAggregator::flush(StockData& completed) {
+  if (!open) {
+    return false;
+  }
+  bar.volume = static_cast<uint32_t>(std::min<uint64_t>(volume, std::numeric_limits<uint32_t>::max()));
+  completed = bar;
+  open = false;
+  return true;
+}
+
+void BarRouter::addTrader(Trader* trader) {
+  lanes.clear();
+  int64_t period = trader->getBarSize();
+  for (Subscription& subscription : subscriptions) {
+    if (subscription.aggregator.getPeriod() == period) {
+      subscription.traders.push_back(trader);
+      return;
+    }
+  }
+  subscriptions.push_back({BarAggregator(period), {trader}, StockData(), nullptr});
+}
+
+void BarRouter::publish(const StockData& tick) {
+  if (fanOut > 1) {
+    bool any = false;
+    for (Subscription& subscription : subscriptions) {
+      subscription.delivered = nullptr;
+      if (subscription.aggregator.getPeriod() == 0) {
+        subscription.delivered = &tick;
+      } else if (subscription.aggregator.add(tick, subscription.bar)) {
+        subscription.delivered = &subscription.bar;
+      }
+      any = any || subscription.delivered != nullptr;
+    }
+    if (any) {
+      deliverLanes();
+    }
+    return;
+  }
+
+  StockData bar;
+  for (Subscription& subscription : subscriptions) {
+    // Subscribers to the raw stream get the tick itself, without a copy
+    const StockData* delivered = &tick;
+    if (subscription.aggregator.getPeriod() != 0) {
+      if (!subscription.aggregator.add(tick, bar)) {
+        continue;
+      }
+      delivered = &bar;
+    }
+    for (Trader* trader : subscription.traders) {
+      trader->onBar(*delivered);
+    }
+  }
+}
+
+bool BarRouter::finish() {
+  bool delivered = false;
+  if (fanOut > 1) {
+    for (Subscription& subscription : subscriptions) {
+      bool flushed = subscription.aggregator.flush(subscription.bar);
+      subscription.delivered = flushed ? &subscription.bar : nullptr;
+      delivered = delivered || flushed;
+    }
+    if (delivered) {
+      deliverLanes();
+    }
+    return delivered;
+  }
+
+  StockData bar;
+  for (Subscription& subscription : subscriptions) {
+    if (subscription.aggregator.flush(bar)) {
+      for (Trader* trader : subscription.traders) {
+        trader->onBar(bar);
+      }
+      delivered = true;
+    }
+  }
+  return delivered;
+}
+
+void BarRouter::setFanOut(size_t count) {
+  fanOut = std::max<size_t>(count, 1);
+  lanes.clear();
+}
+
+// Lane i prefers worker i - 1, so a lane's traders usually stay in one
+// worker's cache from tick to tick
+void BarRouter::deliverLanes() {
+  if (lanes.empty()) {
+    size_t traders = 0;
+    for (const Subscription& subscription : subscriptions) {
+      traders += subscription.traders.size();
+    }
+    lanes.resize(std::max<size_t>(std::min(fanOut, traders), 1));
+    size_t next = 0;
+    for (size_t s = 0; s < subscriptions.size(); ++s) {
+      for (Trader* trader : subscriptions[s].traders) {
+        lanes[next++ % lanes.size()].push_back({s, trader});
+      }
+    }
+  }
+
+  TaskGroup group;
+  for (size_t l = 1; l < lanes.size(); ++l) {
+    group.run([this, l] { deliver(lanes[l]); }, static_cast<int>(l - 1));
+  }
+  deliver(lanes[0]);
+  group.wait();
+}
+
+void BarRouter::deliver(const std::vector<Delivery>& lane) const {
+  for (const Delivery& delivery : lane) {
+    const StockData* bar = subscriptions[delivery.subscription].delivered;
+    if (bar != nullptr) {
+      delivery.trader->onSharedBar(*bar);
+    }
+  }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bar_aggregator.h
+ * @brief Incremental aggregation of ticks into fixed-size bars
+ *
+ * This file defines the BarAggregator, which folds a stream of ticks or
+ * fine bars into coarser bars in a single pass, and the BarRouter, which
+ * delivers each trader the resolution it subscribed to. Neither allocates
+ * after the traders have been added, so intraday streams that are orders of
+ * magnitude larger than daily data aggregate at memory speed.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "stock_data.h"
+
+class Trader;
+
+/**
+ * @brief Parses a bar size such as 1s, 30s, 1m, 5m, 1h or 1d
+ *
+ * "tick" or "0" selects the stream as delivered, without aggregation.
+ *
+ * @param text Count followed by s, m, h or d
+ * @param periodNs Receives the bar length in ns; 0 for ticks
+ * @return True if the text is a valid bar size
+ */
+bool parseBarSize(std::string_view text, int64_t& periodNs);
+
+/**
+ * @class BarAggregator
+ * @brief Folds ticks of one symbol into bars aligned to multiples of a period
+ *
+ * Bars are aligned to the epoch, so 1d bars start at midnight UTC and 5m
+ * bars at :00, :05 and so on, and are stamped with their start time. A bar
+ * is complete when the first tick of a later period arrives; flush() closes
+ * the last, partial one at the end of the stream. Ticks may themselves be
+ * bars: open, high, low, close and volume all combine correctly.
+ */
+class BarAggregator {
+  public:
+    /**
+     * @brief Constructs an aggregator
+     *
+     * @param periodNs Bar length in ns; 0 passes every tick through
+     */
+    explicit BarAggregator(int64_t periodNs = 0);
+
+    /**
+     * @brief Gets the bar length in ns
+     */
+    int64_t getPeriod() const;
+
+    /**
+     * @brief Adds a tick
+     *
+     * @param tick Tick or bar, not earlier than the previous one
+     * @param completed Receives the bar the tick completed, if any
+     * @return True if a bar was completed
+     */
+    bool add(const StockData& tick, StockData& completed);
+
+    /**
+     * @brief Closes the bar in progress
+     *
+     * @param completed Receives the partial bar, if any
+     * @return True if a bar was in progress
+     */
+    bool flush(StockData& completed);
+
+  private:
+    int64_t period;   ///< Bar length in ns
+    int64_t bucket;   ///< Start of the bar in progress
+    uint64_t volume;  ///< Volume of the bar in progress, before saturation
+    StockData bar;    ///< Bar in progress
+    bool open;        ///< Whether a bar is in progress
+};
+
+/**
+ * @class BarRouter
+ * @brief Delivers a tick stream to traders at the resolution each subscribed to
+ *
+ * Traders with the same bar size share one aggregator and receive bars in
+ * the order they were added. With a fan-out, the traders are dealt into
+ * lanes that receive each tick at once on the shared ThreadPool, and the
+ * tick is only done when every lane is; each trader stays in one lane, so
+ * it still sees every bar in order.
+ */
+class BarRouter {
+  public:
+    /**
+     * @brief Subscribes a trader at its bar size
+     *
+     * @param trader Trader to deliver to
+     */
+    void addTrader(Trader* trader);
+
+    /**
+     * @brief Feeds one tick, delivering every bar it completes
+     *
+     * @param tick Tick or bar, not earlier than the previous one
+     */
+    void publish(const StockData& tick);
+
+    /**
+     * @brief Delivers the partial bars still in progress
+     *
+     * @return True if any bar was delivered
+     */
+    bool finish();
+
+    /**
+     * @brief Spreads each tick's deliveries over lanes run in parallel
+     *
+     * The publishing thread runs one lane and the shared pool the others.
+     * Traders receive bars through Trader::onSharedBar(), so their reports
+     * wait in their mailboxes until their next bar. Set before the first tick.
+     *
+     * @param lanes Lanes per tick; 1 (default) delivers every bar on the publishing thread
+     */
+    void setFanOut(size_t lanes);
+
+  private:
+    /**
+     * @struct Subscription
+     * @brief Traders sharing one bar size
+     */
+    struct Subscription {
+        BarAggregator aggregator;      ///< Aggregator for the bar size
+        std::vector<Trader*> traders;  ///< Subscribed traders
+        StockData bar;                 ///< Bar completed by the current tick, when fanned out
+        const StockData* delivered = nullptr;  ///< Bar the current tick delivers, or nullptr
+    };
+
+    /**
+     * @struct Delivery
+     * @brief One trader in a lane and the subscription it receives bars from
+     */
+    struct Delivery {
+        size_t subscription;  ///< Index into subscriptions
+        Trader* trader;       ///< Trader to deliver to
+    };
+
+    /**
+     * @brief Delivers the bars the current tick completed, one lane per task
+     */
+    void deliverLanes();
+
+    /**
+     * @brief Delivers the current bars to the traders of one lane
+     */
+    void deliver(const std::vector<Delivery>& lane) const;
+
+    std::vector<Subscription> subscriptions;  ///< One per distinct bar size
+    size_t fanOut = 1;                        ///< Lanes requested per tick
+    std::vector<std::vector<Delivery>> lanes; ///< Traders dealt round-robin; rebuilt after addTrader()
+};
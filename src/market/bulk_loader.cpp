@@ -0,0 +1,211 @@
+#include "bulk_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <utility>
+
+#include "date.h"
+
+namespace {
+
+// Values bound per row: symbol, date, open, high, low, close, volume
+constexpr size_t kColumns = 7;
+
+// Room for one formatted timestamp
+constexpr size_t kDateLength = 32;
+
+// Widens a float to the double with the same shortest decimal form, so the
+// database holds 100.66559 rather than 100.665588378906
+double shortestDouble(float value) {
+  char buffer[32];
+  auto written = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  double widened = value;
+  std::from_chars(buffer, written.ptr, widened);
+  return widened;
+}
+
+}  // namespace
+
+BulkLoader::BulkLoader(std::string database, size_t rowsPerStatement)
+: databasePath(std::move(database)), batchRows(std::max<size_t>(rowsPerStatement, 1)), db(nullptr),
+  insert(nullptr), createdTable(false), loading(false) {}
+
+BulkLoader::~BulkLoader() {
+  abandon();
+}
+
+bool BulkLoader::begin() {
+  abandon();
+  started = std::chrono::steady_clock::now();
+  stats = LoadStats();
+
+  if (sqlite3_open(databasePath.c_str(), &db) != SQLITE_OK) {
+    std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << "\n";
+    abandon();
+    return false;
+  }
+
+  // A crash mid-load can lose the load but not corrupt the file: the
+  // write-ahead log keeps the database consistent without syncing
+  if (!exec("PRAGMA journal_mode=WAL;") || !exec("PRAGMA synchronous=OFF;") || !exec("PRAGMA cache_size=-65536;")) {
+    abandon();
+    return false;
+  }
+
+  sqlite3_stmt* exists = nullptr;
+  sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'stock_data';", -1, &exists,
+                     nullptr);
+  createdTable = exists != nullptr && sqlite3_step(exists) != SQLITE_ROW;
+  sqlite3_finalize(exists);
+
+  if (!exec("BEGIN TRANSACTION;")) {
+    abandon();
+    return false;
+  }
+  loading = true;
+
+  // The key of a new table is built after the load, by finish()
+  if (createdTable
+      && !exec("CREATE TABLE stock_data ("
+               "symbol TEXT, date TEXT, open REAL, high REAL, low REAL, close REAL, volume INTEGER);")) {
+    abandon();
+    return false;
+  }
+
+  size_t variables = static_cast<size_t>(sqlite3_limit(db, SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+  batchRows = std::max<size_t>(std::min(batchRows, variables / kColumns), 1);
+  insert = prepareInsert(batchRows);
+  if (insert == nullptr) {
+    abandon();
+    return false;
+  }
+  pending.reserve(batchRows);
+  dates.resize(batchRows * kDateLength);
+  return true;
+}
+
+bool BulkLoader::add(const StockData& bar) {
+  if (!loading) {
+    return false;
+  }
+  pending.push_back(bar);
+  return pending.size() < batchRows || flush(insert);
+}
+
+bool BulkLoader::add(const std::vector<StockData>& bars) {
+  for (const StockData& bar : bars) {
+    if (!add(bar)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BulkLoader::finish() {
+  if (!loading) {
+    return false;
+  }
+
+  bool ok = true;
+  if (!pending.empty()) {
+    sqlite3_stmt* tail = prepareInsert(pending.size());
+    ok = tail != nullptr && flush(tail);
+    sqlite3_finalize(tail);
+  }
+
+  // One sort of the finished table instead of an index update per row
+  if (ok && createdTable) {
+    const char* key = "CREATE UNIQUE INDEX stock_data_key ON stock_data (symbol, date);";
+    if (sqlite3_exec(db, key, nullptr, nullptr, nullptr) != SQLITE_OK) {
+      ok = removeDuplicates() && exec(key);
+    }
+  }
+
+  if (!ok || !exec("COMMIT;")) {
+    abandon();
+    return false;
+  }
+  loading = false;
+
+  // Back to durable writes; the checkpoint syncs the loaded pages into the database
+  ok = exec("PRAGMA synchronous=NORMAL;") && exec("PRAGMA wal_checkpoint(TRUNCATE);");
+  abandon();
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  return ok;
+}
+
+const LoadStats& BulkLoader::getStats() const {
+  return stats;
+}
+
+bool BulkLoader::exec(const char* sql) {
+  char* error = nullptr;
+  if (sqlite3_exec(db, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+    std::cerr << "Cannot load stock data: " << (error != nullptr ? error : sqlite3_errmsg(db)) << "\n";
+    sqlite3_free(error);
+    return false;
+  }
+  return true;
+}
+
+sqlite3_stmt* BulkLoader::prepareInsert(size_t rows) {
+  std::string sql = "INSERT OR REPLACE INTO stock_data VALUES ";
+  sql.reserve(sql.size() + rows * 17);
+  for (size_t i = 0; i < rows; ++i) {
+    sql += i == 0 ? "(?,?,?,?,?,?,?)" : ",(?,?,?,?,?,?,?)";
+  }
+
+  sqlite3_stmt* statement = nullptr;
+  if (sqlite3_prepare_v2(db, sql.c_str(), static_cast<int>(sql.size()), &statement, nullptr) != SQLITE_OK) {
+    std::cerr << "Cannot prepare insert: " << sqlite3_errmsg(db) << "\n";
+    sqlite3_finalize(statement);
+    return nullptr;
+  }
+  return statement;
+}
+
+// Symbols come from the SymbolTable and dates from a buffer that outlives
+// the step, so neither is copied by SQLite
+bool BulkLoader::flush(sqlite3_stmt* statement) {
+  for (size_t i = 0; i < pending.size(); ++i) {
+    const StockData& bar = pending[i];
+    char* date = &dates[i * kDateLength];
+    size_t length = formatTimestamp(bar.timestamp, date);
+    int column = static_cast<int>(i * kColumns);
+    sqlite3_bind_text(statement, column + 1, bar.symbolName().c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(statement, column + 2, date, static_cast<int>(length), SQLITE_STATIC);
+    sqlite3_bind_double(statement, column + 3, shortestDouble(bar.open));
+    sqlite3_bind_double(statement, column + 4, shortestDouble(bar.high));
+    sqlite3_bind_double(statement, column + 5, shortestDouble(bar.low));
+    sqlite3_bind_double(statement, column + 6, shortestDouble(bar.close));
+    sqlite3_bind_int64(statement, column + 7, bar.volume);
+  }
+
+  bool ok = sqlite3_step(statement) == SQLITE_DONE;
+  if (!ok) {
+    std::cerr << "Cannot insert stock data: " << sqlite3_errmsg(db) << "\n";
+  }
+  sqlite3_reset(statement);
+  stats.rows += ok ? pending.size() : 0;
+  pending.clear();
+  return ok;
+}
+
+// Rowids grow in insertion order, so the highest one per key is the last row added
+bool BulkLoader::removeDuplicates() {
+  return exec("DELETE FROM stock_data WHERE rowid NOT IN "
+              "(SELECT MAX(rowid) FROM stock_data GROUP BY symbol, date);");
+}
+
+void BulkLoader::abandon() {
+  sqlite3_finalize(insert);
+  insert = nullptr;
+  if (loading) {
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    loading = false;
+  }
+  sqlite3_close(db);
+  db = nullptr;
+  pending.clear();
+}
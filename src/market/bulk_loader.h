@@ -0,0 +1,142 @@
+/**
+ * @file bulk_loader.h
+ * @brief Fast bulk writer of OHLCV rows into the stock_data table
+ *
+ * This file defines BulkLoader, which stores large numbers of bars in a
+ * SQLite database in one transaction. Rows are inserted many at a time
+ * through one reused prepared statement, with the write-ahead log on and
+ * syncing off for the duration of the load. A table the loader creates is
+ * filled without an index, and its (symbol, date) key is built once the
+ * rows are in, which is much cheaper than maintaining the key on every
+ * insert when rows arrive date by date across many symbols.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sqlite3.h"
+#include "stock_data.h"
+
+/**
+ * @struct LoadStats
+ * @brief Size and speed of a bulk load
+ */
+struct LoadStats {
+    uint64_t rows = 0;     ///< Rows written
+    double seconds = 0;    ///< Time from begin() to the end of finish()
+
+    /**
+     * @brief Gets the load rate
+     */
+    double rowsPerSecond() const { return seconds > 0 ? rows / seconds : 0; }
+};
+
+/**
+ * @class BulkLoader
+ * @brief Writes bars into the stock_data table of one database
+ *
+ * Call begin(), add() every bar, then finish(). Rows for a symbol and date
+ * already stored replace the old ones, as with get_stock_data.py; within
+ * one load, the last row added for a key wins. Nothing is visible to other
+ * connections until finish() commits, and a loader destroyed before then
+ * rolls the load back.
+ */
+class BulkLoader {
+  public:
+    /// Rows inserted by one statement; 7 values each stays under SQLite's oldest variable limit
+    static constexpr size_t kRowsPerStatement = 128;
+
+    /**
+     * @brief Constructs a loader for a database
+     *
+     * @param database Path to the SQLite database; created if missing
+     * @param rowsPerStatement Rows per INSERT; lowered if SQLite allows fewer variables
+     */
+    explicit BulkLoader(std::string database, size_t rowsPerStatement = kRowsPerStatement);
+
+    /**
+     * @brief Rolls back an unfinished load and closes the database
+     */
+    ~BulkLoader();
+
+    BulkLoader(const BulkLoader&) = delete;
+    BulkLoader& operator=(const BulkLoader&) = delete;
+
+    /**
+     * @brief Opens the database, tunes it for loading and starts the transaction
+     *
+     * @return True if the load can start
+     */
+    bool begin();
+
+    /**
+     * @brief Adds one bar
+     *
+     * @param bar Bar to store
+     * @return True unless writing a full batch failed
+     */
+    bool add(const StockData& bar);
+
+    /**
+     * @brief Adds bars in order
+     *
+     * @param bars Bars to store
+     * @return True unless writing failed
+     */
+    bool add(const std::vector<StockData>& bars);
+
+    /**
+     * @brief Writes the remaining rows, builds the key if needed and commits
+     *
+     * Syncing is back on once this returns.
+     *
+     * @return True if every row was stored
+     */
+    bool finish();
+
+    /**
+     * @brief Gets the rows written so far and, after finish(), the load time
+     */
+    const LoadStats& getStats() const;
+
+  private:
+    /**
+     * @brief Runs a statement without results, reporting any error
+     */
+    bool exec(const char* sql);
+
+    /**
+     * @brief Prepares an INSERT of a number of rows
+     */
+    sqlite3_stmt* prepareInsert(size_t rows);
+
+    /**
+     * @brief Binds the pending rows to a statement and runs it
+     */
+    bool flush(sqlite3_stmt* statement);
+
+    /**
+     * @brief Removes all but the last row added for each key, so the key can be built
+     */
+    bool removeDuplicates();
+
+    /**
+     * @brief Rolls back, restores syncing and closes the database
+     */
+    void abandon();
+
+    std::string databasePath;   ///< Path to the database
+    size_t batchRows;           ///< Rows per full INSERT
+    sqlite3* db;                ///< Connection, open between begin() and finish()
+    sqlite3_stmt* insert;       ///< INSERT of batchRows rows
+    std::vector<StockData> pending;  ///< Rows not yet inserted
+    std::vector<char> dates;    ///< Formatted dates of the rows being inserted
+    bool createdTable;          ///< Whether this load created stock_data, and so builds its key
+    bool loading;               ///< Whether a transaction is open
+    std::chrono::steady_clock::time_point started;  ///< When begin() was called
+    LoadStats stats;            ///< Rows written and load time
+};
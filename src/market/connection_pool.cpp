@@ -0,0 +1,199 @@
+#include "connection_pool.h"
+
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr int64_t kDefaultMmapSize = int64_t(256) << 20;
+constexpr size_t kDefaultMaxIdle = 16;
+
+}  // namespace
+
+ConnectionPool::Connection::~Connection() {
+  for (auto& [sql, statement] : queries) {
+    sqlite3_finalize(statement);
+  }
+  sqlite3_close(db);
+}
+
+ConnectionPool::Lease::Lease() : pool(nullptr) {}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+: pool(other.pool), connection(std::move(other.connection)), message(std::move(other.message)) {
+  other.pool = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+  if (this != &other) {
+    release();
+    pool = other.pool;
+    connection = std::move(other.connection);
+    message = std::move(other.message);
+    other.pool = nullptr;
+  }
+  return *this;
+}
+
+ConnectionPool::Lease::~Lease() {
+  release();
+}
+
+ConnectionPool::Lease::operator bool() const {
+  return connection != nullptr;
+}
+
+sqlite3* ConnectionPool::Lease::handle() const {
+  return connection != nullptr ? connection->db : nullptr;
+}
+
+sqlite3_stmt* ConnectionPool::Lease::prepare(const std::string& sql) {
+  if (connection == nullptr) {
+    return nullptr;
+  }
+
+  auto it = connection->queries.find(sql);
+  if (it != connection->queries.end()) {
+    sqlite3_reset(it->second);
+    sqlite3_clear_bindings(it->second);
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    ++pool->counters.cached;
+    return it->second;
+  }
+
+  sqlite3_stmt* statement = nullptr;
+  if (sqlite3_prepare_v3(connection->db, sql.c_str(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT,
+                         &statement, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(statement);
+    return nullptr;
+  }
+  connection->queries.emplace(sql, statement);
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  ++pool->counters.prepared;
+  return statement;
+}
+
+const std::string& ConnectionPool::Lease::error() const {
+  return message;
+}
+
+void ConnectionPool::Lease::release() {
+  if (connection != nullptr) {
+    pool->release(std::move(connection));
+  }
+  pool = nullptr;
+}
+
+ConnectionPool& ConnectionPool::instance() {
+  static ConnectionPool pool;
+  return pool;
+}
+
+ConnectionPool::ConnectionPool() : mmapSize(kDefaultMmapSize), maxIdle(kDefaultMaxIdle), generation(0), counters{} {}
+
+ConnectionPool::~ConnectionPool() = default;
+
+// Reuse the most recently returned connection; open a new one outside the
+// lock only when every connection to the database is leased
+ConnectionPool::Lease ConnectionPool::acquire(const std::string& database) {
+  Lease lease;
+  lease.pool = this;
+
+  while (true) {
+    std::unique_ptr<Connection> connection;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = idle.find(database);
+      if (it == idle.end() || it->second.empty()) {
+        break;
+      }
+      connection = std::move(it->second.back());
+      it->second.pop_back();
+    }
+    if (!moved(*connection)) {
+      lease.connection = std::move(connection);
+      std::lock_guard<std::mutex> lock(mutex);
+      ++counters.reused;
+      return lease;
+    }
+  }
+
+  auto connection = std::make_unique<Connection>();
+  connection->database = database;
+  int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+  if (sqlite3_open_v2(database.c_str(), &connection->db, flags, nullptr) != SQLITE_OK) {
+    lease.message = sqlite3_errmsg(connection->db);
+    lease.pool = nullptr;
+    return lease;
+  }
+
+  int64_t mapped = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    mapped = mmapSize;
+    connection->generation = generation;
+    ++counters.opened;
+  }
+  std::string pragma = "PRAGMA mmap_size=" + std::to_string(mapped) + ";";
+  sqlite3_exec(connection->db, pragma.c_str(), nullptr, nullptr, nullptr);
+
+  lease.connection = std::move(connection);
+  return lease;
+}
+
+void ConnectionPool::setMmapSize(int64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  mmapSize = bytes;
+}
+
+void ConnectionPool::setMaxIdle(size_t connections) {
+  std::vector<std::unique_ptr<Connection>> closing;
+  std::lock_guard<std::mutex> lock(mutex);
+  maxIdle = connections;
+  for (auto& [database, pooled] : idle) {
+    while (pooled.size() > maxIdle) {
+      closing.push_back(std::move(pooled.front()));
+      pooled.erase(pooled.begin());
+    }
+  }
+}
+
+void ConnectionPool::clear() {
+  std::map<std::string, std::vector<std::unique_ptr<Connection>>> closing;
+  std::lock_guard<std::mutex> lock(mutex);
+  closing.swap(idle);
+  ++generation;
+}
+
+ConnectionPool::Stats ConnectionPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats current = counters;
+  current.idle = 0;
+  for (const auto& [database, connections] : idle) {
+    current.idle += connections.size();
+  }
+  return current;
+}
+
+// A statement left mid-query would hold its read transaction open and pin
+// an old snapshot of the database, so every statement is reset on return
+void ConnectionPool::release(std::unique_ptr<Connection> connection) {
+  for (auto& [sql, statement] : connection->queries) {
+    sqlite3_reset(statement);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (connection->generation != generation) {
+    return;
+  }
+  std::vector<std::unique_ptr<Connection>>& connections = idle[connection->database];
+  if (connections.size() < maxIdle) {
+    connections.push_back(std::move(connection));
+  }
+}
+
+bool ConnectionPool::moved(const Connection& connection) {
+  int hasMoved = 0;
+  sqlite3_file_control(connection.db, "main", SQLITE_FCNTL_HAS_MOVED, &hasMoved);
+  return hasMoved != 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file connection_pool.h
+ * @brief Shared read-only SQLite connections with cached prepared statements
+ *
+ * This file defines ConnectionPool, which keeps read-only connections to
+ * each database open between queries and hands them to one thread at a
+ * time. Connections are opened without SQLite's internal mutex and with
+ * memory-mapped I/O, and each keeps the statements prepared on it, so a
+ * backtest that queries the database pays neither the open nor the parse
+ * again, and threads querying concurrently never wait on each other.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sqlite3.h"
+
+/**
+ * @class ConnectionPool
+ * @brief Process-wide pool of read-only connections, by database path
+ *
+ * A thread acquires a Lease, queries through it and lets it go; the
+ * connection and every statement prepared on it then wait, reset, for the
+ * next thread that asks for the same database. The most recently returned
+ * connection is handed out first, so its page cache and statements are
+ * warm. Connections to a database file that has since been deleted or
+ * replaced are closed instead of reused.
+ */
+class ConnectionPool {
+  private:
+    struct Connection;
+
+  public:
+    /**
+     * @struct Stats
+     * @brief Counters describing pool effectiveness
+     */
+    struct Stats {
+        uint64_t opened;      ///< Connections opened
+        uint64_t reused;      ///< Leases served by an idle connection
+        uint64_t prepared;    ///< Statements compiled
+        uint64_t cached;      ///< Statements served already compiled
+        size_t idle;          ///< Connections currently waiting for a lease
+    };
+
+    /**
+     * @class Lease
+     * @brief Exclusive use of one connection; returns it to the pool when destroyed
+     */
+    class Lease {
+      public:
+        Lease();
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        /**
+         * @brief Checks whether the lease holds an open connection
+         */
+        explicit operator bool() const;
+
+        /**
+         * @brief Gets the connection, for error messages and one-off calls
+         */
+        sqlite3* handle() const;
+
+        /**
+         * @brief Gets a statement compiled on this connection
+         *
+         * The first request for a query on a connection compiles it; later
+         * requests return the same statement, reset and with its bindings
+         * cleared. The statement is valid until the lease ends.
+         *
+         * @param sql Query text
+         * @return The statement, or nullptr if the query does not compile
+         */
+        sqlite3_stmt* prepare(const std::string& sql);
+
+        /**
+         * @brief Gets why the connection could not be opened
+         */
+        const std::string& error() const;
+
+      private:
+        friend class ConnectionPool;
+
+        /**
+         * @brief Returns the connection, if any, to its pool
+         */
+        void release();
+
+        ConnectionPool* pool;                     ///< Pool the connection goes back to
+        std::unique_ptr<Connection> connection;   ///< Connection held, or null
+        std::string message;                      ///< Open error, if the lease is empty
+    };
+
+    /**
+     * @brief Gets the process-wide pool
+     *
+     * @return The shared instance
+     */
+    static ConnectionPool& instance();
+
+    ~ConnectionPool();
+
+    /**
+     * @brief Leases a read-only connection to a database
+     *
+     * @param database Path to the SQLite database; must already exist
+     * @return The lease; empty, with error() set, if the database cannot be opened
+     */
+    Lease acquire(const std::string& database);
+
+    /**
+     * @brief Sets the bytes of each database file mapped into memory
+     *
+     * Applies to connections opened afterwards; 0 turns memory mapping off.
+     *
+     * @param bytes Mapping limit per connection (default 256 MiB)
+     */
+    void setMmapSize(int64_t bytes);
+
+    /**
+     * @brief Sets how many idle connections are kept per database
+     *
+     * Connections returned beyond the limit are closed; 0 turns pooling off.
+     *
+     * @param connections Idle connections kept per database (default 16)
+     */
+    void setMaxIdle(size_t connections);
+
+    /**
+     * @brief Closes every idle connection
+     *
+     * Leased connections are closed when their leases end.
+     */
+    void clear();
+
+    /**
+     * @brief Gets the current counters
+     */
+    Stats stats() const;
+
+  private:
+    ConnectionPool();
+
+    /**
+     * @struct Connection
+     * @brief An open connection and the statements compiled on it
+     */
+    struct Connection {
+        std::string database;                          ///< Path the connection was opened with
+        sqlite3* db = nullptr;                         ///< Read-only connection
+        std::map<std::string, sqlite3_stmt*> queries;  ///< Statements by query text
+        uint64_t generation = 0;                       ///< clear() count when opened
+
+        ~Connection();
+    };
+
+    /**
+     * @brief Takes back a connection at the end of a lease
+     */
+    void release(std::unique_ptr<Connection> connection);
+
+    /**
+     * @brief Checks whether the file under a connection was deleted or replaced
+     */
+    static bool moved(const Connection& connection);
+
+    mutable std::mutex mutex;  ///< Guards every member below
+    std::map<std::string, std::vector<std::unique_ptr<Connection>>> idle;  ///< Idle connections, most recent last
+    int64_t mmapSize;          ///< Mapping limit of new connections
+    size_t maxIdle;            ///< Idle connections kept per database
+    uint64_t generation;       ///< Times clear() was called; older connections are closed on return
+    Stats counters;            ///< Open/reuse/prepare counters
+};
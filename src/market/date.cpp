@@ -0,0 +1,179 @@
+#include "date.h"
+
+namespace {
+
+bool isLeapYear(int year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+unsigned daysInMonth(int year, unsigned month) {
+  static const unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+// Reads n ASCII digits; returns -1 on any non-digit
+inline int readDigits(const char* p, int n) {
+  int value = 0;
+  for (int i = 0; i < n; ++i) {
+    unsigned digit = static_cast<unsigned>(p[i] - '0');
+    if (digit > 9) {
+      return -1;
+    }
+    value = value * 10 + static_cast<int>(digit);
+  }
+  return value;
+}
+
+}  // namespace
+
+// Howard Hinnant's days_from_civil
+int32_t daysFromCivil(int year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+// Howard Hinnant's civil_from_days
+void civilFromDays(int32_t days, int& year, unsigned& month, unsigned& day) {
+  const int64_t z = static_cast<int64_t>(days) + 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = static_cast<unsigned>(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = static_cast<int>(static_cast<int64_t>(yoe) + era * 400 + (month <= 2));
+}
+
+bool parseDate(std::string_view text, int32_t& days) {
+  if (text.size() != 10 || text[4] != '-' || text[7] != '-') {
+    return false;
+  }
+
+  const int year = readDigits(text.data(), 4);
+  const int month = readDigits(text.data() + 5, 2);
+  const int day = readDigits(text.data() + 8, 2);
+  if (year < 0 || month < 1 || month > 12 || day < 1 ||
+      static_cast<unsigned>(day) > daysInMonth(year, month)) {
+    return false;
+  }
+
+  days = daysFromCivil(year, month, day);
+  return true;
+}
+
+bool parseTimestamp(std::string_view text, int64_t& timestamp) {
+  int32_t days = 0;
+  if (!parseDate(text.substr(0, 10), days)) {
+    return false;
+  }
+  timestamp = daysToTimestamp(days);
+  if (text.size() == 10) {
+    return true;
+  }
+
+  if (text.size() < 19 || (text[10] != ' ' && text[10] != 'T') || text[13] != ':' || text[16] != ':') {
+    return false;
+  }
+  const int hour = readDigits(text.data() + 11, 2);
+  const int minute = readDigits(text.data() + 14, 2);
+  const int second = readDigits(text.data() + 17, 2);
+  if (hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59) {
+    return false;
+  }
+  timestamp += (hour * 3600LL + minute * 60LL + second) * kNanosPerSecond;
+
+  if (text.size() == 19) {
+    return true;
+  }
+  size_t digits = text.size() - 20;
+  if (text[19] != '.' || digits == 0 || digits > 9) {
+    return false;
+  }
+  int fraction = readDigits(text.data() + 20, static_cast<int>(digits));
+  if (fraction < 0) {
+    return false;
+  }
+  for (size_t i = digits; i < 9; ++i) {
+    fraction *= 10;
+  }
+  timestamp += fraction;
+  return true;
+}
+
+bool isValidDate(std::string_view text) {
+  int32_t days;
+  return parseDate(text, days);
+}
+
+void formatDate(int32_t days, char* out) {
+  int year;
+  unsigned month;
+  unsigned day;
+  civilFromDays(days, year, month, day);
+
+  // Years outside 0000-9999 cannot be written in this layout; clamp them
+  unsigned y = year < 0 ? 0 : (year > 9999 ? 9999 : static_cast<unsigned>(year));
+  out[0] = static_cast<char>('0' + y / 1000);
+  out[1] = static_cast<char>('0' + y / 100 % 10);
+  out[2] = static_cast<char>('0' + y / 10 % 10);
+  out[3] = static_cast<char>('0' + y % 10);
+  out[4] = '-';
+  out[5] = static_cast<char>('0' + month / 10);
+  out[6] = static_cast<char>('0' + month % 10);
+  out[7] = '-';
+  out[8] = static_cast<char>('0' + day / 10);
+  out[9] = static_cast<char>('0' + day % 10);
+  out[10] = '\0';
+}
+
+std::string formatDate(int32_t days) {
+  char buffer[11];
+  formatDate(days, buffer);
+  return std::string(buffer, 10);
+}
+
+size_t formatTimestamp(int64_t timestamp, char* out) {
+  int32_t days = timestampToDays(timestamp);
+  formatDate(days, out);
+  int64_t nanos = timestamp - daysToTimestamp(days);
+  if (nanos == 0) {
+    return 10;
+  }
+
+  int64_t seconds = nanos / kNanosPerSecond;
+  unsigned parts[3] = {static_cast<unsigned>(seconds / 3600), static_cast<unsigned>(seconds / 60 % 60),
+                       static_cast<unsigned>(seconds % 60)};
+  char* p = out + 10;
+  for (int i = 0; i < 3; ++i) {
+    *p++ = i == 0 ? ' ' : ':';
+    *p++ = static_cast<char>('0' + parts[i] / 10);
+    *p++ = static_cast<char>('0' + parts[i] % 10);
+  }
+
+  int64_t fraction = nanos % kNanosPerSecond;
+  if (fraction != 0) {
+    *p++ = '.';
+    for (int64_t scale = kNanosPerSecond / 10; scale > 0 && fraction != 0; scale /= 10) {
+      *p++ = static_cast<char>('0' + fraction / scale);
+      fraction %= scale;
+    }
+  }
+  *p = '\0';
+  return static_cast<size_t>(p - out);
+}
+
+int weekday(int32_t days) {
+  // 1970-01-01 was a Thursday
+  int result = (days + 4) % 7;
+  return result < 0 ? result + 7 : result;
+}
+
+bool isWeekend(int32_t days) {
+  int day = weekday(days);
+  return day == 0 || day == 6;
+}
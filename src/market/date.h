@@ -0,0 +1,145 @@
+/**
+ * @file date.h
+ * @brief Fast calendar date parsing, formatting and arithmetic
+ *
+ * Dates are represented as the number of days since 1970-01-01 in the
+ * proleptic Gregorian calendar, so they sort and compare with a single
+ * integer operation. Timestamps are nanoseconds since the same epoch.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Nanoseconds in one second
+constexpr int64_t kNanosPerSecond = 1000000000LL;
+
+/// Nanoseconds in one day
+constexpr int64_t kNanosPerDay = 86400LL * kNanosPerSecond;
+
+/// Nanoseconds in an average Gregorian year, used to annualise returns
+constexpr int64_t kNanosPerYear = 31556952LL * kNanosPerSecond;
+
+/**
+ * @brief Converts a calendar date to days since 1970-01-01
+ *
+ * @param year Year
+ * @param month Month (1-12)
+ * @param day Day of the month (1-31)
+ * @return Days since the epoch; negative before 1970
+ */
+int32_t daysFromCivil(int year, unsigned month, unsigned day);
+
+/**
+ * @brief Converts days since 1970-01-01 to a calendar date
+ *
+ * @param days Days since the epoch
+ * @param year Receives the year
+ * @param month Receives the month (1-12)
+ * @param day Receives the day of the month (1-31)
+ */
+void civilFromDays(int32_t days, int& year, unsigned& month, unsigned& day);
+
+/**
+ * @brief Parses a YYYY-MM-DD date
+ *
+ * Rejects anything that is not exactly ten characters in that layout or
+ * that names a day the month does not have.
+ *
+ * @param text Text to parse
+ * @param days Receives days since 1970-01-01
+ * @return True if the text is a valid date
+ */
+bool parseDate(std::string_view text, int32_t& days);
+
+/**
+ * @brief Parses a date with an optional UTC time of day
+ *
+ * Accepts YYYY-MM-DD, which is midnight, or YYYY-MM-DD HH:MM:SS with a 'T'
+ * or a space between date and time and up to nine fractional digits, so
+ * daily and intraday rows share the date column.
+ *
+ * @param text Text to parse
+ * @param timestamp Receives nanoseconds since the epoch
+ * @return True if the text is a valid date or date and time
+ */
+bool parseTimestamp(std::string_view text, int64_t& timestamp);
+
+/**
+ * @brief Checks that text is a valid YYYY-MM-DD date
+ *
+ * @param text Text to check
+ * @return True if parseDate() would accept it
+ */
+bool isValidDate(std::string_view text);
+
+/**
+ * @brief Formats days since 1970-01-01 as YYYY-MM-DD
+ *
+ * @param days Days since the epoch
+ * @param out Buffer of at least 11 characters; receives a NUL-terminated date
+ */
+void formatDate(int32_t days, char* out);
+
+/**
+ * @brief Formats days since 1970-01-01 as YYYY-MM-DD
+ *
+ * @param days Days since the epoch
+ * @return The formatted date
+ */
+std::string formatDate(int32_t days);
+
+/**
+ * @brief Formats a timestamp as parseTimestamp() reads it
+ *
+ * Midnight is written as YYYY-MM-DD alone, so daily bars keep their plain
+ * dates; other times as YYYY-MM-DD HH:MM:SS, with a fraction only when the
+ * timestamp is not a whole second.
+ *
+ * @param timestamp Nanoseconds since the epoch
+ * @param out Buffer of at least 30 characters; receives a NUL-terminated text
+ * @return Number of characters written, excluding the NUL
+ */
+size_t formatTimestamp(int64_t timestamp, char* out);
+
+/**
+ * @brief Gets the day of the week
+ *
+ * @param days Days since 1970-01-01
+ * @return 0 for Sunday through 6 for Saturday
+ */
+int weekday(int32_t days);
+
+/**
+ * @brief Checks whether a day falls on Saturday or Sunday
+ *
+ * @param days Days since 1970-01-01
+ * @return True on weekends
+ */
+bool isWeekend(int32_t days);
+
+/**
+ * @brief Converts days since the epoch to a timestamp at midnight UTC
+ *
+ * @param days Days since 1970-01-01
+ * @return Nanoseconds since the epoch
+ */
+inline int64_t daysToTimestamp(int32_t days) {
+  return static_cast<int64_t>(days) * kNanosPerDay;
+}
+
+/**
+ * @brief Gets the day a timestamp falls on
+ *
+ * @param timestamp Nanoseconds since the epoch
+ * @return Days since 1970-01-01, rounded towards negative infinity
+ */
+inline int32_t timestampToDays(int64_t timestamp) {
+  int64_t days = timestamp / kNanosPerDay;
+  if (timestamp % kNanosPerDay < 0) {
+    days -= 1;
+  }
+  return static_cast<int32_t>(days);
+}
@@ -0,0 +1,243 @@
+#include "market_data_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+#include "sqlite3.h"
+#include "connection_pool.h"
+#include "date.h"
+#include "symbol_table.h"
+
+namespace {
+
+constexpr size_t kDefaultCapacity = size_t(256) << 20;
+
+// Bars of a series whose timestamps fall on days [first, last]. Compares
+// in days so far-off range ends such as 9999-12-31 cannot overflow.
+std::pair<const StockData*, const StockData*> daySpan(const PriceSeries& series, int32_t first, int32_t last) {
+  auto byDay = [](const StockData& bar, int32_t day) { return timestampToDays(bar.timestamp) < day; };
+  const StockData* begin = series.bars.data();
+  const StockData* end = begin + series.bars.size();
+  const StockData* lo = std::lower_bound(begin, end, first, byDay);
+  const StockData* hi = std::lower_bound(lo, end, last + 1, byDay);
+  return {lo, hi};
+}
+
+}  // namespace
+
+size_t PriceSeries::bytes() const {
+  return sizeof(PriceSeries) + bars.capacity() * sizeof(StockData);
+}
+
+MarketDataCache& MarketDataCache::instance() {
+  static MarketDataCache cache;
+  return cache;
+}
+
+MarketDataCache::MarketDataCache() : capacity(kDefaultCapacity), bytes(0), loads(0), counters{} {}
+
+void MarketDataCache::setCapacity(size_t limit) {
+  std::lock_guard<std::mutex> lock(mutex);
+  capacity = limit;
+  evict();
+}
+
+// Look up or start loading a series. The first caller for a key loads it
+// outside the lock; later callers wait on the same shared future, so each
+// series is queried once no matter how many threads ask for it at once.
+std::shared_ptr<const PriceSeries> MarketDataCache::get(const std::string& database, const std::string& symbol) {
+  Key key = makeKey(database, symbol);
+  std::promise<std::shared_ptr<const PriceSeries>> promise;
+  std::shared_future<std::shared_ptr<const PriceSeries>> future;
+  uint64_t generation = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      ++counters.hits;
+      recency.splice(recency.begin(), recency, it->second.lru);
+      future = it->second.series;
+    } else {
+      ++counters.misses;
+      recency.push_front(key);
+      Entry& entry = entries[key];
+      entry.series = promise.get_future().share();
+      entry.lru = recency.begin();
+      entry.generation = generation = ++loads;
+    }
+  }
+
+  if (generation == 0) {
+    return future.get();
+  }
+
+  std::shared_ptr<const PriceSeries> series = load(database, symbol);
+  promise.set_value(series);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  if (it == entries.end() || it->second.generation != generation) {
+    // Invalidated while loading; the caller still gets what was read
+    return series;
+  }
+  if (series->bars.empty()) {
+    // Do not pin a miss, so rows fetched later become visible
+    recency.erase(it->second.lru);
+    entries.erase(it);
+    return series;
+  }
+  it->second.bytes = series->bytes();
+  bytes += it->second.bytes;
+  evict();
+  return series;
+}
+
+SeriesView MarketDataCache::range(const std::string& database, const std::string& symbol,
+                                  const std::string& start, const std::string& end) {
+  SeriesView view;
+  int32_t first = 0;
+  int32_t last = 0;
+  if (!parseDate(start, first) || !parseDate(end, last) || last < first) {
+    return view;
+  }
+
+  view.owner = get(database, symbol);
+  auto span = daySpan(*view.owner, first, last);
+  view.data = span.first;
+  view.size = static_cast<size_t>(span.second - span.first);
+  return view;
+}
+
+bool MarketDataCache::hasData(const std::string& database, const std::string& symbol,
+                              const std::string& start, const std::string& end) {
+  {
+    Key key = makeKey(database, symbol);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.bytes > 0) {
+      int32_t first = 0;
+      int32_t last = 0;
+      if (!parseDate(start, first) || !parseDate(end, last)) {
+        return false;
+      }
+      auto span = daySpan(*it->second.series.get(), first, last);
+      return span.first != span.second;
+    }
+  }
+
+  ConnectionPool::Lease connection = ConnectionPool::instance().acquire(database);
+  if (!connection) {
+    return false;
+  }
+
+  bool found = false;
+  // Intraday rows carry a time after the date, so the range ends before the next day
+  const char* query = "SELECT 1 FROM stock_data WHERE symbol = ? AND date >= ? AND date < ? LIMIT 1;";
+  int32_t last = 0;
+  std::string afterEnd = parseDate(end, last) ? formatDate(last + 1) : end;
+  sqlite3_stmt* stmt = connection.prepare(query);
+  if (stmt != nullptr) {
+    sqlite3_bind_text(stmt, 1, symbol.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, start.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, afterEnd.c_str(), -1, SQLITE_STATIC);
+    found = sqlite3_step(stmt) == SQLITE_ROW;
+  }
+  return found;
+}
+
+void MarketDataCache::invalidate(const std::string& database, const std::string& symbol) {
+  Key key = makeKey(database, symbol);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    return;
+  }
+  bytes -= it->second.bytes;
+  recency.erase(it->second.lru);
+  entries.erase(it);
+}
+
+void MarketDataCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Entries still loading are dropped too; their loaders notice the
+  // generation mismatch and hand the series to their callers only
+  entries.clear();
+  recency.clear();
+  bytes = 0;
+  counters = Stats{};
+}
+
+MarketDataCache::Stats MarketDataCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats current = counters;
+  current.bytes = bytes;
+  current.entries = entries.size();
+  return current;
+}
+
+// Spellings of one file, such as a relative and an absolute path, must
+// share an entry, or invalidate() would miss the copy a replay reads
+MarketDataCache::Key MarketDataCache::makeKey(const std::string& database, const std::string& symbol) {
+  std::error_code error;
+  std::filesystem::path path = std::filesystem::weakly_canonical(database, error);
+  if (error) {
+    path = std::filesystem::absolute(database, error).lexically_normal();
+  }
+  return Key(error ? database : path.string(), symbol);
+}
+
+// Walk from the least recently used end, skipping series still loading.
+// A series larger than the whole budget is handed out but not retained.
+void MarketDataCache::evict() {
+  auto it = recency.end();
+  while (bytes > capacity && it != recency.begin()) {
+    --it;
+    auto entry = entries.find(*it);
+    if (entry->second.bytes == 0) {
+      continue;
+    }
+    bytes -= entry->second.bytes;
+    ++counters.evictions;
+    entries.erase(entry);
+    it = recency.erase(it);
+  }
+}
+
+// Read every bar of the symbol in date order; the range filter is applied
+// in memory so one load serves every date range of a sweep
+std::shared_ptr<const PriceSeries> MarketDataCache::load(const std::string& database, const std::string& symbol) {
+  auto series = std::make_shared<PriceSeries>();
+  series->symbol = SymbolTable::instance().intern(symbol);
+
+  ConnectionPool::Lease connection = ConnectionPool::instance().acquire(database);
+  if (!connection) {
+    std::cerr << "Cannot open database: " << connection.error() << "\n";
+    return series;
+  }
+
+  const char* query = "SELECT date, open, high, low, close, volume FROM stock_data "
+                      "WHERE symbol = ? ORDER BY date;";
+  sqlite3_stmt* stmt = connection.prepare(query);
+  if (stmt == nullptr) {
+    std::cerr << "Cannot execute query: " << sqlite3_errmsg(connection.handle()) << "\n";
+    return series;
+  }
+
+  sqlite3_bind_text(stmt, 1, symbol.c_str(), -1, SQLITE_STATIC);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    int64_t timestamp = 0;
+    if (text == nullptr || !parseTimestamp(std::string_view(text, sqlite3_column_bytes(stmt, 0)), timestamp)) {
+      continue;
+    }
+    series->bars.emplace_back(series->symbol, timestamp,
+                              sqlite3_column_double(stmt, 1), sqlite3_column_double(stmt, 2),
+                              sqlite3_column_double(stmt, 3), sqlite3_column_double(stmt, 4),
+                              sqlite3_column_int64(stmt, 5));
+  }
+  series->bars.shrink_to_fit();
+  return series;
+}
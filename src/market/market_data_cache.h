@@ -0,0 +1,194 @@
+/**
+ * @file market_data_cache.h
+ * @brief Process-wide read-only cache of decoded price series
+ *
+ * This file defines the MarketDataCache class which loads each symbol's
+ * full history from SQLite once and shares it, read-only, with every
+ * StockMarket and worker thread that replays it. Parameter sweeps that replay
+ * the same symbol thousands of times hit the database exactly once.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stock_data.h"
+
+/**
+ * @struct PriceSeries
+ * @brief Immutable history of one symbol, ordered by timestamp
+ */
+struct PriceSeries {
+    uint32_t symbol;              ///< Symbol id in the global SymbolTable
+    std::vector<StockData> bars;  ///< Bars ordered by timestamp
+
+    /**
+     * @brief Gets the memory charged to the cache for this series
+     */
+    size_t bytes() const;
+};
+
+/**
+ * @struct SeriesView
+ * @brief Non-owning view of a contiguous run of bars
+ *
+ * Keeps the series it points into alive, so a view stays valid even if the
+ * cache evicts the series while a replay is still using it.
+ */
+struct SeriesView {
+    std::shared_ptr<const PriceSeries> owner;  ///< Series the view points into
+    const StockData* data = nullptr;           ///< First bar
+    size_t size = 0;                           ///< Number of bars
+
+    const StockData* begin() const { return data; }
+    const StockData* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+};
+
+/**
+ * @class MarketDataCache
+ * @brief Reference-counted, LRU-evicted cache of price series
+ *
+ * Series are keyed by database path and symbol; paths are normalized, so
+ * "data/x.db" and "./data/x.db" share one entry. Concurrent requests for a
+ * series that is still loading wait for the single in-flight load instead
+ * of querying the database again. When the bytes held exceed the budget,
+ * the least recently used series are dropped from the cache; callers that
+ * still hold them keep them alive through the shared pointer.
+ */
+class MarketDataCache {
+  public:
+    /// Database the application reads and fetches into unless told otherwise
+    static constexpr const char* kDefaultDatabase = "./data/stock_data.db";
+
+    /**
+     * @struct Stats
+     * @brief Counters describing cache effectiveness
+     */
+    struct Stats {
+        uint64_t hits;       ///< Requests served from memory
+        uint64_t misses;     ///< Requests that loaded from the database
+        uint64_t evictions;  ///< Series dropped to stay within budget
+        size_t bytes;        ///< Bytes currently held
+        size_t entries;      ///< Series currently held
+    };
+
+    /**
+     * @brief Gets the process-wide cache
+     *
+     * @return The shared instance
+     */
+    static MarketDataCache& instance();
+
+    /**
+     * @brief Sets the memory budget and evicts down to it
+     *
+     * @param bytes Maximum bytes of series to keep (default 256 MiB)
+     */
+    void setCapacity(size_t bytes);
+
+    /**
+     * @brief Gets a symbol's full history, loading it on first use
+     *
+     * @param database Path to the SQLite database
+     * @param symbol Symbol to load
+     * @return The series; empty if the database has no rows for the symbol
+     */
+    std::shared_ptr<const PriceSeries> get(const std::string& database, const std::string& symbol);
+
+    /**
+     * @brief Gets the bars of a symbol within an inclusive date range
+     *
+     * @param database Path to the SQLite database
+     * @param symbol Symbol to load
+     * @param start First date (YYYY-MM-DD)
+     * @param end Last date (YYYY-MM-DD)
+     * @return View of the bars in range
+     */
+    SeriesView range(const std::string& database, const std::string& symbol,
+                     const std::string& start, const std::string& end);
+
+    /**
+     * @brief Checks whether the database has any rows for a symbol and range
+     *
+     * Answers from memory when the series is cached and otherwise runs a
+     * single COUNT query, so callers can skip launching the Python fetcher.
+     *
+     * @param database Path to the SQLite database
+     * @param symbol Symbol to check
+     * @param start First date (YYYY-MM-DD)
+     * @param end Last date (YYYY-MM-DD)
+     * @return True if at least one row exists
+     */
+    bool hasData(const std::string& database, const std::string& symbol,
+                 const std::string& start, const std::string& end);
+
+    /**
+     * @brief Drops a symbol so the next request reloads it
+     *
+     * Used after new rows have been written for the symbol.
+     *
+     * @param database Path to the SQLite database
+     * @param symbol Symbol to drop
+     */
+    void invalidate(const std::string& database, const std::string& symbol);
+
+    /**
+     * @brief Drops every cached series and resets the counters
+     */
+    void clear();
+
+    /**
+     * @brief Gets the current counters
+     */
+    Stats stats() const;
+
+  private:
+    MarketDataCache();
+
+    using Key = std::pair<std::string, std::string>;  ///< Normalized database path and symbol
+
+    /**
+     * @brief Builds the key of a series, with the database path made absolute and normal
+     */
+    static Key makeKey(const std::string& database, const std::string& symbol);
+
+    /**
+     * @struct Entry
+     * @brief A cached or still-loading series
+     */
+    struct Entry {
+        std::shared_future<std::shared_ptr<const PriceSeries>> series;  ///< Ready once loaded
+        std::list<Key>::iterator lru;  ///< Position in the recency list
+        size_t bytes = 0;              ///< Bytes charged; 0 while loading
+        uint64_t generation = 0;       ///< Load that created the entry
+    };
+
+    /**
+     * @brief Reads a symbol's full history from the database
+     */
+    static std::shared_ptr<const PriceSeries> load(const std::string& database, const std::string& symbol);
+
+    /**
+     * @brief Drops least recently used loaded series until within budget
+     *
+     * Must be called with the mutex held.
+     */
+    void evict();
+
+    mutable std::mutex mutex;      ///< Guards every member below
+    std::map<Key, Entry> entries;  ///< Series by key
+    std::list<Key> recency;        ///< Most recently used first
+    size_t capacity;               ///< Budget in bytes
+    size_t bytes;                  ///< Bytes held by loaded series
+    uint64_t loads;                ///< Loads started; numbers entry generations
+    Stats counters;                ///< Hit/miss/eviction counters
+};
@@ -0,0 +1,90 @@
+#include "market_recording.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "symbol_table.h"
+
+namespace {
+
+constexpr char kRecordingMagic[8] = {'T', 'E', 'R', 'E', 'C', '0', '0', '1'};
+constexpr char kSymbolTag = 'S';
+constexpr char kBarTag = 'B';
+
+}  // namespace
+
+MarketRecorder::MarketRecorder(const std::string& path)
+: file(path, std::ios::binary | std::ios::trunc), count(0) {
+  if (!file) {
+    std::cerr << "Cannot create recording " << path << "\n";
+    return;
+  }
+  file.write(kRecordingMagic, sizeof(kRecordingMagic));
+}
+
+bool MarketRecorder::isOpen() const {
+  return file.is_open() && file.good();
+}
+
+void MarketRecorder::record(const StockData& bar) {
+  if (!file) {
+    return;
+  }
+
+  auto it = fileIds.find(bar.symbol);
+  if (it == fileIds.end()) {
+    const std::string& name = bar.symbolName();
+    uint16_t length = static_cast<uint16_t>(name.size());
+    file.put(kSymbolTag);
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.write(name.data(), length);
+    it = fileIds.emplace(bar.symbol, static_cast<uint32_t>(fileIds.size())).first;
+  }
+
+  StockData stored = bar;
+  stored.symbol = it->second;
+  file.put(kBarTag);
+  file.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+  count += 1;
+}
+
+uint64_t MarketRecorder::size() const {
+  return count;
+}
+
+bool loadRecording(const std::string& path, std::vector<StockData>& bars) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(kRecordingMagic)];
+  if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kRecordingMagic, sizeof(magic)) != 0) {
+    std::cerr << "Cannot read recording " << path << "\n";
+    return false;
+  }
+
+  std::vector<uint32_t> symbols;
+  char tag;
+  while (file.get(tag)) {
+    if (tag == kSymbolTag) {
+      uint16_t length = 0;
+      std::string name;
+      if (!file.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+        break;
+      }
+      name.resize(length);
+      if (!file.read(&name[0], length)) {
+        break;
+      }
+      symbols.push_back(SymbolTable::instance().intern(name));
+    } else if (tag == kBarTag) {
+      StockData bar;
+      if (!file.read(reinterpret_cast<char*>(&bar), sizeof(bar)) || bar.symbol >= symbols.size()) {
+        break;
+      }
+      bar.symbol = symbols[bar.symbol];
+      bars.push_back(bar);
+    } else {
+      std::cerr << "Corrupt recording " << path << "\n";
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file market_recording.h
+ * @brief Recording and loading of the market event stream
+ *
+ * This file defines the MarketRecorder, which writes every bar a
+ * StockMarket publishes to a binary file, and loadRecording(), which reads
+ * such a file back so the exact same input can be replayed later.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stock_data.h"
+
+/**
+ * @class MarketRecorder
+ * @brief Appends published bars to a recording file
+ *
+ * The file starts with an 8-byte magic and holds a sequence of tagged
+ * entries: a symbol definition the first time a symbol appears, then raw
+ * 32-byte StockData records that refer to symbols by their position in the
+ * file. Symbol ids are process-local, so they are never written directly.
+ */
+class MarketRecorder {
+  public:
+    /**
+     * @brief Creates or replaces a recording file
+     *
+     * @param path File to write
+     */
+    explicit MarketRecorder(const std::string& path);
+
+    /**
+     * @brief Checks whether the file could be created
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Appends a bar to the recording
+     *
+     * @param bar Bar as published to traders
+     */
+    void record(const StockData& bar);
+
+    /**
+     * @brief Gets the number of bars recorded
+     */
+    uint64_t size() const;
+
+  private:
+    std::ofstream file;                              ///< Recording being written
+    std::unordered_map<uint32_t, uint32_t> fileIds;  ///< File symbol index by SymbolTable id
+    uint64_t count;                                  ///< Bars written
+};
+
+/**
+ * @brief Reads every bar of a recording
+ *
+ * Symbols are interned into the global SymbolTable as they are read.
+ *
+ * @param path Recording file
+ * @param bars Receives the bars in recorded order
+ * @return False if the file is missing or malformed
+ */
+bool loadRecording(const std::string& path, std::vector<StockData>& bars);
@@ -0,0 +1,436 @@
+#include "series_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "symbol_table.h"
+
+namespace {
+
+constexpr char kSeriesMagic[8] = {'T', 'E', 'S', 'E', 'R', '0', '0', '1'};
+
+// Ticks from 1 down to 0.000001; finer grids are no smaller than raw float bits
+constexpr int kMaxDecimals = 6;
+constexpr double kPowers[kMaxDecimals + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+// Bars, decimals, first timestamp and first close
+constexpr size_t kHeaderBytes = 4 + 1 + 8 + 8;
+
+// Lets the decoder read every value with one unaligned 8-byte load, up to
+// the end of the last group of eight
+constexpr size_t kPadding = 64;
+
+// Widths above this cannot be read with one load and are stored as 64
+constexpr unsigned kMaxPackedWidth = 56;
+
+// Smallest block: every column a one-byte base and a zero width
+constexpr size_t kMinBlockBytes = 6 * 2;
+
+// Eight values span exactly Width bytes, so within a group every offset
+// and shift is a constant and the group needs no per-value arithmetic.
+// Writes up to the next multiple of eight values.
+template <unsigned Width>
+void unpackFixed(const uint8_t* in, size_t count, uint64_t base, uint64_t* values) {
+  constexpr uint64_t mask = (uint64_t(1) << Width) - 1;
+  for (size_t group = 0; group < count; group += 8, in += Width, values += 8) {
+    for (unsigned j = 0; j < 8; ++j) {
+      uint64_t word;
+      std::memcpy(&word, in + j * Width / 8, 8);
+      values[j] = ((word >> (j * Width % 8)) & mask) + base;
+    }
+  }
+}
+
+using Unpacker = void (*)(const uint8_t*, size_t, uint64_t, uint64_t*);
+
+template <size_t... Widths>
+constexpr std::array<Unpacker, sizeof...(Widths)> makeUnpackers(std::index_sequence<Widths...>) {
+  return {&unpackFixed<Widths>...};
+}
+
+// Unpackers by width, 0 to kMaxPackedWidth
+constexpr auto kUnpackers = makeUnpackers(std::make_index_sequence<kMaxPackedWidth + 1>());
+
+enum Column { kTimestamp, kClose, kOpen, kHigh, kLow, kVolume, kColumns };
+
+// Most bars that encoded data of this size could hold
+size_t encodableBars(size_t bytes) {
+  size_t payload = bytes > kHeaderBytes + kPadding ? bytes - kHeaderBytes - kPadding : 0;
+  return (payload / kMinBlockBytes) * SeriesDecoder::kBlockBars;
+}
+
+uint64_t zigzag(uint64_t value) {
+  return (value << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+uint64_t unzigzag(uint64_t value) {
+  return (value >> 1) ^ (0 - (value & 1));
+}
+
+// Maps float bits to integers in the same order as the floats, so nearby
+// prices become nearby integers; the mapping is its own inverse
+int64_t orderedBits(float price) {
+  int32_t bits = std::bit_cast<int32_t>(price);
+  return bits ^ ((bits >> 31) & 0x7FFFFFFF);
+}
+
+float fromOrderedBits(int64_t value) {
+  int32_t bits = static_cast<int32_t>(value);
+  return std::bit_cast<float>(bits ^ ((bits >> 31) & 0x7FFFFFFF));
+}
+
+// Stored form of a price: ticks when on a decimal grid, else ordered bits
+int64_t storedPrice(float price, int decimals) {
+  if (decimals < 0) {
+    return orderedBits(price);
+  }
+  return static_cast<int64_t>(std::nearbyint(static_cast<double>(price) * kPowers[decimals]));
+}
+
+float decimalPrice(int64_t ticks, double scale) {
+  return static_cast<float>(static_cast<double>(ticks) / scale);
+}
+
+// Checks a price comes back bit for bit from its ticks, decoded exactly as
+// the decoder will
+bool onGrid(float price, int decimals) {
+  double scaled = static_cast<double>(price) * kPowers[decimals];
+  if (!(std::fabs(scaled) < 0x1p52)) {
+    return false;
+  }
+  float back = decimalPrice(static_cast<int64_t>(std::nearbyint(scaled)), kPowers[decimals]);
+  return std::bit_cast<uint32_t>(back) == std::bit_cast<uint32_t>(price);
+}
+
+// Coarsest tick that reproduces every price, or -1 if none does
+int findDecimals(const StockData* bars, size_t count) {
+  for (int decimals = 0; decimals <= kMaxDecimals; ++decimals) {
+    bool fits = true;
+    for (size_t i = 0; i < count && fits; ++i) {
+      fits = onGrid(bars[i].open, decimals) && onGrid(bars[i].high, decimals) && onGrid(bars[i].low, decimals)
+             && onGrid(bars[i].close, decimals);
+    }
+    if (fits) {
+      return decimals;
+    }
+  }
+  return -1;
+}
+
+template <typename T>
+void putRaw(std::vector<uint8_t>& out, T value) {
+  size_t at = out.size();
+  out.resize(at + sizeof(T));
+  std::memcpy(&out[at], &value, sizeof(T));
+}
+
+template <typename T>
+T getRaw(const uint8_t* in) {
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  return value;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// Frame of reference: the block minimum, then every value less the minimum
+// at the width of the largest difference
+void packColumn(std::vector<uint8_t>& out, const uint64_t* values, size_t count) {
+  auto [low, high] = std::minmax_element(values, values + count);
+  uint64_t base = *low;
+  unsigned width = static_cast<unsigned>(std::bit_width(*high - base));
+  if (width > kMaxPackedWidth) {
+    width = 64;
+  }
+  putVarint(out, base);
+  out.push_back(static_cast<uint8_t>(width));
+
+  size_t at = out.size();
+  size_t bytes = (count * width + 7) / 8;
+  out.resize(at + bytes + kPadding, 0);
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t value = values[i] - base;
+    if (width == 64) {
+      std::memcpy(&out[at + i * 8], &value, 8);
+      continue;
+    }
+    size_t bit = i * width;
+    uint64_t word = getRaw<uint64_t>(&out[at + bit / 8]);
+    word |= value << (bit % 8);
+    std::memcpy(&out[at + bit / 8], &word, 8);
+  }
+  out.resize(at + bytes);
+}
+
+// Header, then per block one packed column each for timestamp deltas of
+// deltas, close deltas, open less the previous close, high above the
+// body, low below the body and volume
+std::vector<uint8_t> encode(const StockData* bars, size_t count, int decimals) {
+  std::vector<uint8_t> out;
+  out.reserve(kHeaderBytes + count * 8 + kPadding);
+
+  uint64_t timestamp = count > 0 ? static_cast<uint64_t>(bars[0].timestamp) : 0;
+  uint64_t step = 0;
+  uint64_t close = count > 0 ? static_cast<uint64_t>(storedPrice(bars[0].close, decimals)) : 0;
+  putRaw<uint32_t>(out, static_cast<uint32_t>(count));
+  putRaw<int8_t>(out, static_cast<int8_t>(decimals));
+  putRaw<uint64_t>(out, timestamp);
+  putRaw<uint64_t>(out, close);
+
+  uint64_t columns[kColumns][SeriesDecoder::kBlockBars];
+  for (size_t first = 0; first < count; first += SeriesDecoder::kBlockBars) {
+    size_t size = std::min(count - first, SeriesDecoder::kBlockBars);
+    for (size_t i = 0; i < size; ++i) {
+      const StockData& bar = bars[first + i];
+      uint64_t nextStep = static_cast<uint64_t>(bar.timestamp) - timestamp;
+      int64_t open = storedPrice(bar.open, decimals);
+      int64_t high = storedPrice(bar.high, decimals);
+      int64_t low = storedPrice(bar.low, decimals);
+      int64_t barClose = storedPrice(bar.close, decimals);
+      columns[kTimestamp][i] = zigzag(nextStep - step);
+      columns[kClose][i] = zigzag(static_cast<uint64_t>(barClose) - close);
+      columns[kOpen][i] = zigzag(static_cast<uint64_t>(open) - close);
+      columns[kHigh][i] = zigzag(static_cast<uint64_t>(high) - static_cast<uint64_t>(std::max(open, barClose)));
+      columns[kLow][i] = zigzag(static_cast<uint64_t>(std::min(open, barClose)) - static_cast<uint64_t>(low));
+      columns[kVolume][i] = bar.volume;
+      timestamp = static_cast<uint64_t>(bar.timestamp);
+      step = nextStep;
+      close = static_cast<uint64_t>(barClose);
+    }
+    for (int column = 0; column < kColumns; ++column) {
+      packColumn(out, columns[column], size);
+    }
+  }
+  out.resize(out.size() + kPadding, 0);
+  return out;
+}
+
+}  // namespace
+
+double CompressedSeries::ratio() const {
+  return data.empty() ? 0 : static_cast<double>(count) * sizeof(StockData) / data.size();
+}
+
+// Raw bits always work; a decimal grid usually packs tighter, but not
+// always, so both are tried when the series has one
+CompressedSeries compressSeries(const StockData* bars, size_t count) {
+  CompressedSeries series;
+  series.symbol = count > 0 ? bars[0].symbol : 0;
+  series.count = static_cast<uint32_t>(count);
+  series.data = encode(bars, count, -1);
+
+  int decimals = findDecimals(bars, count);
+  if (decimals >= 0) {
+    std::vector<uint8_t> ticks = encode(bars, count, decimals);
+    if (ticks.size() < series.data.size()) {
+      series.data.swap(ticks);
+    }
+  }
+  series.data.shrink_to_fit();
+  return series;
+}
+
+SeriesDecoder::SeriesDecoder(const CompressedSeries& _series)
+: series(_series), position(kHeaderBytes), remaining(0), malformed(false), decimals(-1), scale(1), timestamp(0),
+  step(0), close(0) {
+  const std::vector<uint8_t>& data = series.data;
+  if (data.size() < kHeaderBytes + kPadding) {
+    malformed = true;
+    return;
+  }
+  remaining = getRaw<uint32_t>(&data[0]);
+  decimals = getRaw<int8_t>(&data[4]);
+  timestamp = getRaw<uint64_t>(&data[5]);
+  close = getRaw<uint64_t>(&data[13]);
+  if (decimals > kMaxDecimals || decimals < -1) {
+    malformed = true;
+    remaining = 0;
+    return;
+  }
+  scale = decimals >= 0 ? kPowers[decimals] : 1;
+}
+
+// Columns are decoded one at a time with fixed-width loads and running
+// sums, so each loop carries at most one dependency from value to value
+size_t SeriesDecoder::next(StockData* bars) {
+  if (remaining == 0) {
+    return 0;
+  }
+  size_t count = std::min(remaining, kBlockBars);
+  for (auto& column : columns) {
+    if (!unpackColumn(count, column)) {
+      malformed = true;
+      remaining = 0;
+      return 0;
+    }
+  }
+
+  uint64_t* times = columns[kTimestamp];
+  uint64_t* closes = columns[kClose];
+  uint64_t* opens = columns[kOpen];
+  uint64_t* highs = columns[kHigh];
+  uint64_t* lows = columns[kLow];
+  uint64_t time = timestamp;
+  uint64_t delta = step;
+  for (size_t i = 0; i < count; ++i) {
+    delta += unzigzag(times[i]);
+    time += delta;
+    times[i] = time;
+  }
+  timestamp = time;
+  step = delta;
+  uint64_t previous = close;
+  for (size_t i = 0; i < count; ++i) {
+    opens[i] = previous + unzigzag(opens[i]);
+    previous += unzigzag(closes[i]);
+    closes[i] = previous;
+  }
+  close = previous;
+  for (size_t i = 0; i < count; ++i) {
+    int64_t open = static_cast<int64_t>(opens[i]);
+    int64_t barClose = static_cast<int64_t>(closes[i]);
+    highs[i] = static_cast<uint64_t>(std::max(open, barClose)) + unzigzag(highs[i]);
+    lows[i] = static_cast<uint64_t>(std::min(open, barClose)) - unzigzag(lows[i]);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    StockData& bar = bars[i];
+    bar.timestamp = static_cast<int64_t>(times[i]);
+    bar.symbol = series.symbol;
+    bar.volume = static_cast<uint32_t>(columns[kVolume][i]);
+    bar.open = price(static_cast<int64_t>(opens[i]));
+    bar.high = price(static_cast<int64_t>(highs[i]));
+    bar.low = price(static_cast<int64_t>(lows[i]));
+    bar.close = price(static_cast<int64_t>(closes[i]));
+  }
+  remaining -= count;
+  return count;
+}
+
+bool SeriesDecoder::failed() const {
+  return malformed;
+}
+
+bool SeriesDecoder::unpackColumn(size_t count, uint64_t* values) {
+  const std::vector<uint8_t>& data = series.data;
+  uint64_t base = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    if (position >= data.size() || shift > 63) {
+      return false;
+    }
+    uint8_t byte = data[position++];
+    base |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (byte < 0x80) {
+      break;
+    }
+  }
+  if (position >= data.size()) {
+    return false;
+  }
+  unsigned width = data[position++];
+  size_t bytes = (count * width + 7) / 8;
+  if ((width > kMaxPackedWidth && width != 64) || position + bytes + kPadding > data.size()) {
+    return false;
+  }
+
+  const uint8_t* in = &data[position];
+  if (width == 64) {
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = getRaw<uint64_t>(in + i * 8) + base;
+    }
+  } else {
+    kUnpackers[width](in, count, base, values);
+  }
+  position += bytes;
+  return true;
+}
+
+float SeriesDecoder::price(int64_t value) const {
+  return decimals < 0 ? fromOrderedBits(value) : decimalPrice(value, scale);
+}
+
+// The header's count is only trusted as far as the data could hold that
+// many blocks, so a corrupt count fails decoding instead of allocating
+bool decompressSeries(const CompressedSeries& series, std::vector<StockData>& bars) {
+  SeriesDecoder decoder(series);
+  bars.reserve(bars.size() + std::min<size_t>(series.count, encodableBars(series.data.size())));
+  size_t at = bars.size();
+  while (true) {
+    bars.resize(at + SeriesDecoder::kBlockBars);
+    size_t decoded = decoder.next(&bars[at]);
+    if (decoded == 0) {
+      break;
+    }
+    at += decoded;
+  }
+  bars.resize(at);
+  return !decoder.failed();
+}
+
+bool writeSeriesFile(const std::string& path, const std::vector<CompressedSeries>& series) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cerr << "Cannot create series file " << path << "\n";
+    return false;
+  }
+  file.write(kSeriesMagic, sizeof(kSeriesMagic));
+  for (const CompressedSeries& entry : series) {
+    const std::string& name = SymbolTable::instance().name(entry.symbol);
+    uint16_t length = static_cast<uint16_t>(name.size());
+    uint64_t size = entry.data.size();
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.write(name.data(), length);
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(entry.data.data()), static_cast<std::streamsize>(size));
+  }
+  return static_cast<bool>(file);
+}
+
+bool readSeriesFile(const std::string& path, std::vector<CompressedSeries>& series) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  uint64_t fileSize = file ? static_cast<uint64_t>(file.tellg()) : 0;
+  file.seekg(0);
+  char magic[sizeof(kSeriesMagic)];
+  if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kSeriesMagic, sizeof(magic)) != 0) {
+    std::cerr << "Cannot read series file " << path << "\n";
+    return false;
+  }
+
+  uint16_t length = 0;
+  while (file.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+    std::string name(length, '\0');
+    uint64_t size = 0;
+    CompressedSeries entry;
+    // A size past the end of the file is corrupt, not a reason to allocate it
+    if (!file.read(&name[0], length) || !file.read(reinterpret_cast<char*>(&size), sizeof(size))
+        || size < kHeaderBytes + kPadding || size > fileSize - static_cast<uint64_t>(file.tellg())) {
+      std::cerr << "Corrupt series file " << path << "\n";
+      return false;
+    }
+    entry.data.resize(size);
+    if (!file.read(reinterpret_cast<char*>(entry.data.data()), static_cast<std::streamsize>(size))) {
+      std::cerr << "Corrupt series file " << path << "\n";
+      return false;
+    }
+    entry.count = getRaw<uint32_t>(&entry.data[0]);
+    if (entry.count > encodableBars(entry.data.size())) {
+      std::cerr << "Corrupt series file " << path << "\n";
+      return false;
+    }
+    entry.symbol = SymbolTable::instance().intern(name);
+    series.push_back(std::move(entry));
+  }
+  return true;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file series_codec.h
+ * @brief Lossless compressed storage of one symbol's bars
+ *
+ * This file defines CompressedSeries, the encoder that produces it, and
+ * SeriesDecoder, which turns it back into bars a block at a time. Bars are
+ * stored by column in blocks of 128: timestamps as deltas of deltas, closes
+ * as deltas, opens, highs and lows as offsets from the neighbouring closes,
+ * and prices as integer ticks when the series sits on a decimal grid. Each
+ * column of a block is bit-packed at the width of its largest value, so
+ * decoding is a fixed-width unpack and a prefix sum per column with no
+ * branches per value.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stock_data.h"
+
+/**
+ * @struct CompressedSeries
+ * @brief Encoded bars of one symbol, ordered by timestamp
+ */
+struct CompressedSeries {
+    uint32_t symbol = 0;        ///< Symbol id in the global SymbolTable
+    uint32_t count = 0;         ///< Bars encoded
+    std::vector<uint8_t> data;  ///< Header and blocks
+
+    /**
+     * @brief Gets the bytes the bars would take uncompressed, divided by the bytes they take
+     */
+    double ratio() const;
+};
+
+/**
+ * @brief Encodes the bars of one symbol
+ *
+ * Decoding gives back every field bit for bit. Prices are stored as
+ * multiples of the coarsest power-of-ten tick that reproduces every one of
+ * them, if that is smaller than their raw bit patterns.
+ *
+ * @param bars Bars of one symbol, ordered by timestamp
+ * @param count Number of bars
+ * @return The encoded series
+ */
+CompressedSeries compressSeries(const StockData* bars, size_t count);
+
+/**
+ * @class SeriesDecoder
+ * @brief Streams the bars of a CompressedSeries in blocks
+ *
+ * Holds one block of decoded columns at a time, so replaying a series takes
+ * a few kilobytes however long it is.
+ */
+class SeriesDecoder {
+  public:
+    /// Bars per block, and so the most next() writes at once
+    static constexpr size_t kBlockBars = 128;
+
+    /**
+     * @brief Starts decoding a series
+     *
+     * @param series Series to decode; must outlive the decoder
+     */
+    explicit SeriesDecoder(const CompressedSeries& series);
+
+    /**
+     * @brief Decodes the next block
+     *
+     * @param bars Receives up to kBlockBars bars
+     * @return Bars written; 0 at the end of the series or if it is malformed
+     */
+    size_t next(StockData* bars);
+
+    /**
+     * @brief Checks whether the series ended early because it is malformed
+     */
+    bool failed() const;
+
+  private:
+    /**
+     * @brief Unpacks one column of the current block into a scratch array
+     */
+    bool unpackColumn(size_t count, uint64_t* values);
+
+    /**
+     * @brief Converts a stored price back to the float it was encoded from
+     */
+    float price(int64_t value) const;
+
+    const CompressedSeries& series;  ///< Series being decoded
+    size_t position;                 ///< Next byte of series.data to read
+    size_t remaining;                ///< Bars not yet decoded
+    bool malformed;                  ///< Whether decoding stopped at bad data
+    int decimals;                    ///< Decimal places of a price tick, or -1 for raw float bits
+    double scale;                    ///< 10^decimals
+    uint64_t timestamp;              ///< Timestamp of the previous bar
+    uint64_t step;                   ///< Timestamp delta of the previous bar
+    uint64_t close;                  ///< Stored close of the previous bar
+    uint64_t columns[6][kBlockBars]; ///< Unpacked columns of the current block
+};
+
+/**
+ * @brief Decodes a whole series
+ *
+ * @param series Series to decode
+ * @param bars Receives the bars, appended in order
+ * @return False if the series is malformed
+ */
+bool decompressSeries(const CompressedSeries& series, std::vector<StockData>& bars);
+
+/**
+ * @brief Writes compressed series to a file
+ *
+ * Symbols are stored by name, as symbol ids are process-local.
+ *
+ * @param path File to create or replace
+ * @param series Series to store
+ * @return False if the file cannot be written
+ */
+bool writeSeriesFile(const std::string& path, const std::vector<CompressedSeries>& series);
+
+/**
+ * @brief Reads every series of a file written by writeSeriesFile()
+ *
+ * Symbols are interned into the global SymbolTable as they are read.
+ *
+ * @param path File to read
+ * @param series Receives the series, appended in file order
+ * @return False if the file is missing or malformed
+ */
+bool readSeriesFile(const std::string& path, std::vector<CompressedSeries>& series);
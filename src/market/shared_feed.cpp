@@ -0,0 +1,313 @@
+#include "shared_feed.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "symbol_table.h"
+#include "../core/spsc_ring.h"
+
+namespace {
+
+// "TEFEED01"; stored last, so a subscriber never maps a half-built feed
+constexpr uint64_t kFeedMagic = 0x3130444545464554;
+
+constexpr size_t kMaxSymbols = 4096;
+constexpr size_t kSymbolBytes = 32;
+
+// Slot sequence while the publisher rewrites it
+constexpr uint64_t kWriting = ~uint64_t(0);
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "feed atomics must work across processes");
+static_assert(sizeof(StockData) == 4 * sizeof(uint64_t), "a bar must fill exactly four slot words");
+
+/**
+ * @struct FeedHeader
+ * @brief Start of the shared memory object
+ */
+struct FeedHeader {
+    std::atomic<uint64_t> magic;   ///< kFeedMagic once the feed is ready
+    uint64_t capacity;             ///< Slots in the ring; a power of two
+    uint64_t slotBytes;            ///< Size of a slot, to reject a feed from another build
+    alignas(kCacheLineSize) std::atomic<uint64_t> published;  ///< Bars published
+    std::atomic<uint32_t> closed;                             ///< Nonzero once no more bars follow
+    alignas(kCacheLineSize) std::atomic<uint32_t> symbols;    ///< Symbol names sent
+    char names[kMaxSymbols][kSymbolBytes];                    ///< NUL-terminated symbol names by feed index
+};
+
+/**
+ * @struct FeedSlot
+ * @brief One bar in the ring, guarded by its sequence number
+ */
+struct FeedSlot {
+    std::atomic<uint64_t> sequence;  ///< Sequence number of the bar held plus one; 0 if none
+    std::atomic<uint64_t> words[4];  ///< The bar, with the symbol replaced by its feed index
+};
+
+constexpr size_t kSlotsOffset = (sizeof(FeedHeader) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+
+FeedHeader* headerOf(void* mapping) {
+  return static_cast<FeedHeader*>(mapping);
+}
+
+const FeedHeader* headerOf(const void* mapping) {
+  return static_cast<const FeedHeader*>(mapping);
+}
+
+FeedSlot* slotsOf(void* mapping) {
+  return reinterpret_cast<FeedSlot*>(static_cast<char*>(mapping) + kSlotsOffset);
+}
+
+const FeedSlot* slotsOf(const void* mapping) {
+  return reinterpret_cast<const FeedSlot*>(static_cast<const char*>(mapping) + kSlotsOffset);
+}
+
+// Shared memory object names start with a slash
+std::string objectName(const std::string& name) {
+  return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+}  // namespace
+
+SharedFeedPublisher::SharedFeedPublisher(const std::string& _name, size_t capacity)
+: name(objectName(_name)), mapping(nullptr), mappedBytes(0), next(0) {
+  size_t slots = std::bit_ceil(std::max<size_t>(capacity, 2));
+  size_t bytes = kSlotsOffset + slots * sizeof(FeedSlot);
+
+  // A feed left behind by a publisher that crashed
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    std::cerr << "Cannot create feed " << name << ": " << std::strerror(errno) << "\n";
+    return;
+  }
+  if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    std::cerr << "Cannot size feed " << name << ": " << std::strerror(errno) << "\n";
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return;
+  }
+  void* shared = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (shared == MAP_FAILED) {
+    std::cerr << "Cannot map feed " << name << ": " << std::strerror(errno) << "\n";
+    shm_unlink(name.c_str());
+    return;
+  }
+
+  // Constructing every slot also faults the ring in before the first bar
+  FeedHeader* header = new (shared) FeedHeader();
+  FeedSlot* ring = slotsOf(shared);
+  for (size_t i = 0; i < slots; ++i) {
+    new (&ring[i]) FeedSlot();
+  }
+  header->capacity = slots;
+  header->slotBytes = sizeof(FeedSlot);
+  header->magic.store(kFeedMagic, std::memory_order_release);
+
+  mapping = shared;
+  mappedBytes = bytes;
+}
+
+SharedFeedPublisher::~SharedFeedPublisher() {
+  if (mapping == nullptr) {
+    return;
+  }
+  close();
+  munmap(mapping, mappedBytes);
+  shm_unlink(name.c_str());
+}
+
+bool SharedFeedPublisher::isOpen() const {
+  return mapping != nullptr;
+}
+
+// Per-slot seqlock: the slot is marked as being written before its words
+// change and stamped with the bar's sequence number after, so a reader
+// that sees the same stamp before and after its copy read one whole bar
+bool SharedFeedPublisher::publish(const StockData& bar) {
+  if (mapping == nullptr) {
+    return false;
+  }
+  FeedHeader* header = headerOf(mapping);
+  if (header->closed.load(std::memory_order_relaxed) != 0) {
+    return false;
+  }
+  int64_t index = registerSymbol(bar.symbol);
+  if (index < 0) {
+    return false;
+  }
+
+  StockData stored = bar;
+  stored.symbol = static_cast<uint32_t>(index);
+  uint64_t words[4];
+  std::memcpy(words, &stored, sizeof(words));
+
+  FeedSlot& slot = slotsOf(mapping)[next & (header->capacity - 1)];
+  slot.sequence.store(kWriting, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < 4; ++i) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.sequence.store(next + 1, std::memory_order_release);
+  next += 1;
+  header->published.store(next, std::memory_order_release);
+  return true;
+}
+
+void SharedFeedPublisher::close() {
+  if (mapping != nullptr) {
+    headerOf(mapping)->closed.store(1, std::memory_order_release);
+  }
+}
+
+uint64_t SharedFeedPublisher::size() const {
+  return next;
+}
+
+// Names are written before the count that publishes them and never change
+int64_t SharedFeedPublisher::registerSymbol(uint32_t symbol) {
+  auto it = feedIds.find(symbol);
+  if (it != feedIds.end()) {
+    return it->second;
+  }
+
+  const std::string& symbolName = SymbolTable::instance().name(symbol);
+  size_t index = feedIds.size();
+  if (index >= kMaxSymbols || symbolName.size() >= kSymbolBytes) {
+    std::cerr << "Cannot send symbol " << symbolName << " on feed " << name << "\n";
+    return -1;
+  }
+  FeedHeader* header = headerOf(mapping);
+  std::memcpy(header->names[index], symbolName.data(), symbolName.size());
+  header->symbols.store(static_cast<uint32_t>(index + 1), std::memory_order_release);
+  feedIds.emplace(symbol, static_cast<uint32_t>(index));
+  return static_cast<int64_t>(index);
+}
+
+SharedFeedSubscriber::SharedFeedSubscriber(const std::string& name)
+: mapping(nullptr), mappedBytes(0), next(0), lost(0) {
+  std::string object = objectName(name);
+  int fd = shm_open(object.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kSlotsOffset) {
+    ::close(fd);
+    return;
+  }
+  size_t bytes = static_cast<size_t>(info.st_size);
+  void* shared = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (shared == MAP_FAILED) {
+    return;
+  }
+
+  // Not ready yet, or written by a different build
+  const FeedHeader* header = headerOf(static_cast<const void*>(shared));
+  uint64_t capacity = header->magic.load(std::memory_order_acquire) == kFeedMagic ? header->capacity : 0;
+  if (capacity == 0 || !std::has_single_bit(capacity) || header->slotBytes != sizeof(FeedSlot)
+      || kSlotsOffset + capacity * sizeof(FeedSlot) > bytes) {
+    munmap(shared, bytes);
+    return;
+  }
+
+  mapping = shared;
+  mappedBytes = bytes;
+  uint64_t published = header->published.load(std::memory_order_acquire);
+  next = published > capacity ? published - capacity : 0;
+}
+
+SharedFeedSubscriber::~SharedFeedSubscriber() {
+  if (mapping != nullptr) {
+    munmap(const_cast<void*>(mapping), mappedBytes);
+  }
+}
+
+bool SharedFeedSubscriber::isOpen() const {
+  return mapping != nullptr;
+}
+
+bool SharedFeedSubscriber::poll(StockData& bar) {
+  if (mapping == nullptr) {
+    return false;
+  }
+  const FeedHeader* header = headerOf(mapping);
+  uint64_t published = header->published.load(std::memory_order_acquire);
+  if (next >= published) {
+    return false;
+  }
+  uint64_t capacity = header->capacity;
+  if (published - next > capacity) {
+    lost += published - capacity - next;
+    next = published - capacity;
+  }
+
+  const FeedSlot& slot = slotsOf(mapping)[next & (capacity - 1)];
+  uint64_t before = slot.sequence.load(std::memory_order_acquire);
+  uint64_t words[4];
+  for (size_t i = 0; i < 4; ++i) {
+    words[i] = slot.words[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+  if (before != next + 1 || after != before) {
+    // The publisher lapped this reader and is rewriting the slot, so the
+    // oldest bar still intact is the one after the slot being written
+    published = header->published.load(std::memory_order_acquire);
+    uint64_t oldest = std::max(next + 1, published + 1 > capacity ? published + 1 - capacity : 0);
+    lost += oldest - next;
+    next = oldest;
+    return false;
+  }
+
+  std::memcpy(&bar, words, sizeof(words));
+  if (bar.symbol >= localIds.size()) {
+    learnSymbols();
+  }
+  next += 1;
+  if (bar.symbol >= localIds.size()) {
+    return false;
+  }
+  bar.symbol = localIds[bar.symbol];
+  return true;
+}
+
+uint64_t SharedFeedSubscriber::position() const {
+  return next;
+}
+
+uint64_t SharedFeedSubscriber::missed() const {
+  return lost;
+}
+
+// Closed is set after the last bar is published, so once it is seen the
+// published count is final
+bool SharedFeedSubscriber::finished() const {
+  if (mapping == nullptr) {
+    return true;
+  }
+  const FeedHeader* header = headerOf(mapping);
+  return header->closed.load(std::memory_order_acquire) != 0
+         && next >= header->published.load(std::memory_order_acquire);
+}
+
+void SharedFeedSubscriber::learnSymbols() {
+  const FeedHeader* header = headerOf(mapping);
+  size_t count = std::min<size_t>(header->symbols.load(std::memory_order_acquire), kMaxSymbols);
+  for (size_t i = localIds.size(); i < count; ++i) {
+    const char* text = header->names[i];
+    localIds.push_back(SymbolTable::instance().intern(std::string_view(text, strnlen(text, kSymbolBytes))));
+  }
+}
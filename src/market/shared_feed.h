@@ -0,0 +1,157 @@
+/**
+ * @file shared_feed.h
+ * @brief Market data broadcast between processes through shared memory
+ *
+ * This file defines SharedFeedPublisher and SharedFeedSubscriber, the two
+ * ends of a ring of bars in a POSIX shared memory object. One process
+ * publishes; any number of processes map the same pages read-only and read
+ * the bars in place, with no system call, socket or pipe on the way. Every
+ * bar carries a sequence number, so a subscriber that falls a whole ring
+ * behind knows exactly how many bars it missed.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stock_data.h"
+
+/**
+ * @class SharedFeedPublisher
+ * @brief Creates a feed and publishes bars into it
+ *
+ * Publishing never waits for subscribers: the ring keeps the most recent
+ * bars and overwrites older ones. Symbols are sent by name the first time
+ * they appear, as symbol ids are process-local. The feed is removed from
+ * the system when the publisher is destroyed; subscribers that have it
+ * mapped keep reading until the end.
+ */
+class SharedFeedPublisher {
+  public:
+    /// Bars the ring holds by default
+    static constexpr size_t kDefaultCapacity = 65536;
+
+    /**
+     * @brief Creates a feed, replacing any feed left with the same name
+     *
+     * @param name Shared memory object name, such as "/market"
+     * @param capacity Bars the ring holds; rounded up to a power of two
+     */
+    explicit SharedFeedPublisher(const std::string& name, size_t capacity = kDefaultCapacity);
+
+    /**
+     * @brief Ends the feed, unmaps it and removes its name
+     */
+    ~SharedFeedPublisher();
+
+    SharedFeedPublisher(const SharedFeedPublisher&) = delete;
+    SharedFeedPublisher& operator=(const SharedFeedPublisher&) = delete;
+
+    /**
+     * @brief Checks whether the feed could be created
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Publishes a bar under the next sequence number
+     *
+     * @param bar Bar to publish
+     * @return False if the feed is closed or its symbol cannot be sent
+     */
+    bool publish(const StockData& bar);
+
+    /**
+     * @brief Tells subscribers no more bars will follow
+     */
+    void close();
+
+    /**
+     * @brief Gets the number of bars published, and so the next sequence number
+     */
+    uint64_t size() const;
+
+  private:
+    /**
+     * @brief Sends a symbol's name to subscribers
+     *
+     * @return The symbol's index in the feed, or -1 if it cannot be sent
+     */
+    int64_t registerSymbol(uint32_t symbol);
+
+    std::string name;                                  ///< Shared memory object name
+    void* mapping;                                     ///< Mapped feed, or nullptr
+    size_t mappedBytes;                                ///< Length of the mapping
+    uint64_t next;                                     ///< Sequence number of the next bar
+    std::unordered_map<uint32_t, uint32_t> feedIds;    ///< Feed symbol index by SymbolTable id
+};
+
+/**
+ * @class SharedFeedSubscriber
+ * @brief Reads the bars of a feed another process publishes
+ *
+ * A subscriber starts at the oldest bar still in the ring and reads in
+ * sequence. Each read is checked against the slot's sequence number, so a
+ * bar overwritten while it was being copied is never returned; the reader
+ * instead skips ahead to the oldest bar left and counts the ones it lost.
+ */
+class SharedFeedSubscriber {
+  public:
+    /**
+     * @brief Maps an existing feed read-only
+     *
+     * @param name Shared memory object name given to the publisher
+     */
+    explicit SharedFeedSubscriber(const std::string& name);
+
+    /**
+     * @brief Unmaps the feed
+     */
+    ~SharedFeedSubscriber();
+
+    SharedFeedSubscriber(const SharedFeedSubscriber&) = delete;
+    SharedFeedSubscriber& operator=(const SharedFeedSubscriber&) = delete;
+
+    /**
+     * @brief Checks whether the feed exists and was mapped
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Reads the next bar if one has been published
+     *
+     * @param bar Receives the bar, with its symbol id in this process
+     * @return False if no new bar is available yet
+     */
+    bool poll(StockData& bar);
+
+    /**
+     * @brief Gets the sequence number of the next bar to read
+     */
+    uint64_t position() const;
+
+    /**
+     * @brief Gets the number of bars overwritten before they could be read
+     */
+    uint64_t missed() const;
+
+    /**
+     * @brief Checks whether the publisher has closed the feed and every bar has been read
+     */
+    bool finished() const;
+
+  private:
+    /**
+     * @brief Interns the names of symbols the publisher has sent since the last call
+     */
+    void learnSymbols();
+
+    const void* mapping;              ///< Mapped feed, or nullptr
+    size_t mappedBytes;               ///< Length of the mapping
+    uint64_t next;                    ///< Sequence number of the next bar to read
+    uint64_t lost;                    ///< Bars skipped after overruns
+    std::vector<uint32_t> localIds;   ///< SymbolTable id by feed symbol index
+};
@@ -1,8 +1,40 @@
 #include "stock_data.h"
 
+#include <algorithm>
+
+#include "date.h"
+#include "symbol_table.h"
+
+namespace {
+
+uint32_t clampVolume(long long volume) {
+  return static_cast<uint32_t>(std::min<long long>(std::max<long long>(volume, 0), UINT32_MAX));
+}
+
+}  // namespace
+
 // Default constructor initializes empty values
-StockData::StockData() {}
+StockData::StockData() : timestamp(0), symbol(0), volume(0), open(0), high(0), low(0), close(0) {}
+
+// Close-only constructor uses the close for every price field
+StockData::StockData(uint32_t _symbol, int64_t _timestamp, double _close)
+  : timestamp(_timestamp), symbol(_symbol), volume(0), open(static_cast<float>(_close)),
+    high(static_cast<float>(_close)), low(static_cast<float>(_close)), close(static_cast<float>(_close)) {}
+
+// Full constructor sets all fields
+StockData::StockData(uint32_t _symbol, int64_t _timestamp, double _open, double _high,
+                     double _low, double _close, long long _volume)
+  : timestamp(_timestamp), symbol(_symbol), volume(clampVolume(_volume)), open(static_cast<float>(_open)),
+    high(static_cast<float>(_high)), low(static_cast<float>(_low)), close(static_cast<float>(_close)) {}
+
+const std::string& StockData::symbolName() const {
+  return SymbolTable::instance().name(symbol);
+}
+
+int32_t StockData::day() const {
+  return timestampToDays(timestamp);
+}
 
-// Parameterized constructor sets all fields
-StockData::StockData(std::string _symbol, std::string _date, double _close) 
-  : symbol(_symbol), date(_date), close(_close) {}
\ No newline at end of file
+std::string StockData::date() const {
+  return formatDate(day());
+}
@@ -1,48 +1,100 @@
 /**
  * @file stock_data.h
  * @brief Stock data structure and utilities
- * 
+ *
  * This file defines the StockData struct which represents
  * a single data point for a stock, including its symbol,
- * date, and closing price.
+ * timestamp, and open/high/low/close/volume values.
  */
 
 #ifndef STOCK_DATA_H
 #define STOCK_DATA_H
 
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <type_traits>
 
 /**
  * @struct StockData
- * @brief Structure representing a single stock data point
- * 
+ * @brief Compact 32-byte record representing a single stock data point
+ *
  * Contains the essential information for a stock at a given point in time:
- * - Stock symbol
- * - Date
- * - Closing price
+ * - Symbol id from the global SymbolTable
+ * - Timestamp in nanoseconds since the Unix epoch (midnight UTC for daily bars)
+ * - Opening, high, low and closing prices
+ * - Traded volume
+ *
+ * The record holds no strings, so it is trivially copyable, bars pack two
+ * to a cache line, and ordering by time is a single integer comparison.
+ * Prices are single precision, which keeps about seven significant digits,
+ * well below a cent for any listed price.
  */
 struct StockData {
-    std::string symbol;  ///< Stock symbol (e.g., "AAPL")
-    std::string date;    ///< Date of the data point
-    double close;        ///< Closing price for the day
+    int64_t timestamp;   ///< Nanoseconds since 1970-01-01 UTC
+    uint32_t symbol;     ///< Symbol id in the global SymbolTable
+    uint32_t volume;     ///< Number of shares traded (saturates at UINT32_MAX)
+    float open;          ///< Opening price
+    float high;          ///< Highest price
+    float low;           ///< Lowest price
+    float close;         ///< Closing price
 
     /**
      * @brief Default constructor
-     * 
-     * Initializes a StockData instance with empty symbol and date,
-     * and zero closing price.
+     *
+     * Initializes a StockData instance with symbol id 0, the epoch as its
+     * timestamp, and zero prices and volume.
      */
     StockData();
 
     /**
-     * @brief Parameterized constructor
-     * 
-     * @param _symbol Stock symbol
-     * @param _date Date of the data point
+     * @brief Close-only constructor
+     *
+     * Uses the close for every price field and zero volume.
+     *
+     * @param _symbol Symbol id
+     * @param _timestamp Nanoseconds since the epoch
      * @param _close Closing price
      */
-    StockData(std::string _symbol, std::string _date, double _close);
+    StockData(uint32_t _symbol, int64_t _timestamp, double _close);
+
+    /**
+     * @brief Full OHLCV constructor
+     *
+     * @param _symbol Symbol id
+     * @param _timestamp Nanoseconds since the epoch
+     * @param _open Opening price
+     * @param _high Highest price
+     * @param _low Lowest price
+     * @param _close Closing price
+     * @param _volume Traded volume; clamped to the representable range
+     */
+    StockData(uint32_t _symbol, int64_t _timestamp, double _open, double _high,
+              double _low, double _close, long long _volume);
+
+    /**
+     * @brief Gets the symbol text from the global SymbolTable
+     *
+     * @return The symbol (e.g., "AAPL")
+     */
+    const std::string& symbolName() const;
+
+    /**
+     * @brief Gets the day the data point falls on
+     *
+     * @return Days since 1970-01-01
+     */
+    int32_t day() const;
+
+    /**
+     * @brief Formats the day the data point falls on
+     *
+     * @return The date as YYYY-MM-DD
+     */
+    std::string date() const;
 };
 
-#endif // STOCK_DATA_H
\ No newline at end of file
+static_assert(sizeof(StockData) == 32, "StockData must stay a 32-byte record");
+static_assert(std::is_trivially_copyable<StockData>::value, "StockData must be trivially copyable");
+
+#endif // STOCK_DATA_H
@@ -1,73 +1,306 @@
+#include <algorithm>
+#include <atomic>
+
 #include "sqlite3.h"
 #include "stock_market.h"
 #include "stock_data.h"
+#include "date.h"
+#include "market_data_cache.h"
+#include "symbol_table.h"
+#include "../net/event_publisher.h"
 #include "../trader/trader.h"
 
-// Initialize market with symbol and date range, then connect to database
-StockMarket::StockMarket(std::string symbol, std::string start, std::string end)
-: stock_symbol(symbol), start_date(start), end_date(end), current_date(start) {
-  setDataBase();
+namespace {
+
+// Prices print with two decimals; set once, since markets on several
+// threads would otherwise race on the stream's flags
+void formatPrices() {
+  static const bool formatted = [] {
+    std::cout << std::fixed << std::setprecision(2);
+    return true;
+  }();
+  (void)formatted;
+}
+
+// Failed polls of the prefetch ring before a side parks until the other hands over a batch
+constexpr unsigned kPrefetchSpins = 256;
+
+// Waits until ready() holds: briefly spinning, then sleeping on the count
+// the other side bumps. Announcing the park before reading the count, as
+// ThreadPool's sleepers do, means a hand-over is never missed.
+template <typename Ready>
+void waitForBatch(Ready ready, std::atomic<uint32_t>& handedOver, std::atomic<bool>& parked) {
+  for (unsigned attempt = 0; !ready(); ++attempt) {
+    if (attempt < kPrefetchSpins) {
+      backoff(attempt);
+      continue;
+    }
+    parked.store(true, std::memory_order_seq_cst);
+    uint32_t seen = handedOver.load(std::memory_order_seq_cst);
+    if (!ready()) {
+      handedOver.wait(seen, std::memory_order_seq_cst);
+    }
+    parked.store(false, std::memory_order_seq_cst);
+  }
 }
 
+// Counts a batch handed over and wakes the other side only if it parked
+void handOverBatch(std::atomic<uint32_t>& handedOver, std::atomic<bool>& parked) {
+  handedOver.fetch_add(1, std::memory_order_seq_cst);
+  if (parked.load(std::memory_order_seq_cst)) {
+    handedOver.notify_one();
+  }
+}
+
+}  // namespace
+
+// Initialize market with symbol and date range; the database is opened only when streaming
+StockMarket::StockMarket(std::string symbol, std::string start, std::string end, std::string database)
+: stock_symbol(symbol), start_date(start), end_date(end), current_date(start), database_path(database),
+  symbol_id(SymbolTable::instance().intern(symbol)), cached(true), prefetch(true), batch_rows(1024),
+  batch_count(2), engine(nullptr), recorder(nullptr), feed(nullptr), eventStream(nullptr),
+  stmt(nullptr) {}
+
 void StockMarket::addTrader(Trader *trader) {
   traders.push_back(trader);
+  bars.addTrader(trader);
 }
 
-// Notify all registered traders of price changes
+// Notify all registered traders of price changes, then let a deterministic
+// engine execute the orders they placed before the next tick
 void StockMarket::notifyTraders(double newPrice) {
   for (Trader* trader : traders) {
     trader->notify(newPrice);
   }
+  advanceEngine();
 }
 
-// Connect to database, process data, and clean up resources
+void StockMarket::publish(const StockData& bar) {
+  if (recorder != nullptr) {
+    recorder->record(bar);
+  }
+  if (feed != nullptr) {
+    feed->publish(bar);
+  }
+  if (eventStream != nullptr) {
+    eventStream->price(bar);
+  }
+  if (engine != nullptr) {
+    engine->observe(bar);
+  }
+  bars.publish(bar);
+  advanceEngine();
+}
+
+void StockMarket::finishBars() {
+  if (bars.finish()) {
+    advanceEngine();
+  }
+}
+
+void StockMarket::advanceEngine() {
+  if (engine != nullptr && engine->getMode() == EngineMode::Deterministic) {
+    engine->advance();
+  }
+}
+
+// Replay from the shared cache, or lease a connection, process data, and return it to the pool
 void StockMarket::runSimulation() {
-  connectDataTable();
-  sqlite3_finalize(stmt);
-  sqlite3_close(db);
+  if (cached) {
+    formatPrices();
+    SeriesView view = MarketDataCache::instance().range(database_path, stock_symbol, start_date, end_date);
+    std::clog << "Simulating " << stock_symbol << "!\n";
+    replay(view.data, view.size);
+    return;
+  }
+
+  setDataBase();
+  if (connection) {
+    connectDataTable();
+  }
+  finishBars();
+  stmt = nullptr;
+  connection = ConnectionPool::Lease();
+}
+
+// Replay in-memory data points, skipping the database entirely
+void StockMarket::replay(const std::vector<StockData>& data) {
+  replay(data.data(), data.size());
 }
 
-// Open connection to SQLite database and handle errors
+void StockMarket::replay(const StockData* data, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    publish(data[i]);
+  }
+  finishBars();
+}
+
+void StockMarket::replay(const CompressedSeries& series) {
+  SeriesDecoder decoder(series);
+  StockData block[SeriesDecoder::kBlockBars];
+  size_t count = 0;
+  while ((count = decoder.next(block)) > 0) {
+    for (size_t i = 0; i < count; ++i) {
+      publish(block[i]);
+    }
+  }
+  finishBars();
+}
+
+void StockMarket::replay(SharedFeedSubscriber& source) {
+  StockData bar;
+  unsigned attempt = 0;
+  while (true) {
+    if (source.poll(bar)) {
+      publish(bar);
+      attempt = 0;
+    } else if (source.finished()) {
+      break;
+    } else {
+      backoff(attempt++);
+    }
+  }
+  finishBars();
+}
+
+void StockMarket::setCached(bool enabled) {
+  cached = enabled;
+}
+
+void StockMarket::setEngine(Engine* eng) {
+  engine = eng;
+}
+
+void StockMarket::setRecorder(MarketRecorder* rec) {
+  recorder = rec;
+}
+
+void StockMarket::setFeed(SharedFeedPublisher* publisher) {
+  feed = publisher;
+}
+
+void StockMarket::setEventStream(EventStream* stream) {
+  eventStream = stream;
+}
+
+void StockMarket::setPrefetch(bool enabled, size_t batchRows, size_t batches) {
+  prefetch = enabled;
+  batch_rows = std::max<size_t>(batchRows, 1);
+  batch_count = std::max<size_t>(batches, 2);
+}
+
+void StockMarket::setFanOut(size_t lanes) {
+  bars.setFanOut(lanes);
+}
+
+// Lease a read-only connection to the SQLite database and handle errors
 void StockMarket::setDataBase() {
-  rc = sqlite3_open("./data/stock_data.db", &db);
+  connection = ConnectionPool::instance().acquire(database_path);
 
-  if (rc) {
-    std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << "\n";
+  if (!connection) {
+    std::cerr << "Cannot open database: " << connection.error() << "\n";
     return;
   }
 
-  std::cout << "Connected to database\n";
+  std::clog << "Connected to database\n";
 }
 
-// Prepare SQL query to retrieve date and closing price data
+// Get the cached SQL query to retrieve date and closing price data for the symbol and range
 void StockMarket::connectDataTable() {
-  std::cout << std::fixed << std::setprecision(2);
-  
-  std::string query = "SELECT date, close FROM stock_data;";
+  formatPrices();
 
-  rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, 0);
+  // Intraday rows carry a time after the date, so the range ends before the next day
+  std::string query = "SELECT date, close FROM stock_data "
+                      "WHERE symbol = ? AND date >= ? AND date < ? ORDER BY date;";
+  int32_t last = 0;
+  parseDate(end_date, last);
+  std::string after_end = formatDate(last + 1);
 
-  if (rc == SQLITE_OK) {
-    getNewStockData();
+  stmt = connection.prepare(query);
+
+  if (stmt != nullptr) {
+    sqlite3_bind_text(stmt, 1, stock_symbol.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, start_date.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, after_end.c_str(), -1, SQLITE_STATIC);
+    if (prefetch) {
+      getNewStockDataPrefetched();
+    } else {
+      getNewStockData();
+    }
   } else {
-    std::cerr << "Cannot execute query: " << sqlite3_errmsg(db) << "\n";
+    std::cerr << "Cannot execute query: " << sqlite3_errmsg(connection.handle()) << "\n";
   }
 }
 
 // Process each row of stock data and notify traders of price changes
 void StockMarket::getNewStockData() {
-  std::cout << "Simulating " << stock_symbol << "!\n";
+  std::clog << "Simulating " << stock_symbol << "!\n";
 
   while (true) {
     if (sqlite3_step(stmt) != SQLITE_ROW) {
       break;
     }
 
-    for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
-      const char* value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
-      if (i == 1) {
-        notifyTraders(std::atof(value));
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    int64_t timestamp = 0;
+    if (text != nullptr) {
+      parseTimestamp(std::string_view(text, sqlite3_column_bytes(stmt, 0)), timestamp);
+    }
+    publish(StockData(symbol_id, timestamp, sqlite3_column_double(stmt, 1)));
+  }
+}
+// Reader thread steps the query into batches; this thread replays them.
+// The ring bounds how far the reader runs ahead, so memory stays at
+// batch_count * batch_rows compact rows regardless of the date range.
+// Whichever side is ahead parks rather than polls, leaving the CPU to the
+// one doing the work.
+void StockMarket::getNewStockDataPrefetched() {
+  std::clog << "Simulating " << stock_symbol << "!\n";
+
+  SpscRing<RowBatch> ring(batch_count);
+  std::atomic<uint32_t> filled(0);
+  std::atomic<uint32_t> drained(0);
+  std::atomic<bool> readerParked(false);
+  std::atomic<bool> replayParked(false);
+
+  std::thread reader([&] {
+    bool done = false;
+    while (!done) {
+      RowBatch* batch = nullptr;
+      waitForBatch([&] { return (batch = ring.beginWrite()) != nullptr; }, drained, readerParked);
+
+      batch->rows.resize(batch_rows);
+      batch->count = 0;
+      while (batch->count < batch_rows) {
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+          done = true;
+          break;
+        }
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        int64_t timestamp = 0;
+        if (text != nullptr) {
+          parseTimestamp(std::string_view(text, sqlite3_column_bytes(stmt, 0)), timestamp);
+        }
+        batch->rows[batch->count++] = StockData(symbol_id, timestamp, sqlite3_column_double(stmt, 1));
       }
+      batch->last = done;
+      ring.commitWrite();
+      handOverBatch(filled, replayParked);
     }
+  });
+
+  bool last = false;
+  while (!last) {
+    RowBatch* batch = nullptr;
+    waitForBatch([&] { return (batch = ring.beginRead()) != nullptr; }, filled, replayParked);
+
+    for (size_t i = 0; i < batch->count; ++i) {
+      publish(batch->rows[i]);
+    }
+    last = batch->last;
+    ring.commitRead();
+    handOverBatch(drained, readerParked);
   }
-}
\ No newline at end of file
+
+  reader.join();
+}
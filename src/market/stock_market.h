@@ -16,7 +16,15 @@
 #include <thread>
 
 #include "sqlite3.h"
+#include "bar_aggregator.h"
+#include "connection_pool.h"
+#include "market_data_cache.h"
+#include "market_recording.h"
+#include "series_codec.h"
+#include "shared_feed.h"
 #include "stock_data.h"
+#include "../core/spsc_ring.h"
+#include "../core/engine.h"
 #include "../trader/trader.h"
 
 /**
@@ -37,12 +45,16 @@ class StockMarket {
      * @param symbol Stock symbol to track
      * @param start Start date for simulation
      * @param end End date for simulation
+     * @param database Path to the SQLite database holding the stock_data table
      */
-    StockMarket(std::string symbol, std::string start, std::string end);
+    StockMarket(std::string symbol, std::string start, std::string end,
+                std::string database = MarketDataCache::kDefaultDatabase);
 
     /**
      * @brief Adds a trader to receive price updates
      * 
+     * Replayed bars reach the trader aggregated to its bar size.
+     * 
      * @param trader Pointer to the trader to add
      */
     void addTrader(Trader *trader);
@@ -58,20 +70,136 @@ class StockMarket {
      * @brief Runs the market simulation
      * 
      * Iterates through historical data and notifies traders
-     * of price changes at each time step.
+     * of price changes at each time step. By default the data comes from the
+     * process-wide MarketDataCache, so repeated runs over the same symbol
+     * query the database only once.
      */
     void runSimulation();
 
+    /**
+     * @brief Runs the market simulation over data already held in memory
+     * 
+     * Replays the closing prices in order without touching the database.
+     * 
+     * @param data Stock data points to replay
+     */
+    void replay(const std::vector<StockData>& data);
+
+    /**
+     * @brief Runs the market simulation over a contiguous run of data points
+     * 
+     * @param data First data point to replay
+     * @param count Number of data points
+     */
+    void replay(const StockData* data, size_t count);
+
+    /**
+     * @brief Runs the market simulation over a compressed series
+     * 
+     * Decodes one block of bars at a time straight into the replay loop, so
+     * the uncompressed series is never held in memory.
+     * 
+     * @param series Series to replay
+     */
+    void replay(const CompressedSeries& series);
+
+    /**
+     * @brief Runs the market simulation over a feed another process publishes
+     * 
+     * Delivers bars as they arrive until the publisher closes the feed.
+     * 
+     * @param feed Subscriber to read from
+     */
+    void replay(SharedFeedSubscriber& feed);
+
+    /**
+     * @brief Chooses whether runSimulation() reads through the shared cache
+     * 
+     * When disabled, every run streams its range straight from SQLite,
+     * optionally through the prefetching reader, over a connection leased
+     * from the shared ConnectionPool. Markets on many threads can then
+     * query one database at once without waiting on each other.
+     * 
+     * @param enabled Whether to replay from MarketDataCache (default true)
+     */
+    void setCached(bool enabled);
+
+    /**
+     * @brief Connects the engine that executes the traders' orders
+     * 
+     * The engine observes every bar before the traders do, for its slippage
+     * model. A deterministic engine is also sequenced with the ticks: after
+     * every tick has been delivered to every trader, it executes the orders
+     * that tick produced, on the market's thread and before the next tick.
+     * Together with a recorded input stream this makes a run reproducible
+     * bit for bit.
+     * 
+     * @param eng Engine shared with the traders, or nullptr
+     */
+    void setEngine(Engine* eng);
+
+    /**
+     * @brief Records every published bar
+     * 
+     * @param rec Recorder owned by the caller, or nullptr to stop recording
+     */
+    void setRecorder(MarketRecorder* rec);
+
+    /**
+     * @brief Broadcasts every published bar to other processes
+     * 
+     * @param feed Publisher owned by the caller, or nullptr to stop broadcasting
+     */
+    void setFeed(SharedFeedPublisher* feed);
+
+    /**
+     * @brief Publishes every bar as a price on a UDP event feed
+     * 
+     * @param stream Stream of an EventPublisher used only by this market's thread, or nullptr to stop
+     */
+    void setEventStream(EventStream* stream);
+
+    /**
+     * @brief Configures the prefetching reader used by runSimulation()
+     * 
+     * When enabled, a reader thread steps the SQLite query and decodes rows
+     * into fixed-size batches while the replay thread notifies traders from
+     * the previous batch, so database I/O overlaps strategy evaluation.
+     * Whichever thread gets ahead sleeps until the other hands over a batch.
+     * 
+     * @param enabled Whether to read on a separate thread (default true)
+     * @param batchRows Rows per batch
+     * @param batches Batches in flight; 2 gives classic double buffering
+     */
+    void setPrefetch(bool enabled, size_t batchRows = 1024, size_t batches = 2);
+
+    /**
+     * @brief Delivers each tick to groups of traders in parallel
+     * 
+     * The traders are dealt into lanes; the market's thread delivers to one
+     * and workers of ThreadPool::shared() to the others, and the next tick
+     * waits for all of them. Each trader keeps one lane, so it sees bars and
+     * reports in order, but different traders' orders of one tick reach the
+     * engine in whatever order they are sent. A deterministic engine still
+     * executes them before the next tick, but its digest varies between
+     * runs. Set before the simulation runs.
+     * 
+     * @param lanes Traders notified at once; 1 (default) notifies them one by one
+     */
+    void setFanOut(size_t lanes);
+
   private:
     std::vector<Trader*> traders;  ///< List of traders to notify
+    BarRouter bars;                ///< Traders by subscribed bar size
 
     std::string stock_symbol;  ///< Stock symbol being tracked
     std::string start_date;    ///< Simulation start date
     std::string end_date;      ///< Simulation end date
     std::string current_date;  ///< Current simulation date
+    std::string database_path; ///< Path to the SQLite database
     
     /**
-     * @brief Sets up the SQLite database connection
+     * @brief Leases a connection to the SQLite database from the shared pool
      */
     void setDataBase();
 
@@ -85,8 +213,49 @@ class StockMarket {
      */
     void getNewStockData();
 
-    sqlite3 *db;           ///< SQLite database connection
-    sqlite3_stmt *stmt;    ///< SQLite prepared statement
+    /**
+     * @brief Retrieves stock data through the prefetching reader thread
+     */
+    void getNewStockDataPrefetched();
+
+    /**
+     * @brief Records a bar if recording, then delivers it to every trader
+     * 
+     * @param bar Bar to publish
+     */
+    void publish(const StockData& bar);
+
+    /**
+     * @brief Delivers the bars still being aggregated at the end of a replay
+     */
+    void finishBars();
+
+    /**
+     * @brief Lets a deterministic engine execute the orders of the current tick
+     */
+    void advanceEngine();
+
+    /**
+     * @struct RowBatch
+     * @brief Fixed-size batch of decoded rows handed from reader to replay thread
+     */
+    struct RowBatch {
+        std::vector<StockData> rows;  ///< Decoded rows; storage is reused between batches
+        size_t count = 0;             ///< Number of valid rows
+        bool last = false;            ///< True for the final batch of the query
+    };
+
+    uint32_t symbol_id;     ///< Id of stock_symbol in the global SymbolTable
+    bool cached;            ///< Whether runSimulation() replays from MarketDataCache
+    bool prefetch;          ///< Whether runSimulation() reads on a separate thread
+    size_t batch_rows;      ///< Rows per prefetched batch
+    size_t batch_count;     ///< Batches in flight between reader and replay thread
+    Engine* engine;           ///< Engine observing bars; advanced after every tick if deterministic
+    MarketRecorder* recorder; ///< Destination of published bars, if recording
+    SharedFeedPublisher* feed; ///< Feed broadcasting published bars, if any
+    EventStream* eventStream;  ///< Event feed of published bars, if any
+
+    ConnectionPool::Lease connection;  ///< Read-only connection, leased while streaming
+    sqlite3_stmt *stmt;    ///< Range query, cached on the leased connection
     std::string datatable; ///< Name of the data table
-    int rc;               ///< SQLite return code
 };
\ No newline at end of file
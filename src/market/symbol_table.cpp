@@ -0,0 +1,41 @@
+#include "symbol_table.h"
+
+#include <mutex>
+
+SymbolTable& SymbolTable::instance() {
+  static SymbolTable table;
+  return table;
+}
+
+uint32_t SymbolTable::intern(std::string_view symbol) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(symbol);
+    if (it != ids.end()) {
+      return it->second;
+    }
+  }
+
+  // Re-check under the exclusive lock in case another thread interned it
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  auto it = ids.find(symbol);
+  if (it != ids.end()) {
+    return it->second;
+  }
+
+  uint32_t id = static_cast<uint32_t>(names.size());
+  names.emplace_back(symbol);
+  ids.emplace(names.back(), id);
+  return id;
+}
+
+const std::string& SymbolTable::name(uint32_t id) const {
+  static const std::string unknown;
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return id < names.size() ? names[id] : unknown;
+}
+
+size_t SymbolTable::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return names.size();
+}
@@ -0,0 +1,62 @@
+/**
+ * @file symbol_table.h
+ * @brief Process-wide table of interned stock symbols
+ *
+ * Symbols are mapped once to small integer ids so bar records can refer to
+ * them with four bytes and compare them with a single integer operation.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @class SymbolTable
+ * @brief Thread-safe mapping between symbol strings and dense ids
+ *
+ * Ids are assigned in order of first use starting at 0 and are never
+ * reused, so an id stays valid for the lifetime of the process. Lookups
+ * take a shared lock; only interning a new symbol takes the exclusive lock.
+ */
+class SymbolTable {
+  public:
+    /**
+     * @brief Gets the process-wide table
+     *
+     * @return The shared instance
+     */
+    static SymbolTable& instance();
+
+    /**
+     * @brief Gets the id of a symbol, assigning one on first use
+     *
+     * @param symbol Symbol text (e.g., "AAPL")
+     * @return The symbol's id
+     */
+    uint32_t intern(std::string_view symbol);
+
+    /**
+     * @brief Gets the text of a symbol
+     *
+     * @param id Id returned by intern()
+     * @return The symbol text; empty for unknown ids
+     */
+    const std::string& name(uint32_t id) const;
+
+    /**
+     * @brief Gets the number of interned symbols
+     */
+    size_t size() const;
+
+  private:
+    SymbolTable() = default;
+
+    mutable std::shared_mutex mutex;                      ///< Guards both containers
+    std::deque<std::string> names;                        ///< Text by id; deque keeps references stable
+    std::unordered_map<std::string_view, uint32_t> ids;   ///< Id by text; views point into names
+};
@@ -0,0 +1,370 @@
+#include "synthetic_data.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "bulk_loader.h"
+#include "date.h"
+#include "symbol_table.h"
+
+namespace {
+
+constexpr double kTradingDaysPerYear = 252.0;
+
+// Regular US session, 14:30 to 21:00 UTC
+constexpr int64_t kSessionOpen = (14 * 3600 + 30 * 60) * kNanosPerSecond;
+constexpr int64_t kSessionLength = (6 * 3600 + 30 * 60) * kNanosPerSecond;
+
+// Price is re-derived from the log price this often to bound approximation error
+constexpr size_t kResyncInterval = 1024;
+
+uint64_t splitMix64(uint64_t& x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256** step
+inline uint64_t nextRandom(uint64_t* s) {
+  const uint64_t result = rotl(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+// Uniform double in (0, 1)
+inline double nextUniform(uint64_t* s) {
+  return ((nextRandom(s) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Tables for Marsaglia and Tsang's 128-layer ziggurat
+struct Ziggurat {
+    uint32_t kn[128];
+    double wn[128];
+    double fn[128];
+
+    Ziggurat() {
+      const double m1 = 2147483648.0;
+      const double vn = 9.91256303526217e-3;
+      double dn = 3.442619855899;
+      double tn = dn;
+      double q = vn / std::exp(-0.5 * dn * dn);
+
+      kn[0] = static_cast<uint32_t>((dn / q) * m1);
+      kn[1] = 0;
+      wn[0] = q / m1;
+      wn[127] = dn / m1;
+      fn[0] = 1.0;
+      fn[127] = std::exp(-0.5 * dn * dn);
+
+      for (int i = 126; i >= 1; --i) {
+        dn = std::sqrt(-2.0 * std::log(vn / dn + std::exp(-0.5 * dn * dn)));
+        kn[i + 1] = static_cast<uint32_t>((dn / tn) * m1);
+        tn = dn;
+        fn[i] = std::exp(-0.5 * dn * dn);
+        wn[i] = dn / m1;
+      }
+    }
+};
+
+const Ziggurat& ziggurat() {
+  static const Ziggurat tables;
+  return tables;
+}
+
+// Slow path of the ziggurat: wedges and the tail
+double normalFallback(uint64_t* s, int32_t hz, uint32_t iz) {
+  const Ziggurat& z = ziggurat();
+  const double r = 3.442620;
+
+  while (true) {
+    double x = hz * z.wn[iz];
+    if (iz == 0) {
+      double y;
+      do {
+        x = -std::log(nextUniform(s)) * (1.0 / r);
+        y = -std::log(nextUniform(s));
+      } while (y + y < x * x);
+      return hz > 0 ? r + x : -r - x;
+    }
+    if (z.fn[iz] + nextUniform(s) * (z.fn[iz - 1] - z.fn[iz]) < std::exp(-0.5 * x * x)) {
+      return x;
+    }
+
+    hz = static_cast<int32_t>(nextRandom(s) >> 32);
+    iz = hz & 127;
+    uint32_t magnitude = hz < 0 ? 0u - static_cast<uint32_t>(hz) : static_cast<uint32_t>(hz);
+    if (magnitude < z.kn[iz]) {
+      return hz * z.wn[iz];
+    }
+  }
+}
+
+// Standard normal draw; roughly 99% of calls take the first branch
+inline double nextNormal(uint64_t* s) {
+  const Ziggurat& z = ziggurat();
+  int32_t hz = static_cast<int32_t>(nextRandom(s) >> 32);
+  uint32_t iz = hz & 127;
+  uint32_t magnitude = hz < 0 ? 0u - static_cast<uint32_t>(hz) : static_cast<uint32_t>(hz);
+  if (magnitude < z.kn[iz]) {
+    return hz * z.wn[iz];
+  }
+  return normalFallback(s, hz, iz);
+}
+
+// exp(x) for the small per-step log returns, accurate to ~1e-9 for |x| < 0.02
+inline double smallExp(double x) {
+  return 1.0 + x * (1.0 + x * (0.5 + x * (1.0 / 6.0)));
+}
+
+// Number of steps until the next event of a Poisson process with per-step rate p
+inline uint64_t stepsUntilEvent(uint64_t* s, double p) {
+  if (p <= 0) {
+    return UINT64_MAX;
+  }
+  return static_cast<uint64_t>(-std::log(nextUniform(s)) / p) + 1;
+}
+
+}  // namespace
+
+SyntheticMarket::SyntheticMarket(SyntheticConfig _config) : config(_config) {}
+
+// Derive an independent xoshiro stream per symbol from the seed and index
+SyntheticMarket::Stream SyntheticMarket::makeStream(size_t index) const {
+  Stream stream;
+  uint64_t x = config.seed ^ (0xd1b54a32d192ed03ULL * (index + 1));
+  for (uint64_t& word : stream.s) {
+    word = splitMix64(x);
+  }
+  stream.price = config.initialPrice;
+  stream.logPrice = std::log(config.initialPrice);
+  stream.turbulent = false;
+  return stream;
+}
+
+// One step of the configured process; used for the daily path where the
+// per-step cost is dominated by bar bookkeeping anyway
+void SyntheticMarket::step(Stream& stream, double dt) const {
+  double mu = config.drift;
+  double sigma = config.volatility;
+
+  if (config.model == PriceModel::RegimeSwitching) {
+    if (nextUniform(stream.s) < config.switchRate * dt) {
+      stream.turbulent = !stream.turbulent;
+    }
+    if (stream.turbulent) {
+      mu = config.turbulentDrift;
+      sigma = config.turbulentVolatility;
+    }
+  }
+
+  double dx;
+  if (config.model == PriceModel::OrnsteinUhlenbeck) {
+    dx = config.reversionSpeed * (std::log(config.longRunPrice) - stream.logPrice) * dt
+       + sigma * std::sqrt(dt) * nextNormal(stream.s);
+  } else {
+    dx = (mu - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * nextNormal(stream.s);
+  }
+
+  if (config.model == PriceModel::JumpDiffusion &&
+      nextUniform(stream.s) < config.jumpIntensity * dt) {
+    dx += config.jumpMean + config.jumpStdDev * nextNormal(stream.s);
+  }
+
+  stream.logPrice += dx;
+  stream.price = std::exp(stream.logPrice);
+}
+
+std::vector<StockData> SyntheticMarket::generateDaily(const std::vector<std::string>& symbols,
+                                                      const std::string& start, size_t days) {
+  int32_t first = 0;
+  if (!parseDate(start, first)) {
+    std::cerr << "Invalid start date: " << start << "\n";
+    return {};
+  }
+
+  // Trading dates are shared by every symbol
+  std::vector<int64_t> dates;
+  dates.reserve(days);
+  for (int32_t d = first; dates.size() < days; ++d) {
+    if (!isWeekend(d)) {
+      dates.push_back(daysToTimestamp(d));
+    }
+  }
+
+  const int ticks = config.ticksPerDay > 0 ? config.ticksPerDay : 1;
+  const double dt = 1.0 / (kTradingDaysPerYear * ticks);
+
+  std::vector<StockData> data;
+  data.reserve(symbols.size() * days);
+
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    Stream stream = makeStream(i);
+    uint32_t symbol = SymbolTable::instance().intern(symbols[i]);
+
+    for (size_t d = 0; d < days; ++d) {
+      double open = stream.price;
+      double high = open;
+      double low = open;
+      for (int t = 0; t < ticks; ++t) {
+        step(stream, dt);
+        high = std::max(high, stream.price);
+        low = std::min(low, stream.price);
+      }
+
+      // Lognormal volume, busier on turbulent days
+      double volumeScale = stream.turbulent ? 2.0 : 1.0;
+      long long volume = static_cast<long long>(
+          config.averageVolume * volumeScale * std::exp(0.3 * nextNormal(stream.s) - 0.045));
+
+      data.emplace_back(symbol, dates[d], open, high, low, stream.price, volume);
+    }
+  }
+
+  return data;
+}
+
+std::vector<StockData> SyntheticMarket::generateIntraday(const std::vector<std::string>& symbols,
+                                                         const std::string& start, size_t days, int64_t barNs) {
+  if (barNs >= kNanosPerDay || barNs <= 0) {
+    return generateDaily(symbols, start, days);
+  }
+  int32_t first = 0;
+  if (!parseDate(start, first)) {
+    std::cerr << "Invalid start date: " << start << "\n";
+    return {};
+  }
+
+  std::vector<int64_t> opens;
+  opens.reserve(days);
+  for (int32_t d = first; opens.size() < days; ++d) {
+    if (!isWeekend(d)) {
+      opens.push_back(daysToTimestamp(d) + kSessionOpen);
+    }
+  }
+
+  const size_t barsPerDay = static_cast<size_t>((kSessionLength + barNs - 1) / barNs);
+  const int ticksPerDay = config.ticksPerDay > 0 ? config.ticksPerDay : 1;
+  const size_t ticks = std::max<size_t>(1, ticksPerDay / barsPerDay);
+  const double dt = 1.0 / (kTradingDaysPerYear * barsPerDay * ticks);
+  const double averageVolume = config.averageVolume / barsPerDay;
+
+  std::vector<StockData> data;
+  data.reserve(symbols.size() * days * barsPerDay);
+
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    Stream stream = makeStream(i);
+    uint32_t symbol = SymbolTable::instance().intern(symbols[i]);
+
+    for (size_t d = 0; d < days; ++d) {
+      for (size_t b = 0; b < barsPerDay; ++b) {
+        double open = stream.price;
+        double high = open;
+        double low = open;
+        for (size_t t = 0; t < ticks; ++t) {
+          step(stream, dt);
+          high = std::max(high, stream.price);
+          low = std::min(low, stream.price);
+        }
+
+        double volumeScale = stream.turbulent ? 2.0 : 1.0;
+        long long volume = static_cast<long long>(
+            averageVolume * volumeScale * std::exp(0.3 * nextNormal(stream.s) - 0.045));
+
+        data.emplace_back(symbol, opens[d] + static_cast<int64_t>(b) * barNs, open, high, low, stream.price, volume);
+      }
+    }
+  }
+
+  return data;
+}
+
+size_t SyntheticMarket::tradingDaysBetween(const std::string& start, const std::string& end) {
+  int32_t first = 0;
+  int32_t last = 0;
+  if (!parseDate(start, first) || !parseDate(end, last)) {
+    return 0;
+  }
+
+  size_t days = 0;
+  for (int32_t d = first; d <= last; ++d) {
+    days += isWeekend(d) ? 0 : 1;
+  }
+  return days;
+}
+
+// Hot path: constants are hoisted, jumps and regime switches are scheduled by
+// sampling waiting times instead of testing a uniform on every tick, and the
+// price is updated with a polynomial exp that is resynced periodically.
+void SyntheticMarket::generateTicks(size_t index, double* prices, size_t count) {
+  Stream stream = makeStream(index);
+  const int ticksPerDay = config.ticksPerDay > 0 ? config.ticksPerDay : 1;
+  const double dt = 1.0 / (kTradingDaysPerYear * ticksPerDay);
+  const double sqrtDt = std::sqrt(dt);
+
+  double sigma = config.volatility;
+  double driftStep = (config.drift - 0.5 * sigma * sigma) * dt;
+  double volStep = sigma * sqrtDt;
+
+  const double reversionStep = config.reversionSpeed * dt;
+  const double logMean = std::log(config.longRunPrice);
+  const bool meanReverting = config.model == PriceModel::OrnsteinUhlenbeck;
+
+  uint64_t nextJump = config.model == PriceModel::JumpDiffusion
+      ? stepsUntilEvent(stream.s, config.jumpIntensity * dt) : UINT64_MAX;
+  uint64_t nextSwitch = config.model == PriceModel::RegimeSwitching
+      ? stepsUntilEvent(stream.s, config.switchRate * dt) : UINT64_MAX;
+
+  double logPrice = stream.logPrice;
+  double price = stream.price;
+
+  for (size_t t = 0; t < count; ++t) {
+    double dx;
+    if (meanReverting) {
+      dx = reversionStep * (logMean - logPrice) + volStep * nextNormal(stream.s);
+    } else {
+      dx = driftStep + volStep * nextNormal(stream.s);
+    }
+
+    if (--nextJump == 0) {
+      double jump = config.jumpMean + config.jumpStdDev * nextNormal(stream.s);
+      dx += jump;
+      price *= std::exp(jump);
+      price *= smallExp(dx - jump);
+      nextJump = stepsUntilEvent(stream.s, config.jumpIntensity * dt);
+    } else {
+      price *= smallExp(dx);
+    }
+    logPrice += dx;
+
+    if (--nextSwitch == 0) {
+      stream.turbulent = !stream.turbulent;
+      double mu = stream.turbulent ? config.turbulentDrift : config.drift;
+      sigma = stream.turbulent ? config.turbulentVolatility : config.volatility;
+      driftStep = (mu - 0.5 * sigma * sigma) * dt;
+      volStep = sigma * sqrtDt;
+      nextSwitch = stepsUntilEvent(stream.s, config.switchRate * dt);
+    }
+
+    if ((t & (kResyncInterval - 1)) == kResyncInterval - 1) {
+      price = std::exp(logPrice);
+    }
+    prices[t] = price;
+  }
+}
+
+bool SyntheticMarket::writeToDatabase(const std::vector<StockData>& data, const std::string& database) {
+  BulkLoader loader(database);
+  return loader.begin() && loader.add(data) && loader.finish();
+}
@@ -0,0 +1,160 @@
+/**
+ * @file synthetic_data.h
+ * @brief Deterministic synthetic market data generator
+ *
+ * This file defines the SyntheticMarket class which produces reproducible
+ * price series from a seed, so the engine can be run and benchmarked without
+ * network access to Yahoo Finance.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stock_data.h"
+
+/**
+ * @enum PriceModel
+ * @brief Stochastic process used to evolve the log price
+ */
+enum class PriceModel {
+  GeometricBrownianMotion,  ///< Constant drift and volatility
+  JumpDiffusion,            ///< Merton model: GBM plus normally distributed jumps
+  OrnsteinUhlenbeck,        ///< Log price reverts towards a long-run mean
+  RegimeSwitching           ///< Two-state Markov chain between calm and turbulent regimes
+};
+
+/**
+ * @struct SyntheticConfig
+ * @brief Parameters for the synthetic price process
+ *
+ * Rates are annualised; one year is 252 trading days.
+ */
+struct SyntheticConfig {
+    PriceModel model = PriceModel::GeometricBrownianMotion;  ///< Price process
+    uint64_t seed = 42;              ///< Seed; equal seeds give identical series
+    double initialPrice = 100.0;     ///< Price at the start of the series
+    double drift = 0.05;             ///< Annual drift of the log price
+    double volatility = 0.2;         ///< Annual volatility
+
+    double jumpIntensity = 2.0;      ///< Expected jumps per year (JumpDiffusion)
+    double jumpMean = -0.02;         ///< Mean log jump size (JumpDiffusion)
+    double jumpStdDev = 0.05;        ///< Log jump size standard deviation (JumpDiffusion)
+
+    double reversionSpeed = 5.0;     ///< Speed of reversion per year (OrnsteinUhlenbeck)
+    double longRunPrice = 100.0;     ///< Price the process reverts to (OrnsteinUhlenbeck)
+
+    double turbulentDrift = -0.1;     ///< Annual drift in the turbulent regime (RegimeSwitching)
+    double turbulentVolatility = 0.6; ///< Annual volatility in the turbulent regime (RegimeSwitching)
+    double switchRate = 4.0;          ///< Expected regime switches per year (RegimeSwitching)
+
+    int ticksPerDay = 390;           ///< Intraday steps used to build each daily bar
+    double averageVolume = 1e6;      ///< Mean daily volume
+};
+
+/**
+ * @class SyntheticMarket
+ * @brief Generates seeded OHLCV series for any number of symbols
+ *
+ * Each symbol draws from its own random stream derived from the seed and
+ * the symbol's position, so a symbol's series does not depend on which other
+ * symbols are generated alongside it. Normals are drawn with a ziggurat
+ * sampler and prices are stepped without transcendental calls, which keeps
+ * the tick path at a few nanoseconds per tick.
+ */
+class SyntheticMarket {
+  public:
+    /**
+     * @brief Constructs a new SyntheticMarket instance
+     *
+     * @param config Parameters of the price process
+     */
+    explicit SyntheticMarket(SyntheticConfig config);
+
+    /**
+     * @brief Generates daily bars for several symbols
+     *
+     * Bars fall on weekdays starting at the given date. Each bar's open, high,
+     * low and close come from ticksPerDay intraday steps.
+     *
+     * @param symbols Symbols to generate
+     * @param start First trading date (YYYY-MM-DD)
+     * @param days Number of trading days per symbol
+     * @return Bars ordered by symbol, then date
+     */
+    std::vector<StockData> generateDaily(const std::vector<std::string>& symbols,
+                                         const std::string& start, size_t days);
+
+    /**
+     * @brief Generates intraday bars for several symbols
+     *
+     * Bars cover a 6.5 hour session from 14:30 to 21:00 UTC on weekdays
+     * starting at the given date, and are stamped with their start time.
+     * Each bar is built from enough steps to keep ticksPerDay steps a day.
+     * A bar size of a day or more produces daily bars.
+     *
+     * @param symbols Symbols to generate
+     * @param start First trading date (YYYY-MM-DD)
+     * @param days Number of trading days per symbol
+     * @param barNs Bar length in ns
+     * @return Bars ordered by symbol, then time
+     */
+    std::vector<StockData> generateIntraday(const std::vector<std::string>& symbols,
+                                            const std::string& start, size_t days, int64_t barNs);
+
+    /**
+     * @brief Counts the weekdays in an inclusive date range
+     *
+     * @param start First date (YYYY-MM-DD)
+     * @param end Last date (YYYY-MM-DD)
+     * @return Number of trading days generateDaily would emit for the range
+     */
+    static size_t tradingDaysBetween(const std::string& start, const std::string& end);
+
+    /**
+     * @brief Generates a tick-level price path into a caller-owned buffer
+     *
+     * @param stream Index of the random stream (the symbol's position)
+     * @param prices Output buffer
+     * @param count Number of ticks to write
+     */
+    void generateTicks(size_t stream, double* prices, size_t count);
+
+    /**
+     * @brief Writes bars into the stock_data table of a SQLite database
+     *
+     * Creates the table if needed and replaces existing rows for the same
+     * symbol and date, in one BulkLoader transaction.
+     *
+     * @param data Bars to store
+     * @param database Path to the SQLite database
+     * @return True if every row was written
+     */
+    static bool writeToDatabase(const std::vector<StockData>& data, const std::string& database);
+
+  private:
+    /**
+     * @struct Stream
+     * @brief Random number and price state for one symbol
+     */
+    struct Stream {
+        uint64_t s[4];     ///< xoshiro256** state
+        double price;      ///< Current price
+        double logPrice;   ///< Current log price
+        bool turbulent;    ///< Current regime (RegimeSwitching)
+    };
+
+    /**
+     * @brief Seeds a stream for the given symbol position
+     */
+    Stream makeStream(size_t index) const;
+
+    /**
+     * @brief Advances a stream by one step of length dt years
+     */
+    void step(Stream& stream, double dt) const;
+
+    SyntheticConfig config;  ///< Parameters of the price process
+};
@@ -0,0 +1,72 @@
+/**
+ * @file event_protocol.h
+ * @brief Binary wire format of the engine event feed
+ *
+ * This file defines the datagrams an EventPublisher sends: a short header
+ * naming the stream, followed by fixed-size event records. Every record
+ * carries its stream's sequence number, so a receiver can tell exactly how
+ * many events it missed, and the publisher's steady-clock time, so a
+ * receiver on the same machine can measure how late each event arrived.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "order_protocol.h"
+
+namespace wire {
+
+/// "TEEV" in the first bytes of every event datagram
+constexpr uint32_t kEventMagic = 0x56454554;
+
+/**
+ * @enum EventType
+ * @brief Kind of an event record
+ */
+enum class EventType : uint8_t {
+  Ack = 1,        ///< The engine took an order: it rests or executes next
+  Execution = 2,  ///< An order filled, was rejected or was cancelled
+  Price = 3,      ///< A bar was published by a market
+};
+
+/**
+ * @struct EventPacketHeader
+ * @brief First bytes of every event datagram
+ */
+struct EventPacketHeader {
+    uint32_t magic;   ///< kEventMagic
+    uint16_t stream;  ///< Stream the records belong to
+    uint16_t count;   ///< Records following the header
+    int64_t sendTime; ///< Publisher's steady clock in ns when the datagram was sent
+};
+
+/**
+ * @struct EventRecord
+ * @brief One event
+ *
+ * Fields are read according to the type: acks and executions describe an
+ * order of a trader; prices describe a bar of a symbol.
+ */
+struct EventRecord {
+    uint64_t sequence;   ///< Position in the stream, from 1, with no gaps at the publisher
+    int64_t time;        ///< Publisher's steady clock in ns when the event happened
+    uint64_t id;         ///< Order id; bar timestamp in ns for a price
+    double price;        ///< Order price, execution price, or bar close
+    uint32_t trader;     ///< Trader id; symbol id of a price
+    uint32_t quantity;   ///< Shares ordered or traded; bar volume for a price
+    EventType type;      ///< Kind of event
+    uint8_t buy;         ///< 1 for a buy, 0 for a sell
+    uint8_t detail;      ///< OrderType of an ack, ExecutionStatus of an execution
+    uint8_t reason;      ///< RejectReason of an execution
+    char symbol[12];     ///< Symbol of a price, NUL-padded; longer names are cut; empty otherwise
+};
+
+/// Records that fit in one datagram
+constexpr size_t kEventsPerDatagram = (kMaxDatagram - sizeof(EventPacketHeader)) / sizeof(EventRecord);
+
+static_assert(sizeof(EventPacketHeader) == 16);
+static_assert(sizeof(EventRecord) == 56);
+
+}  // namespace wire
@@ -0,0 +1,277 @@
+#include "event_publisher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../market/stock_data.h"
+#include "../market/symbol_table.h"
+#include "../trader/trader.h"
+
+namespace {
+
+// Datagrams handed to one sendmmsg() call
+constexpr size_t kDatagramsPerSend = 64;
+
+constexpr int kSendBufferBytes = 4 << 20;
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+EventStream::EventStream(uint16_t id, size_t capacity)
+: streamId(id), ring(capacity), sequence(0), lost(0) {}
+
+void EventStream::ack(uint64_t orderId, uint32_t trader, OrderType type, bool isBuy, double price) {
+  wire::EventRecord record{};
+  record.id = orderId;
+  record.price = price;
+  record.trader = trader;
+  record.quantity = 1;
+  record.type = wire::EventType::Ack;
+  record.buy = isBuy ? 1 : 0;
+  record.detail = static_cast<uint8_t>(type);
+  publish(record);
+}
+
+void EventStream::execution(const ExecutionReport& report) {
+  wire::EventRecord record{};
+  record.id = report.orderId;
+  record.price = report.price;
+  record.trader = report.trader->getId();
+  record.quantity = report.filledQuantity;
+  record.type = wire::EventType::Execution;
+  record.buy = report.buy ? 1 : 0;
+  record.detail = static_cast<uint8_t>(report.status);
+  record.reason = static_cast<uint8_t>(report.reason);
+  publish(record);
+}
+
+// The name is filled in by the sender; the symbol id travels in its place
+void EventStream::price(const StockData& bar) {
+  wire::EventRecord record{};
+  record.id = static_cast<uint64_t>(bar.timestamp);
+  record.price = bar.close;
+  record.trader = bar.symbol;
+  record.quantity = bar.volume;
+  record.type = wire::EventType::Price;
+  publish(record);
+}
+
+// The sequence advances even when the ring is full, so the receiver sees
+// exactly how many events it lost
+void EventStream::publish(wire::EventRecord& record) {
+  uint64_t next = sequence.load(std::memory_order_relaxed) + 1;
+  sequence.store(next, std::memory_order_relaxed);
+  record.sequence = next;
+  record.time = steadyNanos();
+  if (!ring.tryPush(record)) {
+    lost.store(lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+}
+
+uint16_t EventStream::id() const {
+  return streamId;
+}
+
+uint64_t EventStream::published() const {
+  return sequence.load(std::memory_order_relaxed);
+}
+
+uint64_t EventStream::dropped() const {
+  return lost.load(std::memory_order_relaxed);
+}
+
+EventPublisher::EventPublisher(const EventPublisherConfig& _config)
+: config(_config), fd(-1), opened(0), passes(0), stopSending(false), sentEvents(0), sentDatagrams(0),
+  failedSends(0), datagrams(kDatagramsPerSend * wire::kMaxDatagram) {
+  in_addr group;
+  if (inet_pton(AF_INET, config.host.c_str(), &group) != 1) {
+    std::cerr << "Invalid event feed address " << config.host << "\n";
+    return;
+  }
+  fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    std::cerr << "Cannot open event feed socket: " << std::strerror(errno) << "\n";
+    return;
+  }
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &kSendBufferBytes, sizeof(kSendBufferBytes));
+
+  if (IN_MULTICAST(ntohl(group.s_addr))) {
+    in_addr local;
+    if (inet_pton(AF_INET, config.interface.c_str(), &local) != 1
+        || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) != 0) {
+      std::cerr << "Cannot send multicast from " << config.interface << "\n";
+      ::close(fd);
+      fd = -1;
+      return;
+    }
+    unsigned char ttl = static_cast<unsigned char>(std::clamp(config.ttl, 0, 255));
+    unsigned char loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  }
+  sender = std::thread(&EventPublisher::run, this);
+}
+
+EventPublisher::~EventPublisher() {
+  stopSending.store(true, std::memory_order_release);
+  if (sender.joinable()) {
+    sender.join();
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+bool EventPublisher::isOpen() const {
+  return fd >= 0;
+}
+
+EventStream* EventPublisher::openStream() {
+  std::lock_guard<std::mutex> lock(openMutex);
+  size_t count = opened.load(std::memory_order_relaxed);
+  if (fd < 0 || count == kMaxStreams) {
+    return nullptr;
+  }
+  streams[count] = std::make_unique<EventStream>(static_cast<uint16_t>(count), config.streamCapacity);
+  opened.store(count + 1, std::memory_order_release);
+  return streams[count].get();
+}
+
+// A pass that starts after the call reaches every event published before it
+void EventPublisher::flush() {
+  if (fd < 0) {
+    return;
+  }
+  uint64_t target = passes.load(std::memory_order_acquire) + 2;
+  while (passes.load(std::memory_order_acquire) < target) {
+    std::this_thread::sleep_for(config.flushInterval);
+  }
+}
+
+EventPublisherStats EventPublisher::stats() const {
+  EventPublisherStats stats;
+  stats.events = sentEvents.load(std::memory_order_relaxed);
+  stats.datagrams = sentDatagrams.load(std::memory_order_relaxed);
+  stats.sendErrors = failedSends.load(std::memory_order_relaxed);
+  size_t count = opened.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; ++i) {
+    stats.dropped += streams[i]->dropped();
+  }
+  return stats;
+}
+
+void EventPublisher::run() {
+  while (true) {
+    bool stopping = stopSending.load(std::memory_order_acquire);
+    size_t sent = sendPending();
+    passes.fetch_add(1, std::memory_order_release);
+    if (stopping && sent == 0) {
+      return;
+    }
+    if (sent == 0) {
+      std::this_thread::sleep_for(config.flushInterval);
+    }
+  }
+}
+
+// Datagrams from all streams share each sendmmsg() call. A stream keeps its
+// turn for up to one call's worth of full datagrams, so a busy producer
+// cannot starve the others and records of one stream still leave in order
+size_t EventPublisher::sendPending() {
+  sockaddr_in destination;
+  std::memset(&destination, 0, sizeof(destination));
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(config.port);
+  inet_pton(AF_INET, config.host.c_str(), &destination.sin_addr);
+
+  iovec buffers[kDatagramsPerSend];
+  mmsghdr headers[kDatagramsPerSend];
+
+  size_t total = 0;
+  size_t count = opened.load(std::memory_order_acquire);
+  size_t stream = 0;
+  size_t turn = 0;
+  while (stream < count) {
+    size_t filled = 0;
+    while (stream < count && filled < kDatagramsPerSend) {
+      EventStream& source = *streams[stream];
+      char* datagram = datagrams.data() + filled * wire::kMaxDatagram;
+      char* next = datagram + sizeof(wire::EventPacketHeader);
+      uint16_t records = 0;
+      while (records < wire::kEventsPerDatagram) {
+        wire::EventRecord* slot = source.ring.beginRead();
+        if (slot == nullptr) {
+          break;
+        }
+        wire::EventRecord record = *slot;
+        source.ring.commitRead();
+        if (record.type == wire::EventType::Price) {
+          const std::string& name = SymbolTable::instance().name(record.trader);
+          std::memcpy(record.symbol, name.data(), std::min(name.size(), sizeof(record.symbol)));
+        }
+        std::memcpy(next, &record, sizeof(record));
+        next += sizeof(record);
+        records += 1;
+      }
+      if (records == 0) {
+        stream += 1;
+        turn = 0;
+        continue;
+      }
+      wire::EventPacketHeader header{wire::kEventMagic, source.streamId, records, 0};
+      std::memcpy(datagram, &header, sizeof(header));
+      buffers[filled] = {datagram, static_cast<size_t>(next - datagram)};
+      total += records;
+      filled += 1;
+      turn += 1;
+      if (records < wire::kEventsPerDatagram || turn == kDatagramsPerSend) {
+        stream += 1;
+        turn = 0;
+      }
+    }
+    if (filled == 0) {
+      break;
+    }
+
+    int64_t now = steadyNanos();
+    for (size_t i = 0; i < filled; ++i) {
+      std::memcpy(datagrams.data() + i * wire::kMaxDatagram + offsetof(wire::EventPacketHeader, sendTime), &now,
+                  sizeof(now));
+      std::memset(&headers[i], 0, sizeof(headers[i]));
+      headers[i].msg_hdr.msg_name = &destination;
+      headers[i].msg_hdr.msg_namelen = sizeof(destination);
+      headers[i].msg_hdr.msg_iov = &buffers[i];
+      headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    size_t done = 0;
+    while (done < filled) {
+      int sent = sendmmsg(fd, headers + done, static_cast<unsigned>(filled - done), 0);
+      if (sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // The datagram at the front is lost; receivers see the gap
+        failedSends.fetch_add(1, std::memory_order_relaxed);
+        done += 1;
+        continue;
+      }
+      done += static_cast<size_t>(sent);
+      sentDatagrams.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+    }
+  }
+  sentEvents.fetch_add(total, std::memory_order_relaxed);
+  return total;
+}
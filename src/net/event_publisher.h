@@ -0,0 +1,210 @@
+/**
+ * @file event_publisher.h
+ * @brief UDP feed of the acks, executions and prices of running engines
+ *
+ * This file defines EventPublisher and the EventStreams that feed it. An
+ * engine or market thread writes each event into its own stream's
+ * lock-free ring and moves on; a sender thread packs the events into
+ * datagrams and sends them to a unicast or multicast address. Producers
+ * never wait: if a stream's ring is full the event is dropped, and the
+ * gap in sequence numbers tells receivers so.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_protocol.h"
+#include "../core/spsc_ring.h"
+
+struct ExecutionReport;
+struct StockData;
+enum class OrderType : uint8_t;
+
+/**
+ * @class EventStream
+ * @brief One producer's sequence of events
+ *
+ * Only one thread may publish into a stream at a time; a stream may be
+ * handed to another thread once the first one is done with it.
+ */
+class EventStream {
+  public:
+    /**
+     * @brief Creates a stream; use EventPublisher::openStream()
+     *
+     * @param id Stream id sent with every datagram
+     * @param capacity Events buffered for the sender thread
+     */
+    EventStream(uint16_t id, size_t capacity);
+
+    EventStream(const EventStream&) = delete;
+    EventStream& operator=(const EventStream&) = delete;
+
+    /**
+     * @brief Publishes that the engine took an order
+     *
+     * @param orderId Id of the order
+     * @param trader Id of the trader that sent it
+     * @param type Order type
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price or limit; the stop of a stop order
+     */
+    void ack(uint64_t orderId, uint32_t trader, OrderType type, bool isBuy, double price);
+
+    /**
+     * @brief Publishes the outcome of an order
+     *
+     * @param report Execution report sent to the trader
+     */
+    void execution(const ExecutionReport& report);
+
+    /**
+     * @brief Publishes a bar
+     *
+     * @param bar Bar published by a market
+     */
+    void price(const StockData& bar);
+
+    /**
+     * @brief Gets the stream id
+     */
+    uint16_t id() const;
+
+    /**
+     * @brief Gets the number of events published, including dropped ones
+     */
+    uint64_t published() const;
+
+    /**
+     * @brief Gets the number of events dropped because the sender fell behind
+     */
+    uint64_t dropped() const;
+
+  private:
+    friend class EventPublisher;
+
+    /**
+     * @brief Numbers, timestamps and queues an event
+     */
+    void publish(wire::EventRecord& record);
+
+    uint16_t streamId;                   ///< Id sent with every datagram
+    SpscRing<wire::EventRecord> ring;    ///< Events waiting for the sender thread
+    std::atomic<uint64_t> sequence;      ///< Sequence number of the latest event; written by the producer
+    std::atomic<uint64_t> lost;          ///< Events the ring had no room for; written by the producer
+};
+
+/**
+ * @struct EventPublisherConfig
+ * @brief Where an EventPublisher sends and how it batches
+ */
+struct EventPublisherConfig {
+    std::string host = "127.0.0.1";   ///< Destination address; 224.0.0.0 to 239.255.255.255 sends multicast
+    uint16_t port = 47000;            ///< Destination port
+    std::string interface = "127.0.0.1";  ///< Local interface multicast leaves from
+    int ttl = 0;                      ///< Multicast hops; 0 keeps datagrams on this machine
+    size_t streamCapacity = 8192;     ///< Events buffered per stream
+    std::chrono::microseconds flushInterval{200};  ///< How long the sender sleeps once it has sent everything
+};
+
+/**
+ * @struct EventPublisherStats
+ * @brief Counters of an EventPublisher
+ */
+struct EventPublisherStats {
+    uint64_t events = 0;      ///< Events handed to the socket
+    uint64_t datagrams = 0;   ///< Datagrams sent
+    uint64_t dropped = 0;     ///< Events dropped by streams whose ring was full
+    uint64_t sendErrors = 0;  ///< Datagrams the socket refused
+};
+
+/**
+ * @class EventPublisher
+ * @brief Sends the events of its streams as UDP datagrams
+ *
+ * The sender thread wakes every flush interval and sends every waiting
+ * event in datagrams of whole records, up to 64 datagrams per sendmmsg()
+ * call, so under load events leave in full datagrams and when idle none
+ * waits longer than the interval. Symbol names are looked up on the
+ * sender thread; producers only copy the bar.
+ */
+class EventPublisher {
+  public:
+    /// Most streams one publisher carries
+    static constexpr size_t kMaxStreams = 256;
+
+    /**
+     * @brief Opens the socket and starts the sender thread
+     *
+     * @param config Destination and batching
+     */
+    explicit EventPublisher(const EventPublisherConfig& config = EventPublisherConfig());
+
+    /**
+     * @brief Sends every event queued, then stops the sender thread
+     */
+    ~EventPublisher();
+
+    EventPublisher(const EventPublisher&) = delete;
+    EventPublisher& operator=(const EventPublisher&) = delete;
+
+    /**
+     * @brief Checks whether the socket could be opened
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Adds a stream for one producer
+     *
+     * Safe to call from any thread while the publisher runs.
+     *
+     * @return The stream, owned by the publisher; nullptr if closed or kMaxStreams are open
+     */
+    EventStream* openStream();
+
+    /**
+     * @brief Blocks until every event published so far has been sent
+     */
+    void flush();
+
+    /**
+     * @brief Gets a snapshot of the counters
+     */
+    EventPublisherStats stats() const;
+
+  private:
+    /**
+     * @brief Sender thread loop
+     */
+    void run();
+
+    /**
+     * @brief Sends what the streams hold
+     *
+     * @return Events sent
+     */
+    size_t sendPending();
+
+    EventPublisherConfig config;     ///< Destination and batching
+    int fd;                          ///< UDP socket, or -1
+    std::array<std::unique_ptr<EventStream>, kMaxStreams> streams;  ///< Streams; the first `opened` are set
+    std::mutex openMutex;            ///< Serializes openStream()
+    std::atomic<size_t> opened;      ///< Streams published to the sender thread
+    std::atomic<uint64_t> passes;    ///< Times the sender went through every stream, for flush()
+    std::atomic<bool> stopSending;   ///< Asks the sender to drain and exit
+    std::atomic<uint64_t> sentEvents;    ///< Events sent
+    std::atomic<uint64_t> sentDatagrams; ///< Datagrams sent
+    std::atomic<uint64_t> failedSends;   ///< Datagrams the socket refused
+    std::vector<char> datagrams;     ///< Datagrams being filled, kMaxDatagram bytes apart; sender thread only
+    std::thread sender;              ///< Thread sending datagrams
+};
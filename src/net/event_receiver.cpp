@@ -0,0 +1,198 @@
+#include "event_receiver.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Datagrams taken per recvmmsg() call
+constexpr size_t kDatagramsPerRead = 64;
+
+constexpr int kReceiveBufferBytes = 8 << 20;
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+EventReceiver::EventReceiver()
+: fd(-1), boundPort(0), buffers(kDatagramsPerRead * wire::kMaxDatagram) {}
+
+EventReceiver::~EventReceiver() {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+bool EventReceiver::listen(const std::string& host, uint16_t port, const std::string& interface) {
+  in_addr group;
+  if (inet_pton(AF_INET, host.c_str(), &group) != 1) {
+    std::cerr << "Invalid event feed address " << host << "\n";
+    return false;
+  }
+  bool multicast = IN_MULTICAST(ntohl(group.s_addr));
+
+  int socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (socketFd < 0) {
+    std::cerr << "Cannot open event feed socket: " << std::strerror(errno) << "\n";
+    return false;
+  }
+  int one = 1;
+  if (multicast) {
+    setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  }
+  setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &kReceiveBufferBytes, sizeof(kReceiveBufferBytes));
+
+  // A group is joined on the interface but bound by address, so only its
+  // datagrams reach this socket
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr = group;
+  bool bound = bind(socketFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+  if (bound && multicast) {
+    ip_mreq membership;
+    membership.imr_multiaddr = group;
+    bound = inet_pton(AF_INET, interface.c_str(), &membership.imr_interface) == 1
+            && setsockopt(socketFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == 0;
+  }
+  socklen_t length = sizeof(address);
+  if (!bound || getsockname(socketFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+    std::cerr << "Cannot listen to event feed " << host << ":" << port << ": " << std::strerror(errno) << "\n";
+    ::close(socketFd);
+    return false;
+  }
+
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  fd = socketFd;
+  boundPort = ntohs(address.sin_port);
+  return true;
+}
+
+uint16_t EventReceiver::port() const {
+  return boundPort;
+}
+
+int EventReceiver::poll(int timeoutMs) {
+  if (fd < 0) {
+    return -1;
+  }
+  pollfd wait{fd, POLLIN, 0};
+  int ready = ::poll(&wait, 1, timeoutMs);
+  if (ready < 0) {
+    return errno == EINTR ? 0 : -1;
+  }
+  if (ready == 0) {
+    return 0;
+  }
+
+  iovec vectors[kDatagramsPerRead];
+  mmsghdr headers[kDatagramsPerRead];
+  for (size_t i = 0; i < kDatagramsPerRead; ++i) {
+    vectors[i] = {buffers.data() + i * wire::kMaxDatagram, wire::kMaxDatagram};
+    std::memset(&headers[i], 0, sizeof(headers[i]));
+    headers[i].msg_hdr.msg_iov = &vectors[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int handled = 0;
+  while (true) {
+    int received = recvmmsg(fd, headers, kDatagramsPerRead, MSG_DONTWAIT, nullptr);
+    if (received < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return handled;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    int64_t now = steadyNanos();
+    for (int i = 0; i < received; ++i) {
+      handled += handleDatagram(buffers.data() + i * wire::kMaxDatagram, headers[i].msg_len, now);
+    }
+  }
+}
+
+int EventReceiver::handleDatagram(const char* data, size_t size, int64_t now) {
+  wire::EventPacketHeader header;
+  if (size < sizeof(header)) {
+    counters.malformed += 1;
+    return 0;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != wire::kEventMagic || size != sizeof(header) + header.count * sizeof(wire::EventRecord)) {
+    counters.malformed += 1;
+    return 0;
+  }
+
+  counters.datagrams += 1;
+  counters.wireLatency.record(now - header.sendTime);
+  if (header.stream >= lastSequence.size()) {
+    lastSequence.resize(header.stream + 1, 0);
+  }
+  uint64_t& last = lastSequence[header.stream];
+  if (last == 0) {
+    counters.streams += 1;
+  }
+
+  for (uint16_t i = 0; i < header.count; ++i) {
+    wire::EventRecord record;
+    std::memcpy(&record, data + sizeof(header) + i * sizeof(record), sizeof(record));
+    // The first record heard from a stream sets its position, so joining
+    // late is not a gap; a stream starting over is a new publisher
+    if (record.sequence == 1 && last != 0) {
+      counters.restarts += 1;
+      last = 0;
+    }
+    if (last != 0 && record.sequence > last + 1) {
+      counters.missed += record.sequence - last - 1;
+    }
+    if (record.sequence > last) {
+      last = record.sequence;
+    } else {
+      counters.late += 1;
+    }
+    counters.events += 1;
+    counters.eventLatency.record(now - record.time);
+    if (record.type == wire::EventType::Ack) {
+      counters.acks += 1;
+    } else if (record.type == wire::EventType::Execution) {
+      counters.executions += 1;
+    } else if (record.type == wire::EventType::Price) {
+      counters.prices += 1;
+    }
+    if (recordHandler) {
+      recordHandler(header.stream, record);
+    }
+  }
+  return header.count;
+}
+
+void EventReceiver::setHandler(std::function<void(uint16_t, const wire::EventRecord&)> handler) {
+  recordHandler = std::move(handler);
+}
+
+const EventReceiverStats& EventReceiver::stats() const {
+  return counters;
+}
+
+void EventReceiver::resetStats() {
+  size_t streams = counters.streams;
+  counters = EventReceiverStats();
+  counters.streams = streams;
+}
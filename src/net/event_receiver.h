@@ -0,0 +1,117 @@
+/**
+ * @file event_receiver.h
+ * @brief Receiving end of the engine event feed
+ *
+ * This file defines EventReceiver, which listens for the datagrams of an
+ * EventPublisher, checks every stream's sequence numbers for gaps and
+ * measures how long events took to arrive. It backs the feed monitor tool
+ * and the event feed benchmark.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "event_protocol.h"
+#include "../core/latency_histogram.h"
+
+/**
+ * @struct EventReceiverStats
+ * @brief What an EventReceiver has seen
+ */
+struct EventReceiverStats {
+    uint64_t datagrams = 0;   ///< Datagrams received
+    uint64_t events = 0;      ///< Records received
+    uint64_t acks = 0;        ///< Ack records
+    uint64_t executions = 0;  ///< Execution records
+    uint64_t prices = 0;      ///< Price records
+    uint64_t missed = 0;      ///< Records skipped over in some stream's sequence
+    uint64_t late = 0;        ///< Records older than one already received: reordered or duplicated
+    uint64_t malformed = 0;   ///< Datagrams that were not whole event datagrams
+    uint64_t restarts = 0;    ///< Streams that started over from sequence 1, as when a publisher restarts
+    size_t streams = 0;       ///< Streams heard from
+    LatencyHistogram eventLatency;  ///< From the event to its receipt, batching included
+    LatencyHistogram wireLatency;   ///< From the datagram's send to its receipt
+};
+
+/**
+ * @class EventReceiver
+ * @brief Listens to an event feed on a unicast or multicast address
+ *
+ * Latencies compare the publisher's steady clock with this process's, so
+ * they are only meaningful on the publisher's machine. Not thread-safe.
+ */
+class EventReceiver {
+  public:
+    EventReceiver();
+
+    /**
+     * @brief Closes the socket
+     */
+    ~EventReceiver();
+
+    EventReceiver(const EventReceiver&) = delete;
+    EventReceiver& operator=(const EventReceiver&) = delete;
+
+    /**
+     * @brief Starts listening
+     *
+     * A multicast address is joined on the given interface; several
+     * receivers may listen to the same group and port.
+     *
+     * @param host Address the publisher sends to
+     * @param port Port the publisher sends to; 0 picks a free one
+     * @param interface Local interface to join a multicast group on
+     * @return False if the socket cannot be bound
+     */
+    bool listen(const std::string& host, uint16_t port, const std::string& interface = "127.0.0.1");
+
+    /**
+     * @brief Gets the port listened on
+     */
+    uint16_t port() const;
+
+    /**
+     * @brief Handles the datagrams that arrive within a timeout
+     *
+     * @param timeoutMs Longest wait for the first datagram; 0 only reads what is there
+     * @return Records handled, or -1 if the socket failed
+     */
+    int poll(int timeoutMs);
+
+    /**
+     * @brief Sets a callback run for every record received
+     *
+     * @param handler Called with the stream id and the record
+     */
+    void setHandler(std::function<void(uint16_t, const wire::EventRecord&)> handler);
+
+    /**
+     * @brief Gets what has been received so far
+     */
+    const EventReceiverStats& stats() const;
+
+    /**
+     * @brief Forgets the counters and latencies, but not the streams' positions
+     */
+    void resetStats();
+
+  private:
+    /**
+     * @brief Checks and counts one datagram
+     *
+     * @return Records handled
+     */
+    int handleDatagram(const char* data, size_t size, int64_t now);
+
+    int fd;                           ///< UDP socket, or -1
+    uint16_t boundPort;               ///< Port listened on
+    std::vector<uint64_t> lastSequence;  ///< Highest sequence received by stream id; 0 if none
+    std::vector<char> buffers;        ///< Receive buffers, kMaxDatagram bytes apart
+    EventReceiverStats counters;      ///< Counters and latencies
+    std::function<void(uint16_t, const wire::EventRecord&)> recordHandler;  ///< Optional callback
+};
@@ -0,0 +1,270 @@
+#include "order_client.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../trader/trader.h"
+
+namespace {
+
+constexpr size_t kReadBytes = 65536;
+
+constexpr int kUdpBufferBytes = 4 << 20;
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+OrderClient::OrderClient()
+: fd(-1), transport(Transport::Tcp), nextClientId(1), sent(0), acked(0), accepted(0), executed(0),
+  in(kReadBytes + wire::kMaxMessage), inUsed(0) {}
+
+OrderClient::~OrderClient() {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+bool OrderClient::connect(const std::string& host, uint16_t port, Transport type) {
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+    std::cerr << "Invalid gateway address " << host << "\n";
+    return false;
+  }
+
+  int socketFd = socket(AF_INET, (type == Transport::Tcp ? SOCK_STREAM : SOCK_DGRAM) | SOCK_CLOEXEC, 0);
+  if (socketFd < 0 || ::connect(socketFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    std::cerr << "Cannot connect to gateway " << host << ":" << port << ": " << std::strerror(errno) << "\n";
+    if (socketFd >= 0) {
+      ::close(socketFd);
+    }
+    return false;
+  }
+  int one = 1;
+  if (type == Transport::Tcp) {
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  } else {
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &kUdpBufferBytes, sizeof(kUdpBufferBytes));
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDBUF, &kUdpBufferBytes, sizeof(kUdpBufferBytes));
+  }
+
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  fd = socketFd;
+  transport = type;
+  inUsed = 0;
+  return true;
+}
+
+template <typename Message>
+void OrderClient::append(const Message& message) {
+  const char* bytes = reinterpret_cast<const char*>(&message);
+  out.insert(out.end(), bytes, bytes + sizeof(message));
+  sent += 1;
+}
+
+uint64_t OrderClient::sendOrder(OrderType type, bool isBuy, double price, double stopPrice) {
+  wire::NewOrderMessage message{};
+  message.header = wire::headerFor<wire::NewOrderMessage>(wire::MessageType::NewOrder);
+  message.clientOrderId = nextClientId++;
+  message.sendTime = steadyNanos();
+  message.price = price;
+  message.stopPrice = stopPrice;
+  message.orderType = static_cast<uint8_t>(type);
+  message.buy = isBuy ? 1 : 0;
+  append(message);
+  return message.clientOrderId;
+}
+
+uint64_t OrderClient::sendCancel(uint64_t orderId) {
+  wire::CancelMessage message{};
+  message.header = wire::headerFor<wire::CancelMessage>(wire::MessageType::Cancel);
+  message.clientOrderId = nextClientId++;
+  message.sendTime = steadyNanos();
+  message.orderId = orderId;
+  append(message);
+  return message.clientOrderId;
+}
+
+uint64_t OrderClient::sendReplace(uint64_t orderId, double price) {
+  wire::ReplaceMessage message{};
+  message.header = wire::headerFor<wire::ReplaceMessage>(wire::MessageType::Replace);
+  message.clientOrderId = nextClientId++;
+  message.sendTime = steadyNanos();
+  message.orderId = orderId;
+  message.price = price;
+  append(message);
+  return message.clientOrderId;
+}
+
+// A stream goes out in as few send() calls as the socket allows; datagrams
+// are cut at message boundaries and go out together through sendmmsg()
+bool OrderClient::flush() {
+  if (fd < 0) {
+    return false;
+  }
+
+  if (transport == Transport::Tcp) {
+    size_t offset = 0;
+    while (offset < out.size()) {
+      ssize_t written = send(fd, out.data() + offset, out.size() - offset, MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      offset += static_cast<size_t>(written);
+    }
+    out.clear();
+    return true;
+  }
+
+  std::vector<iovec> buffers;
+  size_t offset = 0;
+  while (offset < out.size()) {
+    size_t begin = offset;
+    while (offset < out.size()) {
+      wire::MessageHeader header;
+      std::memcpy(&header, out.data() + offset, sizeof(header));
+      if (offset + header.length - begin > wire::kMaxDatagram) {
+        break;
+      }
+      offset += header.length;
+    }
+    buffers.push_back({out.data() + begin, offset - begin});
+  }
+  std::vector<mmsghdr> headers(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    std::memset(&headers[i], 0, sizeof(headers[i]));
+    headers[i].msg_hdr.msg_iov = &buffers[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+  size_t done = 0;
+  while (done < headers.size()) {
+    int count = sendmmsg(fd, headers.data() + done, static_cast<unsigned>(headers.size() - done), 0);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    done += static_cast<size_t>(count);
+  }
+  out.clear();
+  return true;
+}
+
+int OrderClient::poll(int timeoutMs) {
+  if (fd < 0) {
+    return -1;
+  }
+  pollfd wait{fd, POLLIN, 0};
+  int ready = ::poll(&wait, 1, timeoutMs);
+  if (ready < 0) {
+    return errno == EINTR ? 0 : -1;
+  }
+  if (ready == 0) {
+    return 0;
+  }
+
+  int handled = 0;
+  while (true) {
+    ssize_t received = recv(fd, in.data() + inUsed, in.size() - inUsed, MSG_DONTWAIT);
+    if (received < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return handled;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (received == 0 && transport == Transport::Tcp) {
+      return -1;
+    }
+    inUsed += static_cast<size_t>(received);
+    ptrdiff_t used = handleMessages(in.data(), inUsed, handled);
+    if (used < 0) {
+      return -1;
+    }
+    // A datagram is whole messages; a stream may end mid-message
+    size_t left = transport == Transport::Tcp ? inUsed - static_cast<size_t>(used) : 0;
+    std::memmove(in.data(), in.data() + used, left);
+    inUsed = left;
+  }
+}
+
+ptrdiff_t OrderClient::handleMessages(const char* data, size_t size, int& handled) {
+  size_t offset = 0;
+  while (true) {
+    wire::MessageHeader header;
+    ptrdiff_t length = wire::peekMessage(data + offset, size - offset, header);
+    if (length < 0) {
+      return -1;
+    }
+    if (length == 0) {
+      return static_cast<ptrdiff_t>(offset);
+    }
+    if (header.type == wire::MessageType::Ack) {
+      wire::AckMessage ack;
+      std::memcpy(&ack, data + offset, sizeof(ack));
+      acked += 1;
+      if (ack.request == wire::MessageType::NewOrder && ack.accepted != 0) {
+        accepted += 1;
+      }
+      if (ack.sendTime > 0) {
+        latency.record(steadyNanos() - ack.sendTime);
+      }
+      if (ackHandler) {
+        ackHandler(ack);
+      }
+    } else if (header.type == wire::MessageType::Execution) {
+      wire::ExecutionMessage execution;
+      std::memcpy(&execution, data + offset, sizeof(execution));
+      executed += 1;
+      if (executionHandler) {
+        executionHandler(execution);
+      }
+    } else {
+      return -1;
+    }
+    handled += 1;
+    offset += static_cast<size_t>(length);
+  }
+}
+
+uint64_t OrderClient::unacknowledged() const {
+  return sent - acked;
+}
+
+uint64_t OrderClient::unreported() const {
+  return accepted - executed;
+}
+
+const LatencyHistogram& OrderClient::roundTrip() const {
+  return latency;
+}
+
+void OrderClient::setHandlers(std::function<void(const wire::AckMessage&)> ack,
+                              std::function<void(const wire::ExecutionMessage&)> execution) {
+  ackHandler = std::move(ack);
+  executionHandler = std::move(execution);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file order_client.h
+ * @brief Client end of the order gateway protocol
+ *
+ * This file defines OrderClient, which connects to an OrderGateway over
+ * TCP or UDP, batches requests into as few writes as possible and decodes
+ * the gateway's answers. It times every request from send to Ack, and
+ * backs the load generator used to measure the gateway.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "order_protocol.h"
+#include "../core/latency_histogram.h"
+
+enum class OrderType : uint8_t;
+
+/**
+ * @class OrderClient
+ * @brief Sends requests to an OrderGateway and receives its answers
+ *
+ * Requests are buffered until flush(). Not thread-safe; use one client per
+ * thread.
+ */
+class OrderClient {
+  public:
+    /**
+     * @enum Transport
+     * @brief Socket type used to reach the gateway
+     */
+    enum class Transport {
+      Tcp,  ///< One stream; nothing is lost
+      Udp,  ///< Datagrams of whole messages; either direction may drop some
+    };
+
+    OrderClient();
+
+    /**
+     * @brief Closes the connection
+     */
+    ~OrderClient();
+
+    OrderClient(const OrderClient&) = delete;
+    OrderClient& operator=(const OrderClient&) = delete;
+
+    /**
+     * @brief Connects to a gateway
+     *
+     * @param host IPv4 address of the gateway
+     * @param port Gateway's TCP or UDP port
+     * @param transport Socket type
+     * @return False if the connection fails
+     */
+    bool connect(const std::string& host, uint16_t port, Transport transport);
+
+    /**
+     * @brief Queues a new order
+     *
+     * @param type Order type
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price of a market order, limit of a limit or stop-limit order
+     * @param stopPrice Trigger of a stop or stop-limit order
+     * @return Client order id, echoed in the Ack
+     */
+    uint64_t sendOrder(OrderType type, bool isBuy, double price, double stopPrice = 0);
+
+    /**
+     * @brief Queues a cancel of an order by its engine id
+     *
+     * @return Client order id of the request, echoed in the Ack
+     */
+    uint64_t sendCancel(uint64_t orderId);
+
+    /**
+     * @brief Queues a price change of an order by its engine id
+     *
+     * @return Client order id of the request, echoed in the Ack
+     */
+    uint64_t sendReplace(uint64_t orderId, double price);
+
+    /**
+     * @brief Sends every queued request
+     *
+     * Blocks until the socket takes them all. The gateway stops reading
+     * from a client that leaves its answers unread, so keep the requests
+     * in flight bounded and call poll() between flushes.
+     *
+     * @return False if the connection failed
+     */
+    bool flush();
+
+    /**
+     * @brief Receives and handles the answers available
+     *
+     * @param timeoutMs Longest wait for the first answer; 0 to only take what has arrived
+     * @return Messages handled, or -1 if the connection closed or failed
+     */
+    int poll(int timeoutMs);
+
+    /**
+     * @brief Gets the number of requests sent whose Ack has not arrived
+     */
+    uint64_t unacknowledged() const;
+
+    /**
+     * @brief Gets the number of orders acknowledged whose execution has not arrived
+     */
+    uint64_t unreported() const;
+
+    /**
+     * @brief Gets the time from each request's send to its Ack, in ns
+     */
+    const LatencyHistogram& roundTrip() const;
+
+    /**
+     * @brief Sets the functions poll() calls for each answer
+     *
+     * @param ack Called for every Ack; may be empty
+     * @param execution Called for every execution; may be empty
+     */
+    void setHandlers(std::function<void(const wire::AckMessage&)> ack,
+                     std::function<void(const wire::ExecutionMessage&)> execution);
+
+  private:
+    /**
+     * @brief Decodes the whole messages at the front of a buffer
+     *
+     * @return Bytes consumed, or -1 if a message is malformed
+     */
+    ptrdiff_t handleMessages(const char* data, size_t size, int& handled);
+
+    template <typename Message>
+    void append(const Message& message);
+
+    int fd;                    ///< Connected socket, or -1
+    Transport transport;       ///< Socket type of fd
+    uint64_t nextClientId;     ///< Client order id of the next request
+    uint64_t sent;             ///< Requests sent
+    uint64_t acked;            ///< Acks received
+    uint64_t accepted;         ///< New orders acknowledged as accepted
+    uint64_t executed;         ///< Executions received
+    std::vector<char> out;     ///< Requests not yet sent
+    std::vector<char> in;      ///< Bytes received and not yet handled
+    size_t inUsed;             ///< Bytes of in holding data
+    LatencyHistogram latency;  ///< Request to Ack times
+    std::function<void(const wire::AckMessage&)> ackHandler;              ///< Called for every Ack, if set
+    std::function<void(const wire::ExecutionMessage&)> executionHandler;  ///< Called for every execution, if set
+};
@@ -0,0 +1,661 @@
+#include "order_gateway.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "order_protocol.h"
+#include "../core/engine.h"
+#include "../core/spsc_ring.h"
+#include "../trader/trader.h"
+
+namespace {
+
+// Datagrams taken from the UDP socket per recvmmsg() call
+constexpr size_t kDatagramBatch = 64;
+
+// Output a connection may have queued before the gateway stops reading from it
+constexpr size_t kMaxPendingOutput = size_t(1) << 20;
+
+// Kernel buffer asked for on the UDP socket, so bursts are not dropped
+constexpr int kUdpBufferBytes = 4 << 20;
+
+// Least time between two sweeps for idle UDP peers
+constexpr int64_t kEvictionIntervalNanos = 1000000000;
+
+// Empty polls spent spinning for reports before waiting in 1 ms steps
+constexpr unsigned kSpinPolls = 256;
+
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t peerKey(const sockaddr_in& address) {
+  return (uint64_t(address.sin_addr.s_addr) << 16) | address.sin_port;
+}
+
+bool parseAddress(const std::string& host, uint16_t port, sockaddr_in& address) {
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  return inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1;
+}
+
+// Binds a non-blocking socket and reports the port it got
+int bindSocket(int type, const sockaddr_in& address, uint16_t& bound) {
+  int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in local;
+  socklen_t length = sizeof(local);
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+      || getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) != 0) {
+    int saved = errno;
+    ::close(fd);
+    errno = saved;
+    return -1;
+  }
+  bound = ntohs(local.sin_port);
+  return fd;
+}
+
+}  // namespace
+
+/**
+ * @class GatewaySession
+ * @brief One client of the gateway, trading as its own Trader
+ *
+ * Touched only by the network thread. Reports reach it through the
+ * trader's mailbox and are turned into messages as they are polled.
+ */
+class GatewaySession : public Trader {
+  public:
+    GatewaySession(int socket, const sockaddr_in& address, GatewayStats& stats)
+    : fd(socket), peer(address), inUsed(0), outSent(0), events(0), lastSeen(0), broken(false), counters(stats) {}
+
+    void notify(double) override {}
+
+    void onExecution(const ExecutionReport& report) override {
+      open.erase(report.orderId);
+      wire::ExecutionMessage message{};
+      message.header = wire::headerFor<wire::ExecutionMessage>(wire::MessageType::Execution);
+      message.orderId = report.orderId;
+      message.price = report.price;
+      message.filledQuantity = report.filledQuantity;
+      message.status = static_cast<uint8_t>(report.status);
+      message.reason = static_cast<uint8_t>(report.reason);
+      message.buy = report.buy ? 1 : 0;
+      append(message);
+      counters.executions += 1;
+    }
+
+    template <typename Message>
+    void append(const Message& message) {
+      const char* bytes = reinterpret_cast<const char*>(&message);
+      out.insert(out.end(), bytes, bytes + sizeof(message));
+    }
+
+    /**
+     * @brief Checks whether any order sent has not been reported yet
+     */
+    bool outstanding() const {
+      return pendingOrders > 0;
+    }
+
+    size_t pendingOutput() const {
+      return out.size() - outSent;
+    }
+
+    int fd;                           ///< Connection socket, or the shared UDP socket
+    sockaddr_in peer;                 ///< Client address
+    std::vector<char> in;             ///< Bytes received and not yet handled; TCP only
+    size_t inUsed;                    ///< Bytes of in holding data
+    std::vector<char> out;            ///< Messages waiting to be sent
+    size_t outSent;                   ///< Bytes of out already sent
+    uint32_t events;                  ///< epoll events watched; TCP only
+    int64_t lastSeen;                 ///< Steady time in ns of the last datagram; UDP only
+    bool broken;                      ///< Whether a send failed and the connection must close
+    std::unordered_set<uint64_t> open;  ///< Engine ids of orders not yet reported
+
+  private:
+    GatewayStats& counters;           ///< Gateway counters, guarded by its statsMutex
+};
+
+OrderGateway::OrderGateway(Engine& eng, const GatewayConfig& cfg)
+: engine(eng), config(cfg), epollFd(-1), listenFd(-1), udpFd(-1), wakeFd(-1), boundTcpPort(0), boundUdpPort(0),
+  stopping(false), nextEviction(0) {
+  config.readBytes = std::max(config.readBytes, wire::kMaxMessage);
+}
+
+OrderGateway::~OrderGateway() {
+  stop();
+}
+
+bool OrderGateway::start() {
+  if (networkThread.joinable()) {
+    return true;
+  }
+  if (engine.getMode() == EngineMode::Deterministic) {
+    std::cerr << "Order gateway needs a threaded or pooled engine\n";
+    return false;
+  }
+
+  auto fail = [this](const char* what) {
+    std::cerr << "Cannot " << what << " for the order gateway: " << std::strerror(errno) << "\n";
+    for (int* fd : {&epollFd, &listenFd, &udpFd, &wakeFd}) {
+      if (*fd >= 0) {
+        ::close(*fd);
+        *fd = -1;
+      }
+    }
+    boundTcpPort = 0;
+    boundUdpPort = 0;
+    return false;
+  };
+
+  sockaddr_in tcpAddress;
+  sockaddr_in udpAddress;
+  if (!parseAddress(config.host, config.tcpPort, tcpAddress) || !parseAddress(config.host, config.udpPort, udpAddress)) {
+    std::cerr << "Invalid order gateway address " << config.host << "\n";
+    return false;
+  }
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) {
+    return fail("create epoll instance");
+  }
+  wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd < 0) {
+    return fail("create eventfd");
+  }
+  listenFd = bindSocket(SOCK_STREAM, tcpAddress, boundTcpPort);
+  if (listenFd < 0 || listen(listenFd, SOMAXCONN) != 0) {
+    return fail("listen on TCP port");
+  }
+  if (config.udp) {
+    udpFd = bindSocket(SOCK_DGRAM, udpAddress, boundUdpPort);
+    if (udpFd < 0) {
+      return fail("bind UDP port");
+    }
+    setsockopt(udpFd, SOL_SOCKET, SO_RCVBUF, &kUdpBufferBytes, sizeof(kUdpBufferBytes));
+    setsockopt(udpFd, SOL_SOCKET, SO_SNDBUF, &kUdpBufferBytes, sizeof(kUdpBufferBytes));
+    scratch.resize(kDatagramBatch * wire::kMaxDatagram);
+  }
+
+  for (int fd : {wakeFd, listenFd, udpFd}) {
+    if (fd < 0) {
+      continue;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      return fail("watch socket");
+    }
+  }
+
+  stopping.store(false, std::memory_order_relaxed);
+  networkThread = std::thread(&OrderGateway::run, this);
+  return true;
+}
+
+void OrderGateway::stop() {
+  if (networkThread.joinable()) {
+    stopping.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+    networkThread.join();
+  }
+  for (int* fd : {&epollFd, &listenFd, &udpFd, &wakeFd}) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+uint16_t OrderGateway::tcpPort() const {
+  return boundTcpPort;
+}
+
+uint16_t OrderGateway::udpPort() const {
+  return boundUdpPort;
+}
+
+GatewayStats OrderGateway::stats() const {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return counters;
+}
+
+// Waits without a timeout while nothing is open. While orders are open their
+// reports arrive without waking epoll, so the thread polls for them: spinning
+// at first, then in 1 ms waits so resting orders do not hold a core
+void OrderGateway::run() {
+  std::vector<epoll_event> events(64);
+  std::vector<int> failed;
+  bool open = false;
+  unsigned idle = 0;
+
+  while (!stopping.load(std::memory_order_acquire)) {
+    int timeout = !open ? -1 : idle < kSpinPolls ? 0 : 1;
+    int ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeout);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Order gateway stopped: " << std::strerror(errno) << "\n";
+      break;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      failed.clear();
+      for (int i = 0; i < ready; ++i) {
+        int fd = events[i].data.fd;
+        uint32_t flags = events[i].events;
+        if (fd == wakeFd) {
+          continue;
+        }
+        if (fd == listenFd) {
+          acceptConnections();
+          continue;
+        }
+        if (fd == udpFd) {
+          readDatagrams();
+          continue;
+        }
+        auto it = connections.find(fd);
+        if (it == connections.end()) {
+          continue;
+        }
+        GatewaySession& session = *it->second;
+        bool alive = true;
+        if ((flags & EPOLLIN) != 0) {
+          alive = readConnection(session);
+        } else if ((flags & (EPOLLHUP | EPOLLERR)) != 0) {
+          alive = false;
+        }
+        if (alive && (flags & EPOLLOUT) != 0) {
+          writeConnection(session);
+        }
+        if (!alive) {
+          failed.push_back(fd);
+        }
+      }
+      for (int fd : failed) {
+        auto it = connections.find(fd);
+        if (it != connections.end()) {
+          closeConnection(*it->second);
+        }
+      }
+      open = flushSessions();
+    }
+
+    if (ready > 0) {
+      idle = 0;
+    } else if (open) {
+      backoff(idle++);
+    }
+  }
+
+  // Every order still open is cancelled, and its report collected, before
+  // the sessions it belongs to are destroyed
+  std::lock_guard<std::mutex> lock(statsMutex);
+  while (!connections.empty()) {
+    closeConnection(*connections.begin()->second);
+  }
+  for (auto& [key, session] : peers) {
+    for (uint64_t orderId : session->open) {
+      engine.cancel(orderId);
+    }
+    closing.push_back(std::move(session));
+  }
+  peers.clear();
+  engine.waitUntilIdle();
+  for (auto& session : closing) {
+    session->pollExecutions();
+  }
+  closing.clear();
+}
+
+void OrderGateway::acceptConnections() {
+  while (true) {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int fd = accept4(listenFd, reinterpret_cast<sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    // Acks are small and latency is the point; never wait to coalesce them
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    auto session = std::make_unique<GatewaySession>(fd, address, counters);
+    session->setEngine(&engine);
+    session->setBalance(config.balance);
+    session->in.resize(config.readBytes + wire::kMaxMessage);
+    session->events = EPOLLIN;
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      ::close(fd);
+      continue;
+    }
+    connections.emplace(fd, std::move(session));
+    counters.connections += 1;
+  }
+}
+
+// Whole messages are handled where they lie in the buffer; only a partial
+// message at the end is moved to the front to wait for the rest
+bool OrderGateway::readConnection(GatewaySession& session) {
+  ssize_t received = read(session.fd, session.in.data() + session.inUsed, session.in.size() - session.inUsed);
+  if (received == 0) {
+    return false;
+  }
+  if (received < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+  counters.reads += 1;
+  counters.bytesIn += static_cast<uint64_t>(received);
+  session.inUsed += static_cast<size_t>(received);
+
+  ptrdiff_t used = handleMessages(session, session.in.data(), session.inUsed);
+  if (used < 0) {
+    counters.malformed += 1;
+    return false;
+  }
+  std::memmove(session.in.data(), session.in.data() + used, session.inUsed - static_cast<size_t>(used));
+  session.inUsed -= static_cast<size_t>(used);
+  return true;
+}
+
+void OrderGateway::readDatagrams() {
+  sockaddr_in addresses[kDatagramBatch];
+  iovec buffers[kDatagramBatch];
+  mmsghdr headers[kDatagramBatch];
+  for (size_t i = 0; i < kDatagramBatch; ++i) {
+    buffers[i] = {scratch.data() + i * wire::kMaxDatagram, wire::kMaxDatagram};
+    std::memset(&headers[i], 0, sizeof(headers[i]));
+    headers[i].msg_hdr.msg_name = &addresses[i];
+    headers[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+    headers[i].msg_hdr.msg_iov = &buffers[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int received = recvmmsg(udpFd, headers, kDatagramBatch, MSG_DONTWAIT, nullptr);
+  int64_t now = steadyNanos();
+  if (received > 0 && now >= nextEviction) {
+    evictIdlePeers(now);
+  }
+  for (int i = 0; i < received; ++i) {
+    size_t size = headers[i].msg_len;
+    counters.reads += 1;
+    counters.bytesIn += size;
+
+    GatewaySession* session = findPeer(addresses[i], now);
+    if (session == nullptr) {
+      counters.peersRefused += 1;
+      continue;
+    }
+    // A datagram holds whole messages; anything else is dropped from the bad message on
+    ptrdiff_t used = handleMessages(*session, static_cast<const char*>(buffers[i].iov_base), size);
+    if ((headers[i].msg_hdr.msg_flags & MSG_TRUNC) != 0 || used != static_cast<ptrdiff_t>(size)) {
+      counters.malformed += 1;
+    }
+  }
+}
+
+GatewaySession* OrderGateway::findPeer(const sockaddr_in& address, int64_t now) {
+  auto it = peers.find(peerKey(address));
+  if (it == peers.end()) {
+    // Every peer is a Trader, so spoofed source addresses must not grow the table without end
+    if (peers.size() >= config.maxPeers && now >= nextEviction) {
+      evictIdlePeers(now);
+    }
+    if (peers.size() >= config.maxPeers) {
+      return nullptr;
+    }
+    auto session = std::make_unique<GatewaySession>(udpFd, address, counters);
+    session->setEngine(&engine);
+    session->setBalance(config.balance);
+    it = peers.emplace(peerKey(address), std::move(session)).first;
+  }
+  it->second->lastSeen = now;
+  return it->second.get();
+}
+
+// A peer with orders open, or reports not yet sent, is kept however long it is silent
+void OrderGateway::evictIdlePeers(int64_t now) {
+  int64_t idle = static_cast<int64_t>(config.peerIdleSeconds * 1e9);
+  nextEviction = now + std::min(idle, kEvictionIntervalNanos);
+  counters.peersEvicted += std::erase_if(peers, [now, idle](const auto& entry) {
+    const GatewaySession& session = *entry.second;
+    return now - session.lastSeen >= idle && !session.outstanding() && session.open.empty()
+           && session.pendingOutput() == 0;
+  });
+}
+
+ptrdiff_t OrderGateway::handleMessages(GatewaySession& session, const char* data, size_t size) {
+  size_t offset = 0;
+  while (true) {
+    wire::MessageHeader header;
+    ptrdiff_t length = wire::peekMessage(data + offset, size - offset, header);
+    if (length < 0) {
+      return -1;
+    }
+    if (length == 0) {
+      return static_cast<ptrdiff_t>(offset);
+    }
+    const char* bytes = data + offset;
+
+    wire::AckMessage ack{};
+    ack.header = wire::headerFor<wire::AckMessage>(wire::MessageType::Ack);
+    ack.request = header.type;
+    int64_t sendTime = 0;
+
+    switch (header.type) {
+      case wire::MessageType::NewOrder: {
+        wire::NewOrderMessage request;
+        std::memcpy(&request, bytes, sizeof(request));
+        ack.clientOrderId = request.clientOrderId;
+        sendTime = request.sendTime;
+        OrderType type = static_cast<OrderType>(request.orderType);
+        bool stopped = type == OrderType::Stop || type == OrderType::StopLimit;
+        bool valid = request.orderType <= static_cast<uint8_t>(OrderType::StopLimit) && request.buy <= 1
+                     && std::isfinite(request.price) && request.price > 0
+                     && (!stopped || (std::isfinite(request.stopPrice) && request.stopPrice > 0));
+        if (valid) {
+          ack.orderId = session.queueUpOrder(type, request.buy != 0, request.price, stopped ? request.stopPrice : 0);
+          ack.accepted = 1;
+          session.open.insert(ack.orderId);
+          counters.orders += 1;
+        }
+        break;
+      }
+      case wire::MessageType::Cancel: {
+        wire::CancelMessage request;
+        std::memcpy(&request, bytes, sizeof(request));
+        ack.clientOrderId = request.clientOrderId;
+        ack.orderId = request.orderId;
+        sendTime = request.sendTime;
+        // Only the session that placed an order may cancel it
+        ack.accepted = session.open.count(request.orderId) != 0 && session.cancelOrder(request.orderId) ? 1 : 0;
+        counters.cancels += 1;
+        break;
+      }
+      case wire::MessageType::Replace: {
+        wire::ReplaceMessage request;
+        std::memcpy(&request, bytes, sizeof(request));
+        ack.clientOrderId = request.clientOrderId;
+        ack.orderId = request.orderId;
+        sendTime = request.sendTime;
+        bool valid = std::isfinite(request.price) && request.price > 0 && session.open.count(request.orderId) != 0;
+        ack.accepted = valid && session.replaceOrder(request.orderId, request.price) ? 1 : 0;
+        counters.replaces += 1;
+        break;
+      }
+      default:
+        // Only the gateway sends acks and executions
+        return -1;
+    }
+
+    if (sendTime > 0) {
+      counters.wireToEngine.record(steadyNanos() - sendTime);
+    }
+    if (ack.accepted == 0) {
+      counters.refused += 1;
+    }
+    ack.sendTime = sendTime;
+    session.append(ack);
+    offset += static_cast<size_t>(length);
+  }
+}
+
+bool OrderGateway::flushSessions() {
+  bool open = false;
+  std::vector<int> broken;
+
+  for (auto& [fd, session] : connections) {
+    if (session->outstanding()) {
+      session->pollExecutions();
+    }
+    if (session->pendingOutput() > 0) {
+      writeConnection(*session);
+    }
+    if (session->broken) {
+      broken.push_back(fd);
+    }
+    open = open || session->outstanding();
+  }
+  for (int fd : broken) {
+    closeConnection(*connections.at(fd));
+  }
+
+  for (auto& [key, session] : peers) {
+    if (session->outstanding()) {
+      session->pollExecutions();
+    }
+    if (session->pendingOutput() > 0) {
+      writeDatagrams(*session);
+    }
+    open = open || session->outstanding();
+  }
+
+  // Sessions whose client left only wait for the reports of their cancels
+  for (auto& session : closing) {
+    session->pollExecutions();
+  }
+  std::erase_if(closing, [](const std::unique_ptr<GatewaySession>& session) { return !session->outstanding(); });
+  return open || !closing.empty();
+}
+
+void OrderGateway::writeConnection(GatewaySession& session) {
+  while (session.outSent < session.out.size()) {
+    ssize_t sent = send(session.fd, session.out.data() + session.outSent, session.out.size() - session.outSent,
+                        MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        session.broken = true;
+      }
+      break;
+    }
+    session.outSent += static_cast<size_t>(sent);
+  }
+  if (session.outSent == session.out.size()) {
+    session.out.clear();
+    session.outSent = 0;
+  }
+
+  // A client that stops reading stops being read, so its output stays bounded
+  size_t pending = session.pendingOutput();
+  uint32_t wanted = (pending < kMaxPendingOutput ? uint32_t(EPOLLIN) : 0u) | (pending > 0 ? uint32_t(EPOLLOUT) : 0u);
+  if (wanted != session.events && !session.broken) {
+    epoll_event event{};
+    event.events = wanted;
+    event.data.fd = session.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+    session.events = wanted;
+  }
+}
+
+void OrderGateway::writeDatagrams(GatewaySession& session) {
+  std::vector<iovec> buffers;
+  size_t offset = session.outSent;
+  size_t size = session.out.size();
+  while (offset < size) {
+    size_t begin = offset;
+    while (offset < size) {
+      wire::MessageHeader header;
+      std::memcpy(&header, session.out.data() + offset, sizeof(header));
+      if (offset + header.length - begin > wire::kMaxDatagram) {
+        break;
+      }
+      offset += header.length;
+    }
+    buffers.push_back({session.out.data() + begin, offset - begin});
+  }
+
+  std::vector<mmsghdr> headers(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    std::memset(&headers[i], 0, sizeof(headers[i]));
+    headers[i].msg_hdr.msg_name = &session.peer;
+    headers[i].msg_hdr.msg_namelen = sizeof(session.peer);
+    headers[i].msg_hdr.msg_iov = &buffers[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+  size_t done = 0;
+  while (done < headers.size()) {
+    int sent = sendmmsg(udpFd, headers.data() + done, static_cast<unsigned>(headers.size() - done), MSG_DONTWAIT);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      break;
+    }
+    done += static_cast<size_t>(sent);
+  }
+  // UDP makes no promise; what the socket will not take is lost
+  counters.dropped += headers.size() - done;
+  session.out.clear();
+  session.outSent = 0;
+}
+
+void OrderGateway::closeConnection(GatewaySession& session) {
+  int fd = session.fd;
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  for (uint64_t orderId : session.open) {
+    engine.cancel(orderId);
+  }
+  session.out.clear();
+  session.outSent = 0;
+
+  auto it = connections.find(fd);
+  if (session.outstanding()) {
+    closing.push_back(std::move(it->second));
+  }
+  connections.erase(it);
+}
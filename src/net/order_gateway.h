@@ -0,0 +1,207 @@
+/**
+ * @file order_gateway.h
+ * @brief Network order entry in front of an Engine
+ *
+ * This file defines OrderGateway, which accepts orders from other
+ * processes over TCP and UDP and submits them to an Engine. One thread
+ * drives every socket through epoll: each readable connection is drained
+ * with one large read, every whole message in the buffer is decoded in
+ * place and submitted, and the answers are written back in one call per
+ * connection. Each connection, and each UDP peer, trades as its own Trader;
+ * a UDP peer with nothing open is forgotten once it has been silent for a while.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/latency_histogram.h"
+
+class Engine;
+class GatewaySession;
+struct sockaddr_in;
+
+/**
+ * @struct GatewayConfig
+ * @brief Where an OrderGateway listens and how each session trades
+ */
+struct GatewayConfig {
+    std::string host = "127.0.0.1";  ///< Address to bind
+    uint16_t tcpPort = 0;            ///< TCP port; 0 for any free port
+    uint16_t udpPort = 0;            ///< UDP port; 0 for any free port
+    bool udp = true;                 ///< Whether to accept orders over UDP too
+    size_t readBytes = 65536;        ///< Most bytes read from a connection at once
+    double balance = 1000000;        ///< Starting balance of every session
+    double peerIdleSeconds = 60;     ///< Silence after which a UDP peer with nothing open is forgotten
+    size_t maxPeers = 4096;          ///< Most UDP peers kept; datagrams from new ones are dropped beyond it
+};
+
+/**
+ * @struct GatewayStats
+ * @brief Counters of an OrderGateway since it started
+ */
+struct GatewayStats {
+    uint64_t connections = 0;  ///< TCP connections accepted
+    uint64_t reads = 0;        ///< Reads that returned data: read() calls and datagrams
+    uint64_t bytesIn = 0;      ///< Bytes received
+    uint64_t orders = 0;       ///< New orders submitted to the engine
+    uint64_t cancels = 0;      ///< Cancels passed to the engine
+    uint64_t replaces = 0;     ///< Replaces passed to the engine
+    uint64_t refused = 0;      ///< Requests answered with a refusing Ack
+    uint64_t malformed = 0;    ///< Connections closed or datagrams dropped over a bad message
+    uint64_t executions = 0;   ///< Execution reports sent
+    uint64_t dropped = 0;      ///< Datagrams the gateway could not send
+    uint64_t peersEvicted = 0; ///< UDP peers forgotten after going idle
+    uint64_t peersRefused = 0; ///< Datagrams dropped because the peer table was full
+    LatencyHistogram wireToEngine;  ///< From the client's sendTime until the engine had the request, in ns
+};
+
+/**
+ * @class OrderGateway
+ * @brief Accepts orders over the network and submits them to an Engine
+ *
+ * The engine must run in threaded or pooled mode and outlive the gateway.
+ * Stopping the gateway, or a client disconnecting, cancels the orders its
+ * sessions still have open. Latency is measured against the clients' steady clock,
+ * so it is meaningful only for clients on the same machine.
+ */
+class OrderGateway {
+  public:
+    /**
+     * @brief Creates a gateway; nothing is bound until start()
+     *
+     * @param engine Engine orders are submitted to
+     * @param config Addresses and session settings
+     */
+    OrderGateway(Engine& engine, const GatewayConfig& config = GatewayConfig());
+
+    /**
+     * @brief Stops the gateway
+     */
+    ~OrderGateway();
+
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    /**
+     * @brief Binds the sockets and starts the network thread
+     *
+     * @return False if the engine is deterministic or a socket cannot be bound
+     */
+    bool start();
+
+    /**
+     * @brief Closes every connection, cancels open orders and joins the network thread
+     */
+    void stop();
+
+    /**
+     * @brief Gets the bound TCP port; 0 before start()
+     */
+    uint16_t tcpPort() const;
+
+    /**
+     * @brief Gets the bound UDP port; 0 before start() or with UDP off
+     */
+    uint16_t udpPort() const;
+
+    /**
+     * @brief Gets a snapshot of the counters
+     */
+    GatewayStats stats() const;
+
+  private:
+    /**
+     * @brief Network thread: waits on the sockets and serves them until stopped
+     */
+    void run();
+
+    /**
+     * @brief Accepts every pending TCP connection
+     */
+    void acceptConnections();
+
+    /**
+     * @brief Reads from a connection and handles the whole messages received
+     *
+     * @return False if the connection closed or sent a bad message
+     */
+    bool readConnection(GatewaySession& session);
+
+    /**
+     * @brief Receives a batch of datagrams and handles their messages
+     */
+    void readDatagrams();
+
+    /**
+     * @brief Finds the session of a UDP peer, creating it if there is room
+     *
+     * @return The session, or nullptr if the peer is new and maxPeers are kept
+     */
+    GatewaySession* findPeer(const sockaddr_in& address, int64_t now);
+
+    /**
+     * @brief Forgets UDP peers that have nothing open and have been silent for peerIdleSeconds
+     */
+    void evictIdlePeers(int64_t now);
+
+    /**
+     * @brief Decodes and handles the whole messages at the front of a buffer
+     *
+     * @param session Session the bytes came from
+     * @param data Received bytes
+     * @param size Number of bytes
+     * @return Bytes consumed, or -1 if a message is malformed
+     */
+    ptrdiff_t handleMessages(GatewaySession& session, const char* data, size_t size);
+
+    /**
+     * @brief Hands the reports the engine produced to their sessions and sends all pending output
+     *
+     * @return True if any session still has orders open
+     */
+    bool flushSessions();
+
+    /**
+     * @brief Writes a connection's pending output, watching for writability if it does not all fit
+     */
+    void writeConnection(GatewaySession& session);
+
+    /**
+     * @brief Sends a UDP session's pending output as datagrams of whole messages
+     */
+    void writeDatagrams(GatewaySession& session);
+
+    /**
+     * @brief Cancels a session's open orders and keeps it until their reports arrive
+     */
+    void closeConnection(GatewaySession& session);
+
+    Engine& engine;                  ///< Engine orders are submitted to
+    GatewayConfig config;            ///< Addresses and session settings
+    int epollFd;                     ///< epoll instance, or -1
+    int listenFd;                    ///< Listening TCP socket, or -1
+    int udpFd;                       ///< UDP socket, or -1
+    int wakeFd;                      ///< eventfd that wakes the network thread to stop, or -1
+    uint16_t boundTcpPort;           ///< Port listenFd is bound to
+    uint16_t boundUdpPort;           ///< Port udpFd is bound to
+    std::thread networkThread;       ///< Thread running run()
+    std::atomic<bool> stopping;      ///< Set by stop() before waking the thread
+    std::vector<char> scratch;       ///< Datagram receive buffers, owned by the network thread
+    int64_t nextEviction;            ///< Steady time in ns of the next idle peer sweep
+
+    std::unordered_map<int, std::unique_ptr<GatewaySession>> connections;  ///< TCP sessions by socket
+    std::unordered_map<uint64_t, std::unique_ptr<GatewaySession>> peers;   ///< UDP sessions by address and port
+    std::vector<std::unique_ptr<GatewaySession>> closing;  ///< Disconnected sessions with orders still open
+
+    mutable std::mutex statsMutex;   ///< Guards counters
+    GatewayStats counters;           ///< Written by the network thread
+};
@@ -0,0 +1,173 @@
+/**
+ * @file order_protocol.h
+ * @brief Binary wire format of the order gateway
+ *
+ * This file defines the messages clients exchange with an OrderGateway.
+ * Every message is a fixed-size record that starts with its length and
+ * type and is laid out exactly as it travels, in the host's little-endian
+ * byte order. A reader checks the header and copies the record out of its
+ * receive buffer in one move, with no parsing pass and no allocation.
+ * Over TCP messages follow each other in the stream; over UDP a datagram
+ * carries one or more whole messages.
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+static_assert(std::endian::native == std::endian::little, "the wire format is the host layout of a little-endian machine");
+
+namespace wire {
+
+/// Largest datagram either side sends; fits an Ethernet frame
+constexpr size_t kMaxDatagram = 1472;
+
+/**
+ * @enum MessageType
+ * @brief Kind of a message, from its header
+ */
+enum class MessageType : uint8_t {
+  NewOrder = 1,    ///< Client to gateway: place an order
+  Cancel = 2,      ///< Client to gateway: cancel an order
+  Replace = 3,     ///< Client to gateway: change an order's price
+  Ack = 16,        ///< Gateway to client: a request was accepted or refused
+  Execution = 17,  ///< Gateway to client: an order executed, was rejected or cancelled
+};
+
+/**
+ * @struct MessageHeader
+ * @brief First bytes of every message
+ */
+struct MessageHeader {
+    uint16_t length;    ///< Bytes in the whole message
+    MessageType type;   ///< Kind of message
+    uint8_t version;    ///< kVersion
+    uint32_t reserved;  ///< Zero
+};
+
+/// Protocol version carried in every header
+constexpr uint8_t kVersion = 1;
+
+/**
+ * @struct NewOrderMessage
+ * @brief Places an order of one share
+ */
+struct NewOrderMessage {
+    MessageHeader header;
+    uint64_t clientOrderId;  ///< Chosen by the client, echoed in the Ack
+    int64_t sendTime;        ///< Client's steady clock in ns when sent; 0 if not measured
+    double price;            ///< Order price of a market order, limit of a limit or stop-limit order
+    double stopPrice;        ///< Trigger of a stop or stop-limit order
+    uint8_t orderType;       ///< OrderType
+    uint8_t buy;             ///< 1 for a buy, 0 for a sell
+    uint8_t padding[6];
+};
+
+/**
+ * @struct CancelMessage
+ * @brief Cancels one of the session's orders
+ */
+struct CancelMessage {
+    MessageHeader header;
+    uint64_t clientOrderId;  ///< Chosen by the client, echoed in the Ack
+    int64_t sendTime;        ///< Client's steady clock in ns when sent; 0 if not measured
+    uint64_t orderId;        ///< Engine order id from the order's Ack
+};
+
+/**
+ * @struct ReplaceMessage
+ * @brief Changes the price of one of the session's orders
+ */
+struct ReplaceMessage {
+    MessageHeader header;
+    uint64_t clientOrderId;  ///< Chosen by the client, echoed in the Ack
+    int64_t sendTime;        ///< Client's steady clock in ns when sent; 0 if not measured
+    uint64_t orderId;        ///< Engine order id from the order's Ack
+    double price;            ///< New limit, or stop of a stop order
+};
+
+/**
+ * @struct AckMessage
+ * @brief Answers a request as soon as the engine has it
+ */
+struct AckMessage {
+    MessageHeader header;
+    uint64_t clientOrderId;  ///< Id from the request
+    int64_t sendTime;        ///< sendTime of the request, so the client can time the round trip
+    uint64_t orderId;        ///< Engine order id; 0 if a new order was refused
+    MessageType request;     ///< Type of the request answered
+    uint8_t accepted;        ///< 1 if the engine took the request
+    uint8_t padding[6];
+};
+
+/**
+ * @struct ExecutionMessage
+ * @brief Outcome of an order, sent once per order
+ */
+struct ExecutionMessage {
+    MessageHeader header;
+    uint64_t orderId;         ///< Engine order id
+    double price;             ///< Execution price, or the order price if nothing traded
+    uint32_t filledQuantity;  ///< Shares traded
+    uint8_t status;           ///< ExecutionStatus
+    uint8_t reason;           ///< RejectReason
+    uint8_t buy;              ///< 1 for a buy, 0 for a sell
+    uint8_t padding;
+};
+
+/**
+ * @brief Gets the size of a message type; 0 if the type is unknown
+ */
+constexpr size_t messageSize(MessageType type) {
+  switch (type) {
+    case MessageType::NewOrder: return sizeof(NewOrderMessage);
+    case MessageType::Cancel: return sizeof(CancelMessage);
+    case MessageType::Replace: return sizeof(ReplaceMessage);
+    case MessageType::Ack: return sizeof(AckMessage);
+    case MessageType::Execution: return sizeof(ExecutionMessage);
+  }
+  return 0;
+}
+
+/// Largest message of any type
+constexpr size_t kMaxMessage = sizeof(NewOrderMessage);
+
+/**
+ * @brief Builds the header of a message
+ */
+template <typename Message>
+MessageHeader headerFor(MessageType type) {
+  return {static_cast<uint16_t>(sizeof(Message)), type, kVersion, 0};
+}
+
+/**
+ * @brief Checks the header at the front of a buffer
+ *
+ * @param data Start of the message
+ * @param available Bytes readable from data
+ * @param header Receives the header
+ * @return Bytes in the message; 0 if more bytes are needed; -1 if the header is invalid
+ */
+inline ptrdiff_t peekMessage(const char* data, size_t available, MessageHeader& header) {
+  if (available < sizeof(MessageHeader)) {
+    return 0;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  size_t size = messageSize(header.type);
+  if (size == 0 || header.length != size || header.version != kVersion) {
+    return -1;
+  }
+  return available < size ? 0 : static_cast<ptrdiff_t>(size);
+}
+
+static_assert(sizeof(MessageHeader) == 8);
+static_assert(sizeof(NewOrderMessage) == 48);
+static_assert(sizeof(CancelMessage) == 32);
+static_assert(sizeof(ReplaceMessage) == 40);
+static_assert(sizeof(AckMessage) == 40);
+static_assert(sizeof(ExecutionMessage) == 32);
+
+}  // namespace wire
@@ -2,7 +2,7 @@ import yfinance as yf
 import sqlite3
 from datetime import datetime
 
-def fetch_and_store_stock_data(symbol, start_date, end_date, database_path='stock_data.db'):
+def fetch_and_store_stock_data(symbol, start_date, end_date, database_path='stock_data.db', interval='1d'):
     # Connect to SQLite database
     conn = sqlite3.connect(database_path)
     cursor = conn.cursor()
@@ -11,12 +11,13 @@ def fetch_and_store_stock_data(symbol, start_date, end_date, database_path='stoc
     cursor.execute('''
         CREATE TABLE IF NOT EXISTS stock_data (
             symbol TEXT,
-            date TEXT PRIMARY KEY,
+            date TEXT,
             open REAL,
             high REAL,
             low REAL,
             close REAL,
-            volume INTEGER
+            volume INTEGER,
+            PRIMARY KEY (symbol, date)
         )
     ''')
 
@@ -36,30 +37,47 @@ def fetch_and_store_stock_data(symbol, start_date, end_date, database_path='stoc
 
     print(f"Downloading data for {symbol} from {start_date} to {end_date}")
     # Fetch stock data from Yahoo Finance
-    stock_data = yf.download(symbol, start=start_date, end=end_date)
+    stock_data = yf.download(symbol, start=start_date, end=end_date, interval=interval)
+
+    # Intraday rows keep their UTC time after the date; daily rows are dates only
+    intraday = interval not in ('1d', '5d', '1wk', '1mo', '3mo')
+    if intraday and stock_data.index.tz is not None:
+        stock_data.index = stock_data.index.tz_convert('UTC')
+
+    # yfinance returns one column per ticker under each field name
+    def column(name):
+        values = stock_data[name]
+        return values.iloc[:, 0] if values.ndim == 2 else values
+
+    dates = stock_data.index.strftime('%Y-%m-%d %H:%M:%S' if intraday else '%Y-%m-%d')
+    rows = zip(
+        (symbol for _ in dates),
+        dates,
+        column('Open').astype(float),
+        column('High').astype(float),
+        column('Low').astype(float),
+        column('Close').astype(float),
+        (int(volume) for volume in column('Volume'))
+    )
+
+    # The write-ahead log keeps the file consistent without syncing during the load
+    cursor.execute('PRAGMA journal_mode=WAL')
+    cursor.execute('PRAGMA synchronous=OFF')
 
     # Begin transaction
     cursor.execute('BEGIN TRANSACTION')
 
     try:
-        # Insert or replace stock data into the database
-        for index, row in stock_data.iterrows():
-            date_str = index.strftime('%Y-%m-%d')
-            cursor.execute('''
-                INSERT OR REPLACE INTO stock_data
-                VALUES (?, ?, ?, ?, ?, ?, ?)
-            ''', (
-                symbol,
-                date_str,
-                float(row['Open'].iloc[0]),
-                float(row['High'].iloc[0]),
-                float(row['Low'].iloc[0]),
-                float(row['Close'].iloc[0]),
-                int(row['Volume'].iloc[0])
-            ))
+        # Insert or replace stock data into the database in one call
+        cursor.executemany('''
+            INSERT OR REPLACE INTO stock_data
+            VALUES (?, ?, ?, ?, ?, ?, ?)
+        ''', rows)
 
         # Commit the transaction
         conn.commit()
+        cursor.execute('PRAGMA synchronous=NORMAL')
+        cursor.execute('PRAGMA wal_checkpoint(TRUNCATE)')
         print(f"Successfully stored data for {symbol}")
     except Exception as e:
         # Rollback in case of error
@@ -0,0 +1,202 @@
+#include "coroutine_strategy.h"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <new>
+#include <utility>
+
+namespace {
+
+// Frames are pooled in 64-byte size classes up to 2 KB; larger ones use the heap
+constexpr size_t kFrameGranularity = 64;
+constexpr size_t kFrameClasses = 32;
+
+/**
+ * @struct FramePool
+ * @brief Free lists of coroutine frames, one per size class
+ *
+ * A freed frame stores the next free frame of its class in its first
+ * bytes, so the pool itself never allocates.
+ */
+struct FramePool {
+    std::array<void*, kFrameClasses> free{};  ///< Head of each class's free list
+
+    ~FramePool() {
+      for (void*& head : free) {
+        while (head != nullptr) {
+          void* next = *static_cast<void**>(head);
+          ::operator delete(head);
+          head = next;
+        }
+      }
+    }
+};
+
+thread_local FramePool framePool;
+
+inline size_t frameClass(size_t size) {
+  return (size + kFrameGranularity - 1) / kFrameGranularity - 1;
+}
+
+}  // namespace
+
+void* allocateFrame(size_t size) {
+  size_t sizeClass = frameClass(size);
+  if (sizeClass >= kFrameClasses) {
+    return ::operator new(size);
+  }
+  void*& head = framePool.free[sizeClass];
+  if (head != nullptr) {
+    void* frame = head;
+    head = *static_cast<void**>(frame);
+    return frame;
+  }
+  return ::operator new((sizeClass + 1) * kFrameGranularity);
+}
+
+void deallocateFrame(void* frame, size_t size) {
+  size_t sizeClass = frameClass(size);
+  if (sizeClass >= kFrameClasses) {
+    ::operator delete(frame);
+    return;
+  }
+  void*& head = framePool.free[sizeClass];
+  *static_cast<void**>(frame) = head;
+  head = frame;
+}
+
+// A strategy that throws has no one to report to; fail loudly instead
+void StrategyTask::promise_type::unhandled_exception() {
+  std::terminate();
+}
+
+StrategyTask::StrategyTask(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+
+StrategyTask::StrategyTask(StrategyTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+StrategyTask& StrategyTask::operator=(StrategyTask&& other) noexcept {
+  if (this != &other) {
+    if (handle) {
+      handle.destroy();
+    }
+    handle = std::exchange(other.handle, nullptr);
+  }
+  return *this;
+}
+
+StrategyTask::~StrategyTask() {
+  if (handle) {
+    handle.destroy();
+  }
+}
+
+bool StrategyTask::done() const {
+  return !handle || handle.done();
+}
+
+CoroutineStrategy::CoroutineStrategy() : timerSequence(0), started(false) {}
+
+CoroutineStrategy::~CoroutineStrategy() {
+  orderWaiters.clear();
+  tasks.clear();
+}
+
+/**
+ * @brief Resumes the tasks waiting on this bar
+ *
+ * Reports were handled by onBar() already, so a task sees its fill before
+ * the bar that followed it; then timers, then bar waiters. Tasks that wait
+ * for another bar while being resumed are resumed on the next one.
+ *
+ * @param newPrice The new stock price
+ */
+void CoroutineStrategy::notify(double newPrice) {
+  currentPrice = newPrice;
+  count += 1;
+
+  int64_t now = getLastBarTime();
+  while (!timers.empty() && timers.top().deadline <= now) {
+    std::coroutine_handle<> handle = timers.top().handle;
+    timers.pop();
+    handle.resume();
+  }
+
+  if (!started) {
+    started = true;
+    spawn(run());
+  }
+
+  resuming.swap(barWaiters);
+  for (std::coroutine_handle<> handle : resuming) {
+    handle.resume();
+  }
+  resuming.clear();
+
+  tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [](const StrategyTask& task) { return task.done(); }),
+              tasks.end());
+}
+
+// Reports nobody awaits, such as those of closePositions(), are ignored
+void CoroutineStrategy::onExecution(const ExecutionReport& report) {
+  if (orderWaiters.empty()) {
+    return;
+  }
+  OrderAwaiter* waiter = orderWaiters.front();
+  orderWaiters.pop_front();
+  waiter->report = report;
+  waiter->handle.resume();
+}
+
+size_t CoroutineStrategy::getTaskCount() const {
+  return static_cast<size_t>(std::count_if(tasks.begin(), tasks.end(),
+                                           [](const StrategyTask& task) { return !task.done(); }));
+}
+
+void CoroutineStrategy::spawn(StrategyTask task) {
+  // The task may spawn others and move the vector, so resume a copy of the handle
+  std::coroutine_handle<> handle = task.handle;
+  tasks.push_back(std::move(task));
+  handle.resume();
+}
+
+CoroutineStrategy::BarAwaiter CoroutineStrategy::nextBar() {
+  return {this};
+}
+
+CoroutineStrategy::TimerAwaiter CoroutineStrategy::after(int64_t delayNs) {
+  return {this, getLastBarTime() + delayNs};
+}
+
+CoroutineStrategy::OrderAwaiter CoroutineStrategy::placeBuy(double price) {
+  return {this, price, true, {}, {}};
+}
+
+CoroutineStrategy::OrderAwaiter CoroutineStrategy::placeSell(double price) {
+  return {this, price, false, {}, {}};
+}
+
+void CoroutineStrategy::BarAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  strategy->barWaiters.push_back(handle);
+}
+
+void CoroutineStrategy::TimerAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  strategy->timers.push({deadline, strategy->timerSequence++, handle});
+}
+
+// The waiter is registered before the order is sent, so a report can never
+// arrive for an order nobody is waiting on yet
+bool CoroutineStrategy::OrderAwaiter::await_suspend(std::coroutine_handle<> caller) {
+  if (strategy->orderWaiters.size() >= kMaxPendingOrders) {
+    report = ExecutionReport::single(0, 0, strategy, price, isBuy, RejectReason::TooManyOrders);
+    return false;
+  }
+  handle = caller;
+  strategy->orderWaiters.push_back(this);
+  if (isBuy) {
+    strategy->queueUpBuy(price);
+  } else {
+    strategy->queueUpSell(price);
+  }
+  return true;
+}
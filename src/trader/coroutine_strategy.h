@@ -0,0 +1,265 @@
+/**
+ * @file coroutine_strategy.h
+ * @brief Strategies written as C++20 coroutines
+ *
+ * This file defines CoroutineStrategy, a Trader whose logic is a coroutine
+ * that awaits the next bar, the fill of its own orders and timers in
+ * market time, instead of a state machine driven by notify(). Coroutines
+ * are resumed by the thread delivering bars, so a strategy needs no thread
+ * of its own, and their frames come from a per-thread pool so suspending
+ * and resuming thousands of strategies does not touch the heap.
+ */
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "trader.h"
+
+/**
+ * @brief Gets memory for a coroutine frame from the calling thread's pool
+ *
+ * @param size Frame size in bytes
+ * @return Frame memory
+ */
+void* allocateFrame(size_t size);
+
+/**
+ * @brief Returns a coroutine frame to the calling thread's pool
+ *
+ * @param frame Memory from allocateFrame()
+ * @param size Size passed to allocateFrame()
+ */
+void deallocateFrame(void* frame, size_t size);
+
+/**
+ * @class StrategyTask
+ * @brief Owning handle of a strategy coroutine
+ *
+ * A task starts suspended. Awaiting it from another task runs it and
+ * resumes the awaiting task when it finishes; CoroutineStrategy::spawn()
+ * runs it alongside the strategy's other tasks. Destroying the task
+ * destroys its frame, and with it any task it is awaiting.
+ */
+class StrategyTask {
+  public:
+    /**
+     * @struct promise_type
+     * @brief Coroutine promise; frames are allocated from the frame pool
+     */
+    struct promise_type {
+        std::coroutine_handle<> continuation;  ///< Task awaiting this one, if any
+
+        /**
+         * @struct FinalAwaiter
+         * @brief Resumes the awaiting task, if any, when the coroutine ends
+         */
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+              std::coroutine_handle<> next = handle.promise().continuation;
+              return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        StrategyTask get_return_object() {
+          return StrategyTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+
+        static void* operator new(size_t size) { return allocateFrame(size); }
+        static void operator delete(void* frame, size_t size) { deallocateFrame(frame, size); }
+    };
+
+    StrategyTask(StrategyTask&& other) noexcept;
+    StrategyTask& operator=(StrategyTask&& other) noexcept;
+    StrategyTask(const StrategyTask&) = delete;
+    StrategyTask& operator=(const StrategyTask&) = delete;
+    ~StrategyTask();
+
+    /**
+     * @brief Checks whether the coroutine has finished
+     */
+    bool done() const;
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+      handle.promise().continuation = caller;
+      return handle;
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    friend class CoroutineStrategy;
+
+    explicit StrategyTask(std::coroutine_handle<promise_type> _handle);
+
+    std::coroutine_handle<promise_type> handle;  ///< Owned coroutine
+};
+
+/**
+ * @class CoroutineStrategy
+ * @brief Trader whose logic is a coroutine resumed by market events
+ *
+ * run() starts on the first bar, and the first nextBar() it awaits
+ * completes with that bar. Each report resumes the task awaiting its order
+ * as the trader handles it: at once on the thread delivering bars, as with
+ * a deterministic Engine or a SimulationKernel, and from the mailbox before
+ * the next bar otherwise. On each bar the strategy then resumes timers that
+ * are due and every task waiting for a bar.
+ *
+ * Reports are matched to awaiting orders first in, first out, so every
+ * order must be placed through placeBuy() or placeSell(); reports nobody
+ * is waiting for, such as those of closePositions(), are ignored.
+ */
+class CoroutineStrategy : public Trader {
+  public:
+    /// Orders a strategy may await at once; further orders are rejected without being sent
+    static constexpr size_t kMaxPendingOrders = 1024;
+
+    CoroutineStrategy();
+
+    /**
+     * @brief Destroys every task, suspended or not
+     */
+    ~CoroutineStrategy() override;
+
+    /**
+     * @brief Resumes the tasks waiting on this bar
+     *
+     * @param newPrice The new stock price
+     */
+    void notify(double newPrice) final;
+
+    /**
+     * @brief Resumes the task awaiting the oldest order
+     *
+     * @param report Outcome of the order
+     */
+    void onExecution(const ExecutionReport& report) final;
+
+    /**
+     * @brief Gets the number of tasks that have not finished
+     */
+    size_t getTaskCount() const;
+
+  protected:
+    /**
+     * @struct BarAwaiter
+     * @brief Suspends until the next bar; yields its close
+     */
+    struct BarAwaiter {
+        CoroutineStrategy* strategy;  ///< Strategy delivering the bar
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        double await_resume() const noexcept { return strategy->currentPrice; }
+    };
+
+    /**
+     * @struct TimerAwaiter
+     * @brief Suspends until the first bar at or after a deadline in market time
+     */
+    struct TimerAwaiter {
+        CoroutineStrategy* strategy;  ///< Strategy delivering bars
+        int64_t deadline;             ///< Bar timestamp to wait for, in ns
+
+        bool await_ready() const noexcept { return deadline <= strategy->getLastBarTime(); }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @struct OrderAwaiter
+     * @brief Sends an order and suspends until its execution report
+     */
+    struct OrderAwaiter {
+        CoroutineStrategy* strategy;    ///< Strategy placing the order
+        double price;                   ///< Order price
+        bool isBuy;                     ///< True for a buy, false for a sell
+        ExecutionReport report{};       ///< Outcome, filled in before resuming
+        std::coroutine_handle<> handle; ///< Task to resume
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> caller);
+        ExecutionReport await_resume() const noexcept { return report; }
+    };
+
+    /**
+     * @brief The strategy's main task, started on the first bar
+     */
+    virtual StrategyTask run() = 0;
+
+    /**
+     * @brief Starts a task that runs alongside the others until it finishes
+     *
+     * @param task Task to start; runs until its first suspension before returning
+     */
+    void spawn(StrategyTask task);
+
+    /**
+     * @brief Awaits the next bar
+     *
+     * @return Awaitable yielding the bar's close
+     */
+    BarAwaiter nextBar();
+
+    /**
+     * @brief Awaits a delay in market time
+     *
+     * Measured between bar timestamps, so timers need bars delivered
+     * through onBar(), and fire on the first bar at or after the deadline.
+     *
+     * @param delayNs Delay after the latest bar, in ns
+     * @return Awaitable
+     */
+    TimerAwaiter after(int64_t delayNs);
+
+    /**
+     * @brief Sends a buy order and awaits its execution report
+     *
+     * @param price Order price
+     * @return Awaitable yielding the ExecutionReport
+     */
+    OrderAwaiter placeBuy(double price);
+
+    /**
+     * @brief Sends a sell order and awaits its execution report
+     *
+     * @param price Order price
+     * @return Awaitable yielding the ExecutionReport
+     */
+    OrderAwaiter placeSell(double price);
+
+  private:
+    /**
+     * @struct Timer
+     * @brief Task waiting for a bar time, ordered by deadline and then by arrival
+     */
+    struct Timer {
+        int64_t deadline;               ///< Bar timestamp to wait for, in ns
+        uint64_t sequence;              ///< Order the timer was set in
+        std::coroutine_handle<> handle; ///< Task to resume
+
+        bool operator>(const Timer& other) const {
+          return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    std::vector<StrategyTask> tasks;                   ///< Spawned tasks, including run()
+    std::vector<std::coroutine_handle<>> barWaiters;   ///< Tasks waiting for the next bar
+    std::vector<std::coroutine_handle<>> resuming;     ///< Bar waiters being resumed
+    std::deque<OrderAwaiter*> orderWaiters;            ///< Awaited orders, oldest first
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;  ///< Pending timers, earliest first
+    uint64_t timerSequence;                            ///< Timers set so far
+    bool started;                                      ///< Whether run() was started
+};
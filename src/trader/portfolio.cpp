@@ -117,34 +117,55 @@ void Portfolio::removeStock(double price, int quantity) {
  * @param history Whether to include trading history
  */
 void Portfolio::print(double closing, double y, std::string type, bool history) {
-  double b = 0;  // Total buy amount
-  double s = 0;  // Total sell amount
-  
   std::cout << "-------------------------------------------------\n";
-  info.updateVals(closing);
 
   std::cout << type << "'s History:\n";
-  for (const auto& pair : stockHistory) {
-    const std::string& action = pair.first;
-    const double& stockInfo = pair.second;
-    if (history) {
-      std::cout << action << ": " << stockInfo << "\n";
-    }
-    if (action == "Buy") {
-      b += stockInfo;
-    } else {
-      s += stockInfo;
+  if (history) {
+    for (const auto& pair : stockHistory) {
+      std::cout << pair.first << ": " << pair.second << "\n";
     }
   }
+
+  TradeSummary summary = summarize(closing, y);
   
-  // Calculate and display yearly return if applicable
+  // Display yearly return if applicable
   if (y > 0) {
-    std::cout << "Yearly Gain/Loss: " << (s / b) / y * 100 << "%\n";
+    std::cout << "Yearly Gain/Loss: " << summary.yearlyReturn << "%\n";
   }
 
   std::cout << "-------------------------------------------------\n";
 }
 
+/**
+ * @brief Summarizes the trading history
+ * 
+ * Updates position values to the closing price and totals the buy and
+ * sell amounts. The yearly return is only computed when y > 0.
+ * 
+ * @param closing Current closing price
+ * @param y Years of trading history
+ * @return Totals and yearly return over the history
+ */
+TradeSummary Portfolio::summarize(double closing, double y) {
+  TradeSummary summary = {0, 0, 0, 0, 0};
+  info.updateVals(closing);
+
+  for (const auto& pair : stockHistory) {
+    if (pair.first == "Buy") {
+      summary.buys += 1;
+      summary.bought += pair.second;
+    } else {
+      summary.sells += 1;
+      summary.sold += pair.second;
+    }
+  }
+
+  if (y > 0 && summary.bought > 0) {
+    summary.yearlyReturn = (summary.sold / summary.bought) / y * 100;
+  }
+  return summary;
+}
+
 /**
  * @brief Gets the total number of stocks in the portfolio
  * 
@@ -62,6 +62,21 @@ struct StockInfo {
     void updateVals(double closingPrice);
 };
 
+/**
+ * @struct TradeSummary
+ * @brief Aggregate results of a trading history
+ * 
+ * Holds the same figures Portfolio::print reports, in a form that can be
+ * written out as machine-readable results.
+ */
+struct TradeSummary {
+    int buys;             ///< Number of executed buys
+    int sells;            ///< Number of executed sells
+    double bought;        ///< Total amount spent on buys
+    double sold;          ///< Total amount received from sells
+    double yearlyReturn;  ///< Yearly gain/loss percentage (0 if no history)
+};
+
 /**
  * @class Portfolio
  * @brief Manages a collection of stock positions and trading history
@@ -112,6 +127,15 @@ class Portfolio {
      */
     void print(double closing, double y, std::string type, bool history);
 
+    /**
+     * @brief Summarizes the trading history
+     * 
+     * @param closing Current closing price
+     * @param y Years of trading history
+     * @return Totals and yearly return over the history
+     */
+    TradeSummary summarize(double closing, double y);
+
   private:
     StockInfo info;  ///< Information about the current stock position
     std::vector<std::pair<std::string, double>> stockHistory;  ///< History of stock prices
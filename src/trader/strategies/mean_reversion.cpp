@@ -9,7 +9,9 @@ MovingMean::MovingMean(double p, double _sma, double _diff, int _sig) :
 price(p), sma(_sma), diff(_diff), signal(_sig) {}
 
 // Initialize running totals and set 50-period window
-MeanReversion::MeanReversion() : sma_total(0), sma_count(0), window(50) {}
+MeanReversion::MeanReversion() : MeanReversion(50) {}
+
+MeanReversion::MeanReversion(int windowSize) : sma_total(0), sma_count(0), window(windowSize) {}
 
 void MeanReversion::notify(double newPrice) {
   currentPrice = newPrice;
@@ -50,10 +52,10 @@ void MeanReversion::updateData(double price) {
 }
 
 // Implementation checks for signal changes to generate buy/sell decisions
-// Requires 50 data points for valid signals to ensure statistical significance
+// Requires a full window of data points for valid signals to ensure statistical significance
 void MeanReversion::decideToBuyOrSell() {
-  // Need at least 50 data points for valid signals
-  if (moving_mean.size() < 50) {
+  // Need a full window of data points for valid signals
+  if (static_cast<int>(moving_mean.size()) < std::max(window, 2)) {
     return;
   }
 
@@ -54,10 +54,17 @@ struct MovingMean {
 class MeanReversion : public Trader {
   public:
     /**
-     * @brief Constructs a new MeanReversion instance
+     * @brief Constructs a new MeanReversion instance with a 50-period window
      */
     MeanReversion();
 
+    /**
+     * @brief Constructs a new MeanReversion instance with a custom window
+     * 
+     * @param windowSize Number of prices in the moving average
+     */
+    explicit MeanReversion(int windowSize);
+
     /**
      * @brief Handles new price updates
      * 
@@ -12,7 +12,11 @@ SMA::SMA(double p, double twenty, double fifty) {
 }
 
 // Initialize running totals for both short and long SMAs
-MovingAverage::MovingAverage() : sma_short_total(0), sma_short_count(0), sma_long_total(0), sma_long_count(0) {}
+MovingAverage::MovingAverage() : MovingAverage(20, 50) {}
+
+MovingAverage::MovingAverage(int shortPeriod, int longPeriod)
+: sma_short_total(0), sma_short_count(0), sma_long_total(0), sma_long_count(0),
+  short_period(shortPeriod), long_period(longPeriod) {}
 
 void MovingAverage::notify(double newPrice) {
   currentPrice = newPrice;
@@ -21,20 +25,20 @@ void MovingAverage::notify(double newPrice) {
   count += 1;
 }
 
-// Implementation maintains separate running totals for 20 and 50 period SMAs
+// Implementation maintains separate running totals for the short and long period SMAs
 // Uses a sliding window approach to efficiently update both averages
 void MovingAverage::updateData(double price) {
   double updateVal = price;
 
-  // Update 20-period SMA
-  if (sma_short_count >= 20) {
-    sma_short_total += updateVal - sma[sma.size() - 20].price;
+  // Update short-period SMA
+  if (sma_short_count >= short_period) {
+    sma_short_total += updateVal - sma[sma.size() - short_period].price;
   } else {
     sma_short_total += updateVal;
   }
 
-  // Update 50-period SMA
-  if (sma_long_count >= 50) {
+  // Update long-period SMA
+  if (sma_long_count >= long_period) {
     sma_long_total += updateVal - sma.front().price;
     sma.pop_front();
   } else {
@@ -46,24 +50,24 @@ void MovingAverage::updateData(double price) {
   
   // Add new data point with current SMAs
   sma.push_back({updateVal, 
-                sma_short_total / std::min(sma_short_count, 20), 
-                sma_long_total / std::min(sma_long_count, 50)});
+                sma_short_total / std::min(sma_short_count, short_period), 
+                sma_long_total / std::min(sma_long_count, long_period)});
 }
 
 // Implementation checks for SMA crossovers to generate trading signals
-// Requires 50 data points to ensure both SMAs are fully initialized
+// Requires a full long window to ensure both SMAs are fully initialized
 void MovingAverage::decideToBuyOrSell() {
-  // Need at least 50 data points for valid signals
-  if (sma.size() < 50) {
+  // Need a full long window for valid signals
+  if (static_cast<int>(sma.size()) < std::max(long_period, 2)) {
     return;
   }
 
-  // Check for bullish crossover (20 crosses above 50)
+  // Check for bullish crossover (short crosses above long)
   if ((sma[sma.size() - 2].sma_short < sma[sma.size() - 2].sma_long) && 
       (sma.back().sma_short >= sma.back().sma_long)) {
     queueUpBuy(sma.back().price);
   }
-  // Check for bearish crossover (20 crosses below 50)
+  // Check for bearish crossover (short crosses below long)
   else if ((sma[sma.size() - 2].sma_short > sma[sma.size() - 2].sma_long) && 
            (sma.back().sma_short <= sma.back().sma_long)) {
     queueUpSell(sma.back().price);
@@ -54,10 +54,18 @@ struct SMA {
 class MovingAverage : public Trader {
   public:
     /**
-     * @brief Constructs a new MovingAverage instance
+     * @brief Constructs a new MovingAverage instance using 20 and 50 period SMAs
      */
     MovingAverage();
 
+    /**
+     * @brief Constructs a new MovingAverage instance with custom periods
+     * 
+     * @param shortPeriod Number of prices in the short SMA
+     * @param longPeriod Number of prices in the long SMA
+     */
+    MovingAverage(int shortPeriod, int longPeriod);
+
     /**
      * @brief Handles new price updates
      * 
@@ -89,4 +97,6 @@ class MovingAverage : public Trader {
     int sma_short_count;     ///< Number of prices in short SMA
     double sma_long_total;   ///< Running total for long SMA
     int sma_long_count;      ///< Number of prices in long SMA
+    int short_period;        ///< Window size of the short SMA
+    int long_period;         ///< Window size of the long SMA
 };
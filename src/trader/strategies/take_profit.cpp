@@ -0,0 +1,60 @@
+#include "take_profit.h"
+
+#include <algorithm>
+
+TakeProfit::TakeProfit(int windowSize, double _target, int64_t holdNs)
+: total(0), window(std::max(windowSize, 1)), target(_target), hold(holdNs), positions(0), expired(false) {}
+
+// Waits for a dip, buys, and hands the position to exitPosition() until it is sold
+StrategyTask TakeProfit::run() {
+  while (true) {
+    double price = co_await nextBar();
+    if (!addPrice(price) || price >= total / window) {
+      continue;
+    }
+
+    ExecutionReport entry = co_await placeBuy(price);
+    if (entry.filled()) {
+      co_await exitPosition(entry.price);
+    }
+  }
+}
+
+// The holding period runs as its own task, so the exit loop only has to
+// check a flag on each bar
+StrategyTask TakeProfit::exitPosition(double entryPrice) {
+  positions += 1;
+  expired = false;
+  spawn(expire(positions));
+
+  while (true) {
+    double price = co_await nextBar();
+    addPrice(price);
+    if (price < entryPrice * (1 + target) && !expired) {
+      continue;
+    }
+
+    ExecutionReport exit = co_await placeSell(price);
+    if (exit.filled()) {
+      co_return;
+    }
+  }
+}
+
+// A timer outliving its position must not cut the next one short
+StrategyTask TakeProfit::expire(uint64_t position) {
+  co_await after(hold);
+  if (position == positions) {
+    expired = true;
+  }
+}
+
+bool TakeProfit::addPrice(double price) {
+  prices.push_back(price);
+  total += price;
+  if (static_cast<int>(prices.size()) > window) {
+    total -= prices.front();
+    prices.pop_front();
+  }
+  return static_cast<int>(prices.size()) >= window;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file take_profit.h
+ * @brief Take-profit trading strategy written as a coroutine
+ * 
+ * This file defines the TakeProfit class, which buys when the price dips
+ * below its moving average and holds until a profit target is reached or
+ * a holding period expires. The whole position lifecycle is one coroutine,
+ * so entry, fill and exit read top to bottom instead of as a state machine.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+#include "../coroutine_strategy.h"
+
+/**
+ * @class TakeProfit
+ * @brief Dip-buying strategy with a profit target and a time stop
+ * 
+ * Implements a trading strategy that:
+ * - Buys when the price is below its moving average
+ * - Waits for the buy to fill
+ * - Sells once the price is a target fraction above the fill price,
+ *   or on the first bar after the holding period, whichever comes first
+ */
+class TakeProfit : public CoroutineStrategy {
+  public:
+    /**
+     * @brief Constructs a new TakeProfit instance
+     * 
+     * @param windowSize Number of prices in the moving average
+     * @param target Profit target as a fraction of the fill price
+     * @param holdNs Longest time to hold a position, in ns of market time
+     */
+    TakeProfit(int windowSize, double target, int64_t holdNs);
+
+  protected:
+    /**
+     * @brief Enters and exits positions, one at a time
+     */
+    StrategyTask run() override;
+
+  private:
+    /**
+     * @brief Holds a position until the target or the holding period is reached, then sells
+     * 
+     * @param entryPrice Fill price of the position
+     */
+    StrategyTask exitPosition(double entryPrice);
+
+    /**
+     * @brief Ends the current position's holding period after a delay
+     * 
+     * @param position Position the timer belongs to
+     */
+    StrategyTask expire(uint64_t position);
+
+    /**
+     * @brief Adds a price to the moving average
+     * 
+     * @param price The new price
+     * @return True once the window is full
+     */
+    bool addPrice(double price);
+
+    std::deque<double> prices;  ///< Prices in the moving average window
+    double total;               ///< Running total of the window
+    int window;                 ///< Size of the moving average window
+    double target;              ///< Profit target as a fraction of the fill price
+    int64_t hold;               ///< Longest holding period in ns
+    uint64_t positions;         ///< Positions opened so far
+    bool expired;               ///< Whether the current position's holding period is over
+};
@@ -3,16 +3,112 @@
 #include "portfolio.h"
 #include "../core/engine.h"
 
+#include <atomic>
+
+#include "../market/date.h"
+
+namespace {
+
+std::atomic<uint32_t> nextTraderId(1);
+
+}  // namespace
+
 // Initialize trader with $1M starting balance and no positions
-Trader::Trader() : balance(1000000), numberStocksOwn(0), count(0) {}
+Trader::Trader()
+: id(nextTraderId++), engine(nullptr), barSize(0), balance(1000000), numberStocksOwn(0), firstSeen(0),
+  lastSeen(0), seenBar(false), currentPrice(0), count(0), position(0),
+  pendingOrders(0) {}
+
+/**
+ * @brief Records when a bar happened and passes its close to notify()
+ * 
+ * @param bar Bar or tick
+ */
+void Trader::onBar(const StockData& bar) {
+  // Written only when it changes, so the engine thread reading it keeps its cached copy
+  std::thread::id self = std::this_thread::get_id();
+  if (ownThread.load(std::memory_order_relaxed) != self) {
+    ownThread.store(self, std::memory_order_relaxed);
+  }
+  receiveBar(bar);
+}
+
+// No thread compares equal to a default id, so every report is mailed
+void Trader::onSharedBar(const StockData& bar) {
+  if (ownThread.load(std::memory_order_relaxed) != std::thread::id()) {
+    ownThread.store(std::thread::id(), std::memory_order_relaxed);
+  }
+  receiveBar(bar);
+}
+
+void Trader::receiveBar(const StockData& bar) {
+  if (!seenBar) {
+    firstSeen = bar.timestamp;
+    seenBar = true;
+  }
+  lastSeen = bar.timestamp;
+  pollExecutions();
+  notify(bar.close);
+}
+
+void Trader::onExecution(const ExecutionReport&) {}
+
+void Trader::deliverExecution(const ExecutionReport& report) {
+  if (std::this_thread::get_id() == ownThread.load(std::memory_order_relaxed)) {
+    pollExecutions();
+    handleExecution(report);
+    return;
+  }
+  mailbox.push(report);
+}
+
+size_t Trader::pollExecutions() {
+  size_t handled = 0;
+  ExecutionReport report;
+  while (mailbox.tryPop(report)) {
+    handleExecution(report);
+    handled += 1;
+  }
+  return handled;
+}
+
+// A trader sending orders faster than it receives bars, or without bars at
+// all, handles its backlog before adding to it, so the mailbox stays bounded
+void Trader::catchUp() {
+  if (mailbox.backlogged()) {
+    pollExecutions();
+  }
+}
+
+void Trader::handleExecution(const ExecutionReport& report) {
+  int traded = static_cast<int>(report.filledQuantity);
+  position += report.buy ? traded : -traded;
+  pendingOrders -= 1;
+  onExecution(report);
+}
+
+int64_t Trader::getLastBarTime() {
+  return lastSeen;
+}
+
+void Trader::setBarSize(int64_t periodNs) {
+  barSize = periodNs;
+}
+
+int64_t Trader::getBarSize() {
+  return barSize;
+}
 
 /**
  * @brief Queues a buy request with the trading engine
  * 
  * @param price The price at which to execute the buy
+ * @return Id of the order
  */
-void Trader::queueUpBuy(double price) {
-  engine->processBuy(*this, price);
+uint64_t Trader::queueUpBuy(double price) {
+  catchUp();
+  pendingOrders += 1;
+  return engine->processBuy(*this, price);
 }
 
 /**
@@ -21,24 +117,45 @@ void Trader::queueUpBuy(double price) {
  * Updates balance, stock count, and portfolio when a buy is executed.
  * 
  * @param price The price at which to buy
+ * @return True if the order filled
  */
-void Trader::buy(double price) {
-  if (price > balance) {
-    return;
+bool Trader::buy(double price) {
+  // Only the executing thread writes these, so plain loads and stores suffice
+  double funds = balance.load(std::memory_order_relaxed);
+  if (price > funds) {
+    return false;
   }
 
-  balance -= price;
-  numberStocksOwn += 1;
   portfolio.addStock(price, 1);
+  balance.store(funds - price, std::memory_order_relaxed);
+  numberStocksOwn.store(numberStocksOwn.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  return true;
 }
 
 /**
  * @brief Queues a sell request with the trading engine
  * 
  * @param price The price at which to execute the sell
+ * @return Id of the order
  */
-void Trader::queueUpSell(double price) {
-  engine->processSell(*this, price);
+uint64_t Trader::queueUpSell(double price) {
+  catchUp();
+  pendingOrders += 1;
+  return engine->processSell(*this, price);
+}
+
+uint64_t Trader::queueUpOrder(OrderType type, bool isBuy, double price, double stopPrice) {
+  catchUp();
+  pendingOrders += 1;
+  return engine->processOrder(*this, type, isBuy, price, stopPrice);
+}
+
+bool Trader::cancelOrder(uint64_t orderId) {
+  return engine->cancel(orderId);
+}
+
+bool Trader::replaceOrder(uint64_t orderId, double price) {
+  return engine->replace(orderId, price);
 }
 
 /**
@@ -47,15 +164,18 @@ void Trader::queueUpSell(double price) {
  * Updates balance, stock count, and portfolio when a sell is executed.
  * 
  * @param price The price at which to sell
+ * @return True if the order filled
  */
-void Trader::sell(double price) {
-  if (numberStocksOwn <= 0) {
-    return;
+bool Trader::sell(double price) {
+  int owned = numberStocksOwn.load(std::memory_order_relaxed);
+  if (owned <= 0) {
+    return false;
   }
-  
-  balance += price;
-  numberStocksOwn -= 1;
+
   portfolio.removeStock(price, 1);
+  balance.store(balance.load(std::memory_order_relaxed) + price, std::memory_order_relaxed);
+  numberStocksOwn.store(owned - 1, std::memory_order_release);
+  return true;
 }
 
 /**
@@ -64,7 +184,7 @@ void Trader::sell(double price) {
  * @return The current balance
  */
 double Trader::getBalance() {
-  return balance;
+  return balance.load(std::memory_order_relaxed);
 }
 
 /**
@@ -73,7 +193,7 @@ double Trader::getBalance() {
  * @param bal The new balance value
  */
 void Trader::setBalance(double bal) {
-  balance = bal;
+  balance.store(bal, std::memory_order_relaxed);
 }
 
 /**
@@ -98,15 +218,73 @@ void Trader::setEngine(Engine *eng) {
  */
 void Trader::print(std::string type, bool history) {
   // Close all positions
-  for (int i = 0; i < numberStocksOwn; i++) {
-    queueUpSell(currentPrice);
-  }
+  closePositions();
   
   // Wait for all sell orders to complete
-  while (numberStocksOwn != 0) {
+  // The release store of the last sell also publishes the portfolio
+  while (numberStocksOwn.load(std::memory_order_acquire) != 0) {
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
 
-  // Print portfolio performance (assuming 252 trading days per year)
-  portfolio.print(currentPrice, count / 252.0, type, history);
-}
\ No newline at end of file
+  // Print portfolio performance
+  portfolio.print(currentPrice, yearsTraded(), type, history);
+}
+
+/**
+ * @brief Queues sell requests for every stock currently owned
+ */
+void Trader::closePositions() {
+  int owned = numberStocksOwn.load(std::memory_order_acquire);
+  for (int i = 0; i < owned; i++) {
+    queueUpSell(currentPrice);
+  }
+}
+
+/**
+ * @brief Summarizes the trader's history at the last seen price
+ * 
+ * @return Totals and yearly return of the trader's portfolio
+ */
+TradeSummary Trader::getSummary() {
+  return portfolio.summarize(currentPrice, yearsTraded());
+}
+
+// Calendar time between the first and latest bar, so intraday and daily
+// runs over the same dates annualise alike
+double Trader::yearsTraded() {
+  if (!seenBar) {
+    return count / 252.0;
+  }
+  return static_cast<double>(lastSeen - firstSeen) / kNanosPerYear;
+}
+
+/**
+ * @brief Gets the number of price updates received
+ * 
+ * @return Number of calls to notify()
+ */
+int Trader::getUpdateCount() {
+  return count;
+}
+
+/**
+ * @brief Gets the trader's process-wide id
+ * 
+ * @return The trader's id
+ */
+uint32_t Trader::getId() {
+  return id;
+}
+
+/**
+ * @brief Replaces the trader's balance and positions with recovered state
+ * 
+ * @param bal Balance to restore
+ * @param restored Portfolio rebuilt from a journal
+ */
+void Trader::restore(double bal, const Portfolio& restored) {
+  portfolio = restored;
+  balance.store(bal, std::memory_order_relaxed);
+  numberStocksOwn.store(portfolio.getNumberOfStock(), std::memory_order_release);
+  position = portfolio.getNumberOfStock();
+}
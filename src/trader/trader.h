@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -17,8 +18,95 @@
 
 #include "../market/stock_data.h"
 #include "portfolio.h"
+#include "../core/spsc_queue.h"
 
 class Engine;
+class Trader;
+
+/**
+ * @enum OrderType
+ * @brief When an order executes and at what price
+ */
+enum class OrderType : uint8_t {
+  Market,     ///< Executes when the engine reaches it
+  Limit,      ///< Rests until the price reaches its limit or better; fills at the limit or better
+  Stop,       ///< Rests until the price reaches its stop, then executes like a market order
+  StopLimit,  ///< Rests until the price reaches its stop, then becomes a limit order
+};
+
+/**
+ * @enum ExecutionStatus
+ * @brief Outcome of an order
+ */
+enum class ExecutionStatus : uint8_t {
+  Filled,           ///< Every share traded
+  PartiallyFilled,  ///< Some shares traded; orders are single shares today, so not yet produced
+  Rejected,         ///< Nothing traded; see the RejectReason
+  Cancelled,        ///< Cancelled by the trader before it executed
+};
+
+/**
+ * @enum RejectReason
+ * @brief Why an order did not fill
+ */
+enum class RejectReason : uint8_t {
+  None,               ///< The order traded
+  InsufficientFunds,  ///< A buy cost more than the trader's balance
+  NoPosition,         ///< A sell found no shares to sell
+  TooManyOrders,      ///< The trader had too many orders outstanding to send it
+  QueueFull,          ///< The engine's bounded queue had no room for it
+};
+
+/**
+ * @struct ExecutionReport
+ * @brief Outcome of an order, reported back to the trader that placed it
+ */
+struct ExecutionReport {
+    uint64_t orderId;         ///< Id the engine gave the order when it was queued; 0 if never queued
+    int64_t time;             ///< Simulated time of the report in ns; 0 outside a SimulationKernel
+    Trader* trader;           ///< Trader that placed the order
+    double price;             ///< Execution price, or the order price if nothing traded
+    uint32_t quantity;        ///< Shares ordered
+    uint32_t filledQuantity;  ///< Shares traded
+    bool buy;                 ///< True for a buy, false for a sell
+    ExecutionStatus status;   ///< Filled, partially filled or rejected
+    RejectReason reason;      ///< Why nothing traded; None unless rejected
+
+    /**
+     * @brief Checks whether any shares traded
+     */
+    bool filled() const { return filledQuantity > 0; }
+
+    /**
+     * @brief Builds the report of a single-share order that executed or was rejected
+     * 
+     * @param orderId Id of the order
+     * @param time Simulated time of the report in ns
+     * @param trader Trader that placed the order
+     * @param price Execution or order price
+     * @param buy True for a buy, false for a sell
+     * @param reason RejectReason::None if the share traded
+     */
+    static ExecutionReport single(uint64_t orderId, int64_t time, Trader* trader, double price, bool buy,
+                                  RejectReason reason) {
+      bool traded = reason == RejectReason::None;
+      return {orderId, time, trader, price, 1, traded ? 1u : 0u, buy,
+              traded ? ExecutionStatus::Filled : ExecutionStatus::Rejected, reason};
+    }
+
+    /**
+     * @brief Builds the report of a single-share order cancelled before it executed
+     * 
+     * @param orderId Id of the order
+     * @param time Simulated time of the report in ns
+     * @param trader Trader that placed the order
+     * @param price Order price at cancellation
+     * @param buy True for a buy, false for a sell
+     */
+    static ExecutionReport cancelled(uint64_t orderId, int64_t time, Trader* trader, double price, bool buy) {
+      return {orderId, time, trader, price, 1, 0, buy, ExecutionStatus::Cancelled, RejectReason::None};
+    }
+};
 
 /**
  * @class Trader
@@ -28,6 +116,12 @@ class Engine;
  * trading strategies. It manages the trader's balance, portfolio, and
  * interaction with the trading engine. Derived classes must implement
  * the notify() method to define their specific trading logic.
+ * 
+ * State is grouped by the thread that writes it, each group on its own
+ * cache lines: the engine thread owns balance, share count and portfolio,
+ * the thread delivering bars owns prices, counters and strategy fields.
+ * The only fields crossing threads are the atomic balance and share count,
+ * and execution reports, which are passed through a mailbox.
  */
 class Trader {
   public:
@@ -48,33 +142,162 @@ class Trader {
      */
     virtual void notify(double newPrice) = 0;
 
+    /**
+     * @brief Virtual destructor for derived strategies
+     */
+    virtual ~Trader() = default;
+
+    /**
+     * @brief Receives the outcome of one of the trader's orders
+     * 
+     * Called once per order, in the order the engine executed them, always
+     * on the thread that delivers the trader's bars, after position and
+     * pendingOrders are updated. The default ignores reports.
+     * 
+     * @param report Outcome of the order
+     */
+    virtual void onExecution(const ExecutionReport& report);
+
+    /**
+     * @brief Hands the trader the report of one of its orders
+     * 
+     * Called by engines on any thread. On the thread delivering the
+     * trader's bars the report is handled at once; from any other thread it
+     * waits in the trader's mailbox for the next bar or pollExecutions().
+     * Once more than a chunk of reports is waiting, the next order the
+     * trader sends handles the backlog first, even from within notify().
+     * 
+     * @param report Outcome of the order
+     */
+    void deliverExecution(const ExecutionReport& report);
+
+    /**
+     * @brief Handles the reports waiting in the mailbox, oldest first
+     * 
+     * Must be called on the thread delivering the trader's bars; onBar()
+     * calls it before notify().
+     * 
+     * @return Number of reports handled
+     */
+    size_t pollExecutions();
+
+    /**
+     * @brief Delivers a bar at the trader's resolution
+     * 
+     * Records when the bar happened, so returns are annualised over the time
+     * actually traded, handles the reports that arrived since the last bar,
+     * then passes the close to notify(). The calling thread becomes the
+     * trader's own thread, on which reports are handled.
+     * 
+     * @param bar Bar or tick
+     */
+    void onBar(const StockData& bar);
+
+    /**
+     * @brief Delivers a bar from whichever thread is free to deliver it
+     * 
+     * Like onBar(), but no thread becomes the trader's own: every report
+     * waits in the mailbox until the next bar. Used by markets that deliver
+     * a tick to several traders at once on different threads; deliveries to
+     * one trader must still happen one after another.
+     * 
+     * @param bar Bar or tick
+     */
+    void onSharedBar(const StockData& bar);
+
+    /**
+     * @brief Subscribes to bars of a given length
+     * 
+     * Markets aggregate their stream to this size before delivering it.
+     * Set before the trader is added to a market.
+     * 
+     * @param periodNs Bar length in ns; 0 (default) for the stream as delivered
+     */
+    void setBarSize(int64_t periodNs);
+
+    /**
+     * @brief Gets the timestamp of the latest bar delivered through onBar()
+     * 
+     * @return Nanoseconds since the epoch; 0 before the first bar
+     */
+    int64_t getLastBarTime();
+
+    /**
+     * @brief Gets the subscribed bar length
+     * 
+     * @return Bar length in ns; 0 for the stream as delivered
+     */
+    int64_t getBarSize();
+
     /**
      * @brief Queues a buy request with the trading engine
      * 
      * @param price The price at which to execute the buy
+     * @return Id of the order, for cancelOrder() and replaceOrder()
      */
-    void queueUpBuy(double price);
+    uint64_t queueUpBuy(double price);
 
     /**
      * @brief Queues a sell request with the trading engine
      * 
      * @param price The price at which to execute the sell
+     * @return Id of the order, for cancelOrder() and replaceOrder()
+     */
+    uint64_t queueUpSell(double price);
+
+    /**
+     * @brief Queues an order of any type with the trading engine
+     * 
+     * Limit, stop and stop-limit orders rest in the engine until the
+     * market reaches their price, and are reported when they execute or
+     * are cancelled.
+     * 
+     * @param type Order type
+     * @param isBuy True for a buy, false for a sell
+     * @param price Order price of a market order, limit of a limit or stop-limit order
+     * @param stopPrice Trigger of a stop or stop-limit order
+     * @return Id of the order, for cancelOrder() and replaceOrder()
+     */
+    uint64_t queueUpOrder(OrderType type, bool isBuy, double price, double stopPrice = 0);
+
+    /**
+     * @brief Cancels one of the trader's orders that has not executed yet
+     * 
+     * A cancelled order still gets an ExecutionReport, with status
+     * Cancelled, in its place among the trader's reports.
+     * 
+     * @param orderId Id returned when the order was queued
+     * @return True if the order will not execute; false if it already has
+     */
+    bool cancelOrder(uint64_t orderId);
+
+    /**
+     * @brief Changes the price of one of the trader's orders that has not executed yet
+     * 
+     * The order keeps its id and its place in the queue. A resting order
+     * is checked against the market again and loses its priority.
+     * 
+     * @param orderId Id returned when the order was queued
+     * @param price New order price: the limit, or the stop of a stop order
+     * @return True if the order will execute at the new price; false if it already executed
      */
-    void queueUpSell(double price);
+    bool replaceOrder(uint64_t orderId, double price);
 
     /**
      * @brief Executes a buy order
      * 
      * @param price The price at which to buy
+     * @return True if the order filled, false if funds were insufficient
      */
-    void buy(double price);
+    bool buy(double price);
 
     /**
      * @brief Executes a sell order
      * 
      * @param price The price at which to sell
+     * @return True if the order filled, false if no stock was owned
      */
-    void sell(double price);
+    bool sell(double price);
 
     /**
      * @brief Gets the current balance
@@ -104,14 +327,93 @@ class Trader {
      * @param history Whether to include trading history
      */
     void print(std::string type, bool history);
+
+    /**
+     * @brief Queues sell requests for every stock currently owned
+     * 
+     * The sells execute asynchronously on the engine's thread.
+     */
+    void closePositions();
+
+    /**
+     * @brief Summarizes the trader's history at the last seen price
+     * 
+     * @return Totals and yearly return of the trader's portfolio
+     */
+    TradeSummary getSummary();
+
+    /**
+     * @brief Gets the number of price updates received
+     * 
+     * @return Number of calls to notify()
+     */
+    int getUpdateCount();
+
+    /**
+     * @brief Gets the trader's process-wide id
+     * 
+     * Ids are assigned in construction order starting at 1, across every
+     * engine and backtest in the process.
+     * 
+     * @return The trader's id
+     */
+    uint32_t getId();
+
+    /**
+     * @brief Replaces the trader's balance and positions with recovered state
+     * 
+     * @param bal Balance to restore
+     * @param restored Portfolio rebuilt from a journal
+     */
+    void restore(double bal, const Portfolio& restored);
     
   private:
+    // Set before trading starts, read-only afterwards
+    uint32_t id;         ///< Process-wide trader id
     Engine *engine;      ///< Pointer to the trading engine
-    double balance;      ///< Current balance
-    int numberStocksOwn; ///< Number of stocks currently owned
-    Portfolio portfolio; ///< Portfolio of stocks
+    int64_t barSize;     ///< Subscribed bar length in ns; 0 for every tick
+
+    // Written by the thread executing orders: the engine thread in threaded mode
+    alignas(kCacheLineSize) std::atomic<double> balance;  ///< Current balance
+    std::atomic<int> numberStocksOwn;  ///< Number of stocks currently owned; published after portfolio
+    Portfolio portfolio; ///< Portfolio of stocks; read by other threads only once the engine is idle
+
+    // Written by the thread delivering bars
+    alignas(kCacheLineSize) int64_t firstSeen;  ///< Timestamp of the first bar delivered
+    int64_t lastSeen;    ///< Timestamp of the latest bar delivered
+    bool seenBar;        ///< Whether any bar was delivered through onBar()
+    std::atomic<std::thread::id> ownThread;  ///< Thread delivering bars, on which reports are handled
+
+    // Handed from the engine thread to the bar thread; the queue keeps each side on its own line
+    SpscQueue<ExecutionReport> mailbox;      ///< Reports from an engine thread, oldest first
+
+    /**
+     * @brief Handles waiting reports if a backlog has built up; called before sending an order
+     */
+    void catchUp();
+
+    /**
+     * @brief Records when a bar happened, handles waiting reports and calls notify()
+     */
+    void receiveBar(const StockData& bar);
+
+    /**
+     * @brief Updates position and pendingOrders, then calls onExecution()
+     */
+    void handleExecution(const ExecutionReport& report);
+
+    /**
+     * @brief Gets the length of the history traded, in years
+     * 
+     * Measured between the first and latest bar delivered through onBar().
+     * Traders fed through notify() alone fall back to 252 updates a year.
+     */
+    double yearsTraded();
 
   protected:
-    double currentPrice; ///< Current price of the stock
+    // Written by the thread delivering bars
+    alignas(kCacheLineSize) double currentPrice; ///< Current price of the stock
     int count;          ///< Counter for tracking operations
+    int position;       ///< Shares held according to the reports handled so far
+    int pendingOrders;  ///< Orders queued whose reports have not been handled yet
 };
@@ -0,0 +1,145 @@
+/**
+ * @file engine_queue_test.cpp
+ * @brief Checks that a bounded Engine queue reports every order in send order
+ *
+ * Each case sends orders to a deterministic engine whose queue holds two,
+ * then checks the ids its traders got reports for, in arrival order.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "core/engine.h"
+#include "trader/trader.h"
+
+namespace {
+
+// Trader that records the reports it gets
+class RecordingTrader : public Trader {
+  public:
+    void notify(double) override {}
+
+    void onExecution(const ExecutionReport& report) override {
+      reports.push_back(report);
+    }
+
+    std::vector<ExecutionReport> reports;
+};
+
+int failures = 0;
+
+void expectOrder(const std::string& name, RecordingTrader& trader, const std::vector<uint64_t>& sent) {
+  trader.pollExecutions();
+  std::vector<uint64_t> received;
+  for (const ExecutionReport& report : trader.reports) {
+    received.push_back(report.orderId);
+  }
+  if (received != sent) {
+    failures += 1;
+    std::cerr << "FAIL " << name << ": reports for";
+    for (uint64_t id : received) {
+      std::cerr << " " << id;
+    }
+    std::cerr << ", sent";
+    for (uint64_t id : sent) {
+      std::cerr << " " << id;
+    }
+    std::cerr << "\n";
+  }
+}
+
+void expectReason(const std::string& name, const ExecutionReport& report, ExecutionStatus status,
+                  RejectReason reason) {
+  if (report.status != status || report.reason != reason) {
+    failures += 1;
+    std::cerr << "FAIL " << name << ": order " << report.orderId << " has the wrong outcome\n";
+  }
+}
+
+// Buy, sell, buy: the third order finds the queue full behind an order of
+// the other side, so no policy can coalesce it
+void testPolicy(const std::string& name, QueuePolicy policy) {
+  Engine engine(EngineMode::Deterministic);
+  engine.setQueueLimit(2, policy);
+  RecordingTrader trader;
+  trader.setEngine(&engine);
+
+  std::vector<uint64_t> sent;
+  sent.push_back(trader.queueUpBuy(10.0));
+  sent.push_back(trader.queueUpSell(10.0));
+  sent.push_back(trader.queueUpBuy(10.0));
+  engine.waitUntilIdle();
+  expectOrder(name, trader, sent);
+  if (trader.reports.size() != 3) {
+    return;
+  }
+  if (policy == QueuePolicy::Reject || policy == QueuePolicy::Coalesce) {
+    expectReason(name, trader.reports[2], ExecutionStatus::Rejected, RejectReason::QueueFull);
+  } else if (policy == QueuePolicy::DropOldest) {
+    expectReason(name, trader.reports[0], ExecutionStatus::Rejected, RejectReason::QueueFull);
+  }
+}
+
+// Buys in a row: each one after the queue fills displaces the one before it
+void testCoalesceDisplaces() {
+  Engine engine(EngineMode::Deterministic);
+  engine.setQueueLimit(2, QueuePolicy::Coalesce);
+  RecordingTrader trader;
+  trader.setEngine(&engine);
+
+  std::vector<uint64_t> sent;
+  sent.push_back(trader.queueUpBuy(10.0));
+  sent.push_back(trader.queueUpBuy(10.0));
+  sent.push_back(trader.queueUpBuy(11.0));
+  sent.push_back(trader.queueUpBuy(12.0));
+  engine.waitUntilIdle();
+  expectOrder("coalesce displaces", trader, sent);
+  if (trader.reports.size() == 4) {
+    expectReason("coalesce displaces", trader.reports[1], ExecutionStatus::Cancelled, RejectReason::None);
+    expectReason("coalesce displaces", trader.reports[2], ExecutionStatus::Cancelled, RejectReason::None);
+  }
+}
+
+// A refusal waits for the trader's own earlier orders, not for other traders'
+void testTwoTraders(const std::string& name, QueuePolicy policy) {
+  Engine engine(EngineMode::Deterministic);
+  engine.setQueueLimit(2, policy);
+  RecordingTrader first;
+  RecordingTrader second;
+  first.setEngine(&engine);
+  second.setEngine(&engine);
+
+  std::vector<uint64_t> firstSent;
+  std::vector<uint64_t> secondSent;
+  firstSent.push_back(first.queueUpBuy(10.0));
+  secondSent.push_back(second.queueUpBuy(10.0));
+  firstSent.push_back(first.queueUpSell(10.0));
+  secondSent.push_back(second.queueUpSell(10.0));
+  firstSent.push_back(first.queueUpBuy(10.0));
+  engine.waitUntilIdle();
+  expectOrder(name + ", first trader", first, firstSent);
+  expectOrder(name + ", second trader", second, secondSent);
+}
+
+}  // namespace
+
+int main() {
+  testPolicy("block", QueuePolicy::Block);
+  testPolicy("reject", QueuePolicy::Reject);
+  testPolicy("drop oldest", QueuePolicy::DropOldest);
+  testPolicy("coalesce", QueuePolicy::Coalesce);
+  testCoalesceDisplaces();
+  testTwoTraders("block, two traders", QueuePolicy::Block);
+  testTwoTraders("reject, two traders", QueuePolicy::Reject);
+  testTwoTraders("drop oldest, two traders", QueuePolicy::DropOldest);
+  testTwoTraders("coalesce, two traders", QueuePolicy::Coalesce);
+
+  if (failures != 0) {
+    std::cerr << failures << " check(s) failed\n";
+    return 1;
+  }
+  std::cout << "All engine queue checks passed\n";
+  return 0;
+}